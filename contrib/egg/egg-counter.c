@@ -40,8 +40,10 @@
 G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref, egg_counter_arena_unref)
 
 #define NAME_FORMAT        "/EggCounters-%u"
-#define MAGIC              0x71167125
+#define MAGIC              0x71167126
 #define COUNTER_MAX_SHM    (1024 * 1024 * 4)
+#define MALLOC_GROUPS      16
+#define MALLOC_HISTOGRAMS  16
 #define COUNTERS_PER_GROUP 8
 #define DATA_CELL_SIZE     64
 #define CELLS_PER_INFO     (sizeof(CounterInfo) / DATA_CELL_SIZE)
@@ -49,15 +51,24 @@ G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref,
 #define CELLS_PER_GROUP(ncpu)                             \
   (((sizeof (CounterInfo) * COUNTERS_PER_GROUP) +         \
     (sizeof(EggCounterValue) * (ncpu))) / DATA_CELL_SIZE)
+#define CELLS_PER_HISTOGRAM(ncpu) \
+  ((sizeof (EggHistogramData) * (ncpu)) / DATA_CELL_SIZE)
 #define EGG_MEMORY_BARRIER __sync_synchronize()
 
+enum {
+  KIND_COUNTER,
+  KIND_HISTOGRAM,
+};
+
 typedef struct
 {
   guint cell : 29;       /* Counter groups starting cell */
   guint position : 3;    /* Index within counter group */
   gchar category[20];    /* Counter category name. */
   gchar name[32];        /* Counter name. */
-  gchar description[72]; /* Counter description */
+  gchar description[64]; /* Counter description */
+  guint32 kind;          /* KIND_COUNTER or KIND_HISTOGRAM */
+  guint32 data_cell;     /* Histogram data starting cell */
 } CounterInfo __attribute__((aligned (DATA_CELL_SIZE)));
 
 G_STATIC_ASSERT (sizeof (CounterInfo) == 128);
@@ -74,6 +85,7 @@ typedef struct
 } DataCell __attribute__((aligned (DATA_CELL_SIZE)));
 
 G_STATIC_ASSERT (sizeof (DataCell) == 64);
+G_STATIC_ASSERT (sizeof (EggHistogramData) == (17 * DATA_CELL_SIZE));
 
 typedef struct
 {
@@ -99,6 +111,8 @@ struct _EggCounterArena
   GPid      pid;
   guint     n_counters;
   GList    *counters;
+  GList    *histograms;
+  gsize     histogram_cell;
 };
 
 G_LOCK_DEFINE_STATIC (reglock);
@@ -141,6 +155,28 @@ egg_counter_reset (EggCounter *counter)
   EGG_MEMORY_BARRIER;
 }
 
+/**
+ * egg_counter_add:
+ * @counter: An #EggCounter.
+ * @count: The amount to add.
+ *
+ * Adds @count to @counter. This is the same as EGG_COUNTER_ADD(), for
+ * counters that are registered at runtime instead of with
+ * EGG_DEFINE_COUNTER().
+ */
+void
+egg_counter_add (EggCounter *counter,
+                 gint64      count)
+{
+  g_return_if_fail (counter);
+
+#ifdef EGG_COUNTER_REQUIRES_ATOMIC
+  __sync_add_and_fetch ((gint64 *)&counter->values [0], count);
+#else
+  counter->values [egg_get_current_cpu ()].value += count;
+#endif
+}
+
 static void
 _egg_counter_arena_atexit (void)
 {
@@ -159,6 +195,7 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   gpointer mem;
   unsigned pid;
   gsize size;
+  guint ncpu;
   gint page_size;
   gint fd;
   gchar name [32];
@@ -169,7 +206,6 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   if (page_size < 4096)
     {
       page_size = 4096;
-      size = page_size * 4;
       goto use_malloc;
     }
 
@@ -179,8 +215,11 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
    * We have some very tricky work ahead of us to add unlimited numbers
    * of counters at runtime. We basically need to avoid placing counters
    * that could overlap a page.
+   *
+   * Histograms are much larger than counters, so reserve the maximum size
+   * up front. Pages of the shm file are only backed once they are touched.
    */
-  size = page_size * 4;
+  size = COUNTER_MAX_SHM;
 
   arena->ref_count = 1;
   arena->is_local_arena = TRUE;
@@ -216,6 +255,7 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   arena->data_is_mmapped = TRUE;
   arena->cells = mem;
   arena->n_cells = (size / DATA_CELL_SIZE);
+  arena->histogram_cell = arena->n_cells;
   arena->data_length = size;
 
   header = mem;
@@ -237,9 +277,21 @@ use_malloc:
   g_warning ("Failed to allocate shared memory for counters. "
              "Counters will not be available to external processes.");
 
+  /*
+   * Nothing outside this process can read a malloc'd arena, so there is no
+   * reason to reserve the full shm size. Make room for a fixed number of
+   * counter groups and histograms; anything past that gets its own
+   * allocation at registration time.
+   */
+  ncpu = g_get_num_processors ();
+  size = (CELLS_PER_HEADER +
+          (MALLOC_GROUPS * CELLS_PER_GROUP (ncpu)) +
+          (MALLOC_HISTOGRAMS * CELLS_PER_HISTOGRAM (ncpu))) * DATA_CELL_SIZE;
+  size = (size + page_size - 1) / page_size * page_size;
+
   arena->data_is_mmapped = FALSE;
-  arena->cells = g_malloc0 (size << 1);
   arena->n_cells = (size / DATA_CELL_SIZE);
+  arena->histogram_cell = arena->n_cells;
   arena->data_length = size;
 
   /*
@@ -247,12 +299,14 @@ use_malloc:
    * malloc. Since we are at least a page size, we should pretty much
    * be guaranteed this, but better to check with posix_memalign().
    */
-  if (posix_memalign ((void *)&arena->cells, page_size, size << 1) != 0)
+  if (posix_memalign ((void *)&arena->cells, page_size, size) != 0)
     {
       perror ("posix_memalign()");
       abort ();
     }
 
+  memset (arena->cells, 0, size);
+
   header = (void *)arena->cells;
   header->magic = MAGIC;
   header->ncpu = g_get_num_processors ();
@@ -336,7 +390,24 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
 
       info = &(((CounterInfo *)&arena->cells[group_start_cell])[position]);
 
-      counter = g_new0 (EggCounter, 1);
+      if (info->kind == KIND_HISTOGRAM)
+        {
+          EggHistogram *histogram;
+
+          if (info->data_cell + CELLS_PER_HISTOGRAM (ncpu) > arena->n_cells)
+            goto failure;
+
+          histogram = g_new0 (EggHistogram, 1);
+          histogram->data = (EggHistogramData *)(gpointer)&arena->cells [info->data_cell];
+          counter = &histogram->counter;
+          arena->histograms = g_list_prepend (arena->histograms, histogram);
+        }
+      else
+        {
+          counter = g_new0 (EggCounter, 1);
+          arena->counters = g_list_prepend (arena->counters, counter);
+        }
+
       counter->category = g_strndup (info->category, sizeof info->category);
       counter->name = g_strndup (info->name, sizeof info->name);
       counter->description = g_strndup (info->description, sizeof info->description);
@@ -347,8 +418,6 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
                info->cell, info->position, info->category, info->name, counter->values,
                (guint8*)counter->values - (guint8*)mem);
 #endif
-
-      arena->counters = g_list_prepend (arena->counters, counter);
     }
 
   close (fd);
@@ -391,6 +460,7 @@ _egg_counter_arena_destroy (EggCounterArena *arena)
     g_free (arena->cells);
 
   g_clear_pointer (&arena->counters, g_list_free);
+  g_clear_pointer (&arena->histograms, g_list_free);
 
   arena->cells = NULL;
 
@@ -448,9 +518,13 @@ egg_counter_arena_foreach (EggCounterArena       *arena,
     func (iter->data, user_data);
 }
 
-void
-egg_counter_arena_register (EggCounterArena *arena,
-                            EggCounter      *counter)
+/*
+ * Reserves a CounterInfo slot for @counter and points its values at the
+ * per-CPU data for that slot. Must be called with reglock held.
+ */
+static CounterInfo *
+_egg_counter_arena_add (EggCounterArena *arena,
+                        EggCounter      *counter)
 {
   CounterInfo *info;
   guint group;
@@ -458,19 +532,8 @@ egg_counter_arena_register (EggCounterArena *arena,
   guint position;
   guint group_start_cell;
 
-  g_return_if_fail (arena != NULL);
-  g_return_if_fail (counter != NULL);
-
-  if (!arena->is_local_arena)
-    {
-      g_warning ("Cannot add counters to a remote arena.");
-      return;
-    }
-
   ncpu = g_get_num_processors ();
 
-  G_LOCK (reglock);
-
   /*
    * Get the counter group and position within the group of the counter.
    */
@@ -481,6 +544,10 @@ egg_counter_arena_register (EggCounterArena *arena,
    * Get the starting cell for this group. Cells roughly map to cachelines.
    */
   group_start_cell = CELLS_PER_HEADER + (CELLS_PER_GROUP (ncpu) * group);
+
+  if (group_start_cell + CELLS_PER_GROUP (ncpu) > arena->histogram_cell)
+    return NULL;
+
   info = &((CounterInfo *)&arena->cells [group_start_cell])[position];
 
   g_assert (position < COUNTERS_PER_GROUP);
@@ -492,6 +559,7 @@ egg_counter_arena_register (EggCounterArena *arena,
    */
   info->cell = group_start_cell + (COUNTERS_PER_GROUP * CELLS_PER_INFO);
   info->position = position;
+  info->kind = KIND_COUNTER;
   g_snprintf (info->category, sizeof info->category, "%s", counter->category);
   g_snprintf (info->description, sizeof info->description, "%s", counter->description);
   g_snprintf (info->name, sizeof info->name, "%s", counter->name);
@@ -502,21 +570,232 @@ egg_counter_arena_register (EggCounterArena *arena,
            info->cell, info->position, info->category, info->name);
 #endif
 
-  /*
-   * Track the counter address, so we can _foreach() them.
-   */
-  arena->counters = g_list_append (arena->counters, counter);
   arena->n_counters++;
 
+  return info;
+}
+
+static void
+_egg_counter_arena_publish (EggCounterArena *arena)
+{
   /*
    * Now notify remote processes of the counter.
    */
   EGG_MEMORY_BARRIER;
   ((ShmHeader *)&arena->cells[0])->n_counters++;
+}
+
+void
+egg_counter_arena_register (EggCounterArena *arena,
+                            EggCounter      *counter)
+{
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (counter != NULL);
+
+  if (!arena->is_local_arena)
+    {
+      g_warning ("Cannot add counters to a remote arena.");
+      return;
+    }
+
+  G_LOCK (reglock);
+
+  if (_egg_counter_arena_add (arena, counter) == NULL)
+    {
+      G_UNLOCK (reglock);
+      g_warning ("No space left for counter %s/%s.", counter->category, counter->name);
+      counter->values = g_malloc0 (sizeof (EggCounterValue) * g_get_num_processors ());
+      return;
+    }
+
+  /*
+   * Track the counter address, so we can _foreach() them.
+   */
+  arena->counters = g_list_append (arena->counters, counter);
+  _egg_counter_arena_publish (arena);
+
+  G_UNLOCK (reglock);
+}
+
+void
+egg_counter_arena_register_histogram (EggCounterArena *arena,
+                                      EggHistogram    *histogram)
+{
+  CounterInfo *info;
+  gsize data_cell;
+  guint ncpu;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (histogram != NULL);
+
+  if (!arena->is_local_arena)
+    {
+      g_warning ("Cannot add histograms to a remote arena.");
+      return;
+    }
+
+  ncpu = g_get_num_processors ();
+
+  G_LOCK (reglock);
+
+  /*
+   * Bucket data is allocated from the end of the arena, growing down
+   * towards the counters.
+   */
+  data_cell = arena->histogram_cell - CELLS_PER_HISTOGRAM (ncpu);
+  arena->histogram_cell = data_cell;
+
+  if ((data_cell > arena->n_cells) ||
+      (info = _egg_counter_arena_add (arena, &histogram->counter)) == NULL)
+    {
+      arena->histogram_cell = data_cell + CELLS_PER_HISTOGRAM (ncpu);
+      G_UNLOCK (reglock);
+      g_warning ("No space left for histogram %s/%s.",
+                 histogram->counter.category, histogram->counter.name);
+      histogram->counter.values = g_malloc0 (sizeof (EggCounterValue) * ncpu);
+      histogram->data = g_malloc0 (sizeof (EggHistogramData) * ncpu);
+      return;
+    }
+
+  histogram->data = (EggHistogramData *)(gpointer)&arena->cells [data_cell];
+  info->data_cell = data_cell;
+  info->kind = KIND_HISTOGRAM;
+
+  arena->histograms = g_list_append (arena->histograms, histogram);
+  _egg_counter_arena_publish (arena);
 
   G_UNLOCK (reglock);
 }
 
+void
+egg_counter_arena_foreach_histogram (EggCounterArena         *arena,
+                                     EggHistogramForeachFunc  func,
+                                     gpointer                 user_data)
+{
+  GList *iter;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (func != NULL);
+
+  for (iter = arena->histograms; iter; iter = iter->next)
+    func (iter->data, user_data);
+}
+
+/**
+ * egg_histogram_get_buckets:
+ * @histogram: An #EggHistogram
+ * @buckets: (out) (array fixed-size=128): location for the bucket counts
+ * @sum: (out) (optional): location for the sum of all recorded values
+ *
+ * Sums the per-CPU buckets of @histogram into @buckets, which must have
+ * room for %EGG_HISTOGRAM_N_BUCKETS values.
+ *
+ * Returns: the number of recorded values.
+ */
+gint64
+egg_histogram_get_buckets (EggHistogram *histogram,
+                           gint64       *buckets,
+                           gint64       *sum)
+{
+  gint64 total = 0;
+  gint64 count = 0;
+  guint ncpu;
+  guint i;
+  guint j;
+
+  g_return_val_if_fail (histogram != NULL, 0);
+  g_return_val_if_fail (buckets != NULL, 0);
+
+  ncpu = g_get_num_processors ();
+
+  memset (buckets, 0, sizeof (gint64) * EGG_HISTOGRAM_N_BUCKETS);
+
+  EGG_MEMORY_BARRIER;
+
+  for (i = 0; i < ncpu; i++)
+    {
+      EggHistogramData *data = &histogram->data [i];
+
+      for (j = 0; j < EGG_HISTOGRAM_N_BUCKETS; j++)
+        {
+          buckets [j] += data->buckets [j];
+          count += data->buckets [j];
+        }
+
+      total += data->sum;
+    }
+
+  if (sum != NULL)
+    *sum = total;
+
+  return count;
+}
+
+/**
+ * egg_histogram_get_bucket_max:
+ * @bucket: a bucket index
+ *
+ * Gets the largest value that is recorded into @bucket.
+ */
+gint64
+egg_histogram_get_bucket_max (guint bucket)
+{
+  guint msb;
+  guint sub;
+
+  if (bucket < 8)
+    return bucket;
+
+  if (bucket >= EGG_HISTOGRAM_N_BUCKETS - 1)
+    return G_MAXINT64;
+
+  msb = bucket >> 2;
+  sub = bucket & 3;
+
+  return ((G_GINT64_CONSTANT (5) + sub) << (msb - 2)) - 1;
+}
+
+/**
+ * egg_histogram_get_percentile:
+ * @buckets: (array fixed-size=128): bucket counts
+ * @percentile: a percentile between 0 and 100
+ *
+ * Gets an upper bound for the value at @percentile within @buckets, as
+ * retrieved with egg_histogram_get_buckets(). @buckets may also be the
+ * difference between two snapshots to get the percentile over a period.
+ *
+ * Returns: the value, or -1 if @buckets is empty.
+ */
+gint64
+egg_histogram_get_percentile (const gint64 *buckets,
+                              gdouble       percentile)
+{
+  gint64 count = 0;
+  gint64 target;
+  gint64 seen = 0;
+  guint i;
+
+  g_return_val_if_fail (buckets != NULL, -1);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    count += buckets [i];
+
+  if (count == 0)
+    return -1;
+
+  target = MAX (1, (gint64)((CLAMP (percentile, 0.0, 100.0) / 100.0) * count + 0.5));
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      seen += buckets [i];
+
+      if (seen >= target)
+        return egg_histogram_get_bucket_max (i);
+    }
+
+  return egg_histogram_get_bucket_max (EGG_HISTOGRAM_N_BUCKETS - 1);
+}
+
 #ifdef __linux__
 static void *
 _egg_counter_find_getcpu_in_vdso (void)
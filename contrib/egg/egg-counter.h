@@ -58,6 +58,27 @@
  *   EGG_COUNTER_ADD (Symbol);
  *
  *
+ * Histograms
+ * ==========
+ *
+ * To track a distribution of values, such as latencies, rather than a sum,
+ * define a histogram. Values are recorded into log-linear buckets (four
+ * buckets per power of two), which is precise enough for percentiles and
+ * keeps recording to a couple of increments.
+ *
+ *   EGG_DEFINE_HISTOGRAM (Symbol, "Category", "Name", "Description")
+ *
+ * Durations in microseconds can be recorded around a hot path with the
+ * timer helpers.
+ *
+ *   gint64 begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
+ *   ...
+ *   EGG_HISTOGRAM_TIMER_END (Symbol, begin_time);
+ *
+ * Like counters, histograms have a bucket array per CPU in the shared
+ * memory zone so recording does not need synchronization.
+ *
+ *
  * Architecture Support
  * ====================
  *
@@ -118,6 +139,13 @@
  *
  *  [8 CounterInfo Structs (128-bytes each)][N_CPU Data Zones (64-byte each)]
  *
+ * Histogram buckets are allocated from the end of the zone, growing down
+ * towards the counters. Each histogram also takes a CounterInfo slot, whose
+ * value is the number of recorded samples, and which points at the bucket
+ * data.
+ *
+ *  [N_CPU EggHistogramData (1088-bytes each)]
+ *
  * See egg-counter.c for more information on the contents of these structures.
  *
  *
@@ -241,9 +269,61 @@ G_BEGIN_DECLS
   } G_STMT_END
 #endif
 
-typedef struct _EggCounter      EggCounter;
-typedef struct _EggCounterArena EggCounterArena;
-typedef struct _EggCounterValue EggCounterValue;
+/**
+ * EGG_DEFINE_HISTOGRAM:
+ * @Identifier: The symbol name of the histogram
+ * @Category: A string category for the histogram.
+ * @Name: A string name for the histogram.
+ * @Description: A string description for the histogram.
+ *
+ * |[<!-- language="C" -->
+ * EGG_DEFINE_HISTOGRAM (parse_time, "Clang", "Parse Time", "Time to parse a translation unit (usec)");
+ * ]|
+ */
+#define EGG_DEFINE_HISTOGRAM(Identifier, Category, Name, Description)                               \
+ static EggHistogram Identifier##_hist = { { NULL, Category, Name, Description }, NULL };            \
+ static void Identifier##_hist_init (void) __attribute__((constructor));                            \
+ static void                                                                                        \
+ Identifier##_hist_init (void)                                                                      \
+ {                                                                                                  \
+   egg_counter_arena_register_histogram (egg_counter_arena_get_default(), &Identifier##_hist);      \
+ }
+
+/**
+ * EGG_HISTOGRAM_RECORD:
+ * @Identifier: The identifier of the histogram.
+ * @Value: the value to record.
+ *
+ * Records @Value in the histogram @Identifier. Negative values are
+ * recorded as zero.
+ */
+#define EGG_HISTOGRAM_RECORD(Identifier, Value) \
+  egg_histogram_record (&Identifier##_hist, ((gint64)(Value)))
+
+/**
+ * EGG_HISTOGRAM_TIMER_BEGIN:
+ *
+ * Gets the current monotonic time, to be passed to EGG_HISTOGRAM_TIMER_END().
+ */
+#define EGG_HISTOGRAM_TIMER_BEGIN() g_get_monotonic_time()
+
+/**
+ * EGG_HISTOGRAM_TIMER_END:
+ * @Identifier: The identifier of the histogram.
+ * @BeginTime: the value returned from EGG_HISTOGRAM_TIMER_BEGIN().
+ *
+ * Records the number of microseconds since @BeginTime in @Identifier.
+ */
+#define EGG_HISTOGRAM_TIMER_END(Identifier, BeginTime) \
+  EGG_HISTOGRAM_RECORD(Identifier, g_get_monotonic_time() - (BeginTime))
+
+#define EGG_HISTOGRAM_N_BUCKETS 128
+
+typedef struct _EggCounter       EggCounter;
+typedef struct _EggCounterArena  EggCounterArena;
+typedef struct _EggCounterValue  EggCounterValue;
+typedef struct _EggHistogram     EggHistogram;
+typedef struct _EggHistogramData EggHistogramData;
 
 /**
  * EggCounterForeachFunc:
@@ -255,6 +335,17 @@ typedef struct _EggCounterValue EggCounterValue;
 typedef void (*EggCounterForeachFunc) (EggCounter *counter,
                                        gpointer    user_data);
 
+/**
+ * EggHistogramForeachFunc:
+ * @histogram: the histogram.
+ * @user_data: data supplied to egg_counter_arena_foreach_histogram().
+ *
+ * Function prototype for callbacks provided to
+ * egg_counter_arena_foreach_histogram().
+ */
+typedef void (*EggHistogramForeachFunc) (EggHistogram *histogram,
+                                         gpointer      user_data);
+
 struct _EggCounter
 {
   /*< Private >*/
@@ -270,19 +361,89 @@ struct _EggCounterValue
   gint64          padding [7];
 } __attribute__ ((aligned(8)));
 
-GType            egg_counter_arena_get_type     (void);
-guint            egg_get_current_cpu_call       (void);
-EggCounterArena *egg_counter_arena_get_default  (void);
-EggCounterArena *egg_counter_arena_new_for_pid  (GPid                   pid);
-EggCounterArena *egg_counter_arena_ref          (EggCounterArena       *arena);
-void             egg_counter_arena_unref        (EggCounterArena       *arena);
-void             egg_counter_arena_register     (EggCounterArena       *arena,
-                                                 EggCounter            *counter);
-void             egg_counter_arena_foreach      (EggCounterArena       *arena,
-                                                 EggCounterForeachFunc  func,
-                                                 gpointer               user_data);
-void             egg_counter_reset              (EggCounter            *counter);
-gint64           egg_counter_get                (EggCounter            *counter);
+struct _EggHistogramData
+{
+  volatile gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  volatile gint64 sum;
+  gint64          padding [7];
+} __attribute__ ((aligned(8)));
+
+struct _EggHistogram
+{
+  /*< Private >*/
+  EggCounter        counter;
+  EggHistogramData *data;
+} __attribute__ ((aligned(8)));
+
+GType            egg_counter_arena_get_type           (void);
+guint            egg_get_current_cpu_call             (void);
+EggCounterArena *egg_counter_arena_get_default        (void);
+EggCounterArena *egg_counter_arena_new_for_pid        (GPid                     pid);
+EggCounterArena *egg_counter_arena_ref                (EggCounterArena         *arena);
+void             egg_counter_arena_unref              (EggCounterArena         *arena);
+void             egg_counter_arena_register           (EggCounterArena         *arena,
+                                                       EggCounter              *counter);
+void             egg_counter_arena_register_histogram (EggCounterArena         *arena,
+                                                       EggHistogram            *histogram);
+void             egg_counter_arena_foreach            (EggCounterArena         *arena,
+                                                       EggCounterForeachFunc    func,
+                                                       gpointer                 user_data);
+void             egg_counter_arena_foreach_histogram  (EggCounterArena         *arena,
+                                                       EggHistogramForeachFunc  func,
+                                                       gpointer                 user_data);
+void             egg_counter_reset                    (EggCounter              *counter);
+gint64           egg_counter_get                      (EggCounter              *counter);
+void             egg_counter_add                      (EggCounter              *counter,
+                                                       gint64                   count);
+gint64           egg_histogram_get_buckets            (EggHistogram            *histogram,
+                                                       gint64                  *buckets,
+                                                       gint64                  *sum);
+gint64           egg_histogram_get_percentile         (const gint64            *buckets,
+                                                       gdouble                  percentile);
+gint64           egg_histogram_get_bucket_max         (guint                    bucket);
+
+/*
+ * Four linear buckets per power of two. Values below 4 get a bucket each,
+ * buckets 4 through 7 are unused.
+ */
+static inline guint
+egg_histogram_get_bucket (gint64 value)
+{
+  guint msb;
+
+  if (value < 4)
+    return value < 0 ? 0 : (guint)value;
+
+  msb = 63 - __builtin_clzll ((guint64)value);
+
+  if (msb >= (EGG_HISTOGRAM_N_BUCKETS / 4))
+    return EGG_HISTOGRAM_N_BUCKETS - 1;
+
+  return (msb << 2) | ((value >> (msb - 2)) & 3);
+}
+
+static inline void
+egg_histogram_record (EggHistogram *histogram,
+                      gint64        value)
+{
+  guint bucket = egg_histogram_get_bucket (value);
+
+  value = MAX (value, 0);
+
+#ifdef EGG_COUNTER_REQUIRES_ATOMIC
+  __sync_add_and_fetch ((gint64 *)&histogram->data[0].buckets[bucket], 1);
+  __sync_add_and_fetch ((gint64 *)&histogram->data[0].sum, value);
+  __sync_add_and_fetch ((gint64 *)&histogram->counter.values[0], 1);
+#else
+  {
+    guint cpu = egg_get_current_cpu ();
+
+    histogram->data[cpu].buckets[bucket]++;
+    histogram->data[cpu].sum += value;
+    histogram->counter.values[cpu].value++;
+  }
+#endif
+}
 
 G_END_DECLS
 
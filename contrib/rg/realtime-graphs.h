@@ -27,8 +27,12 @@ G_BEGIN_DECLS
 #include "rg-cpu-graph.h"
 #include "rg-cpu-table.h"
 #include "rg-graph.h"
+#include "rg-io-table.h"
 #include "rg-line-renderer.h"
+#include "rg-mem-table.h"
+#include "rg-process-table.h"
 #include "rg-renderer.h"
+#include "rg-sampler.h"
 #include "rg-table.h"
 
 G_END_DECLS
@@ -21,6 +21,7 @@
 #include "rg-cpu-graph.h"
 #include "rg-cpu-table.h"
 #include "rg-line-renderer.h"
+#include "rg-sampler.h"
 
 struct _RgCpuGraph
 {
@@ -87,7 +88,7 @@ rg_cpu_graph_constructed (GObject *object)
       rg_graph_set_table (RG_GRAPH (self), RG_TABLE (table));
     }
 
-  n_cpu = g_get_num_processors ();
+  n_cpu = MIN (g_get_num_processors (), RG_SAMPLER_MAX_CPU);
 
   for (i = 0; i < n_cpu; i++)
     {
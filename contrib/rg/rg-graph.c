@@ -28,9 +28,12 @@ typedef struct
   EggSignalGroup  *table_signals;
   GPtrArray       *renderers;
   cairo_surface_t *surface;
+  cairo_surface_t *scratch;
+  gint64           surface_end_time;
   guint            tick_handler;
   gint             x_offset;
   guint            surface_dirty : 1;
+  guint            samples_pending : 1;
 } RgGraphPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (RgGraph, rg_graph, GTK_TYPE_DRAWING_AREA)
@@ -59,6 +62,22 @@ rg_graph_clear_surface (RgGraph *self)
   priv->surface_dirty = TRUE;
 }
 
+static gint
+rg_graph_calc_x_offset (RgGraph *self,
+                        gint64   frame_time,
+                        gint     width)
+{
+  RgGraphPrivate *priv = rg_graph_get_instance_private (self);
+  gint64 timespan;
+
+  timespan = rg_table_get_timespan (priv->table);
+
+  if (timespan == 0)
+    return 0;
+
+  return -((frame_time - priv->surface_end_time) / (gdouble)timespan * width);
+}
+
 /**
  * rg_graph_get_table:
  *
@@ -88,6 +107,7 @@ rg_graph_set_table (RgGraph *self,
   if (g_set_object (&priv->table, table))
     {
       egg_signal_group_set_target (priv->table_signals, table);
+      rg_graph_clear_surface (self);
       gtk_widget_queue_allocate (GTK_WIDGET (self));
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_TABLE]);
     }
@@ -115,8 +135,6 @@ rg_graph_tick_cb (GtkWidget     *widget,
   RgGraphPrivate *priv = rg_graph_get_instance_private (self);
   GtkAllocation alloc;
   gint64 frame_time;
-  gint64 end_time;
-  gint64 timespan;
   gint x_offset;
 
   g_assert (RG_IS_GRAPH (self));
@@ -124,16 +142,19 @@ rg_graph_tick_cb (GtkWidget     *widget,
   if ((priv->surface == NULL) || (priv->table == NULL) || !gtk_widget_get_visible (widget))
     goto remove_handler;
 
-  timespan = rg_table_get_timespan (priv->table);
-  if (timespan == 0)
+  if (rg_table_get_timespan (priv->table) == 0)
     goto remove_handler;
 
   gtk_widget_get_allocation (widget, &alloc);
 
   frame_time = gdk_frame_clock_get_frame_time (frame_clock);
-  end_time = rg_table_get_end_time (priv->table);
+  x_offset = rg_graph_calc_x_offset (self, frame_time, alloc.width);
 
-  x_offset = -((frame_time - end_time) / (gdouble)timespan * alloc.width);
+  if (priv->samples_pending)
+    {
+      gtk_widget_queue_draw (widget);
+      return G_SOURCE_CONTINUE;
+    }
 
   if (x_offset != priv->x_offset)
     {
@@ -154,18 +175,117 @@ remove_handler:
 }
 
 static void
-rg_graph_ensure_surface (RgGraph *self)
+rg_graph_render (RgGraph                     *self,
+                 cairo_t                     *cr,
+                 gint64                       end_time,
+                 const cairo_rectangle_int_t *area)
 {
   RgGraphPrivate *priv = rg_graph_get_instance_private (self);
-  GtkAllocation alloc;
-  RgTableIter iter;
   gint64 begin_time;
-  gint64 end_time;
   gdouble y_begin;
   gdouble y_end;
-  cairo_t *cr;
   gsize i;
 
+  g_object_get (priv->table,
+                "value-min", &y_begin,
+                "value-max", &y_end,
+                NULL);
+
+  begin_time = end_time - rg_table_get_timespan (priv->table);
+
+  for (i = 0; i < priv->renderers->len; i++)
+    {
+      RgRenderer *renderer;
+
+      renderer = g_ptr_array_index (priv->renderers, i);
+
+      cairo_save (cr);
+      rg_renderer_render (renderer, priv->table, begin_time, end_time, y_begin, y_end, cr, area);
+      cairo_restore (cr);
+    }
+}
+
+/*
+ * Scrolls the existing surface to the left by the number of whole pixels
+ * that new samples advanced the graph, and renders only the uncovered strip
+ * on the right. Returns %FALSE if a full redraw is needed instead.
+ */
+static gboolean
+rg_graph_advance_surface (RgGraph       *self,
+                          GtkAllocation *alloc)
+{
+  RgGraphPrivate *priv = rg_graph_get_instance_private (self);
+  cairo_surface_t *tmp;
+  RgTableIter iter;
+  gint64 timespan;
+  gint64 end_time;
+  gint64 new_end_time;
+  cairo_t *cr;
+  gint dx;
+
+  if (!rg_table_get_iter_last (priv->table, &iter))
+    return TRUE;
+
+  timespan = rg_table_get_timespan (priv->table);
+  end_time = rg_table_iter_get_timestamp (&iter);
+
+  if (timespan == 0 || alloc->width <= 0 || end_time < priv->surface_end_time)
+    return FALSE;
+
+  dx = (end_time - priv->surface_end_time) / (gdouble)timespan * alloc->width;
+
+  if (dx >= alloc->width)
+    return FALSE;
+
+  /*
+   * Only move by whole pixels so the shifted content stays sharp. Samples
+   * past the new edge are picked up by the next strip.
+   */
+  if (dx == 0)
+    return TRUE;
+
+  new_end_time = priv->surface_end_time + (dx * timespan / alloc->width);
+
+  if (priv->scratch == NULL)
+    priv->scratch = cairo_surface_create_similar (priv->surface,
+                                                  CAIRO_CONTENT_COLOR_ALPHA,
+                                                  alloc->width,
+                                                  alloc->height);
+
+  cr = cairo_create (priv->scratch);
+
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, priv->surface, -dx, 0);
+  cairo_paint (cr);
+
+  cairo_rectangle (cr, alloc->width - dx, 0, dx, alloc->height);
+  cairo_clip (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+  rg_graph_render (self, cr, new_end_time, alloc);
+
+  cairo_destroy (cr);
+
+  tmp = priv->surface;
+  priv->surface = priv->scratch;
+  priv->scratch = tmp;
+
+  priv->surface_end_time = new_end_time;
+
+  return TRUE;
+}
+
+static void
+rg_graph_ensure_surface (RgGraph *self)
+{
+  RgGraphPrivate *priv = rg_graph_get_instance_private (self);
+  GdkFrameClock *frame_clock;
+  GtkAllocation alloc;
+  RgTableIter iter;
+  cairo_t *cr;
+
   g_assert (RG_IS_GRAPH (self));
 
   gtk_widget_get_allocation (GTK_WIDGET (self), &alloc);
@@ -182,6 +302,14 @@ rg_graph_ensure_surface (RgGraph *self)
   if (priv->table == NULL)
     return;
 
+  if (priv->samples_pending && !priv->surface_dirty)
+    {
+      if (!rg_graph_advance_surface (self, &alloc))
+        priv->surface_dirty = TRUE;
+    }
+
+  priv->samples_pending = FALSE;
+
   if (priv->surface_dirty)
     {
       priv->surface_dirty = FALSE;
@@ -194,31 +322,21 @@ rg_graph_ensure_surface (RgGraph *self)
       cairo_fill (cr);
       cairo_restore (cr);
 
-      g_object_get (priv->table,
-                    "value-min", &y_begin,
-                    "value-max", &y_end,
-                    NULL);
-
       rg_table_get_iter_last (priv->table, &iter);
-      end_time = rg_table_iter_get_timestamp (&iter);
-      begin_time = end_time - rg_table_get_timespan (priv->table);
+      priv->surface_end_time = rg_table_iter_get_timestamp (&iter);
 
-      for (i = 0; i < priv->renderers->len; i++)
-        {
-          RgRenderer *renderer;
-
-          renderer = g_ptr_array_index (priv->renderers, i);
-
-          cairo_save (cr);
-          rg_renderer_render (renderer, priv->table, begin_time, end_time, y_begin, y_end, cr, &alloc);
-          cairo_restore (cr);
-        }
+      rg_graph_render (self, cr, priv->surface_end_time, &alloc);
 
       cairo_destroy (cr);
-
-      priv->x_offset = 0;
     }
 
+  if ((frame_clock = gtk_widget_get_frame_clock (GTK_WIDGET (self))))
+    priv->x_offset = rg_graph_calc_x_offset (self,
+                                             gdk_frame_clock_get_frame_time (frame_clock),
+                                             alloc.width);
+  else
+    priv->x_offset = 0;
+
   if (priv->tick_handler == 0)
     priv->tick_handler = gtk_widget_add_tick_callback (GTK_WIDGET (self),
                                                        rg_graph_tick_cb,
@@ -271,7 +389,10 @@ rg_graph_size_allocate (GtkWidget     *widget,
   gtk_widget_get_allocation (widget, &old_alloc);
 
   if ((old_alloc.width != alloc->width) || (old_alloc.height != alloc->height))
-    g_clear_pointer (&priv->surface, cairo_surface_destroy);
+    {
+      g_clear_pointer (&priv->surface, cairo_surface_destroy);
+      g_clear_pointer (&priv->scratch, cairo_surface_destroy);
+    }
 
   GTK_WIDGET_CLASS (rg_graph_parent_class)->size_allocate (widget, alloc);
 }
@@ -279,11 +400,26 @@ rg_graph_size_allocate (GtkWidget     *widget,
 static void
 rg_graph__table_changed (RgGraph *self,
                          RgTable *table)
+{
+  RgGraphPrivate *priv = rg_graph_get_instance_private (self);
+
+  g_assert (RG_IS_GRAPH (self));
+  g_assert (RG_IS_TABLE (table));
+
+  priv->samples_pending = TRUE;
+}
+
+static void
+rg_graph__table_notify (RgGraph    *self,
+                        GParamSpec *pspec,
+                        RgTable    *table)
 {
   g_assert (RG_IS_GRAPH (self));
   g_assert (RG_IS_TABLE (table));
 
+  /* The scale changed, so none of the cached surface can be reused */
   rg_graph_clear_surface (self);
+  gtk_widget_queue_allocate (GTK_WIDGET (self));
 }
 
 static void
@@ -310,6 +446,7 @@ rg_graph_finalize (GObject *object)
   g_clear_object (&priv->table);
   g_clear_object (&priv->table_signals);
   g_clear_pointer (&priv->surface, cairo_surface_destroy);
+  g_clear_pointer (&priv->scratch, cairo_surface_destroy);
   g_clear_pointer (&priv->renderers, g_ptr_array_unref);
 
   G_OBJECT_CLASS (rg_graph_parent_class)->finalize (object);
@@ -388,19 +525,19 @@ rg_graph_init (RgGraph *self)
 
   egg_signal_group_connect_object (priv->table_signals,
                                    "notify::value-max",
-                                   G_CALLBACK (gtk_widget_queue_allocate),
+                                   G_CALLBACK (rg_graph__table_notify),
                                    self,
                                    G_CONNECT_SWAPPED);
 
   egg_signal_group_connect_object (priv->table_signals,
                                    "notify::value-min",
-                                   G_CALLBACK (gtk_widget_queue_allocate),
+                                   G_CALLBACK (rg_graph__table_notify),
                                    self,
                                    G_CONNECT_SWAPPED);
 
   egg_signal_group_connect_object (priv->table_signals,
                                    "notify::timespan",
-                                   G_CALLBACK (gtk_widget_queue_allocate),
+                                   G_CALLBACK (rg_graph__table_notify),
                                    self,
                                    G_CONNECT_SWAPPED);
 
@@ -0,0 +1,146 @@
+/* rg-io-table.c
+ *
+ * Copyright (C) 2015 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+
+#include "rg-io-table.h"
+#include "rg-sampler.h"
+
+#define MIN_VALUE_MAX 1024.0
+
+/*
+ * Block device throughput in KiB/s. The range grows as needed so that
+ * the graph stays readable for both idle and busy disks.
+ */
+struct _RgIoTable
+{
+  RgTable    parent_instance;
+
+  RgSampler *sampler;
+};
+
+G_DEFINE_TYPE (RgIoTable, rg_io_table, RG_TYPE_TABLE)
+
+static void
+rg_io_table_grow (RgIoTable *self,
+                  gdouble    value)
+{
+  gdouble value_max;
+
+  g_object_get (self, "value-max", &value_max, NULL);
+
+  if (value > value_max)
+    g_object_set (self, "value-max", value * 1.25, NULL);
+}
+
+static void
+rg_io_table_add_column (RgIoTable   *self,
+                        const gchar *name)
+{
+  RgColumn *column;
+
+  column = rg_column_new (name, G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+}
+
+static void
+rg_io_table_sample (RgIoTable      *self,
+                    const RgSample *sample,
+                    RgSampler      *sampler)
+{
+  RgTableIter iter;
+
+  g_assert (RG_IS_IO_TABLE (self));
+  g_assert (sample != NULL);
+
+  rg_table_push (RG_TABLE (self), &iter, sample->timestamp);
+  rg_table_iter_set (&iter,
+                     0, sample->io_read,
+                     1, sample->io_write,
+                     -1);
+
+  rg_io_table_grow (self, MAX (sample->io_read, sample->io_write));
+}
+
+static void
+rg_io_table_constructed (GObject *object)
+{
+  RgIoTable *self = (RgIoTable *)object;
+  gint64 timespan;
+  guint max_samples;
+  guint poll_interval_msec;
+
+  G_OBJECT_CLASS (rg_io_table_parent_class)->constructed (object);
+
+  max_samples = rg_table_get_max_samples (RG_TABLE (self));
+  timespan = rg_table_get_timespan (RG_TABLE (self));
+
+  poll_interval_msec = (gdouble)timespan / (gdouble)(max_samples - 1) / 1000L;
+
+  if (poll_interval_msec == 0)
+    {
+      g_critical ("Implausible timespan/max_samples combination for graph.");
+      poll_interval_msec = 1000;
+    }
+
+  rg_io_table_add_column (self, _("Read"));
+  rg_io_table_add_column (self, _("Write"));
+
+  self->sampler = rg_sampler_ref_default ();
+  rg_sampler_require_interval (self->sampler, poll_interval_msec);
+  g_signal_connect_object (self->sampler,
+                           "sample",
+                           G_CALLBACK (rg_io_table_sample),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static void
+rg_io_table_finalize (GObject *object)
+{
+  RgIoTable *self = (RgIoTable *)object;
+
+  g_clear_object (&self->sampler);
+
+  G_OBJECT_CLASS (rg_io_table_parent_class)->finalize (object);
+}
+
+static void
+rg_io_table_class_init (RgIoTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = rg_io_table_constructed;
+  object_class->finalize = rg_io_table_finalize;
+}
+
+static void
+rg_io_table_init (RgIoTable *self)
+{
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", MIN_VALUE_MAX,
+                NULL);
+}
+
+RgTable *
+rg_io_table_new (void)
+{
+  return g_object_new (RG_TYPE_IO_TABLE, NULL);
+}
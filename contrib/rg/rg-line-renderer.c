@@ -133,7 +133,14 @@ rg_line_renderer_render (RgRenderer                  *renderer,
 
   if (rg_table_get_iter_first (table, &iter))
     {
+      RgTableIter prev;
+      gboolean have_prev = FALSE;
+      gboolean more = TRUE;
       guint max_samples;
+      gdouble clip_x1;
+      gdouble clip_y1;
+      gdouble clip_x2;
+      gdouble clip_y2;
       gdouble chunk;
       gdouble last_x;
       gdouble last_y;
@@ -142,16 +149,38 @@ rg_line_renderer_render (RgRenderer                  *renderer,
 
       chunk = area->width / (gdouble)(max_samples - 1) / 2.0;
 
-      last_x = calc_x (&iter, x_begin, x_end, area->width);
-      last_y = calc_y (&iter, y_begin, y_end, area->height, self->column);
+      /*
+       * When only a strip of new samples is being drawn, skip everything
+       * left of the clip except the sample right before it, so the segment
+       * crossing into the clip is still drawn.
+       */
+      cairo_clip_extents (cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+      while (calc_x (&iter, x_begin, x_end, area->width) < clip_x1)
+        {
+          prev = iter;
+          have_prev = TRUE;
+
+          if (!(more = rg_table_iter_next (&iter)))
+            break;
+        }
+
+      if (!have_prev)
+        prev = iter;
+
+      last_x = calc_x (&prev, x_begin, x_end, area->width);
+      last_y = calc_y (&prev, y_begin, y_end, area->height, self->column);
 
       cairo_move_to (cr, last_x, last_y);
 
-      while (rg_table_iter_next (&iter))
+      /* iter is already the next sample if we skipped any */
+      while (more && (have_prev || (more = rg_table_iter_next (&iter))))
         {
           gdouble x;
           gdouble y;
 
+          have_prev = FALSE;
+
           x = calc_x (&iter, x_begin, x_end, area->width);
           y = calc_y (&iter, y_begin, y_end, area->height, self->column);
 
@@ -165,6 +194,9 @@ rg_line_renderer_render (RgRenderer                  *renderer,
 
           last_x = x;
           last_y = y;
+
+          if (last_x > clip_x2)
+            break;
         }
     }
 
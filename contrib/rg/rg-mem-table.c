@@ -0,0 +1,131 @@
+/* rg-mem-table.c
+ *
+ * Copyright (C) 2015 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+
+#include "rg-mem-table.h"
+#include "rg-sampler.h"
+
+/*
+ * Memory usage as a percentage of physical memory (and swap).
+ */
+struct _RgMemTable
+{
+  RgTable    parent_instance;
+
+  RgSampler *sampler;
+};
+
+G_DEFINE_TYPE (RgMemTable, rg_mem_table, RG_TYPE_TABLE)
+
+static void
+rg_mem_table_add_column (RgMemTable  *self,
+                         const gchar *name)
+{
+  RgColumn *column;
+
+  column = rg_column_new (name, G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+}
+
+static void
+rg_mem_table_sample (RgMemTable     *self,
+                     const RgSample *sample,
+                     RgSampler      *sampler)
+{
+  RgTableIter iter;
+
+  g_assert (RG_IS_MEM_TABLE (self));
+  g_assert (sample != NULL);
+
+  rg_table_push (RG_TABLE (self), &iter, sample->timestamp);
+  rg_table_iter_set (&iter,
+                     0, sample->mem_used,
+                     1, sample->mem_cached,
+                     2, sample->swap_used,
+                     -1);
+}
+
+static void
+rg_mem_table_constructed (GObject *object)
+{
+  RgMemTable *self = (RgMemTable *)object;
+  gint64 timespan;
+  guint max_samples;
+  guint poll_interval_msec;
+
+  G_OBJECT_CLASS (rg_mem_table_parent_class)->constructed (object);
+
+  max_samples = rg_table_get_max_samples (RG_TABLE (self));
+  timespan = rg_table_get_timespan (RG_TABLE (self));
+
+  poll_interval_msec = (gdouble)timespan / (gdouble)(max_samples - 1) / 1000L;
+
+  if (poll_interval_msec == 0)
+    {
+      g_critical ("Implausible timespan/max_samples combination for graph.");
+      poll_interval_msec = 1000;
+    }
+
+  rg_mem_table_add_column (self, _("Used"));
+  rg_mem_table_add_column (self, _("Cached"));
+  rg_mem_table_add_column (self, _("Swap"));
+
+  self->sampler = rg_sampler_ref_default ();
+  rg_sampler_require_interval (self->sampler, poll_interval_msec);
+  g_signal_connect_object (self->sampler,
+                           "sample",
+                           G_CALLBACK (rg_mem_table_sample),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static void
+rg_mem_table_finalize (GObject *object)
+{
+  RgMemTable *self = (RgMemTable *)object;
+
+  g_clear_object (&self->sampler);
+
+  G_OBJECT_CLASS (rg_mem_table_parent_class)->finalize (object);
+}
+
+static void
+rg_mem_table_class_init (RgMemTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = rg_mem_table_constructed;
+  object_class->finalize = rg_mem_table_finalize;
+}
+
+static void
+rg_mem_table_init (RgMemTable *self)
+{
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", 100.0,
+                NULL);
+}
+
+RgTable *
+rg_mem_table_new (void)
+{
+  return g_object_new (RG_TYPE_MEM_TABLE, NULL);
+}
@@ -0,0 +1,131 @@
+/* rg-process-table.c
+ *
+ * Copyright (C) 2015 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+
+#include "rg-process-table.h"
+#include "rg-sampler.h"
+
+/*
+ * CPU and memory used by processes spawned by this process, such as
+ * build tools. CPU is a percentage of all processors, memory a
+ * percentage of physical memory.
+ */
+struct _RgProcessTable
+{
+  RgTable    parent_instance;
+
+  RgSampler *sampler;
+};
+
+G_DEFINE_TYPE (RgProcessTable, rg_process_table, RG_TYPE_TABLE)
+
+static void
+rg_process_table_add_column (RgProcessTable *self,
+                             const gchar    *name)
+{
+  RgColumn *column;
+
+  column = rg_column_new (name, G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+}
+
+static void
+rg_process_table_sample (RgProcessTable *self,
+                         const RgSample *sample,
+                         RgSampler      *sampler)
+{
+  RgTableIter iter;
+
+  g_assert (RG_IS_PROCESS_TABLE (self));
+  g_assert (sample != NULL);
+
+  rg_table_push (RG_TABLE (self), &iter, sample->timestamp);
+  rg_table_iter_set (&iter,
+                     0, sample->children_cpu,
+                     1, sample->children_mem,
+                     -1);
+}
+
+static void
+rg_process_table_constructed (GObject *object)
+{
+  RgProcessTable *self = (RgProcessTable *)object;
+  gint64 timespan;
+  guint max_samples;
+  guint poll_interval_msec;
+
+  G_OBJECT_CLASS (rg_process_table_parent_class)->constructed (object);
+
+  max_samples = rg_table_get_max_samples (RG_TABLE (self));
+  timespan = rg_table_get_timespan (RG_TABLE (self));
+
+  poll_interval_msec = (gdouble)timespan / (gdouble)(max_samples - 1) / 1000L;
+
+  if (poll_interval_msec == 0)
+    {
+      g_critical ("Implausible timespan/max_samples combination for graph.");
+      poll_interval_msec = 1000;
+    }
+
+  rg_process_table_add_column (self, _("CPU"));
+  rg_process_table_add_column (self, _("Memory"));
+
+  self->sampler = rg_sampler_ref_default ();
+  rg_sampler_require_interval (self->sampler, poll_interval_msec);
+  g_signal_connect_object (self->sampler,
+                           "sample",
+                           G_CALLBACK (rg_process_table_sample),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static void
+rg_process_table_finalize (GObject *object)
+{
+  RgProcessTable *self = (RgProcessTable *)object;
+
+  g_clear_object (&self->sampler);
+
+  G_OBJECT_CLASS (rg_process_table_parent_class)->finalize (object);
+}
+
+static void
+rg_process_table_class_init (RgProcessTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = rg_process_table_constructed;
+  object_class->finalize = rg_process_table_finalize;
+}
+
+static void
+rg_process_table_init (RgProcessTable *self)
+{
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", 100.0,
+                NULL);
+}
+
+RgTable *
+rg_process_table_new (void)
+{
+  return g_object_new (RG_TYPE_PROCESS_TABLE, NULL);
+}
@@ -0,0 +1,871 @@
+/* rg-sampler.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__FreeBSD__)
+# include <sys/resource.h>
+# include <sys/sysctl.h>
+# include <sys/types.h>
+#endif
+
+#include "rg-sampler.h"
+
+/*
+ * RgSampler collects system statistics on a dedicated thread so that
+ * the main loop never has to read or parse /proc.
+ *
+ * The /proc files are opened once and re-read with pread() on each tick
+ * into a fixed buffer, so a sample does not allocate. Samples are handed
+ * to the main thread through a single-producer, single-consumer ring;
+ * the producer only wakes up the main context, and a GSource drains the
+ * ring and emits RgSampler::sample for each entry.
+ *
+ * If the main loop stalls and the ring fills up, new samples are dropped
+ * rather than blocking the sampler thread.
+ */
+
+#define RING_SIZE              32
+#define DEFAULT_INTERVAL_MSEC  1000
+#define CHILDREN_SCAN_INTERVAL 4
+#define READ_BUFFER_SIZE       32768
+
+typedef struct
+{
+  guint64 busy;
+  guint64 total;
+} CpuTimes;
+
+typedef struct
+{
+  gint    pid;
+  gint    ppid;
+  gint    stat_fd;
+  guint64 last_ticks;
+  guint64 rss_pages;
+  guint   seen : 1;
+} ChildProc;
+
+typedef struct
+{
+  GSource    source;
+  RgSampler *sampler;
+} RgSamplerSource;
+
+struct _RgSampler
+{
+  GObject       parent_instance;
+
+  GThread      *thread;
+  GMutex        mutex;
+  GCond         cond;
+  guint         interval_msec;
+  guint         shutdown : 1;
+
+  /* Ring shared between the sampler thread (head) and main thread (tail) */
+  RgSample     *ring;
+  volatile gint head;
+  volatile gint tail;
+
+  GMainContext *main_context;
+  GSource      *source;
+
+  /* Everything below is only touched by the sampler thread */
+  gint          stat_fd;
+  gint          meminfo_fd;
+  gint          vmstat_fd;
+  CpuTimes      cpu_last [RG_SAMPLER_MAX_CPU];
+  CpuTimes      all_last;
+  guint64       pgpgin_last;
+  guint64       pgpgout_last;
+  guint64       mem_total_kb;
+  gint64        last_time;
+  glong         page_size;
+  guint         n_samples;
+  GHashTable   *children;
+  RgSample      scratch;
+  gchar         buffer [READ_BUFFER_SIZE];
+};
+
+G_DEFINE_TYPE (RgSampler, rg_sampler, G_TYPE_OBJECT)
+
+enum {
+  SAMPLE,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL];
+
+static void
+child_proc_free (gpointer data)
+{
+  ChildProc *child = data;
+
+  if (child->stat_fd != -1)
+    close (child->stat_fd);
+  g_slice_free (ChildProc, child);
+}
+
+static gint
+open_proc_file (const gchar *path)
+{
+  return open (path, O_RDONLY | O_CLOEXEC);
+}
+
+/*
+ * Reads the whole of @fd (from the beginning) into @buffer, which is
+ * always nul-terminated. Returns the number of bytes read or -1.
+ */
+static gssize
+read_proc_file (gint   fd,
+                gchar *buffer,
+                gsize  buffer_len)
+{
+  gssize n;
+
+  if (fd == -1)
+    return -1;
+
+  do
+    n = pread (fd, buffer, buffer_len - 1, 0);
+  while (n < 0 && errno == EINTR);
+
+  buffer [MAX (n, 0)] = '\0';
+
+  return n;
+}
+
+static inline guint64
+parse_u64 (const gchar **str)
+{
+  const gchar *p = *str;
+  guint64 value = 0;
+
+  while (*p == ' ' || *p == '\t')
+    p++;
+
+  while (*p >= '0' && *p <= '9')
+    value = (value * 10) + (*p++ - '0');
+
+  *str = p;
+
+  return value;
+}
+
+static inline const gchar *
+next_line (const gchar *p)
+{
+  p = strchr (p, '\n');
+  return p ? p + 1 : NULL;
+}
+
+#ifdef __linux__
+static void
+rg_sampler_read_cpu (RgSampler *self,
+                     RgSample  *sample)
+{
+  const gchar *p;
+
+  if (read_proc_file (self->stat_fd, self->buffer, sizeof self->buffer) <= 0)
+    return;
+
+  for (p = self->buffer; p != NULL && strncmp (p, "cpu", 3) == 0; p = next_line (p))
+    {
+      guint64 fields [10];
+      CpuTimes times = { 0 };
+      CpuTimes *last;
+      guint id = G_MAXUINT;
+      guint i;
+
+      p += 3;
+
+      if (*p != ' ')
+        id = parse_u64 (&p);
+
+      for (i = 0; i < G_N_ELEMENTS (fields); i++)
+        {
+          fields [i] = parse_u64 (&p);
+          times.total += fields [i];
+        }
+
+      /* Everything but idle and iowait */
+      times.busy = times.total - fields [3] - fields [4];
+
+      if (id == G_MAXUINT)
+        {
+          self->all_last = times;
+          continue;
+        }
+
+      if (id >= RG_SAMPLER_MAX_CPU)
+        continue;
+
+      last = &self->cpu_last [id];
+
+      if (times.total > last->total)
+        sample->cpu [id] = (times.busy - last->busy) * 100.0 / (gdouble)(times.total - last->total);
+
+      *last = times;
+      sample->n_cpu = MAX (sample->n_cpu, id + 1);
+    }
+}
+#elif defined(__FreeBSD__)
+static void
+rg_sampler_read_cpu (RgSampler *self,
+                     RgSample  *sample)
+{
+  static gint mib_cp_times[2];
+  static gsize len_cp_times = 2;
+  guint n_cpu = MIN (g_get_num_processors (), RG_SAMPLER_MAX_CPU);
+  gsize cp_times_size = sizeof (glong) * CPUSTATES * n_cpu;
+  glong *cp_times;
+  guint64 all_busy = 0;
+  guint64 all_total = 0;
+  guint i;
+  guint j;
+
+  if (mib_cp_times[0] == 0 || mib_cp_times[1] == 0)
+    {
+      if (sysctlnametomib ("kern.cp_times", mib_cp_times, &len_cp_times) == -1)
+        return;
+    }
+
+  cp_times = (glong *)(gpointer)self->buffer;
+
+  if (cp_times_size > sizeof self->buffer ||
+      sysctl (mib_cp_times, 2, cp_times, &cp_times_size, NULL, 0) == -1)
+    return;
+
+  for (i = 0, j = 0; i < n_cpu; i++, j += CPUSTATES)
+    {
+      CpuTimes *last = &self->cpu_last [i];
+      CpuTimes times;
+
+      times.busy = cp_times[j + CP_USER] + cp_times[j + CP_NICE] +
+                   cp_times[j + CP_SYS] + cp_times[j + CP_INTR];
+      times.total = times.busy + cp_times[j + CP_IDLE];
+
+      if (times.total > last->total)
+        sample->cpu [i] = (times.busy - last->busy) * 100.0 / (gdouble)(times.total - last->total);
+
+      *last = times;
+      all_busy += times.busy;
+      all_total += times.total;
+    }
+
+  self->all_last.busy = all_busy;
+  self->all_last.total = all_total;
+  sample->n_cpu = n_cpu;
+}
+#else
+static void
+rg_sampler_read_cpu (RgSampler *self,
+                     RgSample  *sample)
+{
+  /* TODO: calculate cpu info for OpenBSD/etc. */
+}
+#endif
+
+static void
+rg_sampler_read_meminfo (RgSampler *self,
+                         RgSample  *sample)
+{
+  guint64 mem_free = 0;
+  guint64 buffers = 0;
+  guint64 cached = 0;
+  guint64 swap_total = 0;
+  guint64 swap_free = 0;
+  const gchar *p;
+
+  if (read_proc_file (self->meminfo_fd, self->buffer, sizeof self->buffer) <= 0)
+    return;
+
+  for (p = self->buffer; p != NULL; p = next_line (p))
+    {
+      const gchar *colon = strchr (p, ':');
+      guint64 *target = NULL;
+      gsize len;
+
+      if (colon == NULL)
+        break;
+
+      len = colon - p;
+
+#define KEY_IS(k) (len == strlen (k) && strncmp (p, k, len) == 0)
+      if (KEY_IS ("MemTotal"))
+        target = &self->mem_total_kb;
+      else if (KEY_IS ("MemFree"))
+        target = &mem_free;
+      else if (KEY_IS ("Buffers"))
+        target = &buffers;
+      else if (KEY_IS ("Cached"))
+        target = &cached;
+      else if (KEY_IS ("SwapTotal"))
+        target = &swap_total;
+      else if (KEY_IS ("SwapFree"))
+        target = &swap_free;
+#undef KEY_IS
+
+      if (target != NULL)
+        {
+          p = colon + 1;
+          *target = parse_u64 (&p);
+        }
+    }
+
+  if (self->mem_total_kb > 0)
+    {
+      guint64 used = self->mem_total_kb - MIN (self->mem_total_kb, mem_free + buffers + cached);
+
+      sample->mem_used = used * 100.0 / (gdouble)self->mem_total_kb;
+      sample->mem_cached = (buffers + cached) * 100.0 / (gdouble)self->mem_total_kb;
+    }
+
+  if (swap_total > 0)
+    sample->swap_used = (swap_total - MIN (swap_total, swap_free)) * 100.0 / (gdouble)swap_total;
+}
+
+static void
+rg_sampler_read_vmstat (RgSampler *self,
+                        RgSample  *sample,
+                        gdouble    elapsed)
+{
+  guint64 pgpgin = 0;
+  guint64 pgpgout = 0;
+  const gchar *p;
+
+  if (read_proc_file (self->vmstat_fd, self->buffer, sizeof self->buffer) <= 0)
+    return;
+
+  for (p = self->buffer; p != NULL; p = next_line (p))
+    {
+      if (strncmp (p, "pgpgin ", 7) == 0)
+        {
+          p += 7;
+          pgpgin = parse_u64 (&p);
+        }
+      else if (strncmp (p, "pgpgout ", 8) == 0)
+        {
+          p += 8;
+          pgpgout = parse_u64 (&p);
+          break;
+        }
+    }
+
+  /* Both counters are in KiB */
+  if (elapsed > 0.0 && self->pgpgin_last > 0)
+    {
+      sample->io_read = (pgpgin - MIN (pgpgin, self->pgpgin_last)) / elapsed;
+      sample->io_write = (pgpgout - MIN (pgpgout, self->pgpgout_last)) / elapsed;
+    }
+
+  self->pgpgin_last = pgpgin;
+  self->pgpgout_last = pgpgout;
+}
+
+/*
+ * Parses utime + stime + cutime + cstime, the parent pid, and rss from the
+ * contents of /proc/<pid>/stat.
+ */
+static gboolean
+parse_pid_stat (const gchar *buffer,
+                gint        *ppid,
+                guint64     *ticks,
+                guint64     *rss_pages)
+{
+  const gchar *p;
+  guint field;
+
+  /* The command name may contain spaces and parens, skip past it */
+  if (!(p = strrchr (buffer, ')')))
+    return FALSE;
+
+  *ticks = 0;
+
+  /* Fields are numbered as in proc(5), starting with state at 3 */
+  for (field = 3, p++; field <= 24 && *p; field++)
+    {
+      guint64 value;
+
+      while (*p == ' ')
+        p++;
+
+      if (field == 3)
+        {
+          p++;
+          continue;
+        }
+
+      value = parse_u64 (&p);
+
+      if (field == 4)
+        *ppid = value;
+      else if (field >= 14 && field <= 17)
+        *ticks += value;
+      else if (field == 24)
+        *rss_pages = value;
+
+      /* Skip negative signs and anything else unexpected */
+      while (*p && *p != ' ')
+        p++;
+    }
+
+  return field > 24;
+}
+
+static void
+read_children_file (RgSampler   *self,
+                    const gchar *path,
+                    GArray      *pids)
+{
+  const gchar *p;
+  gint fd;
+
+  if (-1 == (fd = open_proc_file (path)))
+    return;
+
+  read_proc_file (fd, self->buffer, sizeof self->buffer);
+  close (fd);
+
+  for (p = self->buffer; *p; )
+    {
+      gint pid = parse_u64 (&p);
+
+      if (pid > 0)
+        g_array_append_val (pids, pid);
+
+      if (*p != ' ')
+        break;
+    }
+}
+
+/*
+ * Finds our descendant processes using /proc/<pid>/task/<tid>/children.
+ * Kernels without that file simply report no children.
+ */
+static void
+rg_sampler_scan_children (RgSampler *self)
+{
+  g_autoptr(GArray) pids = NULL;
+  g_autoptr(GDir) dir = NULL;
+  GHashTableIter iter;
+  ChildProc *child;
+  const gchar *name;
+  gboolean first_scan;
+  guint i;
+
+  first_scan = (g_hash_table_size (self->children) == 0 && self->n_samples == 0);
+  pids = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  if ((dir = g_dir_open ("/proc/self/task", 0, NULL)))
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar path [64];
+
+          g_snprintf (path, sizeof path, "/proc/self/task/%s/children", name);
+          read_children_file (self, path, pids);
+        }
+    }
+
+  /* Breadth first, pids grows as we go */
+  for (i = 0; i < pids->len; i++)
+    {
+      gint pid = g_array_index (pids, gint, i);
+      gchar path [64];
+
+      g_snprintf (path, sizeof path, "/proc/%d/task/%d/children", pid, pid);
+      read_children_file (self, path, pids);
+    }
+
+  g_hash_table_iter_init (&iter, self->children);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&child))
+    child->seen = FALSE;
+
+  for (i = 0; i < pids->len; i++)
+    {
+      gint pid = g_array_index (pids, gint, i);
+      gchar path [64];
+
+      if ((child = g_hash_table_lookup (self->children, GINT_TO_POINTER (pid))))
+        {
+          child->seen = TRUE;
+          continue;
+        }
+
+      g_snprintf (path, sizeof path, "/proc/%d/stat", pid);
+
+      child = g_slice_new0 (ChildProc);
+      child->pid = pid;
+      child->seen = TRUE;
+
+      if (-1 == (child->stat_fd = open_proc_file (path)))
+        {
+          child_proc_free (child);
+          continue;
+        }
+
+      /*
+       * Processes that were already running when we started are given a
+       * baseline so their whole lifetime is not counted as one tick. New
+       * processes are most likely short-lived build tools, count them
+       * from the start.
+       */
+      if (first_scan &&
+          read_proc_file (child->stat_fd, self->buffer, sizeof self->buffer) > 0)
+        parse_pid_stat (self->buffer, &child->ppid, &child->last_ticks, &child->rss_pages);
+
+      g_hash_table_insert (self->children, GINT_TO_POINTER (pid), child);
+    }
+
+  /*
+   * Processes not found in the tree have exited and been reaped. Their
+   * time is now part of their parent's cutime, which we already counted,
+   * so move it into the parent's baseline.
+   */
+  g_hash_table_iter_init (&iter, self->children);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&child))
+    {
+      if (!child->seen)
+        {
+          ChildProc *parent = g_hash_table_lookup (self->children, GINT_TO_POINTER (child->ppid));
+
+          if (parent != NULL)
+            parent->last_ticks += child->last_ticks;
+
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+}
+
+static void
+rg_sampler_read_children (RgSampler *self,
+                          RgSample  *sample,
+                          guint64    total_ticks)
+{
+  GHashTableIter iter;
+  ChildProc *child;
+  guint64 ticks = 0;
+  guint64 rss_pages = 0;
+
+  if ((self->n_samples % CHILDREN_SCAN_INTERVAL) == 0)
+    rg_sampler_scan_children (self);
+
+  g_hash_table_iter_init (&iter, self->children);
+
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&child))
+    {
+      guint64 child_ticks = 0;
+      guint64 child_rss = 0;
+
+      if (read_proc_file (child->stat_fd, self->buffer, sizeof self->buffer) <= 0 ||
+          !parse_pid_stat (self->buffer, &child->ppid, &child_ticks, &child_rss))
+        {
+          /* Exited, the next scan will account for it */
+          child->rss_pages = 0;
+          continue;
+        }
+
+      ticks += child_ticks - MIN (child_ticks, child->last_ticks);
+      rss_pages += child_rss;
+
+      child->last_ticks = child_ticks;
+      child->rss_pages = child_rss;
+    }
+
+  sample->n_children = g_hash_table_size (self->children);
+
+  if (total_ticks > 0)
+    sample->children_cpu = MIN (100.0, ticks * 100.0 / (gdouble)total_ticks);
+
+  if (self->mem_total_kb > 0)
+    sample->children_mem = (rss_pages * self->page_size / 1024.0) * 100.0 / (gdouble)self->mem_total_kb;
+}
+
+static void
+rg_sampler_collect (RgSampler *self)
+{
+  RgSample *sample = &self->scratch;
+  guint64 all_total_last;
+  gint64 now;
+  gdouble elapsed;
+  gint head;
+  gint tail;
+
+  now = g_get_monotonic_time ();
+  elapsed = self->last_time ? (now - self->last_time) / (gdouble)G_USEC_PER_SEC : 0.0;
+  all_total_last = self->all_last.total;
+
+  memset (sample, 0, sizeof *sample);
+  sample->timestamp = now;
+
+  rg_sampler_read_cpu (self, sample);
+  rg_sampler_read_meminfo (self, sample);
+  rg_sampler_read_vmstat (self, sample, elapsed);
+  rg_sampler_read_children (self, sample, self->all_last.total - MIN (self->all_last.total, all_total_last));
+
+  self->last_time = now;
+  self->n_samples++;
+
+  /* The first sample has no deltas to report */
+  if (self->n_samples == 1)
+    return;
+
+  head = g_atomic_int_get (&self->head);
+  tail = g_atomic_int_get (&self->tail);
+
+  if ((guint)(head - tail) >= RING_SIZE)
+    return;
+
+  self->ring [(guint)head % RING_SIZE] = *sample;
+  g_atomic_int_set (&self->head, head + 1);
+
+  g_main_context_wakeup (self->main_context);
+}
+
+static gpointer
+rg_sampler_thread (gpointer data)
+{
+  RgSampler *self = data;
+
+  g_mutex_lock (&self->mutex);
+
+  while (!self->shutdown)
+    {
+      gint64 deadline;
+
+      g_mutex_unlock (&self->mutex);
+      rg_sampler_collect (self);
+      g_mutex_lock (&self->mutex);
+
+      deadline = g_get_monotonic_time () + (self->interval_msec * G_TIME_SPAN_MILLISECOND);
+
+      while (!self->shutdown && g_cond_wait_until (&self->cond, &self->mutex, deadline))
+        {
+          /* Spurious wakeup or a new interval, keep waiting */
+        }
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  return NULL;
+}
+
+static gboolean
+rg_sampler_source_prepare (GSource *source,
+                           gint    *timeout)
+{
+  RgSampler *self = ((RgSamplerSource *)source)->sampler;
+
+  *timeout = -1;
+
+  return g_atomic_int_get (&self->head) != g_atomic_int_get (&self->tail);
+}
+
+static gboolean
+rg_sampler_source_check (GSource *source)
+{
+  RgSampler *self = ((RgSamplerSource *)source)->sampler;
+
+  return g_atomic_int_get (&self->head) != g_atomic_int_get (&self->tail);
+}
+
+static gboolean
+rg_sampler_source_dispatch (GSource     *source,
+                            GSourceFunc  callback,
+                            gpointer     user_data)
+{
+  RgSampler *self = ((RgSamplerSource *)source)->sampler;
+  gint head = g_atomic_int_get (&self->head);
+  gint tail = g_atomic_int_get (&self->tail);
+
+  g_object_ref (self);
+
+  for (; tail != head; tail++)
+    {
+      g_signal_emit (self, signals [SAMPLE], 0, &self->ring [(guint)tail % RING_SIZE]);
+      g_atomic_int_set (&self->tail, tail + 1);
+    }
+
+  g_object_unref (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs rg_sampler_source_funcs = {
+  rg_sampler_source_prepare,
+  rg_sampler_source_check,
+  rg_sampler_source_dispatch,
+  NULL,
+};
+
+static void
+rg_sampler_constructed (GObject *object)
+{
+  RgSampler *self = (RgSampler *)object;
+
+  G_OBJECT_CLASS (rg_sampler_parent_class)->constructed (object);
+
+  self->main_context = g_main_context_ref_thread_default ();
+
+  self->source = g_source_new (&rg_sampler_source_funcs, sizeof (RgSamplerSource));
+  ((RgSamplerSource *)self->source)->sampler = self;
+  g_source_set_name (self->source, "[rg] sampler");
+  g_source_attach (self->source, self->main_context);
+
+  self->thread = g_thread_new ("rg-sampler", rg_sampler_thread, self);
+}
+
+static void
+rg_sampler_dispose (GObject *object)
+{
+  RgSampler *self = (RgSampler *)object;
+
+  if (self->thread != NULL)
+    {
+      g_mutex_lock (&self->mutex);
+      self->shutdown = TRUE;
+      g_cond_signal (&self->cond);
+      g_mutex_unlock (&self->mutex);
+
+      g_thread_join (self->thread);
+      self->thread = NULL;
+    }
+
+  if (self->source != NULL)
+    {
+      g_source_destroy (self->source);
+      g_clear_pointer (&self->source, g_source_unref);
+    }
+
+  G_OBJECT_CLASS (rg_sampler_parent_class)->dispose (object);
+}
+
+static void
+rg_sampler_finalize (GObject *object)
+{
+  RgSampler *self = (RgSampler *)object;
+
+  if (self->stat_fd != -1)
+    close (self->stat_fd);
+  if (self->meminfo_fd != -1)
+    close (self->meminfo_fd);
+  if (self->vmstat_fd != -1)
+    close (self->vmstat_fd);
+
+  g_clear_pointer (&self->children, g_hash_table_unref);
+  g_clear_pointer (&self->ring, g_free);
+  g_clear_pointer (&self->main_context, g_main_context_unref);
+
+  g_mutex_clear (&self->mutex);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (rg_sampler_parent_class)->finalize (object);
+}
+
+static void
+rg_sampler_class_init (RgSamplerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = rg_sampler_constructed;
+  object_class->dispose = rg_sampler_dispose;
+  object_class->finalize = rg_sampler_finalize;
+
+  /**
+   * RgSampler::sample:
+   * @self: An #RgSampler
+   * @sample: (type gpointer): the new #RgSample
+   *
+   * Emitted on the main thread for every sample collected. @sample is only
+   * valid for the duration of the signal emission.
+   */
+  signals [SAMPLE] = g_signal_new ("sample",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0,
+                                   NULL, NULL, NULL,
+                                   G_TYPE_NONE,
+                                   1,
+                                   G_TYPE_POINTER);
+}
+
+static void
+rg_sampler_init (RgSampler *self)
+{
+  g_mutex_init (&self->mutex);
+  g_cond_init (&self->cond);
+
+  self->interval_msec = DEFAULT_INTERVAL_MSEC;
+  self->ring = g_new0 (RgSample, RING_SIZE);
+  self->children = g_hash_table_new_full (NULL, NULL, NULL, child_proc_free);
+  self->page_size = sysconf (_SC_PAGESIZE);
+
+  self->stat_fd = open_proc_file ("/proc/stat");
+  self->meminfo_fd = open_proc_file ("/proc/meminfo");
+  self->vmstat_fd = open_proc_file ("/proc/vmstat");
+}
+
+/**
+ * rg_sampler_ref_default:
+ *
+ * Gets the shared #RgSampler, creating it if necessary. The sampler thread
+ * stops when the last reference is released.
+ *
+ * Returns: (transfer full): An #RgSampler.
+ */
+RgSampler *
+rg_sampler_ref_default (void)
+{
+  static RgSampler *instance;
+
+  if (instance == NULL)
+    {
+      instance = g_object_new (RG_TYPE_SAMPLER, NULL);
+      g_object_add_weak_pointer (G_OBJECT (instance), (gpointer *)&instance);
+      return instance;
+    }
+
+  return g_object_ref (instance);
+}
+
+/**
+ * rg_sampler_require_interval:
+ * @self: An #RgSampler
+ * @interval_msec: the interval in milliseconds
+ *
+ * Ensures that samples are collected at least every @interval_msec.
+ */
+void
+rg_sampler_require_interval (RgSampler *self,
+                             guint      interval_msec)
+{
+  g_return_if_fail (RG_IS_SAMPLER (self));
+  g_return_if_fail (interval_msec > 0);
+
+  g_mutex_lock (&self->mutex);
+  if (interval_msec < self->interval_msec)
+    {
+      self->interval_msec = interval_msec;
+      g_cond_signal (&self->cond);
+    }
+  g_mutex_unlock (&self->mutex);
+}
@@ -0,0 +1,71 @@
+/* rg-sampler.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RG_SAMPLER_H
+#define RG_SAMPLER_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define RG_TYPE_SAMPLER (rg_sampler_get_type())
+
+#define RG_SAMPLER_MAX_CPU 128
+
+G_DECLARE_FINAL_TYPE (RgSampler, rg_sampler, RG, SAMPLER, GObject)
+
+/**
+ * RgSample:
+ * @timestamp: monotonic time of the sample
+ * @n_cpu: the number of valid entries in @cpu
+ * @cpu: busy percentage of each CPU since the previous sample
+ * @mem_used: percentage of memory in use, not counting caches
+ * @mem_cached: percentage of memory used by the page cache and buffers
+ * @swap_used: percentage of swap in use
+ * @io_read: KiB per second paged in from block devices
+ * @io_write: KiB per second paged out to block devices
+ * @n_children: the number of processes spawned by this process (such as
+ *   build tools) and their descendants
+ * @children_cpu: CPU usage of those processes, as a percentage of all CPUs
+ * @children_mem: resident memory of those processes, as a percentage of
+ *   total memory
+ *
+ * A snapshot of system activity, produced by the #RgSampler thread.
+ */
+typedef struct
+{
+  gint64  timestamp;
+  guint   n_cpu;
+  gdouble cpu [RG_SAMPLER_MAX_CPU];
+  gdouble mem_used;
+  gdouble mem_cached;
+  gdouble swap_used;
+  gdouble io_read;
+  gdouble io_write;
+  guint   n_children;
+  gdouble children_cpu;
+  gdouble children_mem;
+} RgSample;
+
+RgSampler *rg_sampler_ref_default      (void);
+void       rg_sampler_require_interval (RgSampler *self,
+                                        guint      interval_msec);
+
+G_END_DECLS
+
+#endif /* RG_SAMPLER_H */
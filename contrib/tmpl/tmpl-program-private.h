@@ -0,0 +1,55 @@
+/* tmpl-program-private.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (TMPL_GLIB_INSIDE) && !defined (TMPL_GLIB_COMPILATION)
+# error "Only <tmpl-glib.h> can be included directly."
+#endif
+
+#ifndef TMPL_PROGRAM_PRIVATE_H
+#define TMPL_PROGRAM_PRIVATE_H
+
+#include <gio/gio.h>
+
+#include "tmpl-node.h"
+#include "tmpl-scope.h"
+
+G_BEGIN_DECLS
+
+/*
+ * TmplProgram is the compiled form of a parsed template. Adjacent text
+ * (including constant string expressions) is concatenated into a single
+ * run, and plain symbol references are assigned a slot so that they are
+ * only resolved once per scope rather than on every reference.
+ *
+ * A program is immutable after compilation and may be executed from
+ * multiple threads at once, as long as the scopes it reads from are not
+ * modified concurrently.
+ */
+typedef struct _TmplProgram TmplProgram;
+
+TmplProgram *tmpl_program_compile (TmplNode       *root);
+void         tmpl_program_free    (TmplProgram    *self);
+gboolean     tmpl_program_execute (TmplProgram    *self,
+                                   TmplScope      *scope,
+                                   GOutputStream  *stream,
+                                   GCancellable   *cancellable,
+                                   GError        **error);
+
+G_END_DECLS
+
+#endif /* TMPL_PROGRAM_PRIVATE_H */
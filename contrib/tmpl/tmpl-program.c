@@ -0,0 +1,632 @@
+/* tmpl-program.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "tmpl-program"
+
+#include <string.h>
+
+#include "tmpl-branch-node.h"
+#include "tmpl-condition-node.h"
+#include "tmpl-error.h"
+#include "tmpl-expr-node.h"
+#include "tmpl-expr-private.h"
+#include "tmpl-iter-node.h"
+#include "tmpl-iterator.h"
+#include "tmpl-program-private.h"
+#include "tmpl-symbol.h"
+#include "tmpl-text-node.h"
+#include "tmpl-util-private.h"
+
+/*
+ * Output is buffered and flushed to the destination stream in chunks of
+ * this size so that large templates do not need to be fully rendered in
+ * memory before writing.
+ */
+#define FLUSH_THRESHOLD 8192
+
+typedef enum
+{
+  TMPL_OP_TEXT,
+  TMPL_OP_SYMBOL,
+  TMPL_OP_EXPR,
+  TMPL_OP_BRANCH,
+  TMPL_OP_ITER,
+} TmplOpType;
+
+typedef struct
+{
+  TmplOpType type;
+  union {
+    struct {
+      gchar *text;
+      gsize  len;
+    } text;
+    struct {
+      guint slot;
+    } symbol;
+    TmplExpr *expr;
+    GArray *arms;
+    struct {
+      gchar    *identifier;
+      TmplExpr *expr;
+      GArray   *body;
+    } iter;
+  } u;
+} TmplOp;
+
+typedef struct
+{
+  TmplExpr *condition;
+  GArray   *body;
+} TmplArm;
+
+struct _TmplProgram
+{
+  GArray    *ops;
+  GPtrArray *slot_names;
+};
+
+typedef struct
+{
+  TmplProgram *program;
+  GHashTable  *slots_by_name;
+  GArray      *ops;
+  GString     *text;
+} CompileState;
+
+typedef struct
+{
+  guint       frame;
+  TmplSymbol *symbol;
+} Slot;
+
+typedef struct
+{
+  TmplProgram    *program;
+  Slot           *slots;
+  TmplScope      *scope;
+  guint           frame;
+  guint           last_frame;
+  GString        *output;
+  GOutputStream  *stream;
+  GCancellable   *cancellable;
+  GError        **error;
+} ExecState;
+
+static void     compile_visitor (TmplNode    *node,
+                                 gpointer     user_data);
+static gboolean execute_ops     (ExecState   *state,
+                                 GArray      *ops);
+
+static void
+clear_op (gpointer data)
+{
+  TmplOp *op = data;
+
+  switch (op->type)
+    {
+    case TMPL_OP_TEXT:
+      g_free (op->u.text.text);
+      break;
+
+    case TMPL_OP_SYMBOL:
+      break;
+
+    case TMPL_OP_EXPR:
+      tmpl_expr_unref (op->u.expr);
+      break;
+
+    case TMPL_OP_BRANCH:
+      g_array_unref (op->u.arms);
+      break;
+
+    case TMPL_OP_ITER:
+      g_free (op->u.iter.identifier);
+      tmpl_expr_unref (op->u.iter.expr);
+      g_array_unref (op->u.iter.body);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static void
+clear_arm (gpointer data)
+{
+  TmplArm *arm = data;
+
+  tmpl_expr_unref (arm->condition);
+  g_array_unref (arm->body);
+}
+
+static GArray *
+new_op_array (void)
+{
+  GArray *ops;
+
+  ops = g_array_new (FALSE, FALSE, sizeof (TmplOp));
+  g_array_set_clear_func (ops, clear_op);
+
+  return ops;
+}
+
+static void
+flush_text (CompileState *state)
+{
+  TmplOp op = { 0 };
+
+  if (state->text->len == 0)
+    return;
+
+  op.type = TMPL_OP_TEXT;
+  op.u.text.len = state->text->len;
+  op.u.text.text = g_strndup (state->text->str, state->text->len);
+  g_array_append_val (state->ops, op);
+
+  g_string_truncate (state->text, 0);
+}
+
+static void
+append_op (CompileState *state,
+           TmplOp       *op)
+{
+  flush_text (state);
+  g_array_append_val (state->ops, *op);
+}
+
+static guint
+get_slot (CompileState *state,
+          const gchar  *name)
+{
+  gpointer value;
+
+  if (g_hash_table_lookup_extended (state->slots_by_name, name, NULL, &value))
+    return GPOINTER_TO_UINT (value);
+
+  g_ptr_array_add (state->program->slot_names, g_strdup (name));
+  g_hash_table_insert (state->slots_by_name,
+                       g_ptr_array_index (state->program->slot_names,
+                                          state->program->slot_names->len - 1),
+                       GUINT_TO_POINTER (state->program->slot_names->len - 1));
+
+  return state->program->slot_names->len - 1;
+}
+
+static GArray *
+compile_children (CompileState *parent,
+                  TmplNode     *node)
+{
+  CompileState state = { 0 };
+
+  state.program = parent->program;
+  state.slots_by_name = parent->slots_by_name;
+  state.ops = new_op_array ();
+  state.text = g_string_new (NULL);
+
+  tmpl_node_visit_children (node, compile_visitor, &state);
+
+  flush_text (&state);
+  g_string_free (state.text, TRUE);
+
+  return state.ops;
+}
+
+static void
+compile_arm_visitor (TmplNode *node,
+                     gpointer  user_data)
+{
+  struct {
+    CompileState *state;
+    GArray       *arms;
+  } *data = user_data;
+  TmplExpr *condition;
+  TmplArm arm;
+
+  g_assert (TMPL_IS_CONDITION_NODE (node));
+
+  /* A condition without an expression can never match */
+  if (!(condition = tmpl_condition_node_get_condition (TMPL_CONDITION_NODE (node))))
+    return;
+
+  arm.condition = tmpl_expr_ref (condition);
+  arm.body = compile_children (data->state, node);
+
+  g_array_append_val (data->arms, arm);
+}
+
+static void
+compile_visitor (TmplNode *node,
+                 gpointer  user_data)
+{
+  CompileState *state = user_data;
+  TmplOp op = { 0 };
+
+  g_assert (TMPL_IS_NODE (node));
+  g_assert (state != NULL);
+
+  if (TMPL_IS_TEXT_NODE (node))
+    {
+      g_string_append (state->text, tmpl_text_node_get_text (TMPL_TEXT_NODE (node)));
+    }
+  else if (TMPL_IS_EXPR_NODE (node))
+    {
+      TmplExpr *expr = tmpl_expr_node_get_expr (TMPL_EXPR_NODE (node));
+
+      switch (expr->any.type)
+        {
+        case TMPL_EXPR_STRING:
+          /* Constant strings are folded into the surrounding text run */
+          if (expr->string.value != NULL)
+            g_string_append (state->text, expr->string.value);
+          break;
+
+        case TMPL_EXPR_SYMBOL_REF:
+          op.type = TMPL_OP_SYMBOL;
+          op.u.symbol.slot = get_slot (state, expr->sym_ref.symbol);
+          append_op (state, &op);
+          break;
+
+        default:
+          op.type = TMPL_OP_EXPR;
+          op.u.expr = tmpl_expr_ref (expr);
+          append_op (state, &op);
+          break;
+        }
+    }
+  else if (TMPL_IS_BRANCH_NODE (node) || TMPL_IS_CONDITION_NODE (node))
+    {
+      struct {
+        CompileState *state;
+        GArray       *arms;
+      } data = { state, NULL };
+
+      data.arms = g_array_new (FALSE, FALSE, sizeof (TmplArm));
+      g_array_set_clear_func (data.arms, clear_arm);
+
+      /*
+       * Branch nodes visit the (if) condition followed by each of the
+       * (else if) and (else) conditions, so we get them in order.
+       */
+      if (TMPL_IS_BRANCH_NODE (node))
+        tmpl_node_visit_children (node, compile_arm_visitor, &data);
+      else
+        compile_arm_visitor (node, &data);
+
+      op.type = TMPL_OP_BRANCH;
+      op.u.arms = data.arms;
+      append_op (state, &op);
+    }
+  else if (TMPL_IS_ITER_NODE (node))
+    {
+      op.type = TMPL_OP_ITER;
+      op.u.iter.identifier = g_strdup (tmpl_iter_node_get_identifier (TMPL_ITER_NODE (node)));
+      op.u.iter.expr = tmpl_expr_ref (tmpl_iter_node_get_expr (TMPL_ITER_NODE (node)));
+      op.u.iter.body = compile_children (state, node);
+      append_op (state, &op);
+    }
+  else
+    {
+      g_warning ("Teach me how to expand %s", G_OBJECT_TYPE_NAME (node));
+    }
+}
+
+/**
+ * tmpl_program_compile:
+ * @root: the root #TmplNode of a parsed template
+ *
+ * Compiles the node tree into a #TmplProgram that can be executed
+ * repeatedly without walking the node tree.
+ *
+ * Returns: (transfer full): A newly allocated #TmplProgram.
+ */
+TmplProgram *
+tmpl_program_compile (TmplNode *root)
+{
+  TmplProgram *self;
+  CompileState state = { 0 };
+
+  g_return_val_if_fail (TMPL_IS_NODE (root), NULL);
+
+  self = g_slice_new0 (TmplProgram);
+  self->slot_names = g_ptr_array_new_with_free_func (g_free);
+
+  state.program = self;
+  state.slots_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  state.ops = new_op_array ();
+  state.text = g_string_new (NULL);
+
+  tmpl_node_visit_children (root, compile_visitor, &state);
+
+  flush_text (&state);
+
+  self->ops = state.ops;
+
+  g_string_free (state.text, TRUE);
+  g_hash_table_unref (state.slots_by_name);
+
+  return self;
+}
+
+void
+tmpl_program_free (TmplProgram *self)
+{
+  if (self != NULL)
+    {
+      g_clear_pointer (&self->ops, g_array_unref);
+      g_clear_pointer (&self->slot_names, g_ptr_array_unref);
+      g_slice_free (TmplProgram, self);
+    }
+}
+
+static gboolean
+flush_output (ExecState *state,
+              gboolean   force)
+{
+  gboolean ret = TRUE;
+
+  if (state->output->len == 0)
+    return TRUE;
+
+  if (!force && state->output->len < FLUSH_THRESHOLD)
+    return TRUE;
+
+  ret = g_output_stream_write_all (state->stream,
+                                   state->output->str,
+                                   state->output->len,
+                                   NULL,
+                                   state->cancellable,
+                                   state->error);
+
+  g_string_truncate (state->output, 0);
+
+  return ret;
+}
+
+static void
+append_value (ExecState    *state,
+              const GValue *value)
+{
+  GValue transform = G_VALUE_INIT;
+
+  if (G_VALUE_HOLDS_STRING (value))
+    {
+      const gchar *str = g_value_get_string (value);
+
+      if (str != NULL)
+        g_string_append (state->output, str);
+
+      return;
+    }
+
+  g_value_init (&transform, G_TYPE_STRING);
+
+  if (g_value_transform (value, &transform))
+    {
+      const gchar *tmp;
+
+      if (NULL != (tmp = g_value_get_string (&transform)))
+        g_string_append (state->output, tmp);
+    }
+
+  g_value_unset (&transform);
+}
+
+static TmplSymbol *
+resolve_slot (ExecState  *state,
+              guint       slot)
+{
+  Slot *s = &state->slots [slot];
+  const gchar *name;
+
+  /*
+   * Slots are tagged with the scope frame they were resolved in. Frames
+   * are never reused, so a matching frame means the cached symbol is
+   * still the one tmpl_scope_peek() would return.
+   */
+  if (s->symbol != NULL && s->frame == state->frame)
+    return s->symbol;
+
+  name = g_ptr_array_index (state->program->slot_names, slot);
+
+  s->symbol = tmpl_scope_peek (state->scope, name);
+  s->frame = state->frame;
+
+  if (s->symbol == NULL)
+    {
+      g_set_error (state->error,
+                   TMPL_ERROR,
+                   TMPL_ERROR_MISSING_SYMBOL,
+                   "No such symbol \"%s\" in scope",
+                   name);
+      return NULL;
+    }
+
+  if (tmpl_symbol_get_symbol_type (s->symbol) != TMPL_SYMBOL_VALUE)
+    {
+      g_set_error (state->error,
+                   TMPL_ERROR,
+                   TMPL_ERROR_NOT_A_VALUE,
+                   "The symbol \"%s\" is not a value",
+                   name);
+      s->symbol = NULL;
+      return NULL;
+    }
+
+  return s->symbol;
+}
+
+static gboolean
+execute_op (ExecState *state,
+            TmplOp    *op)
+{
+  GValue value = G_VALUE_INIT;
+  TmplSymbol *symbol;
+  guint i;
+
+  switch (op->type)
+    {
+    case TMPL_OP_TEXT:
+      g_string_append_len (state->output, op->u.text.text, op->u.text.len);
+      return TRUE;
+
+    case TMPL_OP_SYMBOL:
+      if (!(symbol = resolve_slot (state, op->u.symbol.slot)))
+        return FALSE;
+      tmpl_symbol_get_value (symbol, &value);
+      append_value (state, &value);
+      TMPL_CLEAR_VALUE (&value);
+      return TRUE;
+
+    case TMPL_OP_EXPR:
+      if (!tmpl_expr_eval (op->u.expr, state->scope, &value, state->error))
+        return FALSE;
+      append_value (state, &value);
+      TMPL_CLEAR_VALUE (&value);
+      return TRUE;
+
+    case TMPL_OP_BRANCH:
+      for (i = 0; i < op->u.arms->len; i++)
+        {
+          TmplArm *arm = &g_array_index (op->u.arms, TmplArm, i);
+          gboolean matches;
+
+          if (!tmpl_expr_eval (arm->condition, state->scope, &value, state->error))
+            return FALSE;
+
+          matches = tmpl_value_as_boolean (&value);
+          TMPL_CLEAR_VALUE (&value);
+
+          if (matches)
+            return execute_ops (state, arm->body);
+        }
+      return TRUE;
+
+    case TMPL_OP_ITER:
+      if (!tmpl_expr_eval (op->u.iter.expr, state->scope, &value, state->error))
+        return FALSE;
+
+      if (tmpl_value_as_boolean (&value))
+        {
+          TmplIterator iter;
+          TmplScope *old_scope = state->scope;
+          TmplScope *new_scope = tmpl_scope_new_with_parent (old_scope);
+          guint old_frame = state->frame;
+          gboolean ret = TRUE;
+
+          symbol = tmpl_scope_get (new_scope, op->u.iter.identifier);
+
+          state->scope = new_scope;
+          state->frame = ++state->last_frame;
+
+          tmpl_iterator_init (&iter, &value);
+
+          while (ret && tmpl_iterator_next (&iter))
+            {
+              GValue item = G_VALUE_INIT;
+
+              tmpl_iterator_get_value (&iter, &item);
+              tmpl_symbol_assign_value (symbol, &item);
+              TMPL_CLEAR_VALUE (&item);
+
+              ret = execute_ops (state, op->u.iter.body);
+            }
+
+          state->scope = old_scope;
+          state->frame = old_frame;
+
+          tmpl_scope_unref (new_scope);
+
+          if (!ret)
+            {
+              TMPL_CLEAR_VALUE (&value);
+              return FALSE;
+            }
+        }
+
+      TMPL_CLEAR_VALUE (&value);
+      return TRUE;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  return FALSE;
+}
+
+static gboolean
+execute_ops (ExecState *state,
+             GArray    *ops)
+{
+  guint i;
+
+  for (i = 0; i < ops->len; i++)
+    {
+      if (!execute_op (state, &g_array_index (ops, TmplOp, i)))
+        return FALSE;
+
+      if (!flush_output (state, FALSE))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * tmpl_program_execute:
+ * @self: A #TmplProgram
+ * @scope: A #TmplScope containing the symbols for the template
+ * @stream: A #GOutputStream to write the result to
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @error: A location for a #GError, or %NULL
+ *
+ * Executes the program, writing output to @stream as it is produced.
+ *
+ * Returns: %TRUE if successful; otherwise %FALSE and @error is set.
+ */
+gboolean
+tmpl_program_execute (TmplProgram    *self,
+                      TmplScope      *scope,
+                      GOutputStream  *stream,
+                      GCancellable   *cancellable,
+                      GError        **error)
+{
+  ExecState state = { 0 };
+  gboolean ret;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (scope != NULL, FALSE);
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+  state.program = self;
+  state.slots = g_new0 (Slot, self->slot_names->len);
+  state.scope = scope;
+  state.frame = 1;
+  state.last_frame = 1;
+  state.output = g_string_sized_new (FLUSH_THRESHOLD);
+  state.stream = stream;
+  state.cancellable = cancellable;
+  state.error = error;
+
+  ret = execute_ops (&state, self->ops) && flush_output (&state, TRUE);
+
+  g_string_free (state.output, TRUE);
+  g_free (state.slots);
+
+  return ret;
+}
@@ -93,6 +93,86 @@ tmpl_scope_new_with_parent (TmplScope *parent)
   return self;
 }
 
+static TmplSymbol *
+tmpl_scope_copy_symbol (TmplSymbol *symbol)
+{
+  TmplSymbol *copy;
+
+  copy = tmpl_symbol_new ();
+
+  if (tmpl_symbol_get_symbol_type (symbol) == TMPL_SYMBOL_EXPR)
+    {
+      GPtrArray *params = NULL;
+      TmplExpr *expr;
+
+      expr = tmpl_symbol_get_expr (symbol, &params);
+      tmpl_symbol_assign_expr (copy, expr, params);
+    }
+  else
+    {
+      GValue value = G_VALUE_INIT;
+
+      tmpl_symbol_get_value (symbol, &value);
+      tmpl_symbol_assign_value (copy, &value);
+      if (G_VALUE_TYPE (&value) != G_TYPE_INVALID)
+        g_value_unset (&value);
+    }
+
+  return copy;
+}
+
+/**
+ * tmpl_scope_copy:
+ * @self: A #TmplScope
+ *
+ * Creates a new scope containing a copy of every symbol visible from @self,
+ * including those inherited from parent scopes. Assigning to symbols in the
+ * copy does not modify @self or its parents.
+ *
+ * Returns: (transfer full): A newly created #TmplScope.
+ */
+TmplScope *
+tmpl_scope_copy (TmplScope *self)
+{
+  g_autoptr(GPtrArray) chain = NULL;
+  TmplScope *copy;
+  TmplScope *iter;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  copy = tmpl_scope_new ();
+  copy->symbols = g_hash_table_new_full (g_str_hash,
+                                         g_str_equal,
+                                         g_free,
+                                         (GDestroyNotify)tmpl_symbol_unref);
+
+  chain = g_ptr_array_new ();
+  for (iter = self; iter != NULL; iter = iter->parent)
+    g_ptr_array_add (chain, iter);
+
+  /* Walk from the outermost scope so inner definitions shadow outer ones */
+  for (i = chain->len; i > 0; i--)
+    {
+      GHashTableIter hiter;
+      gpointer key;
+      gpointer value;
+
+      iter = g_ptr_array_index (chain, i - 1);
+
+      if (iter->symbols == NULL)
+        continue;
+
+      g_hash_table_iter_init (&hiter, iter->symbols);
+      while (g_hash_table_iter_next (&hiter, &key, &value))
+        g_hash_table_insert (copy->symbols,
+                             g_strdup (key),
+                             tmpl_scope_copy_symbol (value));
+    }
+
+  return copy;
+}
+
 static TmplSymbol *
 tmpl_scope_get_full (TmplScope   *self,
                      const gchar *name,
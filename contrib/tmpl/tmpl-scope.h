@@ -29,6 +29,7 @@ G_BEGIN_DECLS
 
 TmplScope  *tmpl_scope_new             (void);
 TmplScope  *tmpl_scope_new_with_parent (TmplScope   *parent);
+TmplScope  *tmpl_scope_copy            (TmplScope   *self);
 TmplScope  *tmpl_scope_ref             (TmplScope   *self);
 void        tmpl_scope_unref           (TmplScope   *self);
 TmplSymbol *tmpl_scope_peek            (TmplScope   *self,
@@ -21,35 +21,19 @@
 #include <glib/gi18n.h>
 #include <string.h>
 
-#include "tmpl-branch-node.h"
-#include "tmpl-condition-node.h"
 #include "tmpl-error.h"
-#include "tmpl-expr-node.h"
-#include "tmpl-iter-node.h"
-#include "tmpl-iterator.h"
 #include "tmpl-parser.h"
+#include "tmpl-program-private.h"
 #include "tmpl-scope.h"
-#include "tmpl-symbol.h"
 #include "tmpl-template.h"
-#include "tmpl-text-node.h"
-#include "tmpl-util-private.h"
 
 typedef struct
 {
   TmplParser          *parser;
+  TmplProgram         *program;
   TmplTemplateLocator *locator;
 } TmplTemplatePrivate;
 
-typedef struct
-{
-  TmplTemplate   *self;
-  TmplNode       *root;
-  GString        *output;
-  TmplScope      *scope;
-  GError        **error;
-  gboolean        result;
-} TmplTemplateExpandState;
-
 G_DEFINE_TYPE_WITH_PRIVATE (TmplTemplate, tmpl_template, G_TYPE_OBJECT)
 
 enum {
@@ -67,6 +51,7 @@ tmpl_template_finalize (GObject *object)
   TmplTemplatePrivate *priv = tmpl_template_get_instance_private (self);
 
   g_clear_object (&priv->parser);
+  g_clear_pointer (&priv->program, tmpl_program_free);
 
   G_OBJECT_CLASS (tmpl_template_parent_class)->finalize (object);
 }
@@ -264,6 +249,8 @@ tmpl_template_parse (TmplTemplate  *self,
   if (tmpl_parser_parse (parser, cancellable, error))
     {
       g_set_object (&priv->parser, parser);
+      g_clear_pointer (&priv->program, tmpl_program_free);
+      priv->program = tmpl_program_compile (tmpl_parser_get_root (parser));
       ret = TRUE;
     }
 
@@ -272,143 +259,6 @@ tmpl_template_parse (TmplTemplate  *self,
   return ret;
 }
 
-static void
-value_into_string (const GValue *value,
-                   GString      *str)
-{
-  GValue transform = G_VALUE_INIT;
-
-  g_value_init (&transform, G_TYPE_STRING);
-
-  if (g_value_transform (value, &transform))
-    {
-      const gchar *tmp;
-
-      if (NULL != (tmp = g_value_get_string (&transform)))
-        g_string_append (str, tmp);
-    }
-
-  g_value_unset (&transform);
-}
-
-static void
-tmpl_template_expand_visitor (TmplNode *node,
-                              gpointer  user_data)
-{
-  TmplTemplateExpandState *state = user_data;
-
-  g_assert (TMPL_IS_NODE (node));
-  g_assert (state != NULL);
-
-/* Short cirtcuit if an error occurred */
-  if (state->result == FALSE)
-    return;
-
-  if (TMPL_IS_TEXT_NODE (node))
-    {
-      g_string_append (state->output, tmpl_text_node_get_text (TMPL_TEXT_NODE (node)));
-    }
-  else if (TMPL_IS_EXPR_NODE (node))
-    {
-      GValue return_value = { 0 };
-      TmplExpr *expr;
-
-      expr = tmpl_expr_node_get_expr (TMPL_EXPR_NODE (node));
-
-      if (!tmpl_expr_eval (expr, state->scope, &return_value, state->error))
-        {
-          state->result = FALSE;
-          return;
-        }
-
-      value_into_string (&return_value, state->output);
-      g_value_unset (&return_value);
-    }
-  else if (TMPL_IS_BRANCH_NODE (node))
-    {
-      TmplNode *child;
-      GError *local_error = NULL;
-
-      child = tmpl_branch_node_branch (TMPL_BRANCH_NODE (node), state->scope, &local_error);
-
-      if (child != NULL)
-        tmpl_node_visit_children (child, tmpl_template_expand_visitor, state);
-      else if (local_error != NULL)
-        {
-          g_propagate_error (state->error, local_error);
-          state->result = FALSE;
-        }
-    }
-  else if (TMPL_IS_CONDITION_NODE (node))
-    {
-      TmplExpr *expr;
-      GValue value = G_VALUE_INIT;
-
-      expr = tmpl_condition_node_get_condition (TMPL_CONDITION_NODE (node));
-
-      if (!tmpl_expr_eval (expr, state->scope, &value, state->error))
-        {
-          state->result = FALSE;
-          return;
-        }
-
-      if (tmpl_value_as_boolean (&value))
-        tmpl_node_visit_children (node, tmpl_template_expand_visitor, state);
-
-      TMPL_CLEAR_VALUE (&value);
-    }
-  else if (TMPL_IS_ITER_NODE (node))
-    {
-      const gchar *identifier;
-      TmplExpr *expr;
-      GValue return_value = G_VALUE_INIT;
-
-      identifier = tmpl_iter_node_get_identifier (TMPL_ITER_NODE (node));
-
-      expr = tmpl_iter_node_get_expr (TMPL_ITER_NODE (node));
-
-      if (!tmpl_expr_eval (expr, state->scope, &return_value, state->error))
-        {
-          state->result = FALSE;
-          return;
-        }
-
-      if (tmpl_value_as_boolean (&return_value))
-        {
-          TmplIterator iter;
-          TmplScope *old_scope = state->scope;
-          TmplScope *new_scope = tmpl_scope_new_with_parent (old_scope);
-          TmplSymbol *symbol;
-
-          state->scope = new_scope;
-
-          symbol = tmpl_scope_get (new_scope, identifier);
-
-          tmpl_iterator_init (&iter, &return_value);
-
-          while (tmpl_iterator_next (&iter))
-            {
-              GValue value = G_VALUE_INIT;
-
-              tmpl_iterator_get_value (&iter, &value);
-              tmpl_symbol_assign_value (symbol, &value);
-              TMPL_CLEAR_VALUE (&value);
-
-              tmpl_node_visit_children (node, tmpl_template_expand_visitor, state);
-            }
-
-          state->scope = old_scope;
-          tmpl_scope_unref (new_scope);
-        }
-
-      g_value_unset (&return_value);
-    }
-  else
-    {
-      g_warning ("Teach me how to expand %s", G_OBJECT_TYPE_NAME (node));
-    }
-}
-
 /**
  * tmpl_template_expand:
  * @self: A TmplTemplate.
@@ -426,6 +276,10 @@ tmpl_template_expand_visitor (TmplNode *node,
  * To set a symbol value, get the symbol with tmpl_scope_get() and assign
  * a value using tmpl_scope_assign_value() or similar methods.
  *
+ * Output is written to @stream incrementally as the template is expanded.
+ * Once parsed, a template may be expanded from multiple threads at the
+ * same time provided that @scope is not modified during expansion.
+ *
  * Returns: %TRUE if successful, otherwise %FALSE and @error is set.
  */
 gboolean
@@ -436,14 +290,14 @@ tmpl_template_expand (TmplTemplate  *self,
                       GError       **error)
 {
   TmplTemplatePrivate *priv = tmpl_template_get_instance_private (self);
-  TmplTemplateExpandState state = { 0 };
   TmplScope *local_scope = NULL;
+  gboolean ret;
 
   g_return_val_if_fail (TMPL_IS_TEMPLATE (self), FALSE);
   g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
   g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), FALSE);
 
-  if (priv->parser == NULL)
+  if (priv->program == NULL)
     {
       g_set_error (error,
                    TMPL_ERROR,
@@ -455,29 +309,12 @@ tmpl_template_expand (TmplTemplate  *self,
   if (scope == NULL)
     scope = local_scope = tmpl_scope_new ();
 
-  state.root = tmpl_parser_get_root (priv->parser);
-  state.self = self;
-  state.output = g_string_new (NULL);
-  state.result = TRUE;
-  state.error = error;
-  state.scope = scope;
-
-  tmpl_node_visit_children (state.root, tmpl_template_expand_visitor, &state);
-
-  if (state.result != FALSE)
-    state.result = g_output_stream_write_all (stream,
-                                              state.output->str,
-                                              state.output->len,
-                                              NULL,
-                                              cancellable,
-                                              error);
-
-  g_string_free (state.output, TRUE);
+  ret = tmpl_program_execute (priv->program, scope, stream, cancellable, error);
 
   if (local_scope != NULL)
     tmpl_scope_unref (local_scope);
 
-  return state.result;
+  return ret;
 }
 
 /**
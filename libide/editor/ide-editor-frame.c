@@ -24,6 +24,7 @@
 #include "ide-editor-frame.h"
 #include "ide-editor-map-bin.h"
 #include "ide-gtk.h"
+#include "ide-internal.h"
 #include "ide-layout-stack.h"
 #include "ide-source-location.h"
 #include "ide-workbench.h"
@@ -203,7 +204,7 @@ ide_editor_frame_set_position_label (IdeEditorFrame *self,
 static void
 ide_editor_frame_update_search_position_label (IdeEditorFrame *self)
 {
-  GtkSourceSearchContext *search_context;
+  IdeSourceSearchIndex *search_index;
   GtkStyleContext *context;
   GtkTextBuffer *buffer;
   GtkTextIter begin;
@@ -216,10 +217,10 @@ ide_editor_frame_update_search_position_label (IdeEditorFrame *self)
   g_return_if_fail (IDE_IS_EDITOR_FRAME (self));
 
   buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->source_view));
-  search_context = ide_source_view_get_search_context (self->source_view);
+  search_index = _ide_source_view_get_search_index (self->source_view);
   gtk_text_buffer_get_selection_bounds (buffer, &begin, &end);
-  pos = gtk_source_search_context_get_occurrence_position (search_context, &begin, &end);
-  count = gtk_source_search_context_get_occurrences_count (search_context);
+  pos = ide_source_search_index_get_occurrence_position (search_index, &begin, &end);
+  count = ide_source_search_index_get_occurrences_count (search_index);
 
   if ((pos == -1) || (count == -1))
     {
@@ -245,12 +246,12 @@ ide_editor_frame_update_search_position_label (IdeEditorFrame *self)
 }
 
 static void
-ide_editor_frame_on_search_occurrences_notify (IdeEditorFrame          *self,
-                                              GParamSpec             *pspec,
-                                              GtkSourceSearchContext *search_context)
+ide_editor_frame_on_search_occurrences_notify (IdeEditorFrame       *self,
+                                              GParamSpec           *pspec,
+                                              IdeSourceSearchIndex *search_index)
 {
   g_assert (IDE_IS_EDITOR_FRAME (self));
-  g_assert (GTK_SOURCE_IS_SEARCH_CONTEXT (search_context));
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (search_index));
 
   ide_editor_frame_update_search_position_label (self);
 }
@@ -358,7 +359,7 @@ ide_editor_frame_set_document (IdeEditorFrame *self,
                                (G_BINDING_SYNC_CREATE | G_BINDING_BIDIRECTIONAL),
                                search_text_transform_to, search_text_transform_from,
                                NULL, NULL);
-  g_signal_connect_object (search_context,
+  g_signal_connect_object (_ide_source_view_get_search_index (self->source_view),
                            "notify::occurrences-count",
                            G_CALLBACK (ide_editor_frame_on_search_occurrences_notify),
                            self,
@@ -29,7 +29,9 @@
 #include "ide-editor-perspective.h"
 #include "ide-editor-view.h"
 #include "ide-gtk.h"
+#include "ide-internal.h"
 #include "ide-layout-grid.h"
+#include "ide-layout-stack.h"
 #include "ide-workbench-header-bar.h"
 
 struct _IdeEditorPerspective
@@ -150,8 +152,10 @@ ide_editor_perspective_load_buffer (IdeEditorPerspective *self,
                                     IdeBufferManager     *buffer_manager)
 {
   IdeEditorView *view;
+  GtkWidget *active_view;
   GtkWidget *stack;
   IdeWorkbench *workbench;
+  IdeContext *context;
 
   g_assert (IDE_IS_EDITOR_PERSPECTIVE (self));
   g_assert (IDE_IS_BUFFER (buffer));
@@ -165,9 +169,22 @@ ide_editor_perspective_load_buffer (IdeEditorPerspective *self,
                        NULL);
 
   stack = ide_layout_grid_get_last_focus (self->grid);
+  active_view = ide_layout_stack_get_active_view (IDE_LAYOUT_STACK (stack));
+  context = ide_buffer_get_context (buffer);
 
   gtk_container_add (GTK_CONTAINER (stack), GTK_WIDGET (view));
 
+  /*
+   * While restoring a session, add the views in the background. The buffer
+   * manager focuses the most recently used buffer once it has loaded, and
+   * the remaining views are only materialized when the user shows them.
+   */
+  if (_ide_context_is_restoring (context) && active_view != NULL)
+    {
+      ide_layout_stack_set_active_view (IDE_LAYOUT_STACK (stack), active_view);
+      return;
+    }
+
   workbench = ide_widget_get_workbench (GTK_WIDGET (stack));
   ide_workbench_focus (workbench, GTK_WIDGET (view));
 }
@@ -325,6 +325,32 @@ ide_editor_view__buffer_cursor_moved (IdeEditorView      *self,
   g_free (str);
 }
 
+static void
+ide_editor_view__buffer_notify_large_file_mode (IdeEditorView *self,
+                                                GParamSpec    *pspec,
+                                                IdeBuffer     *document)
+{
+  g_assert (IDE_IS_EDITOR_VIEW (self));
+  g_assert (IDE_IS_BUFFER (document));
+
+  /*
+   * Large file mode is decided while loading, after the document is set.
+   * Bracket matching scans the buffer on every cursor movement, so it is
+   * kept off while the file is paged in.
+   */
+  if (ide_buffer_get_large_file_mode (document))
+    {
+      g_settings_unbind (document, "highlight-matching-brackets");
+      gtk_source_buffer_set_highlight_matching_brackets (GTK_SOURCE_BUFFER (document), FALSE);
+    }
+  else
+    {
+      g_settings_bind (self->settings, "highlight-matching-brackets",
+                       document, "highlight-matching-brackets",
+                       G_SETTINGS_BIND_GET);
+    }
+}
+
 static void
 ide_editor_view_set_document (IdeEditorView *self,
                               IdeBuffer     *document)
@@ -343,9 +369,13 @@ ide_editor_view_set_document (IdeEditorView *self,
       g_settings_bind (self->settings, "style-scheme-name",
                        document, "style-scheme-name",
                        G_SETTINGS_BIND_GET);
-      g_settings_bind (self->settings, "highlight-matching-brackets",
-                       document, "highlight-matching-brackets",
-                       G_SETTINGS_BIND_GET);
+
+      g_signal_connect_object (document,
+                               "notify::large-file-mode",
+                               G_CALLBACK (ide_editor_view__buffer_notify_large_file_mode),
+                               self,
+                               G_CONNECT_SWAPPED);
+      ide_editor_view__buffer_notify_large_file_mode (self, NULL, document);
 
       g_signal_connect_object (document,
                                "cursor-moved",
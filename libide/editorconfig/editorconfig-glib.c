@@ -16,8 +16,6 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <editorconfig/editorconfig.h>
-
 #include "editorconfig-glib.h"
 
 static void
@@ -30,90 +28,42 @@ _g_value_free (gpointer data)
 }
 
 GHashTable *
-editorconfig_glib_read (GFile         *file,
-                        GCancellable  *cancellable,
-                        GError       **error)
+editorconfig_glib_table_new (void)
 {
-  editorconfig_handle handle = { 0 };
-  GHashTable *ret = NULL;
-  gchar *filename = NULL;
-  gint code;
-  gint count;
-  guint i;
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _g_value_free);
+}
 
-  filename = g_file_get_path (file);
+void
+editorconfig_glib_table_insert (GHashTable  *table,
+                                const gchar *key,
+                                const gchar *valuestr)
+{
+  GValue *value;
 
-  if (!filename)
-    {
-      /*
-       * This sucks, but we need to basically rewrite editorconfig library
-       * to support this. Not out of the question, but it is for today.
-       */
-      g_set_error (error,
-                   G_IO_ERROR,
-                   G_IO_ERROR_NOT_SUPPORTED,
-                   "only local files are currently supported");
-      return NULL;
-    }
+  g_return_if_fail (table != NULL);
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (valuestr != NULL);
 
-  handle = editorconfig_handle_init ();
-  code = editorconfig_parse (filename, handle);
+  value = g_new0 (GValue, 1);
 
-  switch (code)
+  if ((g_strcmp0 (key, "tab_width") == 0) ||
+      (g_strcmp0 (key, "max_line_length") == 0) ||
+      (g_strcmp0 (key, "indent_size") == 0))
     {
-    case 0:
-      break;
-
-    case EDITORCONFIG_PARSE_NOT_FULL_PATH:
-    case EDITORCONFIG_PARSE_MEMORY_ERROR:
-    case EDITORCONFIG_PARSE_VERSION_TOO_NEW:
-    default:
-      g_set_error (error,
-                   G_IO_ERROR,
-                   G_IO_ERROR_FAILED,
-                   "Failed to parse editorconfig.");
-      goto cleanup;
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
     }
-
-  count = editorconfig_handle_get_name_value_count (handle);
-
-  ret = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _g_value_free);
-
-  for (i = 0; i < count; i++)
+  else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
+           (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
     {
-      GValue *value;
-      const gchar *key = NULL;
-      const gchar *valuestr = NULL;
-
-      value = g_new0 (GValue, 1);
-
-      editorconfig_handle_get_name_value (handle, i, &key, &valuestr);
-
-      if ((g_strcmp0 (key, "tab_width") == 0) ||
-          (g_strcmp0 (key, "max_line_length") == 0) ||
-          (g_strcmp0 (key, "indent_size") == 0))
-        {
-          g_value_init (value, G_TYPE_INT);
-          g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
-        }
-      else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
-               (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
-        {
-          g_value_init (value, G_TYPE_BOOLEAN);
-          g_value_set_boolean (value, g_str_equal (valuestr, "true"));
-        }
-      else
-        {
-          g_value_init (value, G_TYPE_STRING);
-          g_value_set_string (value, valuestr);
-        }
-
-      g_hash_table_replace (ret, g_strdup (key), value);
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, g_str_equal (valuestr, "true"));
+    }
+  else
+    {
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_string (value, valuestr);
     }
 
-cleanup:
-  editorconfig_handle_destroy (handle);
-  g_free (filename);
-
-  return ret;
+  g_hash_table_replace (table, g_strdup (key), value);
 }
@@ -13,8 +13,9 @@
 
 #include <gio/gio.h>
 
-GHashTable *editorconfig_glib_read (GFile         *file,
-                                    GCancellable  *cancellable,
-                                    GError       **error);
+GHashTable *editorconfig_glib_table_new    (void);
+void        editorconfig_glib_table_insert (GHashTable    *table,
+                                            const gchar   *key,
+                                            const gchar   *valuestr);
 
 #endif /* EDITORCONFIG_GLIB_H */
@@ -0,0 +1,1011 @@
+/* ide-editorconfig-cache.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-editorconfig-cache"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "editorconfig-glib.h"
+#include "ini.h"
+
+#include "ide-debug.h"
+#include "ide-internal.h"
+
+#include "ide-editorconfig-cache.h"
+
+/*
+ * IdeEditorconfigCache keeps every .editorconfig that has been consulted
+ * for a context in memory, along with its sections already translated into
+ * compiled regexes. Resolving the settings for a file only has to walk the
+ * cached directories from the root down and match the precompiled patterns,
+ * rather than re-reading and re-translating every file as
+ * editorconfig_parse() does.
+ *
+ * Directories without a .editorconfig are cached too, since they are the
+ * common case. Every probed path is watched with a GFileMonitor (created
+ * on the main thread) and dropped from the cache when it changes, is
+ * created, or is removed.
+ *
+ * Lookups coming from IdeEditorconfigFileSettings are queued and drained by
+ * a single worker thread, so that restoring a session with many files
+ * resolves all of them in one pass instead of one thread per file.
+ */
+
+#define CONFIG_FILE_NAME     ".editorconfig"
+#define MAX_PROPERTY_NAME    50
+#define MAX_PROPERTY_VALUE   255
+
+struct _IdeEditorconfigCache
+{
+  GObject     parent_instance;
+
+  /*
+   * Protects files, pending, and draining. Lookups happen from worker
+   * threads while invalidation happens from the main thread.
+   */
+  GMutex      mutex;
+
+  /* Path of .editorconfig -> EditorconfigFile */
+  GHashTable *files;
+
+  /* Queued GTask from ide_editorconfig_cache_lookup_async() */
+  GPtrArray  *pending;
+
+  /* Path of .editorconfig -> GFileMonitor, main thread only */
+  GHashTable *monitors;
+
+  guint       draining : 1;
+};
+
+typedef struct
+{
+  gint num1;
+  gint num2;
+} EditorconfigRange;
+
+typedef struct
+{
+  gchar     *name;
+  GRegex    *regex;
+  GArray    *ranges;
+  GPtrArray *pairs;
+} EditorconfigSection;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  gchar         *directory;
+  GPtrArray     *sections;
+  guint          is_root : 1;
+  guint          failed : 1;
+} EditorconfigFile;
+
+typedef struct
+{
+  IdeEditorconfigCache *self;
+  gchar                *path;
+} WatchRequest;
+
+G_DEFINE_TYPE (IdeEditorconfigCache, ide_editorconfig_cache, G_TYPE_OBJECT)
+
+static GRegex *
+get_range_regex (void)
+{
+  static GRegex *range_regex;
+
+  if (g_once_init_enter (&range_regex))
+    {
+      GRegex *regex;
+
+      regex = g_regex_new ("^\\{[\\+\\-]?\\d+\\.\\.[\\+\\-]?\\d+\\}$",
+                           G_REGEX_OPTIMIZE, 0, NULL);
+      g_assert (regex != NULL);
+      g_once_init_leave (&range_regex, regex);
+    }
+
+  return range_regex;
+}
+
+static void
+editorconfig_section_free (gpointer data)
+{
+  EditorconfigSection *section = data;
+
+  g_clear_pointer (&section->name, g_free);
+  g_clear_pointer (&section->regex, g_regex_unref);
+  g_clear_pointer (&section->ranges, g_array_unref);
+  g_clear_pointer (&section->pairs, g_ptr_array_unref);
+  g_slice_free (EditorconfigSection, section);
+}
+
+static EditorconfigFile *
+editorconfig_file_ref (EditorconfigFile *file)
+{
+  g_assert (file != NULL);
+  g_assert (file->ref_count > 0);
+
+  g_atomic_int_inc (&file->ref_count);
+
+  return file;
+}
+
+static void
+editorconfig_file_unref (EditorconfigFile *file)
+{
+  g_assert (file != NULL);
+  g_assert (file->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&file->ref_count))
+    {
+      g_clear_pointer (&file->directory, g_free);
+      g_clear_pointer (&file->sections, g_ptr_array_unref);
+      g_slice_free (EditorconfigFile, file);
+    }
+}
+
+static void
+watch_request_free (gpointer data)
+{
+  WatchRequest *request = data;
+
+  g_clear_object (&request->self);
+  g_clear_pointer (&request->path, g_free);
+  g_slice_free (WatchRequest, request);
+}
+
+/*
+ * Translates an editorconfig glob into a regex, following the rules of
+ * ec_glob() in contrib/libeditorconfig. Numeric ranges ({num1..num2})
+ * become capture groups whose bounds are appended to @ranges, since they
+ * need to be checked after the regex has matched.
+ */
+static gchar *
+translate_glob (const gchar *pattern,
+                GArray      *ranges)
+{
+  GString *str;
+  GString *regex;
+  gboolean braces_paired;
+  gboolean in_bracket = FALSE;
+  gint brace_level = 0;
+  gint left_count = 0;
+  gint right_count = 0;
+  gsize i;
+
+  g_assert (pattern != NULL);
+  g_assert (ranges != NULL);
+
+  /* We may need to escape a closing brace ahead of the cursor */
+  str = g_string_new (pattern);
+  regex = g_string_new ("^");
+
+  for (i = 0; i < str->len; i++)
+    {
+      if (str->str [i] == '\\' && str->str [i + 1] != '\0')
+        i++;
+      else if (str->str [i] == '{')
+        left_count++;
+      else if (str->str [i] == '}')
+        right_count++;
+    }
+
+  braces_paired = (left_count == right_count);
+
+  for (i = 0; i < str->len; i++)
+    {
+      gchar ch = str->str [i];
+
+      switch (ch)
+        {
+        case '\\':
+          if (str->str [i + 1] != '\0')
+            {
+              g_string_append_c (regex, '\\');
+              g_string_append_c (regex, str->str [++i]);
+            }
+          else
+            g_string_append (regex, "\\\\");
+          break;
+
+        case '?':
+          g_string_append_c (regex, '.');
+          break;
+
+        case '*':
+          if (str->str [i + 1] == '*')
+            {
+              g_string_append (regex, ".*");
+              i++;
+            }
+          else
+            g_string_append (regex, "[^\\/]*");
+          break;
+
+        case '[':
+          if (in_bracket)
+            {
+              g_string_append (regex, "\\[");
+              break;
+            }
+          else
+            {
+              const gchar *close;
+              const gchar *iter;
+              gboolean has_slash = FALSE;
+
+              for (iter = &str->str [i]; *iter && *iter != ']'; iter++)
+                {
+                  if (*iter == '\\' && *(iter + 1) != '\0')
+                    iter++;
+                  else if (*iter == '/')
+                    {
+                      has_slash = TRUE;
+                      break;
+                    }
+                }
+
+              /* Brackets containing a slash are matched literally */
+              if (has_slash)
+                {
+                  g_autofree gchar *literal = NULL;
+                  g_autofree gchar *escaped = NULL;
+
+                  if (!(close = strchr (&str->str [i], ']')))
+                    close = &str->str [str->len - 1];
+
+                  literal = g_strndup (&str->str [i], close - &str->str [i] + 1);
+                  escaped = g_regex_escape_string (literal, -1);
+                  g_string_append (regex, escaped);
+                  i = close - str->str;
+                  break;
+                }
+            }
+
+          in_bracket = TRUE;
+
+          if (str->str [i + 1] == '!')
+            {
+              g_string_append (regex, "[^");
+              i++;
+            }
+          else
+            g_string_append_c (regex, '[');
+          break;
+
+        case ']':
+          in_bracket = FALSE;
+          g_string_append_c (regex, ']');
+          break;
+
+        case '-':
+          if (in_bracket)
+            g_string_append_c (regex, '-');
+          else
+            g_string_append (regex, "\\-");
+          break;
+
+        case '{':
+          if (!braces_paired)
+            {
+              g_string_append (regex, "\\{");
+              break;
+            }
+          else
+            {
+              gboolean is_single = TRUE;
+              gsize j;
+
+              for (j = i + 1; str->str [j] != '\0' && str->str [j] != '}'; j++)
+                {
+                  if (str->str [j] == '\\' && str->str [j + 1] != '\0')
+                    j++;
+                  else if (str->str [j] == ',')
+                    {
+                      is_single = FALSE;
+                      break;
+                    }
+                }
+
+              if (str->str [j] == '\0')
+                is_single = FALSE;
+
+              if (is_single)
+                {
+                  g_autofree gchar *group = g_strndup (&str->str [i], j - i + 1);
+                  EditorconfigRange range;
+
+                  if (!g_regex_match (get_range_regex (), group, 0, NULL))
+                    {
+                      /* {single} is literal, including its closing brace */
+                      g_string_append (regex, "\\{");
+                      g_string_insert_c (str, j, '\\');
+                      break;
+                    }
+
+                  range.num1 = atoi (group + 1);
+                  range.num2 = atoi (strstr (group, "..") + 2);
+                  g_array_append_val (ranges, range);
+
+                  g_string_append (regex, "([\\+\\-]?\\d+)");
+                  i = j;
+                  break;
+                }
+            }
+
+          brace_level++;
+          g_string_append (regex, "(?:");
+          break;
+
+        case '}':
+          if (!braces_paired)
+            {
+              g_string_append (regex, "\\}");
+              break;
+            }
+
+          brace_level--;
+          g_string_append_c (regex, ')');
+          break;
+
+        case ',':
+          if (brace_level > 0)
+            g_string_append_c (regex, '|');
+          else
+            g_string_append (regex, "\\,");
+          break;
+
+        case '/':
+          /* Non-capturing so that range groups keep their indexes */
+          if (strncmp (&str->str [i], "/**/", 4) == 0)
+            {
+              g_string_append (regex, "(?:\\/|\\/.*\\/)");
+              i += 3;
+            }
+          else
+            g_string_append (regex, "\\/");
+          break;
+
+        default:
+          if (!g_ascii_isalnum (ch))
+            g_string_append_c (regex, '\\');
+          g_string_append_c (regex, ch);
+          break;
+        }
+    }
+
+  g_string_append_c (regex, '$');
+  g_string_free (str, TRUE);
+
+  return g_string_free (regex, FALSE);
+}
+
+static EditorconfigSection *
+editorconfig_section_new (const gchar *directory,
+                          const gchar *name)
+{
+  EditorconfigSection *section;
+  g_autofree gchar *pattern = NULL;
+  g_autofree gchar *regex = NULL;
+  g_autoptr(GError) error = NULL;
+  const gchar *prefix;
+
+  g_assert (directory != NULL);
+  g_assert (name != NULL);
+
+  section = g_slice_new0 (EditorconfigSection);
+  section->name = g_strdup (name);
+  section->ranges = g_array_new (FALSE, FALSE, sizeof (EditorconfigRange));
+  section->pairs = g_ptr_array_new_with_free_func (g_free);
+
+  /*
+   * Sections without a slash match at any depth below the directory,
+   * sections starting with a slash are anchored to the directory.
+   */
+  prefix = g_str_equal (directory, "/") ? "" : directory;
+
+  if (strchr (name, '/') == NULL)
+    pattern = g_strdup_printf ("%s/**/%s", prefix, name);
+  else if (*name != '/')
+    pattern = g_strdup_printf ("%s/%s", prefix, name);
+  else
+    pattern = g_strdup_printf ("%s%s", prefix, name);
+
+  regex = translate_glob (pattern, section->ranges);
+  section->regex = g_regex_new (regex, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &error);
+
+  if (section->regex == NULL)
+    g_debug ("Ignoring section [%s]: %s", name, error->message);
+
+  return section;
+}
+
+static gboolean
+editorconfig_section_matches (EditorconfigSection *section,
+                              const gchar         *path)
+{
+  g_autoptr(GMatchInfo) match_info = NULL;
+  guint i;
+
+  g_assert (section != NULL);
+  g_assert (path != NULL);
+
+  if (section->regex == NULL)
+    return FALSE;
+
+  if (!g_regex_match (section->regex, path, 0, &match_info))
+    return FALSE;
+
+  for (i = 0; i < section->ranges->len; i++)
+    {
+      const EditorconfigRange *range = &g_array_index (section->ranges, EditorconfigRange, i);
+      g_autofree gchar *str = g_match_info_fetch (match_info, i + 1);
+      gint num;
+
+      /* Zero-prefixed numbers such as 010 never match */
+      if (str == NULL || *str == '0')
+        return FALSE;
+
+      num = atoi (str);
+
+      if (num < range->num1 || num > range->num2)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Checks whether section @name of a .editorconfig found in @directory
+ * applies to @path. Used by the unit tests for the glob translation.
+ */
+gboolean
+_ide_editorconfig_section_matches (const gchar *directory,
+                                   const gchar *name,
+                                   const gchar *path)
+{
+  EditorconfigSection *section;
+  gboolean ret;
+
+  g_return_val_if_fail (directory != NULL, FALSE);
+  g_return_val_if_fail (name != NULL, FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+
+  section = editorconfig_section_new (directory, name);
+  ret = editorconfig_section_matches (section, path);
+  editorconfig_section_free (section);
+
+  return ret;
+}
+
+static gboolean
+name_is_case_insensitive (const gchar *name)
+{
+  return (g_str_equal (name, "end_of_line") ||
+          g_str_equal (name, "indent_style") ||
+          g_str_equal (name, "indent_size") ||
+          g_str_equal (name, "insert_final_newline") ||
+          g_str_equal (name, "trim_trailing_whitespace") ||
+          g_str_equal (name, "charset"));
+}
+
+static int
+editorconfig_file_ini_handler (void       *user_data,
+                               const char *section_name,
+                               const char *name,
+                               const char *value)
+{
+  EditorconfigFile *file = user_data;
+  EditorconfigSection *section = NULL;
+  gchar *lower_name;
+  gchar *lower_value;
+
+  g_assert (file != NULL);
+  g_assert (section_name != NULL);
+  g_assert (name != NULL);
+  g_assert (value != NULL);
+
+  if (*section_name == '\0')
+    {
+      if (g_ascii_strcasecmp (name, "root") == 0 &&
+          g_ascii_strcasecmp (value, "true") == 0)
+        file->is_root = TRUE;
+      return 1;
+    }
+
+  if (strlen (name) >= MAX_PROPERTY_NAME || strlen (value) >= MAX_PROPERTY_VALUE)
+    return 0;
+
+  if (file->sections->len > 0)
+    section = g_ptr_array_index (file->sections, file->sections->len - 1);
+
+  if (section == NULL || !g_str_equal (section->name, section_name))
+    {
+      section = editorconfig_section_new (file->directory, section_name);
+      g_ptr_array_add (file->sections, section);
+    }
+
+  lower_name = g_ascii_strdown (name, -1);
+
+  if (name_is_case_insensitive (lower_name))
+    lower_value = g_ascii_strdown (value, -1);
+  else
+    lower_value = g_strdup (value);
+
+  g_ptr_array_add (section->pairs, lower_name);
+  g_ptr_array_add (section->pairs, lower_value);
+
+  return 1;
+}
+
+static EditorconfigFile *
+editorconfig_file_new (const gchar *directory,
+                       const gchar *path)
+{
+  EditorconfigFile *file;
+  gint ret;
+
+  g_assert (directory != NULL);
+  g_assert (path != NULL);
+
+  file = g_slice_new0 (EditorconfigFile);
+  file->ref_count = 1;
+  file->directory = g_strdup (directory);
+  file->sections = g_ptr_array_new_with_free_func (editorconfig_section_free);
+
+  /* -1 means we failed to open the file, which is the common case */
+  if ((ret = ini_parse (path, editorconfig_file_ini_handler, file)) > 0)
+    {
+      g_debug ("Failed to parse %s at line %d", path, ret);
+      file->failed = TRUE;
+    }
+
+  return file;
+}
+
+static void
+ide_editorconfig_cache_monitor_changed (IdeEditorconfigCache *self,
+                                        GFile                *file,
+                                        GFile                *other_file,
+                                        GFileMonitorEvent     event,
+                                        GFileMonitor         *monitor)
+{
+  g_autofree gchar *path = NULL;
+
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (self));
+  g_assert (G_IS_FILE (file));
+  g_assert (G_IS_FILE_MONITOR (monitor));
+
+  if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    return;
+
+  if (!(path = g_file_get_path (file)))
+    return;
+
+  IDE_TRACE_MSG ("Invalidating %s", path);
+
+  g_mutex_lock (&self->mutex);
+  g_hash_table_remove (self->files, path);
+  g_mutex_unlock (&self->mutex);
+}
+
+static gboolean
+ide_editorconfig_cache_watch (gpointer data)
+{
+  WatchRequest *request = data;
+  IdeEditorconfigCache *self = request->self;
+  g_autoptr(GFile) file = NULL;
+  GFileMonitor *monitor;
+
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (self));
+  g_assert (request->path != NULL);
+
+  if (self->monitors == NULL || g_hash_table_contains (self->monitors, request->path))
+    return G_SOURCE_REMOVE;
+
+  /*
+   * Monitoring a missing file works as well, so we also notice when an
+   * .editorconfig gets created in a directory we have already probed.
+   */
+  file = g_file_new_for_path (request->path);
+  monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+
+  if (monitor == NULL)
+    return G_SOURCE_REMOVE;
+
+  g_signal_connect_object (monitor,
+                           "changed",
+                           G_CALLBACK (ide_editorconfig_cache_monitor_changed),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_hash_table_insert (self->monitors, g_strdup (request->path), monitor);
+
+  return G_SOURCE_REMOVE;
+}
+
+static EditorconfigFile *
+ide_editorconfig_cache_get_file (IdeEditorconfigCache *self,
+                                 const gchar          *directory)
+{
+  g_autofree gchar *path = NULL;
+  EditorconfigFile *file;
+  EditorconfigFile *existing;
+  WatchRequest *request;
+
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (self));
+  g_assert (directory != NULL);
+
+  path = g_build_filename (directory, CONFIG_FILE_NAME, NULL);
+
+  g_mutex_lock (&self->mutex);
+  if ((file = g_hash_table_lookup (self->files, path)))
+    editorconfig_file_ref (file);
+  g_mutex_unlock (&self->mutex);
+
+  if (file != NULL)
+    return file;
+
+  /* Parse without holding the lock, another thread may beat us to it */
+  file = editorconfig_file_new (directory, path);
+
+  g_mutex_lock (&self->mutex);
+  if ((existing = g_hash_table_lookup (self->files, path)))
+    {
+      editorconfig_file_unref (file);
+      file = editorconfig_file_ref (existing);
+      g_mutex_unlock (&self->mutex);
+      return file;
+    }
+  g_hash_table_insert (self->files, g_strdup (path), editorconfig_file_ref (file));
+  g_mutex_unlock (&self->mutex);
+
+  request = g_slice_new0 (WatchRequest);
+  request->self = g_object_ref (self);
+  request->path = g_steal_pointer (&path);
+
+  g_main_context_invoke_full (NULL,
+                              G_PRIORITY_DEFAULT,
+                              ide_editorconfig_cache_watch,
+                              request,
+                              watch_request_free);
+
+  return file;
+}
+
+static GHashTable *
+ide_editorconfig_cache_resolve (IdeEditorconfigCache  *self,
+                                const gchar           *path,
+                                GError               **error)
+{
+  g_autoptr(GHashTable) values = NULL;
+  g_autoptr(GPtrArray) files = NULL;
+  g_autofree gchar *directory = NULL;
+  GHashTableIter iter;
+  const gchar *indent_style;
+  const gchar *indent_size;
+  const gchar *tab_width;
+  gpointer k, v;
+  GHashTable *ret;
+  gint i;
+
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (self));
+  g_assert (path != NULL);
+
+  if (!g_path_is_absolute (path))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_FILENAME,
+                   "editorconfig requires an absolute path");
+      return NULL;
+    }
+
+  files = g_ptr_array_new_with_free_func ((GDestroyNotify)editorconfig_file_unref);
+  directory = g_path_get_dirname (path);
+
+  /* Collect from the file's directory up to the root */
+  for (;;)
+    {
+      gchar *parent;
+
+      g_ptr_array_add (files, ide_editorconfig_cache_get_file (self, directory));
+
+      parent = g_path_get_dirname (directory);
+
+      if (g_str_equal (parent, directory))
+        {
+          g_free (parent);
+          break;
+        }
+
+      g_free (directory);
+      directory = parent;
+    }
+
+  values = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, NULL);
+
+  /* Apply from the root down so that nearer files take precedence */
+  for (i = (gint)files->len - 1; i >= 0; i--)
+    {
+      EditorconfigFile *file = g_ptr_array_index (files, i);
+      guint j;
+
+      if (file->failed)
+        {
+          g_set_error (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_FAILED,
+                       "Failed to parse editorconfig.");
+          return NULL;
+        }
+
+      if (file->is_root)
+        g_hash_table_remove_all (values);
+
+      for (j = 0; j < file->sections->len; j++)
+        {
+          EditorconfigSection *section = g_ptr_array_index (file->sections, j);
+          guint k;
+
+          if (!editorconfig_section_matches (section, path))
+            continue;
+
+          for (k = 0; k < section->pairs->len; k += 2)
+            g_hash_table_insert (values,
+                                 g_ptr_array_index (section->pairs, k),
+                                 g_ptr_array_index (section->pairs, k + 1));
+        }
+    }
+
+  /* Same post-processing as editorconfig_parse() for version 0.9 and newer */
+  indent_style = g_hash_table_lookup (values, "indent_style");
+  indent_size = g_hash_table_lookup (values, "indent_size");
+  tab_width = g_hash_table_lookup (values, "tab_width");
+
+  if (indent_style != NULL && indent_size == NULL && g_str_equal (indent_style, "tab"))
+    indent_size = "tab";
+
+  if (indent_size != NULL && tab_width != NULL && g_str_equal (indent_size, "tab"))
+    indent_size = tab_width;
+
+  if (indent_size != NULL && tab_width == NULL && !g_str_equal (indent_size, "tab"))
+    tab_width = indent_size;
+
+  if (indent_size != NULL)
+    g_hash_table_insert (values, "indent_size", (gpointer)indent_size);
+
+  if (tab_width != NULL)
+    g_hash_table_insert (values, "tab_width", (gpointer)tab_width);
+
+  ret = editorconfig_glib_table_new ();
+
+  g_hash_table_iter_init (&iter, values);
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    editorconfig_glib_table_insert (ret, k, v);
+
+  return ret;
+}
+
+static void
+ide_editorconfig_cache_drain_worker (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  IdeEditorconfigCache *self = source_object;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (self));
+
+  for (;;)
+    {
+      g_autoptr(GPtrArray) tasks = NULL;
+      guint i;
+
+      g_mutex_lock (&self->mutex);
+      if (self->pending->len == 0)
+        {
+          self->draining = FALSE;
+          g_mutex_unlock (&self->mutex);
+          break;
+        }
+      tasks = g_steal_pointer (&self->pending);
+      self->pending = g_ptr_array_new_with_free_func (g_object_unref);
+      g_mutex_unlock (&self->mutex);
+
+      IDE_TRACE_MSG ("Resolving editorconfig for %u files", tasks->len);
+
+      /*
+       * Resolve each path on its own so that a broken .editorconfig only
+       * fails the lookups beneath it. Parsed files are still shared through
+       * the cache, so the batch costs no more than before.
+       */
+      for (i = 0; i < tasks->len; i++)
+        {
+          GTask *item = g_ptr_array_index (tasks, i);
+          const gchar *path = g_task_get_task_data (item);
+          GHashTable *values;
+          GError *error = NULL;
+
+          if (g_task_return_error_if_cancelled (item))
+            continue;
+
+          if (!(values = ide_editorconfig_cache_resolve (self, path, &error)))
+            g_task_return_error (item, error);
+          else
+            g_task_return_pointer (item, values, (GDestroyNotify)g_hash_table_unref);
+        }
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * ide_editorconfig_cache_lookup_async:
+ * @self: An #IdeEditorconfigCache
+ * @file: A #GFile
+ * @cancellable: (allow-none): A #GCancellable or %NULL
+ * @callback: A callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Asynchronously resolves the editorconfig settings for @file.
+ *
+ * Requests made while a previous batch is being resolved are queued and
+ * resolved together in the same worker thread.
+ */
+void
+ide_editorconfig_cache_lookup_async (IdeEditorconfigCache *self,
+                                     GFile                *file,
+                                     GCancellable         *cancellable,
+                                     GAsyncReadyCallback   callback,
+                                     gpointer              user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autofree gchar *path = NULL;
+  gboolean start_worker = FALSE;
+
+  g_return_if_fail (IDE_IS_EDITORCONFIG_CACHE (self));
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_editorconfig_cache_lookup_async);
+
+  if (!(path = g_file_get_path (file)))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_NOT_SUPPORTED,
+                               "only local files are currently supported");
+      return;
+    }
+
+  g_task_set_task_data (task, g_steal_pointer (&path), g_free);
+
+  g_mutex_lock (&self->mutex);
+  g_ptr_array_add (self->pending, g_steal_pointer (&task));
+  if (!self->draining)
+    self->draining = start_worker = TRUE;
+  g_mutex_unlock (&self->mutex);
+
+  if (start_worker)
+    {
+      g_autoptr(GTask) drain = g_task_new (self, NULL, NULL, NULL);
+
+      g_task_run_in_thread (drain, ide_editorconfig_cache_drain_worker);
+    }
+}
+
+/**
+ * ide_editorconfig_cache_lookup_finish:
+ *
+ * Completes an asynchronous request to ide_editorconfig_cache_lookup_async().
+ *
+ * Returns: (transfer full): A #GHashTable of property names to #GValue.
+ */
+GHashTable *
+ide_editorconfig_cache_lookup_finish (IdeEditorconfigCache  *self,
+                                      GAsyncResult          *result,
+                                      GError               **error)
+{
+  g_return_val_if_fail (IDE_IS_EDITORCONFIG_CACHE (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * ide_editorconfig_cache_from_context:
+ * @context: An #IdeContext
+ *
+ * Gets the editorconfig cache shared by everything within @context,
+ * creating it if necessary. This must be called from the main thread.
+ *
+ * Returns: (transfer none): An #IdeEditorconfigCache.
+ */
+IdeEditorconfigCache *
+ide_editorconfig_cache_from_context (IdeContext *context)
+{
+  IdeEditorconfigCache *self;
+
+  g_return_val_if_fail (IDE_IS_CONTEXT (context), NULL);
+
+  self = g_object_get_data (G_OBJECT (context), "IDE_EDITORCONFIG_CACHE");
+
+  if (self == NULL)
+    {
+      self = g_object_new (IDE_TYPE_EDITORCONFIG_CACHE, NULL);
+      g_object_set_data_full (G_OBJECT (context), "IDE_EDITORCONFIG_CACHE", self, g_object_unref);
+    }
+
+  return self;
+}
+
+static void
+ide_editorconfig_cache_dispose (GObject *object)
+{
+  IdeEditorconfigCache *self = (IdeEditorconfigCache *)object;
+
+  if (self->monitors != NULL)
+    {
+      GHashTableIter iter;
+      gpointer value;
+
+      g_hash_table_iter_init (&iter, self->monitors);
+      while (g_hash_table_iter_next (&iter, NULL, &value))
+        g_file_monitor_cancel (value);
+
+      g_clear_pointer (&self->monitors, g_hash_table_unref);
+    }
+
+  G_OBJECT_CLASS (ide_editorconfig_cache_parent_class)->dispose (object);
+}
+
+static void
+ide_editorconfig_cache_finalize (GObject *object)
+{
+  IdeEditorconfigCache *self = (IdeEditorconfigCache *)object;
+
+  g_clear_pointer (&self->files, g_hash_table_unref);
+  g_clear_pointer (&self->pending, g_ptr_array_unref);
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (ide_editorconfig_cache_parent_class)->finalize (object);
+}
+
+static void
+ide_editorconfig_cache_class_init (IdeEditorconfigCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = ide_editorconfig_cache_dispose;
+  object_class->finalize = ide_editorconfig_cache_finalize;
+}
+
+static void
+ide_editorconfig_cache_init (IdeEditorconfigCache *self)
+{
+  g_mutex_init (&self->mutex);
+  self->files = g_hash_table_new_full (g_str_hash,
+                                       g_str_equal,
+                                       g_free,
+                                       (GDestroyNotify)editorconfig_file_unref);
+  self->monitors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->pending = g_ptr_array_new_with_free_func (g_object_unref);
+}
@@ -0,0 +1,42 @@
+/* ide-editorconfig-cache.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_EDITORCONFIG_CACHE_H
+#define IDE_EDITORCONFIG_CACHE_H
+
+#include "ide-context.h"
+
+G_BEGIN_DECLS
+
+#define IDE_TYPE_EDITORCONFIG_CACHE (ide_editorconfig_cache_get_type())
+
+G_DECLARE_FINAL_TYPE (IdeEditorconfigCache, ide_editorconfig_cache, IDE, EDITORCONFIG_CACHE, GObject)
+
+IdeEditorconfigCache *ide_editorconfig_cache_from_context (IdeContext            *context);
+void                  ide_editorconfig_cache_lookup_async (IdeEditorconfigCache  *self,
+                                                           GFile                 *file,
+                                                           GCancellable          *cancellable,
+                                                           GAsyncReadyCallback    callback,
+                                                           gpointer               user_data);
+GHashTable           *ide_editorconfig_cache_lookup_finish (IdeEditorconfigCache  *self,
+                                                            GAsyncResult          *result,
+                                                            GError               **error);
+
+G_END_DECLS
+
+#endif /* IDE_EDITORCONFIG_CACHE_H */
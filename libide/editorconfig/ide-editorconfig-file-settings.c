@@ -16,9 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <editorconfig-glib.h>
 #include <glib/gi18n.h>
 
+#include "ide-context.h"
+#include "ide-editorconfig-cache.h"
 #include "ide-editorconfig-file-settings.h"
 #include "ide-file.h"
 
@@ -47,29 +48,14 @@ ide_editorconfig_file_settings_init (IdeEditorconfigFileSettings *self)
 }
 
 static void
-ide_editorconfig_file_settings_init_worker (GTask        *task,
-                                            gpointer      source_object,
-                                            gpointer      task_data,
-                                            GCancellable *cancellable)
+ide_editorconfig_file_settings_apply (IdeEditorconfigFileSettings *self,
+                                      GHashTable                  *ht)
 {
-  GFile *file = task_data;
   GHashTableIter iter;
-  GHashTable *ht;
   gpointer k, v;
-  GError *error = NULL;
-
-  g_assert (G_IS_TASK (task));
-  g_assert (IDE_IS_EDITORCONFIG_FILE_SETTINGS (source_object));
-  g_assert (G_IS_FILE (file));
-  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  ht = editorconfig_glib_read (file, cancellable, &error);
-
-  if (!ht)
-    {
-      g_task_return_error (task, error);
-      return;
-    }
+  g_assert (IDE_IS_EDITORCONFIG_FILE_SETTINGS (self));
+  g_assert (ht != NULL);
 
   g_hash_table_iter_init (&iter, ht);
 
@@ -79,18 +65,18 @@ ide_editorconfig_file_settings_init_worker (GTask        *task,
       const GValue *value = v;
 
       if (g_str_equal (key, "indent_size"))
-        g_object_set_property (source_object, "indent-width", value);
+        g_object_set_property (G_OBJECT (self), "indent-width", value);
       else if (g_str_equal (key, "tab_width") ||
                g_str_equal (key, "trim_trailing_whitespace"))
-        g_object_set_property (source_object, key, value);
+        g_object_set_property (G_OBJECT (self), key, value);
       else if (g_str_equal (key, "insert_final_newline"))
-        g_object_set_property (source_object, "insert-trailing-newline", value);
+        g_object_set_property (G_OBJECT (self), "insert-trailing-newline", value);
       else if (g_str_equal (key, "charset"))
-        g_object_set_property (source_object, "encoding", value);
+        g_object_set_property (G_OBJECT (self), "encoding", value);
       else if (g_str_equal (key, "max_line_length"))
         {
-          g_object_set_property (source_object, "right-margin-position", value);
-          g_object_set (source_object, "show-right-margin", TRUE, NULL);
+          g_object_set_property (G_OBJECT (self), "right-margin-position", value);
+          g_object_set (self, "show-right-margin", TRUE, NULL);
         }
       else if (g_str_equal (key, "end_of_line"))
         {
@@ -103,7 +89,7 @@ ide_editorconfig_file_settings_init_worker (GTask        *task,
           else if (g_strcmp0 (str, "crlf") == 0)
             newline_type = GTK_SOURCE_NEWLINE_TYPE_CR_LF;
 
-          ide_file_settings_set_newline_type (source_object, newline_type);
+          ide_file_settings_set_newline_type (IDE_FILE_SETTINGS (self), newline_type);
         }
       else if (g_str_equal (key, "indent_style"))
         {
@@ -115,13 +101,35 @@ ide_editorconfig_file_settings_init_worker (GTask        *task,
           if (g_strcmp0 (str, "tab") == 0)
             indent_style = IDE_INDENT_STYLE_TABS;
 
-          ide_file_settings_set_indent_style (source_object, indent_style);
+          ide_file_settings_set_indent_style (IDE_FILE_SETTINGS (self), indent_style);
         }
     }
+}
 
-  g_task_return_boolean (task, TRUE);
+static void
+ide_editorconfig_file_settings_lookup_cb (GObject      *object,
+                                          GAsyncResult *result,
+                                          gpointer      user_data)
+{
+  IdeEditorconfigCache *cache = (IdeEditorconfigCache *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GHashTable) ht = NULL;
+  GError *error = NULL;
+
+  g_assert (IDE_IS_EDITORCONFIG_CACHE (cache));
+  g_assert (G_IS_TASK (task));
+
+  ht = ide_editorconfig_cache_lookup_finish (cache, result, &error);
+
+  if (ht == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
 
-  g_hash_table_unref (ht);
+  ide_editorconfig_file_settings_apply (g_task_get_source_object (task), ht);
+
+  g_task_return_boolean (task, TRUE);
 }
 
 static void
@@ -133,6 +141,8 @@ ide_editorconfig_file_settings_init_async (GAsyncInitable      *initable,
 {
   IdeEditorconfigFileSettings *self = (IdeEditorconfigFileSettings *)initable;
   g_autoptr(GTask) task = NULL;
+  IdeEditorconfigCache *cache;
+  IdeContext *context;
   IdeFile *file;
   GFile *gfile = NULL;
 
@@ -154,8 +164,14 @@ ide_editorconfig_file_settings_init_async (GAsyncInitable      *initable,
       return;
     }
 
-  g_task_set_task_data (task, g_object_ref (gfile), g_object_unref);
-  g_task_run_in_thread (task, ide_editorconfig_file_settings_init_worker);
+  context = ide_object_get_context (IDE_OBJECT (self));
+  cache = ide_editorconfig_cache_from_context (context);
+
+  ide_editorconfig_cache_lookup_async (cache,
+                                       gfile,
+                                       cancellable,
+                                       ide_editorconfig_file_settings_lookup_cb,
+                                       g_steal_pointer (&task));
 }
 
 static gboolean
@@ -29,6 +29,7 @@
 #include "ide-application.h"
 #include "ide-application-private.h"
 #include "ide-log.h"
+#include "ide-plugin-profile.h"
 
 static PeasPluginInfo *
 ide_application_locate_tool (IdeApplication *self,
@@ -154,6 +155,7 @@ ide_application_local_command_line (GApplication   *application,
   gboolean standalone = FALSE;
   gboolean version = FALSE;
   gboolean list_commands = FALSE;
+  gboolean profile_startup = FALSE;
 
   GOptionEntry entries[] = {
     /* keep list-commands as first entry */
@@ -178,6 +180,13 @@ ide_application_local_command_line (GApplication   *application,
       &version,
       N_("Show the application's version") },
 
+    { "profile-startup",
+      0,
+      G_OPTION_FLAG_NONE,
+      G_OPTION_ARG_NONE,
+      &profile_startup,
+      N_("Record plugin load times in counters and trace output") },
+
     { "type",
       0,
       G_OPTION_FLAG_HIDDEN,
@@ -361,6 +370,9 @@ ide_application_local_command_line (GApplication   *application,
       self->dbus_address = g_strdup (dbus_address);
     }
 
+  if (profile_startup)
+    ide_plugin_profile_set_enabled (TRUE);
+
   ide_application_load_plugins (self);
 
   if (!g_application_register (application, NULL, &error))
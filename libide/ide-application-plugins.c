@@ -26,6 +26,26 @@
 #include "ide-application-private.h"
 #include "ide-css-provider.h"
 #include "ide-macros.h"
+#include "ide-plugin-profile.h"
+
+/*
+ * Plugins may declare triggers in their .plugin file so that they are only
+ * loaded once they are needed, for example:
+ *
+ *   X-Activate-On-Languages=python,python3
+ *   X-Activate-On-Build-Systems=IdeAutotoolsBuildSystem
+ *   X-Activate-On-Commands=build
+ *   X-Activate-On-Tools=contribute-to
+ *
+ * "Tools" plugins are loaded when they provide the tool given on the command
+ * line. See ide_application_activate_plugins() for the other triggers.
+ */
+static const gchar *activation_triggers [] = {
+  "Languages",
+  "Build-Systems",
+  "Commands",
+  "Tools",
+};
 
 static gboolean
 ide_application_can_load_plugin (IdeApplication *self,
@@ -74,6 +94,59 @@ ide_application_can_load_plugin (IdeApplication *self,
   return TRUE;
 }
 
+static gboolean
+ide_application_should_defer_plugin (IdeApplication *self,
+                                     PeasPluginInfo *plugin_info)
+{
+  guint i;
+
+  g_assert (IDE_IS_APPLICATION (self));
+  g_assert (plugin_info != NULL);
+
+  /*
+   * Tests expect every plugin to be available, and workers only ever load
+   * the plugin providing the worker.
+   */
+  if (self->mode != IDE_APPLICATION_MODE_PRIMARY &&
+      self->mode != IDE_APPLICATION_MODE_TOOL)
+    return FALSE;
+
+  /* Satisfies the "Tools" trigger, the tool was chosen before loading. */
+  if (plugin_info == self->tool)
+    return FALSE;
+
+  for (i = 0; i < G_N_ELEMENTS (activation_triggers); i++)
+    {
+      g_autofree gchar *key = NULL;
+
+      key = g_strdup_printf ("Activate-On-%s", activation_triggers [i]);
+
+      if (peas_plugin_info_get_external_data (plugin_info, key) != NULL)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+ide_application_load_plugin (IdeApplication *self,
+                             PeasEngine     *engine,
+                             PeasPluginInfo *plugin_info)
+{
+  gint64 begin_time;
+
+  g_assert (IDE_IS_APPLICATION (self));
+  g_assert (PEAS_IS_ENGINE (engine));
+  g_assert (plugin_info != NULL);
+
+  g_debug ("Loading plugin \"%s\"",
+           peas_plugin_info_get_module_name (plugin_info));
+
+  begin_time = ide_plugin_profile_begin (plugin_info, "load");
+  peas_engine_load_plugin (engine, plugin_info);
+  ide_plugin_profile_end (plugin_info, "load", begin_time);
+}
+
 void
 ide_application_discover_plugins (IdeApplication *self)
 {
@@ -157,10 +230,14 @@ ide_application_plugins_enabled_changed (IdeApplication *self,
   plugin_info = g_object_get_data (G_OBJECT (settings), "PEAS_PLUGIN_INFO");
   g_assert (plugin_info != NULL);
 
+  /* Deferred plugins are loaded by their activation trigger. */
+  if (enabled && g_hash_table_contains (self->deferred_plugins, plugin_info))
+    return;
+
   if (enabled &&
       ide_application_can_load_plugin (self, plugin_info) &&
       !peas_plugin_info_is_loaded (plugin_info))
-    peas_engine_load_plugin (engine, plugin_info);
+    ide_application_load_plugin (self, engine, plugin_info);
   else if (!enabled && peas_plugin_info_is_loaded (plugin_info))
     peas_engine_unload_plugin (engine, plugin_info);
 }
@@ -176,6 +253,9 @@ ide_application_load_plugins (IdeApplication *self)
   engine = peas_engine_get_default ();
   list = peas_engine_get_plugin_list (engine);
 
+  if (self->deferred_plugins == NULL)
+    self->deferred_plugins = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+
   for (; list; list = list->next)
     {
       PeasPluginInfo *plugin_info = list->data;
@@ -198,15 +278,93 @@ ide_application_load_plugins (IdeApplication *self)
       if (!g_settings_get_boolean (settings, "enabled"))
         continue;
 
-      if (ide_application_can_load_plugin (self, plugin_info))
+      if (!ide_application_can_load_plugin (self, plugin_info))
+        continue;
+
+      if (ide_application_should_defer_plugin (self, plugin_info))
         {
-          g_debug ("Loading plugin \"%s\"",
-                   peas_plugin_info_get_module_name (plugin_info));
-          peas_engine_load_plugin (engine, plugin_info);
+          g_debug ("Deferring plugin \"%s\" until activated", module_name);
+          g_hash_table_insert (self->deferred_plugins, plugin_info, g_object_ref (settings));
+          continue;
         }
+
+      ide_application_load_plugin (self, engine, plugin_info);
     }
 }
 
+/**
+ * ide_application_activate_plugins:
+ * @self: An #IdeApplication
+ * @trigger: the kind of trigger, such as "Languages", "Build-Systems",
+ *   or "Commands"
+ * @value: (nullable): the value for @trigger, such as a language id
+ *
+ * Loads the enabled plugins that were deferred at startup and list @value
+ * within their "X-Activate-On-@trigger" key.
+ *
+ * Returns: %TRUE if any plugins were loaded.
+ */
+gboolean
+ide_application_activate_plugins (IdeApplication *self,
+                                  const gchar    *trigger,
+                                  const gchar    *value)
+{
+  g_autofree gchar *key = NULL;
+  g_autoptr(GPtrArray) matched = NULL;
+  GHashTableIter iter;
+  PeasEngine *engine;
+  gpointer k;
+  gpointer v;
+  gboolean ret = FALSE;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_APPLICATION (self), FALSE);
+  g_return_val_if_fail (trigger != NULL, FALSE);
+
+  if (value == NULL ||
+      self->deferred_plugins == NULL ||
+      g_hash_table_size (self->deferred_plugins) == 0)
+    return FALSE;
+
+  key = g_strdup_printf ("Activate-On-%s", trigger);
+  matched = g_ptr_array_new ();
+
+  g_hash_table_iter_init (&iter, self->deferred_plugins);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      PeasPluginInfo *plugin_info = k;
+      GSettings *settings = v;
+      g_auto(GStrv) values = NULL;
+      const gchar *data;
+
+      if (!(data = peas_plugin_info_get_external_data (plugin_info, key)))
+        continue;
+
+      values = g_strsplit (data, ",", 0);
+
+      if (g_strv_contains ((const gchar * const *)values, value) &&
+          g_settings_get_boolean (settings, "enabled"))
+        g_ptr_array_add (matched, plugin_info);
+    }
+
+  engine = peas_engine_get_default ();
+
+  for (i = 0; i < matched->len; i++)
+    {
+      PeasPluginInfo *plugin_info = g_ptr_array_index (matched, i);
+
+      g_debug ("Activating plugin \"%s\" for %s=%s",
+               peas_plugin_info_get_module_name (plugin_info), trigger, value);
+
+      g_hash_table_remove (self->deferred_plugins, plugin_info);
+      ide_application_load_plugin (self, engine, plugin_info);
+      ret = TRUE;
+    }
+
+  return ret;
+}
+
 static void
 ide_application_addin_added (PeasExtensionSet *set,
                              PeasPluginInfo   *plugin_info,
@@ -214,12 +372,15 @@ ide_application_addin_added (PeasExtensionSet *set,
                              gpointer          user_data)
 {
   IdeApplication *self = user_data;
+  gint64 begin_time;
 
   g_assert (PEAS_IS_EXTENSION_SET (set));
   g_assert (plugin_info != NULL);
   g_assert (IDE_IS_APPLICATION_ADDIN (extension));
 
+  begin_time = ide_plugin_profile_begin (plugin_info, "IdeApplicationAddin");
   ide_application_addin_load (IDE_APPLICATION_ADDIN (extension), self);
+  ide_plugin_profile_end (plugin_info, "IdeApplicationAddin", begin_time);
 }
 
 static void
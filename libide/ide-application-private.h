@@ -60,6 +60,9 @@ struct _IdeApplication
 
   GHashTable          *plugin_css;
 
+  /* PeasPluginInfo to GSettings for plugins waiting on an activation trigger */
+  GHashTable          *deferred_plugins;
+
   GList               *test_funcs;
 };
 
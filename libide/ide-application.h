@@ -54,6 +54,9 @@ GDBusProxy         *ide_application_get_worker_finish    (IdeApplication       *
                                                           GError              **error);
 GMenu              *ide_application_get_menu_by_id       (IdeApplication       *self,
                                                           const gchar          *id);
+gboolean            ide_application_activate_plugins     (IdeApplication       *self,
+                                                          const gchar          *trigger,
+                                                          const gchar          *value);
 
 G_END_DECLS
 
@@ -28,6 +28,10 @@ G_BEGIN_DECLS
 void                _ide_back_forward_list_foreach     (IdeBackForwardList    *self,
                                                         GFunc                  callback,
                                                         gpointer               user_data);
+void                _ide_back_forward_list_foreach_recent
+                                                       (IdeBackForwardList    *self,
+                                                        GFunc                  callback,
+                                                        gpointer               user_data);
 void                _ide_back_forward_list_load_async  (IdeBackForwardList    *self,
                                                         GFile                 *file,
                                                         GCancellable          *cancellable,
@@ -481,6 +481,32 @@ _ide_back_forward_list_foreach (IdeBackForwardList *self,
     callback (iter->data, user_data);
 }
 
+/*
+ * Like _ide_back_forward_list_foreach(), but starts with the current item
+ * and walks the backward list from the most recent item, so that items are
+ * visited in the order the user navigated away from them. The forward list
+ * is visited last, nearest item first.
+ */
+void
+_ide_back_forward_list_foreach_recent (IdeBackForwardList *self,
+                                       GFunc               callback,
+                                       gpointer            user_data)
+{
+  GList *iter;
+
+  g_assert (IDE_IS_BACK_FORWARD_LIST (self));
+  g_assert (callback);
+
+  if (self->current_item)
+    callback (self->current_item, user_data);
+
+  for (iter = self->backward->head; iter; iter = iter->next)
+    callback (iter->data, user_data);
+
+  for (iter = self->forward->head; iter; iter = iter->next)
+    callback (iter->data, user_data);
+}
+
 static void
 find_by_file (gpointer data,
               gpointer user_data)
@@ -21,7 +21,12 @@
 #include "ide-buffer.h"
 #include "ide-buffer-change-monitor.h"
 
-G_DEFINE_TYPE (IdeBufferChangeMonitor, ide_buffer_change_monitor, IDE_TYPE_OBJECT)
+typedef struct
+{
+  IdeBuffer *buffer;
+} IdeBufferChangeMonitorPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (IdeBufferChangeMonitor, ide_buffer_change_monitor, IDE_TYPE_OBJECT)
 
 enum {
   PROP_0,
@@ -53,13 +58,94 @@ ide_buffer_change_monitor_get_change (IdeBufferChangeMonitor *self,
   return IDE_BUFFER_LINE_CHANGE_NONE;
 }
 
+/**
+ * ide_buffer_change_monitor_foreach_change:
+ * @self: An #IdeBufferChangeMonitor
+ * @begin_line: the first line to visit
+ * @end_line: the last line to visit, inclusive
+ * @callback: (scope call): a callback for each range of changed lines
+ * @user_data: user data for @callback
+ *
+ * Calls @callback for the changed lines between @begin_line and @end_line,
+ * in increasing order. Lines without a change are skipped, so this is
+ * cheaper than calling ide_buffer_change_monitor_get_change() for each line
+ * when the monitor implements the foreach_change() vfunc. Otherwise the
+ * lines are walked with ide_buffer_change_monitor_get_change().
+ */
+void
+ide_buffer_change_monitor_foreach_change (IdeBufferChangeMonitor        *self,
+                                          guint                          begin_line,
+                                          guint                          end_line,
+                                          IdeBufferChangeMonitorForeach  callback,
+                                          gpointer                       user_data)
+{
+  g_return_if_fail (IDE_IS_BUFFER_CHANGE_MONITOR (self));
+  g_return_if_fail (begin_line <= end_line);
+  g_return_if_fail (callback != NULL);
+
+  IDE_BUFFER_CHANGE_MONITOR_GET_CLASS (self)->foreach_change (self, begin_line, end_line,
+                                                              callback, user_data);
+}
+
+static void
+ide_buffer_change_monitor_real_foreach_change (IdeBufferChangeMonitor        *self,
+                                               guint                          begin_line,
+                                               guint                          end_line,
+                                               IdeBufferChangeMonitorForeach  callback,
+                                               gpointer                       user_data)
+{
+  IdeBufferChangeMonitorPrivate *priv = ide_buffer_change_monitor_get_instance_private (self);
+  IdeBufferLineChange run_change = IDE_BUFFER_LINE_CHANGE_NONE;
+  GtkTextIter iter;
+  guint run_begin = begin_line;
+  guint line;
+
+  g_assert (IDE_IS_BUFFER_CHANGE_MONITOR (self));
+  g_assert (callback != NULL);
+
+  if (priv->buffer == NULL)
+    return;
+
+  gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (priv->buffer), &iter, begin_line);
+
+  for (line = begin_line; line <= end_line; line++)
+    {
+      IdeBufferLineChange change;
+
+      /* Past the last line of the buffer */
+      if ((guint)gtk_text_iter_get_line (&iter) != line)
+        break;
+
+      change = ide_buffer_change_monitor_get_change (self, &iter);
+
+      if (change != run_change)
+        {
+          if (run_change != IDE_BUFFER_LINE_CHANGE_NONE)
+            callback (run_begin, line - 1, run_change, user_data);
+
+          run_begin = line;
+          run_change = change;
+        }
+
+      gtk_text_iter_forward_line (&iter);
+    }
+
+  if (run_change != IDE_BUFFER_LINE_CHANGE_NONE)
+    callback (run_begin, line - 1, run_change, user_data);
+}
+
 static void
 ide_buffer_change_monitor_set_buffer (IdeBufferChangeMonitor *self,
                                       IdeBuffer              *buffer)
 {
+  IdeBufferChangeMonitorPrivate *priv = ide_buffer_change_monitor_get_instance_private (self);
+
   g_return_if_fail (IDE_IS_BUFFER_CHANGE_MONITOR (self));
   g_return_if_fail (IDE_IS_BUFFER (buffer));
 
+  priv->buffer = buffer;
+  g_object_add_weak_pointer (G_OBJECT (buffer), (gpointer *)&priv->buffer);
+
   if (IDE_BUFFER_CHANGE_MONITOR_GET_CLASS (self)->set_buffer)
     IDE_BUFFER_CHANGE_MONITOR_GET_CLASS (self)->set_buffer (self, buffer);
   else
@@ -94,13 +180,31 @@ ide_buffer_change_monitor_set_property (GObject      *object,
     }
 }
 
+static void
+ide_buffer_change_monitor_finalize (GObject *object)
+{
+  IdeBufferChangeMonitor *self = (IdeBufferChangeMonitor *)object;
+  IdeBufferChangeMonitorPrivate *priv = ide_buffer_change_monitor_get_instance_private (self);
+
+  if (priv->buffer != NULL)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (priv->buffer), (gpointer *)&priv->buffer);
+      priv->buffer = NULL;
+    }
+
+  G_OBJECT_CLASS (ide_buffer_change_monitor_parent_class)->finalize (object);
+}
+
 static void
 ide_buffer_change_monitor_class_init (IdeBufferChangeMonitorClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->finalize = ide_buffer_change_monitor_finalize;
   object_class->set_property = ide_buffer_change_monitor_set_property;
 
+  klass->foreach_change = ide_buffer_change_monitor_real_foreach_change;
+
   properties [PROP_BUFFER] =
     g_param_spec_object ("buffer",
                          "Buffer",
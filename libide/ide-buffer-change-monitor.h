@@ -38,19 +38,41 @@ typedef enum
   IDE_BUFFER_LINE_CHANGE_DELETED = 3,
 } IdeBufferLineChange;
 
+/**
+ * IdeBufferChangeMonitorForeach:
+ * @begin_line: the first line of the range
+ * @end_line: the last line of the range, inclusive
+ * @change: the change of every line in the range
+ * @user_data: closure data
+ */
+typedef void (*IdeBufferChangeMonitorForeach) (guint               begin_line,
+                                               guint               end_line,
+                                               IdeBufferLineChange change,
+                                               gpointer            user_data);
+
 struct _IdeBufferChangeMonitorClass
 {
   IdeObjectClass parent;
 
-  void                (*set_buffer) (IdeBufferChangeMonitor *self,
-                                     IdeBuffer              *buffer);
-  IdeBufferLineChange (*get_change) (IdeBufferChangeMonitor *self,
-                                     const GtkTextIter      *iter);
+  void                (*set_buffer)     (IdeBufferChangeMonitor        *self,
+                                         IdeBuffer                     *buffer);
+  IdeBufferLineChange (*get_change)     (IdeBufferChangeMonitor        *self,
+                                         const GtkTextIter             *iter);
+  void                (*foreach_change) (IdeBufferChangeMonitor        *self,
+                                         guint                          begin_line,
+                                         guint                          end_line,
+                                         IdeBufferChangeMonitorForeach  callback,
+                                         gpointer                       user_data);
 };
 
-IdeBufferLineChange ide_buffer_change_monitor_get_change   (IdeBufferChangeMonitor *self,
-                                                            const GtkTextIter      *iter);
-void                ide_buffer_change_monitor_emit_changed (IdeBufferChangeMonitor *self);
+IdeBufferLineChange ide_buffer_change_monitor_get_change     (IdeBufferChangeMonitor        *self,
+                                                              const GtkTextIter             *iter);
+void                ide_buffer_change_monitor_foreach_change (IdeBufferChangeMonitor        *self,
+                                                              guint                          begin_line,
+                                                              guint                          end_line,
+                                                              IdeBufferChangeMonitorForeach  callback,
+                                                              gpointer                       user_data);
+void                ide_buffer_change_monitor_emit_changed   (IdeBufferChangeMonitor        *self);
 
 G_END_DECLS
 
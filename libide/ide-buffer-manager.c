@@ -39,24 +39,25 @@
 #include "ide-source-location.h"
 #include "ide-unsaved-files.h"
 #include "ide-vcs.h"
+#include "ide-word-completion-provider.h"
 
 #define AUTO_SAVE_TIMEOUT_DEFAULT    60
 #define MAX_FILE_SIZE_BYTES_DEFAULT  (1024UL * 1024UL * 10UL)
 
 struct _IdeBufferManager
 {
-  IdeObject                 parent_instance;
+  IdeObject                  parent_instance;
 
-  GPtrArray                *buffers;
-  GHashTable               *timeouts;
-  IdeBuffer                *focus_buffer;
-  GtkSourceCompletionWords *word_completion;
-  GSettings                *settings;
+  GPtrArray                 *buffers;
+  GHashTable                *timeouts;
+  IdeBuffer                 *focus_buffer;
+  IdeWordCompletionProvider *word_completion;
+  GSettings                 *settings;
 
-  gsize                     max_file_size;
+  gsize                      max_file_size;
 
-  guint                     auto_save_timeout;
-  guint                     auto_save : 1;
+  guint                      auto_save_timeout;
+  guint                      auto_save : 1;
 };
 
 typedef struct
@@ -72,7 +73,9 @@ typedef struct
   IdeFile             *file;
   IdeProgress         *progress;
   GtkSourceFileLoader *loader;
+  gint64               begin_time;
   guint                is_new : 1;
+  guint                large_file : 1;
 } LoadState;
 
 typedef struct
@@ -89,6 +92,10 @@ G_DEFINE_TYPE_EXTENDED (IdeBufferManager, ide_buffer_manager, IDE_TYPE_OBJECT, 0
 
 EGG_DEFINE_COUNTER (registered, "IdeBufferManager", "Registered Buffers",
                     "The number of buffers registered with the buffer manager.")
+EGG_DEFINE_HISTOGRAM (LoadTime, "IdeBufferManager", "Load Time",
+                      "Time to load a file into a buffer (usec).")
+EGG_DEFINE_COUNTER (LargeFiles, "IdeBufferManager", "Large Files",
+                    "The number of files opened in large file mode.")
 
 enum {
   PROP_0,
@@ -118,6 +125,9 @@ static void register_auto_save   (IdeBufferManager *self,
 static void unregister_auto_save (IdeBufferManager *self,
                                   IdeBuffer        *buffer);
 
+static void ide_buffer_manager_load_file_complete (IdeBufferManager *self,
+                                                   GTask            *task);
+
 static GParamSpec *properties [LAST_PROP];
 static guint signals [LAST_SIGNAL];
 
@@ -344,7 +354,12 @@ ide_buffer_manager_add_buffer (IdeBufferManager *self,
   if (self->auto_save)
     register_auto_save (self, buffer);
 
-  gtk_source_completion_words_register (self->word_completion, GTK_TEXT_BUFFER (buffer));
+  /*
+   * Large files are paged in as they are viewed, scanning them for words
+   * would defeat the purpose.
+   */
+  if (!ide_buffer_get_large_file_mode (buffer))
+    ide_word_completion_provider_register_buffer (self->word_completion, buffer);
 
   g_signal_connect_object (buffer,
                            "changed",
@@ -396,7 +411,7 @@ ide_buffer_manager_remove_buffer (IdeBufferManager *self,
   unsaved_files = ide_context_get_unsaved_files (context);
   ide_unsaved_files_remove (unsaved_files, gfile);
 
-  gtk_source_completion_words_unregister (self->word_completion, GTK_TEXT_BUFFER (buffer));
+  ide_word_completion_provider_unregister_buffer (self->word_completion, buffer);
 
   unregister_auto_save (self, buffer);
 
@@ -442,20 +457,10 @@ ide_buffer_manager_load_file__load_cb (GObject      *object,
                                        gpointer      user_data)
 {
   g_autoptr(GTask) task = user_data;
-  g_autofree gchar *guess_contents = NULL;
-  g_autofree gchar *content_type = NULL;
   GtkSourceFileLoader *loader = (GtkSourceFileLoader *)object;
-  IdeBackForwardList *back_forward_list;
-  IdeBackForwardItem *item;
   IdeBufferManager *self;
-  const gchar *path;
-  IdeContext *context;
   LoadState *state;
-  GtkTextIter iter;
-  GtkTextIter end;
   GError *error = NULL;
-  gboolean uncertain = TRUE;
-  gsize i;
 
   g_assert (G_IS_TASK (task));
   g_assert (GTK_SOURCE_IS_FILE_LOADER (loader));
@@ -468,8 +473,6 @@ ide_buffer_manager_load_file__load_cb (GObject      *object,
   g_assert (IDE_IS_BUFFER (state->buffer));
   g_assert (IDE_IS_PROGRESS (state->progress));
 
-  context = ide_object_get_context (IDE_OBJECT (self));
-
   if (!gtk_source_file_loader_load_finish (loader, result, &error))
     {
       /*
@@ -485,6 +488,31 @@ ide_buffer_manager_load_file__load_cb (GObject      *object,
       g_clear_error (&error);
     }
 
+  ide_buffer_manager_load_file_complete (self, task);
+}
+
+static void
+ide_buffer_manager_load_file_complete (IdeBufferManager *self,
+                                       GTask            *task)
+{
+  g_autofree gchar *guess_contents = NULL;
+  g_autofree gchar *content_type = NULL;
+  IdeBackForwardList *back_forward_list;
+  IdeBackForwardItem *item;
+  const gchar *path;
+  IdeContext *context;
+  LoadState *state;
+  GtkTextIter iter;
+  GtkTextIter end;
+  gboolean uncertain = TRUE;
+  gsize i;
+
+  g_assert (IDE_IS_BUFFER_MANAGER (self));
+  g_assert (G_IS_TASK (task));
+
+  state = g_task_get_task_data (task);
+  context = ide_object_get_context (IDE_OBJECT (self));
+
   gtk_text_buffer_set_modified (GTK_TEXT_BUFFER (state->buffer), FALSE);
 
   for (i = 0; i < self->buffers->len; i++)
@@ -560,9 +588,82 @@ emit_signal:
 
   g_signal_emit (self, signals [BUFFER_LOADED], 0, state->buffer);
 
+  EGG_HISTOGRAM_TIMER_END (LoadTime, state->begin_time);
+
   g_task_return_pointer (task, g_object_ref (state->buffer), g_object_unref);
 }
 
+static void
+ide_buffer_manager_map_large_file_worker (GTask        *task,
+                                          gpointer      source_object,
+                                          gpointer      task_data,
+                                          GCancellable *cancellable)
+{
+  const gchar *path = task_data;
+  GMappedFile *mapped_file;
+  GError *error = NULL;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (path != NULL);
+
+  /*
+   * Mapping is cheap, but it may still block on slow storage, so keep it off
+   * the main loop. The pages themselves are faulted in lazily as the buffer
+   * requests them.
+   */
+  if (!(mapped_file = g_mapped_file_new (path, FALSE, &error)))
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, mapped_file, (GDestroyNotify)g_mapped_file_unref);
+}
+
+static void
+ide_buffer_manager__load_large_file_cb (GObject      *object,
+                                        GAsyncResult *result,
+                                        gpointer      user_data)
+{
+  IdeBufferManager *self = (IdeBufferManager *)object;
+  g_autoptr(GTask) task = user_data;
+  GMappedFile *mapped_file;
+  LoadState *state;
+  GError *error = NULL;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_BUFFER_MANAGER (self));
+  g_assert (G_IS_TASK (result));
+  g_assert (G_IS_TASK (task));
+
+  state = g_task_get_task_data (task);
+
+  g_assert (state);
+  g_assert (IDE_IS_BUFFER (state->buffer));
+
+  mapped_file = g_task_propagate_pointer (G_TASK (result), &error);
+
+  if (mapped_file == NULL)
+    {
+      _ide_buffer_set_loading (state->buffer, FALSE);
+      g_task_return_error (task, error);
+      IDE_EXIT;
+    }
+
+  _ide_buffer_set_large_file (state->buffer, mapped_file);
+  _ide_buffer_load_large_file_page (state->buffer);
+  g_mapped_file_unref (mapped_file);
+
+  /* In case a previously small buffer was reloaded. */
+  ide_word_completion_provider_unregister_buffer (self->word_completion, state->buffer);
+
+  ide_progress_set_fraction (state->progress, 1.0);
+
+  EGG_COUNTER_INC (LargeFiles);
+
+  ide_buffer_manager_load_file_complete (self, task);
+
+  IDE_EXIT;
+}
+
 static void
 ide_buffer_manager__load_file_query_info_cb (GObject      *object,
                                              GAsyncResult *result,
@@ -606,11 +707,21 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
 
   if ((self->max_file_size > 0) && (size > self->max_file_size))
     {
-      g_task_return_new_error (task,
-                               G_IO_ERROR,
-                               G_IO_ERROR_INVALID_DATA,
-                               _("File too large to be opened."));
-      IDE_EXIT;
+      /*
+       * We can only page in files that we can map into memory. Anything
+       * else is still too large to be opened.
+       */
+      if (!g_file_is_native (file))
+        {
+          _ide_buffer_set_loading (state->buffer, FALSE);
+          g_task_return_new_error (task,
+                                   G_IO_ERROR,
+                                   G_IO_ERROR_INVALID_DATA,
+                                   _("File too large to be opened."));
+          IDE_EXIT;
+        }
+
+      state->large_file = TRUE;
     }
 
   if (file_info && g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE))
@@ -632,6 +743,23 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
 
   g_signal_emit (self, signals [LOAD_BUFFER], 0, state->buffer);
 
+  if (state->large_file)
+    {
+      g_autoptr(GTask) map_task = NULL;
+
+      map_task = g_task_new (self,
+                             g_task_get_cancellable (task),
+                             ide_buffer_manager__load_large_file_cb,
+                             g_object_ref (task));
+      g_task_set_task_data (map_task, g_file_get_path (file), g_free);
+      g_task_run_in_thread (map_task, ide_buffer_manager_map_large_file_worker);
+
+      IDE_EXIT;
+    }
+
+  /* Leave large file mode if the file shrunk since it was last loaded. */
+  _ide_buffer_set_large_file (state->buffer, NULL);
+
   gtk_source_file_loader_load_async (state->loader,
                                      G_PRIORITY_DEFAULT,
                                      g_task_get_cancellable (task),
@@ -697,8 +825,10 @@ ide_buffer_manager__load_file_read_cb (GObject      *object,
  * loaded, the previously loaded version of the file will be returned, asynchronously.
  *
  * Before loading the file, #IdeBufferManager will check the file size to help protect itself
- * from the user accidentally loading very large files. You can change the maximum size of file
- * that will be loaded with the #IdeBufferManager:max-file-size property.
+ * from the user accidentally loading very large files. Local files larger than the
+ * #IdeBufferManager:max-file-size property are opened in large file mode, where the file is
+ * memory mapped and paged into a read-only buffer on demand. See
+ * ide_buffer_get_large_file_mode() for details.
  *
  * See ide_buffer_manager_load_file_finish() for how to complete this asynchronous request.
  */
@@ -748,6 +878,7 @@ ide_buffer_manager_load_file_async (IdeBufferManager     *self,
     }
 
   state = g_slice_new0 (LoadState);
+  state->begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
   state->is_new = (buffer == NULL);
   state->file = g_object_ref (file);
   state->progress = ide_progress_new ();
@@ -1052,6 +1183,19 @@ ide_buffer_manager_save_file_async  (IdeBufferManager     *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
 
+  /*
+   * Buffers in large file mode only contain the pages that have been viewed,
+   * saving them would truncate the file.
+   */
+  if (ide_buffer_get_large_file_mode (buffer))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_NOT_SUPPORTED,
+                               _("Files opened in large file mode cannot be saved."));
+      return;
+    }
+
   context = ide_object_get_context (IDE_OBJECT (self));
   ide_context_hold_for_object (context, task);
 
@@ -1189,6 +1333,18 @@ list_model_iface_init (GListModelInterface *iface)
   iface->get_item = ide_buffer_manager_get_item;
 }
 
+static void
+ide_buffer_manager_constructed (GObject *object)
+{
+  IdeBufferManager *self = (IdeBufferManager *)object;
+  IdeContext *context;
+
+  G_OBJECT_CLASS (ide_buffer_manager_parent_class)->constructed (object);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  self->word_completion = ide_word_completion_provider_new (context);
+}
+
 static void
 ide_buffer_manager_dispose (GObject *object)
 {
@@ -1204,6 +1360,9 @@ ide_buffer_manager_dispose (GObject *object)
       ide_buffer_manager_remove_buffer (self, buffer);
     }
 
+  /* The project scan holds a reference on the provider until it finishes */
+  if (self->word_completion != NULL)
+    ide_word_completion_provider_cancel (self->word_completion);
   g_clear_object (&self->word_completion);
 
   G_OBJECT_CLASS (ide_buffer_manager_parent_class)->dispose (object);
@@ -1286,6 +1445,7 @@ ide_buffer_manager_class_init (IdeBufferManagerClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->constructed = ide_buffer_manager_constructed;
   object_class->dispose = ide_buffer_manager_dispose;
   object_class->finalize = ide_buffer_manager_finalize;
   object_class->get_property = ide_buffer_manager_get_property;
@@ -1453,7 +1613,6 @@ ide_buffer_manager_init (IdeBufferManager *self)
   self->buffers = g_ptr_array_new ();
   self->max_file_size = MAX_FILE_SIZE_BYTES_DEFAULT;
   self->timeouts = g_hash_table_new (g_direct_hash, g_direct_equal);
-  self->word_completion = gtk_source_completion_words_new (_("Words"), NULL);
   self->settings = g_settings_new ("org.gnome.builder.editor");
 }
 
@@ -1537,17 +1696,18 @@ ide_buffer_manager_get_buffers (IdeBufferManager *self)
  * ide_buffer_manager_get_word_completion:
  * @self: A #IdeBufferManager.
  *
- * Gets the #GtkSourceCompletionWords completion provider that will complete
- * words using the loaded documents.
+ * Gets the completion provider that will complete words found in the
+ * project, using an index that is kept up to date as the loaded documents
+ * are edited.
  *
- * Returns: (transfer none): A #GtkSourceCompletionWords
+ * Returns: (transfer none): A #GtkSourceCompletionProvider
  */
-GtkSourceCompletionWords *
+GtkSourceCompletionProvider *
 ide_buffer_manager_get_word_completion (IdeBufferManager *self)
 {
   g_return_val_if_fail (IDE_IS_BUFFER_MANAGER (self), NULL);
 
-  return self->word_completion;
+  return GTK_SOURCE_COMPLETION_PROVIDER (self->word_completion);
 }
 
 /**
@@ -1605,7 +1765,8 @@ ide_buffer_manager_has_file (IdeBufferManager *self,
  * @self: An #IdeBufferManager.
  *
  * Gets the #IdeBufferManager:max-file-size property. This contains the maximum file size in bytes
- * that a file may be to be loaded by the #IdeBufferManager.
+ * that a file may be to be loaded normally by the #IdeBufferManager. Larger files are opened
+ * in large file mode.
  *
  * If zero, no size limits will be enforced.
  *
@@ -0,0 +1,466 @@
+/* ide-buffer-snapshot.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-buffer-snapshot"
+
+#include <string.h>
+
+#include "egg-counter.h"
+
+#include "ide-buffer-snapshot.h"
+#include "ide-internal.h"
+
+/*
+ * The text of an IdeBuffer is mirrored into a list of small, immutable and
+ * reference counted chunks as it is edited. An edit only replaces the chunks
+ * it touches, so taking a snapshot is a matter of referencing the current
+ * chunks rather than copying the whole buffer. Background consumers can then
+ * walk the chunks from any thread, or flatten them into contiguous bytes if
+ * the API they feed requires it.
+ */
+
+#define CHUNK_SIZE     4096
+#define CHUNK_SIZE_MAX (CHUNK_SIZE * 2)
+
+typedef struct
+{
+  volatile gint ref_count;
+  gsize         len;
+  gsize         n_chars;
+  gchar         data[];
+} Chunk;
+
+struct _IdeBufferSnapshot
+{
+  volatile gint  ref_count;
+  GPtrArray     *chunks;
+  GBytes        *bytes;
+  gsize          length;
+  gsize          change_count;
+};
+
+G_DEFINE_BOXED_TYPE (IdeBufferSnapshot, ide_buffer_snapshot,
+                     ide_buffer_snapshot_ref, ide_buffer_snapshot_unref)
+
+EGG_DEFINE_COUNTER (instances, "IdeBufferSnapshot", "Instances", "Number of IdeBufferSnapshot")
+EGG_DEFINE_COUNTER (flattened, "IdeBufferSnapshot", "Flattened",
+                    "Number of snapshots that were copied into contiguous memory.")
+
+static Chunk *
+chunk_new (const gchar *data,
+           gsize        len)
+{
+  Chunk *chunk;
+
+  chunk = g_malloc (sizeof *chunk + len + 1);
+  chunk->ref_count = 1;
+  chunk->len = len;
+  memcpy (chunk->data, data, len);
+  chunk->data [len] = '\0';
+  chunk->n_chars = g_utf8_strlen (chunk->data, len);
+
+  return chunk;
+}
+
+static Chunk *
+chunk_ref (Chunk *chunk)
+{
+  g_atomic_int_inc (&chunk->ref_count);
+  return chunk;
+}
+
+static void
+chunk_unref (gpointer data)
+{
+  Chunk *chunk = data;
+
+  if (g_atomic_int_dec_and_test (&chunk->ref_count))
+    g_free (chunk);
+}
+
+/*
+ * Inserts @data into @chunks at @index, split into pieces no larger than
+ * CHUNK_SIZE_MAX. Pieces are only ever cut on a UTF-8 character boundary.
+ */
+static void
+chunks_insert_data (GPtrArray   *chunks,
+                    guint        index,
+                    const gchar *data,
+                    gsize        len)
+{
+  while (len > 0)
+    {
+      gsize piece = len;
+
+      if (piece > CHUNK_SIZE_MAX)
+        {
+          piece = CHUNK_SIZE;
+          while (piece > 0 && (data [piece] & 0xC0) == 0x80)
+            piece--;
+          if (piece == 0)
+            piece = CHUNK_SIZE;
+        }
+
+      g_ptr_array_insert (chunks, index++, chunk_new (data, piece));
+
+      data += piece;
+      len -= piece;
+    }
+}
+
+/*
+ * Replaces the chunks from @begin to @end (inclusive) with the concatenation
+ * of @head, @middle and @tail.
+ */
+static void
+chunks_replace (GPtrArray   *chunks,
+                guint        begin,
+                guint        end,
+                const gchar *head,
+                gsize        head_len,
+                const gchar *middle,
+                gsize        middle_len,
+                const gchar *tail,
+                gsize        tail_len)
+{
+  g_autofree gchar *data = NULL;
+  gsize len;
+
+  /*
+   * head and tail point into the chunks we are about to release, so they
+   * must be copied before the chunks are removed.
+   */
+  len = head_len + middle_len + tail_len;
+  data = g_malloc (len + 1);
+  if (head_len > 0)
+    memcpy (data, head, head_len);
+  if (middle_len > 0)
+    memcpy (data + head_len, middle, middle_len);
+  if (tail_len > 0)
+    memcpy (data + head_len + middle_len, tail, tail_len);
+
+  g_ptr_array_remove_range (chunks, begin, end - begin + 1);
+
+  chunks_insert_data (chunks, begin, data, len);
+}
+
+GPtrArray *
+_ide_buffer_chunks_new (void)
+{
+  return g_ptr_array_new_with_free_func (chunk_unref);
+}
+
+void
+_ide_buffer_chunks_insert (GPtrArray   *chunks,
+                           gsize        offset,
+                           const gchar *text,
+                           gsize        len)
+{
+  const gchar *split;
+  Chunk *chunk = NULL;
+  gsize pos = 0;
+  guint i;
+
+  g_return_if_fail (chunks != NULL);
+  g_return_if_fail (text != NULL);
+
+  if (len == 0)
+    return;
+
+  for (i = 0; i < chunks->len; i++)
+    {
+      chunk = g_ptr_array_index (chunks, i);
+
+      if (offset <= pos + chunk->n_chars)
+        break;
+
+      pos += chunk->n_chars;
+    }
+
+  if (i == chunks->len)
+    {
+      g_warn_if_fail (offset == pos);
+      chunks_insert_data (chunks, chunks->len, text, len);
+      return;
+    }
+
+  split = g_utf8_offset_to_pointer (chunk->data, offset - pos);
+
+  /*
+   * Large inserts, such as loading a file, do not need to be merged with
+   * the neighboring text. Only small edits rewrite the chunk they land in.
+   */
+  if (split == chunk->data && len >= CHUNK_SIZE)
+    {
+      chunks_insert_data (chunks, i, text, len);
+      return;
+    }
+
+  if (split == chunk->data + chunk->len && len >= CHUNK_SIZE)
+    {
+      chunks_insert_data (chunks, i + 1, text, len);
+      return;
+    }
+
+  chunks_replace (chunks, i, i,
+                  chunk->data, split - chunk->data,
+                  text, len,
+                  split, chunk->data + chunk->len - split);
+}
+
+void
+_ide_buffer_chunks_delete (GPtrArray *chunks,
+                           gsize      begin,
+                           gsize      end)
+{
+  const gchar *head_end;
+  const gchar *tail_begin;
+  Chunk *first = NULL;
+  Chunk *last;
+  gsize first_pos = 0;
+  gsize last_pos;
+  guint i;
+  guint j;
+
+  g_return_if_fail (chunks != NULL);
+  g_return_if_fail (begin <= end);
+
+  if (begin == end)
+    return;
+
+  for (i = 0; i < chunks->len; i++)
+    {
+      first = g_ptr_array_index (chunks, i);
+
+      if (begin < first_pos + first->n_chars)
+        break;
+
+      first_pos += first->n_chars;
+    }
+
+  g_return_if_fail (i < chunks->len);
+
+  j = i;
+  last = first;
+  last_pos = first_pos;
+
+  while (end > last_pos + last->n_chars)
+    {
+      last_pos += last->n_chars;
+      j++;
+      g_return_if_fail (j < chunks->len);
+      last = g_ptr_array_index (chunks, j);
+    }
+
+  head_end = g_utf8_offset_to_pointer (first->data, begin - first_pos);
+  tail_begin = g_utf8_offset_to_pointer (last->data, end - last_pos);
+
+  chunks_replace (chunks, i, j,
+                  first->data, head_end - first->data,
+                  NULL, 0,
+                  tail_begin, last->data + last->len - tail_begin);
+}
+
+/**
+ * _ide_buffer_snapshot_new:
+ * @chunks: the chunks maintained by the buffer.
+ * @change_count: the change count of the buffer.
+ * @trailing_newline: if a trailing newline should be appended.
+ *
+ * Creates a new snapshot referencing the current chunks. This does not copy
+ * the text, and the buffer is free to continue editing @chunks afterwards.
+ *
+ * Returns: (transfer full): An #IdeBufferSnapshot.
+ */
+IdeBufferSnapshot *
+_ide_buffer_snapshot_new (GPtrArray *chunks,
+                          gsize      change_count,
+                          gboolean   trailing_newline)
+{
+  IdeBufferSnapshot *self;
+  guint i;
+
+  g_return_val_if_fail (chunks != NULL, NULL);
+
+  self = g_slice_new0 (IdeBufferSnapshot);
+  self->ref_count = 1;
+  self->change_count = change_count;
+  self->chunks = g_ptr_array_new_full (chunks->len + 1, chunk_unref);
+
+  for (i = 0; i < chunks->len; i++)
+    {
+      Chunk *chunk = g_ptr_array_index (chunks, i);
+
+      g_ptr_array_add (self->chunks, chunk_ref (chunk));
+      self->length += chunk->len;
+    }
+
+  if (trailing_newline)
+    {
+      g_ptr_array_add (self->chunks, chunk_new ("\n", 1));
+      self->length++;
+    }
+
+  EGG_COUNTER_INC (instances);
+
+  return self;
+}
+
+IdeBufferSnapshot *
+ide_buffer_snapshot_ref (IdeBufferSnapshot *self)
+{
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+ide_buffer_snapshot_unref (IdeBufferSnapshot *self)
+{
+  g_return_if_fail (self);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_pointer (&self->chunks, g_ptr_array_unref);
+      g_clear_pointer (&self->bytes, g_bytes_unref);
+      g_slice_free (IdeBufferSnapshot, self);
+
+      EGG_COUNTER_DEC (instances);
+    }
+}
+
+/**
+ * ide_buffer_snapshot_get_change_count:
+ *
+ * Gets the value of ide_buffer_get_change_count() at the time the snapshot
+ * was created.
+ */
+gsize
+ide_buffer_snapshot_get_change_count (IdeBufferSnapshot *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->change_count;
+}
+
+/**
+ * ide_buffer_snapshot_get_length:
+ *
+ * Gets the length of the snapshot contents in bytes.
+ */
+gsize
+ide_buffer_snapshot_get_length (IdeBufferSnapshot *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->length;
+}
+
+guint
+ide_buffer_snapshot_get_n_chunks (IdeBufferSnapshot *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->chunks->len;
+}
+
+/**
+ * ide_buffer_snapshot_get_chunk:
+ * @length: (out): A location for the length of the chunk in bytes.
+ *
+ * Gets the chunk found at @index. Concatenating all of the chunks in order
+ * results in the contents of the snapshot. Chunks are always valid UTF-8,
+ * and are never split in the middle of a character.
+ *
+ * This is safe to call from any thread.
+ *
+ * Returns: (transfer none): The chunk, which is also \0 terminated.
+ */
+const gchar *
+ide_buffer_snapshot_get_chunk (IdeBufferSnapshot *self,
+                               guint              index,
+                               gsize             *length)
+{
+  Chunk *chunk;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (index < self->chunks->len, NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+
+  chunk = g_ptr_array_index (self->chunks, index);
+  *length = chunk->len;
+
+  return chunk->data;
+}
+
+/**
+ * ide_buffer_snapshot_get_bytes:
+ *
+ * Flattens the snapshot into contiguous memory. The result is cached, so
+ * this only copies the text the first time it is called.
+ *
+ * The data is followed by a \0 which is not included in the length of the
+ * #GBytes, so that it may also be used as a C string.
+ *
+ * This is safe to call from any thread, and it is preferable to do so for
+ * large buffers.
+ *
+ * Returns: (transfer full): A #GBytes.
+ */
+GBytes *
+ide_buffer_snapshot_get_bytes (IdeBufferSnapshot *self)
+{
+  GBytes *bytes;
+  gchar *data;
+  gsize pos = 0;
+  guint i;
+
+  g_return_val_if_fail (self, NULL);
+
+  if (NULL != (bytes = g_atomic_pointer_get (&self->bytes)))
+    return g_bytes_ref (bytes);
+
+  data = g_malloc (self->length + 1);
+
+  for (i = 0; i < self->chunks->len; i++)
+    {
+      Chunk *chunk = g_ptr_array_index (self->chunks, i);
+
+      memcpy (data + pos, chunk->data, chunk->len);
+      pos += chunk->len;
+    }
+
+  data [pos] = '\0';
+
+  bytes = g_bytes_new_take (data, self->length);
+
+  EGG_COUNTER_INC (flattened);
+
+  /* Another thread may have raced us, prefer the published copy. */
+  if (!g_atomic_pointer_compare_and_exchange (&self->bytes, NULL, bytes))
+    {
+      g_bytes_unref (bytes);
+      bytes = g_atomic_pointer_get (&self->bytes);
+    }
+
+  return g_bytes_ref (bytes);
+}
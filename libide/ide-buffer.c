@@ -19,13 +19,16 @@
 #define G_LOG_DOMAIN "ide-buffer"
 
 #include <glib/gi18n.h>
+#include <string.h>
 
 #include "egg-counter.h"
 #include "egg-signal-group.h"
 
+#include "ide-application.h"
 #include "ide-battery-monitor.h"
 #include "ide-buffer.h"
 #include "ide-buffer-change-monitor.h"
+#include "ide-buffer-snapshot.h"
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-diagnostic.h"
@@ -37,6 +40,7 @@
 #include "ide-highlighter.h"
 #include "ide-highlight-engine.h"
 #include "ide-internal.h"
+#include "ide-line-flags-store.h"
 #include "ide-source-iter.h"
 #include "ide-source-location.h"
 #include "ide-source-range.h"
@@ -49,19 +53,61 @@
 #define DEFAULT_DIAGNOSE_CONSERVE_TIMEOUT_MSEC 5000
 #define RECLAIMATION_TIMEOUT_SECS              1
 #define MODIFICATION_TIMEOUT_SECS              1
+#define LARGE_FILE_PAGE_SIZE                   (1024UL * 1024UL)
 
 #define TAG_ERROR      "diagnostician::error"
 #define TAG_WARNING    "diagnostician::warning"
 #define TAG_DEPRECATED "diagnostician::deprecated"
 #define TAG_NOTE       "diagnostician::note"
 
+#define LINE_FLAGS_CHANGES_MASK (IDE_BUFFER_LINE_FLAGS_ADDED | IDE_BUFFER_LINE_FLAGS_CHANGED)
+
+/* ide_buffer_get_line_flags_range() fills the flags from a guint array */
+G_STATIC_ASSERT (sizeof (IdeBufferLineFlags) == sizeof (guint));
+
+/*
+ * A diagnostic whose tags and line flags are currently in the buffer. The
+ * marks sit at the start of the first and last lines the diagnostic is
+ * located on so that we can find those lines again after the buffer has been
+ * edited. They have right gravity, so lines inserted right at the start of
+ * those lines push the marks down along with the diagnostic.
+ */
+typedef struct
+{
+  IdeDiagnostic *diagnostic;
+  GtkTextMark   *begin_mark;
+  GtkTextMark   *end_mark;
+  guint          begin_line;
+} AppliedDiagnostic;
+
+/*
+ * Identifies a diagnostic across diagnose runs. @delta is added to the
+ * line numbers of @diagnostic, which is how a previously applied
+ * diagnostic is compared after the lines above it moved.
+ */
+typedef struct
+{
+  IdeDiagnostic *diagnostic;
+  gint           delta;
+} DiagnosticKey;
+
+typedef struct
+{
+  guint begin;
+  guint end;
+} LineSpan;
+
 typedef struct
 {
   IdeContext             *context;
   IdeDiagnostics         *diagnostics;
-  GHashTable             *diagnostics_line_cache;
+  GPtrArray              *applied_diagnostics;
+  IdeLineFlagsStore      *line_flags;
   IdeFile                *file;
   GBytes                 *content;
+  GPtrArray              *chunks;
+  IdeBufferSnapshot      *snapshot;
+  GMappedFile            *large_file;
   IdeBufferChangeMonitor *change_monitor;
   IdeDiagnostician       *diagnostician;
   IdeHighlightEngine     *highlight_engine;
@@ -76,6 +122,7 @@ typedef struct
 
   guint                   diagnose_timeout;
   guint                   check_modified_timeout;
+  guint                   materialize_handler;
 
   GTimeVal                mtime;
 
@@ -83,8 +130,10 @@ typedef struct
   guint                   reclamation_handler;
 
   gsize                   change_count;
+  gsize                   large_file_offset;
 
   guint                   changed_on_volume : 1;
+  guint                   deferred : 1;
   guint                   diagnostics_dirty : 1;
   guint                   highlight_diagnostics : 1;
   guint                   in_diagnose : 1;
@@ -97,6 +146,10 @@ typedef struct
 G_DEFINE_TYPE_WITH_PRIVATE (IdeBuffer, ide_buffer, GTK_SOURCE_TYPE_BUFFER)
 
 EGG_DEFINE_COUNTER (instances, "IdeBuffer", "Instances", "Number of IdeBuffer instances.")
+EGG_DEFINE_COUNTER (applied_diagnostics, "IdeBuffer", "Applied Diagnostics",
+                    "Number of diagnostics whose tags were applied to a buffer.")
+EGG_DEFINE_COUNTER (removed_diagnostics, "IdeBuffer", "Removed Diagnostics",
+                    "Number of diagnostics whose tags were removed from a buffer.")
 
 enum {
   PROP_0,
@@ -106,6 +159,7 @@ enum {
   PROP_FILE,
   PROP_HAS_DIAGNOSTICS,
   PROP_HIGHLIGHT_DIAGNOSTICS,
+  PROP_LARGE_FILE_MODE,
   PROP_READ_ONLY,
   PROP_STYLE_SCHEME_NAME,
   PROP_TITLE,
@@ -252,6 +306,179 @@ ide_buffer_sync_to_unsaved_files (IdeBuffer *self)
     g_bytes_unref (content);
 }
 
+static void
+applied_diagnostic_free (gpointer data)
+{
+  AppliedDiagnostic *applied = data;
+
+  g_clear_pointer (&applied->diagnostic, ide_diagnostic_unref);
+  g_slice_free (AppliedDiagnostic, applied);
+}
+
+static void
+applied_diagnostic_delete_marks (AppliedDiagnostic *applied)
+{
+  GtkTextBuffer *buffer;
+
+  if ((buffer = gtk_text_mark_get_buffer (applied->begin_mark)))
+    {
+      gtk_text_buffer_delete_mark (buffer, applied->begin_mark);
+      gtk_text_buffer_delete_mark (buffer, applied->end_mark);
+    }
+}
+
+static void
+applied_diagnostic_get_span (AppliedDiagnostic *applied,
+                             LineSpan          *span)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+
+  buffer = gtk_text_mark_get_buffer (applied->begin_mark);
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, applied->begin_mark);
+  span->begin = gtk_text_iter_get_line (&iter);
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, applied->end_mark);
+  span->end = MAX (span->begin, (guint)gtk_text_iter_get_line (&iter));
+}
+
+static guint
+diagnostic_key_hash (gconstpointer data)
+{
+  const DiagnosticKey *key = data;
+  IdeSourceLocation *location;
+  guint hash;
+
+  hash = ide_diagnostic_get_severity (key->diagnostic);
+  hash ^= g_str_hash (ide_diagnostic_get_text (key->diagnostic) ?: "");
+
+  if ((location = ide_diagnostic_get_location (key->diagnostic)))
+    {
+      hash ^= (ide_source_location_get_line (location) + key->delta) * 31;
+      hash ^= ide_source_location_get_line_offset (location) << 16;
+    }
+
+  return hash;
+}
+
+static gboolean
+diagnostic_key_location_equal (IdeSourceLocation *a,
+                               gint               a_delta,
+                               IdeSourceLocation *b,
+                               gint               b_delta)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return ide_source_location_get_line (a) + a_delta == ide_source_location_get_line (b) + b_delta &&
+         ide_source_location_get_line_offset (a) == ide_source_location_get_line_offset (b);
+}
+
+static gboolean
+diagnostic_key_equal (gconstpointer a,
+                      gconstpointer b)
+{
+  const DiagnosticKey *ka = a;
+  const DiagnosticKey *kb = b;
+  guint n_ranges;
+  guint i;
+
+  if (ide_diagnostic_get_severity (ka->diagnostic) != ide_diagnostic_get_severity (kb->diagnostic) ||
+      g_strcmp0 (ide_diagnostic_get_text (ka->diagnostic), ide_diagnostic_get_text (kb->diagnostic)) != 0 ||
+      !diagnostic_key_location_equal (ide_diagnostic_get_location (ka->diagnostic), ka->delta,
+                                      ide_diagnostic_get_location (kb->diagnostic), kb->delta))
+    return FALSE;
+
+  n_ranges = ide_diagnostic_get_num_ranges (ka->diagnostic);
+
+  if (n_ranges != ide_diagnostic_get_num_ranges (kb->diagnostic))
+    return FALSE;
+
+  for (i = 0; i < n_ranges; i++)
+    {
+      IdeSourceRange *ra = ide_diagnostic_get_range (ka->diagnostic, i);
+      IdeSourceRange *rb = ide_diagnostic_get_range (kb->diagnostic, i);
+
+      if (!diagnostic_key_location_equal (ide_source_range_get_begin (ra), ka->delta,
+                                          ide_source_range_get_begin (rb), kb->delta) ||
+          !diagnostic_key_location_equal (ide_source_range_get_end (ra), ka->delta,
+                                          ide_source_range_get_end (rb), kb->delta))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+diagnostic_key_free (gpointer data)
+{
+  g_slice_free (DiagnosticKey, data);
+}
+
+/*
+ * Gets the lines that @diagnostic is located on, from its location and
+ * its ranges.
+ */
+static void
+ide_buffer_get_diagnostic_span (IdeDiagnostic *diagnostic,
+                                LineSpan      *span)
+{
+  IdeSourceLocation *location;
+  guint n_ranges;
+  guint i;
+
+  span->begin = G_MAXUINT;
+  span->end = 0;
+
+  if ((location = ide_diagnostic_get_location (diagnostic)))
+    {
+      span->begin = ide_source_location_get_line (location);
+      span->end = ide_source_location_get_line (location);
+    }
+
+  n_ranges = ide_diagnostic_get_num_ranges (diagnostic);
+
+  for (i = 0; i < n_ranges; i++)
+    {
+      IdeSourceRange *range = ide_diagnostic_get_range (diagnostic, i);
+      guint begin_line = ide_source_location_get_line (ide_source_range_get_begin (range));
+      guint end_line = ide_source_location_get_line (ide_source_range_get_end (range));
+
+      span->begin = MIN (span->begin, MIN (begin_line, end_line));
+      span->end = MAX (span->end, MAX (begin_line, end_line));
+    }
+
+  if (span->begin == G_MAXUINT)
+    span->begin = 0;
+}
+
+/*
+ * A diagnostic located on an empty line is tagged from the end of the
+ * previous line, so the lines its tags can touch start one line early.
+ */
+static inline void
+line_span_include_tagged (LineSpan *span)
+{
+  if (span->begin > 0)
+    span->begin--;
+}
+
+static gint
+line_span_compare (gconstpointer a,
+                   gconstpointer b)
+{
+  const LineSpan *sa = a;
+  const LineSpan *sb = b;
+
+  if (sa->begin < sb->begin)
+    return -1;
+  else if (sa->begin > sb->begin)
+    return 1;
+  else
+    return 0;
+}
+
 static void
 ide_buffer_clear_diagnostics (IdeBuffer *self)
 {
@@ -259,11 +486,19 @@ ide_buffer_clear_diagnostics (IdeBuffer *self)
   GtkTextBuffer *buffer = (GtkTextBuffer *)self;
   GtkTextIter begin;
   GtkTextIter end;
+  guint i;
 
   g_assert (IDE_IS_BUFFER (self));
 
-  if (priv->diagnostics_line_cache)
-    g_hash_table_remove_all (priv->diagnostics_line_cache);
+  if (priv->applied_diagnostics)
+    {
+      for (i = 0; i < priv->applied_diagnostics->len; i++)
+        applied_diagnostic_delete_marks (g_ptr_array_index (priv->applied_diagnostics, i));
+      g_ptr_array_set_size (priv->applied_diagnostics, 0);
+    }
+
+  if (priv->line_flags)
+    ide_line_flags_store_clear (priv->line_flags, IDE_BUFFER_LINE_FLAGS_DIAGNOSTICS_MASK);
 
   gtk_text_buffer_get_bounds (buffer, &begin, &end);
 
@@ -273,6 +508,21 @@ ide_buffer_clear_diagnostics (IdeBuffer *self)
   gtk_text_buffer_remove_tag_by_name (buffer, TAG_ERROR, &begin, &end);
 }
 
+/*
+ * A line may carry diagnostics of several severities but only the most
+ * severe one is reported.
+ */
+static inline IdeBufferLineFlags
+ide_buffer_line_flags_normalize (guint flags)
+{
+  if ((flags & IDE_BUFFER_LINE_FLAGS_ERROR) != 0)
+    flags &= ~(IDE_BUFFER_LINE_FLAGS_WARNING | IDE_BUFFER_LINE_FLAGS_NOTE);
+  else if ((flags & IDE_BUFFER_LINE_FLAGS_WARNING) != 0)
+    flags &= ~IDE_BUFFER_LINE_FLAGS_NOTE;
+
+  return flags;
+}
+
 static void
 ide_buffer_cache_diagnostic_line (IdeBuffer             *self,
                                   IdeSourceLocation     *begin,
@@ -280,33 +530,44 @@ ide_buffer_cache_diagnostic_line (IdeBuffer             *self,
                                   IdeDiagnosticSeverity  severity)
 {
   IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
-  gpointer new_value = GINT_TO_POINTER (severity);
-  gsize line_begin;
-  gsize line_end;
-  gsize i;
+  IdeBufferLineFlags flags;
+  guint line_begin;
+  guint line_end;
 
   g_assert (IDE_IS_BUFFER (self));
   g_assert (begin);
   g_assert (end);
 
-  if (!priv->diagnostics_line_cache)
+  if (!priv->line_flags)
     return;
 
+  switch (severity)
+    {
+    case IDE_DIAGNOSTIC_FATAL:
+    case IDE_DIAGNOSTIC_ERROR:
+      flags = IDE_BUFFER_LINE_FLAGS_ERROR;
+      break;
+
+    case IDE_DIAGNOSTIC_DEPRECATED:
+    case IDE_DIAGNOSTIC_WARNING:
+      flags = IDE_BUFFER_LINE_FLAGS_WARNING;
+      break;
+
+    case IDE_DIAGNOSTIC_NOTE:
+      flags = IDE_BUFFER_LINE_FLAGS_NOTE;
+      break;
+
+    case IDE_DIAGNOSTIC_IGNORED:
+    default:
+      return;
+    }
+
   line_begin = MIN (ide_source_location_get_line (begin),
                     ide_source_location_get_line (end));
   line_end = MAX (ide_source_location_get_line (begin),
                   ide_source_location_get_line (end));
 
-  for (i = line_begin; i <= line_end; i++)
-    {
-      gpointer old_value;
-      gpointer key = GINT_TO_POINTER (i);
-
-      old_value = g_hash_table_lookup (priv->diagnostics_line_cache, key);
-
-      if (new_value > old_value)
-        g_hash_table_replace (priv->diagnostics_line_cache, key, new_value);
-    }
+  ide_line_flags_store_add (priv->line_flags, line_begin, line_end, flags);
 }
 
 static void
@@ -413,31 +674,249 @@ ide_buffer_update_diagnostic (IdeBuffer     *self,
     }
 }
 
+static void
+ide_buffer_apply_diagnostic (IdeBuffer     *self,
+                             IdeDiagnostic *diagnostic)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  GtkTextBuffer *buffer = (GtkTextBuffer *)self;
+  AppliedDiagnostic *applied;
+  LineSpan span;
+  GtkTextIter iter;
+
+  g_assert (IDE_IS_BUFFER (self));
+  g_assert (diagnostic != NULL);
+
+  ide_buffer_update_diagnostic (self, diagnostic);
+  ide_buffer_get_diagnostic_span (diagnostic, &span);
+
+  applied = g_slice_new0 (AppliedDiagnostic);
+  applied->diagnostic = ide_diagnostic_ref (diagnostic);
+  applied->begin_line = span.begin;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, span.begin);
+  applied->begin_mark = gtk_text_buffer_create_mark (buffer, NULL, &iter, FALSE);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, span.end);
+  applied->end_mark = gtk_text_buffer_create_mark (buffer, NULL, &iter, FALSE);
+
+  g_ptr_array_add (priv->applied_diagnostics, applied);
+
+  EGG_COUNTER_INC (applied_diagnostics);
+}
+
+/*
+ * Brings the tags and line flags in the buffer in line with @diagnostics
+ * without starting over. Diagnostics that are still reported keep their
+ * tags. A previously applied diagnostic matches a new one when they have
+ * the same severity, text and positions, once the lines that have moved
+ * since it was applied are accounted for. Only the lines of the diagnostics
+ * that went away are cleared, and the remaining diagnostics overlapping
+ * those lines are applied again. Duplicates within @diagnostics are applied
+ * once.
+ */
 static void
 ide_buffer_update_diagnostics (IdeBuffer      *self,
                                IdeDiagnostics *diagnostics)
 {
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  GtkTextBuffer *buffer = (GtkTextBuffer *)self;
+  g_autoptr(GHashTable) previous = NULL;
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GPtrArray) old_applied = NULL;
+  g_autoptr(GPtrArray) added = NULL;
+  g_autoptr(GArray) removed = NULL;
+  GHashTableIter hiter;
+  gpointer value;
   gsize size;
   gsize i;
 
   g_assert (IDE_IS_BUFFER (self));
-  g_assert (diagnostics);
 
-  size = ide_diagnostics_get_size (diagnostics);
+  /* Disposed */
+  if (priv->applied_diagnostics == NULL)
+    return;
+
+  previous = g_hash_table_new_full (diagnostic_key_hash, diagnostic_key_equal, diagnostic_key_free, NULL);
+  seen = g_hash_table_new_full (diagnostic_key_hash, diagnostic_key_equal, diagnostic_key_free, NULL);
+  added = g_ptr_array_new ();
+  removed = g_array_new (FALSE, FALSE, sizeof (LineSpan));
+
+  old_applied = priv->applied_diagnostics;
+  g_ptr_array_set_free_func (old_applied, NULL);
+  priv->applied_diagnostics = g_ptr_array_new_with_free_func (applied_diagnostic_free);
+
+  for (i = 0; i < old_applied->len; i++)
+    {
+      AppliedDiagnostic *applied = g_ptr_array_index (old_applied, i);
+      DiagnosticKey *key;
+      LineSpan span;
+
+      applied_diagnostic_get_span (applied, &span);
+
+      key = g_slice_new0 (DiagnosticKey);
+      key->diagnostic = applied->diagnostic;
+      key->delta = (gint)span.begin - (gint)applied->begin_line;
+
+      if (g_hash_table_contains (previous, key))
+        {
+          /* An exact duplicate, the new set gets a fresh copy if needed */
+          line_span_include_tagged (&span);
+          g_array_append_val (removed, span);
+          applied_diagnostic_delete_marks (applied);
+          applied_diagnostic_free (applied);
+          diagnostic_key_free (key);
+          continue;
+        }
+
+      g_hash_table_insert (previous, key, applied);
+    }
+
+  size = diagnostics ? ide_diagnostics_get_size (diagnostics) : 0;
 
   for (i = 0; i < size; i++)
     {
-      IdeDiagnostic *diagnostic;
+      IdeDiagnostic *diagnostic = ide_diagnostics_index (diagnostics, i);
+      DiagnosticKey key = { diagnostic, 0 };
+      AppliedDiagnostic *applied;
+      DiagnosticKey *seen_key;
+      LineSpan current;
+      LineSpan span;
+
+      if (diagnostic == NULL || ide_diagnostic_get_severity (diagnostic) == IDE_DIAGNOSTIC_IGNORED)
+        continue;
 
-      diagnostic = ide_diagnostics_index (diagnostics, i);
-      if (diagnostic != NULL)
-        ide_buffer_update_diagnostic (self, diagnostic);
+      /*
+       * Providers may report the same diagnostic more than once. Applying
+       * every copy would leave duplicates behind that the next update has
+       * to clear and re-apply, so only the first one is kept.
+       */
+      if (g_hash_table_contains (seen, &key))
+        continue;
+
+      seen_key = g_slice_new0 (DiagnosticKey);
+      seen_key->diagnostic = diagnostic;
+      g_hash_table_add (seen, seen_key);
+
+      if (!(applied = g_hash_table_lookup (previous, &key)))
+        {
+          g_ptr_array_add (added, diagnostic);
+          continue;
+        }
+
+      g_hash_table_remove (previous, &key);
+
+      /* Still reported, track it in the coordinates of the new diagnostic */
+      ide_buffer_get_diagnostic_span (diagnostic, &span);
+      ide_diagnostic_unref (applied->diagnostic);
+      applied->diagnostic = ide_diagnostic_ref (diagnostic);
+      applied->begin_line = span.begin;
+
+      /* Lines inserted or removed inside the span move the end mark */
+      applied_diagnostic_get_span (applied, &current);
+      if (current.end != span.end)
+        {
+          GtkTextIter iter;
+
+          gtk_text_buffer_get_iter_at_line (buffer, &iter, span.end);
+          gtk_text_buffer_move_mark (buffer, applied->end_mark, &iter);
+        }
+
+      g_ptr_array_add (priv->applied_diagnostics, applied);
     }
+
+  g_hash_table_iter_init (&hiter, previous);
+
+  while (g_hash_table_iter_next (&hiter, NULL, &value))
+    {
+      AppliedDiagnostic *applied = value;
+      LineSpan span;
+
+      applied_diagnostic_get_span (applied, &span);
+      line_span_include_tagged (&span);
+      g_array_append_val (removed, span);
+      applied_diagnostic_delete_marks (applied);
+      applied_diagnostic_free (applied);
+    }
+
+  EGG_COUNTER_ADD (removed_diagnostics, removed->len);
+
+  if (removed->len > 0)
+    {
+      guint n_spans = 0;
+
+      /* Merge the removed spans so each line is cleared once */
+      g_array_sort (removed, line_span_compare);
+
+      for (i = 0; i < removed->len; i++)
+        {
+          LineSpan *span = &g_array_index (removed, LineSpan, i);
+          LineSpan *last = n_spans ? &g_array_index (removed, LineSpan, n_spans - 1) : NULL;
+
+          if (last != NULL && span->begin <= last->end + 1)
+            last->end = MAX (last->end, span->end);
+          else
+            g_array_index (removed, LineSpan, n_spans++) = *span;
+        }
+
+      g_array_set_size (removed, n_spans);
+
+      for (i = 0; i < removed->len; i++)
+        {
+          const LineSpan *span = &g_array_index (removed, LineSpan, i);
+          GtkTextIter begin;
+          GtkTextIter end;
+
+          gtk_text_buffer_get_iter_at_line (buffer, &begin, span->begin);
+          gtk_text_buffer_get_iter_at_line (buffer, &end, span->end);
+          if (!gtk_text_iter_ends_line (&end))
+            gtk_text_iter_forward_to_line_end (&end);
+
+          gtk_text_buffer_remove_tag_by_name (buffer, TAG_NOTE, &begin, &end);
+          gtk_text_buffer_remove_tag_by_name (buffer, TAG_WARNING, &begin, &end);
+          gtk_text_buffer_remove_tag_by_name (buffer, TAG_DEPRECATED, &begin, &end);
+          gtk_text_buffer_remove_tag_by_name (buffer, TAG_ERROR, &begin, &end);
+
+          if (priv->line_flags != NULL)
+            ide_line_flags_store_remove (priv->line_flags,
+                                         span->begin,
+                                         span->end,
+                                         IDE_BUFFER_LINE_FLAGS_DIAGNOSTICS_MASK);
+        }
+
+      /* Restore what the cleared lines lost from diagnostics that remain */
+      for (i = 0; i < priv->applied_diagnostics->len; i++)
+        {
+          AppliedDiagnostic *applied = g_ptr_array_index (priv->applied_diagnostics, i);
+          LineSpan span;
+          guint lo = 0;
+          guint hi = removed->len;
+
+          applied_diagnostic_get_span (applied, &span);
+          line_span_include_tagged (&span);
+
+          /* Find the last removed span starting at or before span.end */
+          while (lo < hi)
+            {
+              guint mid = lo + (hi - lo) / 2;
+
+              if (g_array_index (removed, LineSpan, mid).begin <= span.end)
+                lo = mid + 1;
+              else
+                hi = mid;
+            }
+
+          if (lo > 0 && g_array_index (removed, LineSpan, lo - 1).end >= span.begin)
+            ide_buffer_update_diagnostic (self, applied->diagnostic);
+        }
+    }
+
+  for (i = 0; i < added->len; i++)
+    ide_buffer_apply_diagnostic (self, g_ptr_array_index (added, i));
 }
 
-static void
-ide_buffer_set_diagnostics (IdeBuffer      *self,
-                            IdeDiagnostics *diagnostics)
+void
+_ide_buffer_set_diagnostics (IdeBuffer      *self,
+                             IdeDiagnostics *diagnostics)
 {
   IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
 
@@ -448,10 +927,7 @@ ide_buffer_set_diagnostics (IdeBuffer      *self,
       g_clear_pointer (&priv->diagnostics, ide_diagnostics_unref);
       priv->diagnostics = diagnostics ? ide_diagnostics_ref (diagnostics) : NULL;
 
-      ide_buffer_clear_diagnostics (self);
-
-      if (diagnostics)
-        ide_buffer_update_diagnostics (self, diagnostics);
+      ide_buffer_update_diagnostics (self, diagnostics);
 
       g_signal_emit (self, signals [LINE_FLAGS_CHANGED], 0);
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_HAS_DIAGNOSTICS]);
@@ -504,12 +980,12 @@ ide_buffer__diagnostician_diagnose_cb (GObject      *object,
   if (error)
     g_message ("%s", error->message);
 
-  ide_buffer_set_diagnostics (self, diagnostics);
+  _ide_buffer_set_diagnostics (self, diagnostics);
 
   if (priv->diagnostics_dirty)
     ide_buffer_queue_diagnose (self);
 
-  if (!priv->has_done_diagnostics_once)
+  if (!priv->has_done_diagnostics_once && priv->highlight_engine != NULL)
     {
       priv->has_done_diagnostics_once = TRUE;
       ide_highlight_engine_rebuild (priv->highlight_engine);
@@ -562,8 +1038,19 @@ ide_buffer_queue_diagnose (IdeBuffer *self)
 
   g_assert (IDE_IS_BUFFER (self));
 
+  /*
+   * Large files are only partially loaded into the buffer, so there is
+   * nothing meaningful a diagnostician could tell us about them.
+   */
+  if (priv->large_file != NULL)
+    return;
+
   priv->diagnostics_dirty = TRUE;
 
+  /* We will diagnose once the buffer is materialized. */
+  if (priv->deferred)
+    return;
+
   if (priv->diagnose_timeout != 0)
     {
       g_source_remove (priv->diagnose_timeout);
@@ -578,6 +1065,62 @@ ide_buffer_queue_diagnose (IdeBuffer *self)
   priv->diagnose_timeout = g_timeout_add (timeout_msec, ide_buffer__diagnose_timeout_cb, self);
 }
 
+static void
+ide_buffer_add_change_flags (guint               begin_line,
+                             guint               end_line,
+                             IdeBufferLineChange change,
+                             gpointer            user_data)
+{
+  IdeLineFlagsStore *line_flags = user_data;
+
+  switch (change)
+    {
+    case IDE_BUFFER_LINE_CHANGE_ADDED:
+      ide_line_flags_store_add (line_flags, begin_line, end_line, IDE_BUFFER_LINE_FLAGS_ADDED);
+      break;
+
+    case IDE_BUFFER_LINE_CHANGE_CHANGED:
+      ide_line_flags_store_add (line_flags, begin_line, end_line, IDE_BUFFER_LINE_FLAGS_CHANGED);
+      break;
+
+    case IDE_BUFFER_LINE_CHANGE_DELETED:
+    case IDE_BUFFER_LINE_CHANGE_NONE:
+    default:
+      break;
+    }
+}
+
+/*
+ * Copies the state of the change monitor into the line flags store so that
+ * gutters do not need to query the change monitor for every line they draw.
+ * The monitor only reports the changed ranges, so this costs as much as the
+ * diff rather than the length of the buffer.
+ */
+static void
+ide_buffer_update_change_flags (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  guint n_lines;
+
+  g_assert (IDE_IS_BUFFER (self));
+
+  if (priv->line_flags == NULL)
+    return;
+
+  ide_line_flags_store_clear (priv->line_flags, LINE_FLAGS_CHANGES_MASK);
+
+  if (priv->change_monitor == NULL)
+    return;
+
+  n_lines = gtk_text_buffer_get_line_count (GTK_TEXT_BUFFER (self));
+
+  ide_buffer_change_monitor_foreach_change (priv->change_monitor,
+                                            0,
+                                            n_lines - 1,
+                                            ide_buffer_add_change_flags,
+                                            priv->line_flags);
+}
+
 static void
 ide_buffer__change_monitor_changed_cb (IdeBuffer              *self,
                                        IdeBufferChangeMonitor *monitor)
@@ -587,6 +1130,8 @@ ide_buffer__change_monitor_changed_cb (IdeBuffer              *self,
   g_assert (IDE_IS_BUFFER (self));
   g_assert (IDE_IS_BUFFER_CHANGE_MONITOR (monitor));
 
+  ide_buffer_update_change_flags (self);
+
   g_signal_emit (self, signals [LINE_FLAGS_CHANGED], 0);
 
   IDE_EXIT;
@@ -605,7 +1150,7 @@ ide_buffer_reload_change_monitor (IdeBuffer *self)
       g_clear_object (&priv->change_monitor);
     }
 
-  if (priv->context && priv->file)
+  if (priv->context && priv->file && !priv->large_file && !priv->deferred)
     {
       IdeVcs *vcs;
 
@@ -622,6 +1167,7 @@ ide_buffer_reload_change_monitor (IdeBuffer *self)
         }
     }
 
+  ide_buffer_update_change_flags (self);
 }
 
 static void
@@ -677,6 +1223,7 @@ ide_buffer_changed (GtkTextBuffer *buffer)
   priv->diagnostics_dirty = TRUE;
 
   g_clear_pointer (&priv->content, g_bytes_unref);
+  g_clear_pointer (&priv->snapshot, ide_buffer_snapshot_unref);
 
   if (priv->highlight_diagnostics && !priv->in_diagnose)
     ide_buffer_queue_diagnose (self);
@@ -687,6 +1234,9 @@ ide_buffer_delete_range (GtkTextBuffer *buffer,
                          GtkTextIter   *start,
                          GtkTextIter   *end)
 {
+  IdeBuffer *self = (IdeBuffer *)buffer;
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
   IDE_ENTRY;
 
 #ifdef IDE_ENABLE_TRACE
@@ -705,6 +1255,31 @@ ide_buffer_delete_range (GtkTextBuffer *buffer,
   }
 #endif
 
+  _ide_buffer_chunks_delete (priv->chunks,
+                             gtk_text_iter_get_offset (start),
+                             gtk_text_iter_get_offset (end));
+
+  if (priv->line_flags != NULL)
+    {
+      GtkTextIter *first = start;
+      GtkTextIter *last = end;
+      guint n_lines;
+
+      if (gtk_text_iter_compare (first, last) > 0)
+        first = end, last = start;
+
+      /*
+       * The lines joined onto the first line go away. If the deletion starts
+       * at the beginning of a line, what survives of the last line takes its
+       * place instead.
+       */
+      n_lines = gtk_text_iter_get_line (last) - gtk_text_iter_get_line (first);
+      ide_line_flags_store_delete_lines (priv->line_flags,
+                                         gtk_text_iter_get_line (first) +
+                                           !gtk_text_iter_starts_line (first),
+                                         n_lines);
+    }
+
   GTK_TEXT_BUFFER_CLASS (ide_buffer_parent_class)->delete_range (buffer, start, end);
 
   ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
@@ -718,7 +1293,11 @@ ide_buffer_insert_text (GtkTextBuffer *buffer,
                         const gchar   *text,
                         gint           len)
 {
+  IdeBuffer *self = (IdeBuffer *)buffer;
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
   gboolean check_modeline = FALSE;
+  guint first_line;
+  gint line_count;
 
   g_assert (IDE_IS_BUFFER (buffer));
   g_assert (location);
@@ -734,8 +1313,23 @@ ide_buffer_insert_text (GtkTextBuffer *buffer,
       ((text [0] == '\n') || ((len > 1) && (strchr (text, '\n') != NULL))))
     check_modeline = TRUE;
 
+  _ide_buffer_chunks_insert (priv->chunks, gtk_text_iter_get_offset (location), text, len);
+
+  /* Text inserted at the start of a line pushes that line down too */
+  first_line = gtk_text_iter_get_line (location) + !gtk_text_iter_starts_line (location);
+  line_count = gtk_text_buffer_get_line_count (buffer);
+
   GTK_TEXT_BUFFER_CLASS (ide_buffer_parent_class)->insert_text (buffer, location, text, len);
 
+  /*
+   * Let GtkTextBuffer decide what breaks a line ("\r", "\r\n", U+2029 as
+   * well as "\n") by looking at how many lines were added.
+   */
+  if (priv->line_flags != NULL)
+    ide_line_flags_store_insert_lines (priv->line_flags,
+                                       first_line,
+                                       gtk_text_buffer_get_line_count (buffer) - line_count);
+
   ide_buffer_emit_cursor_moved (IDE_BUFFER (buffer));
 
   if (check_modeline)
@@ -911,6 +1505,10 @@ ide_buffer_notify_language (IdeBuffer  *self,
   if ((language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (self))))
     lang_id = gtk_source_language_get_id (language);
 
+  /* Load plugins deferred until a buffer of this language is opened. */
+  if (IDE_IS_APPLICATION (g_application_get_default ()))
+    ide_application_activate_plugins (IDE_APPLICATION_DEFAULT, "Languages", lang_id);
+
   if (priv->symbol_resolver_adapter)
     ide_extension_adapter_set_value (priv->symbol_resolver_adapter, lang_id);
 
@@ -995,6 +1593,8 @@ ide_buffer_dispose (GObject *object)
       priv->check_modified_timeout = 0;
     }
 
+  ide_clear_source (&priv->materialize_handler);
+
   if (priv->file_monitor)
     {
       g_file_monitor_cancel (priv->file_monitor);
@@ -1018,9 +1618,12 @@ ide_buffer_dispose (GObject *object)
       g_clear_object (&priv->change_monitor);
     }
 
-  g_clear_pointer (&priv->diagnostics_line_cache, g_hash_table_unref);
+  g_clear_pointer (&priv->line_flags, ide_line_flags_store_free);
+  g_clear_pointer (&priv->applied_diagnostics, g_ptr_array_unref);
   g_clear_pointer (&priv->diagnostics, ide_diagnostics_unref);
   g_clear_pointer (&priv->content, g_bytes_unref);
+  g_clear_pointer (&priv->snapshot, ide_buffer_snapshot_unref);
+  g_clear_pointer (&priv->large_file, g_mapped_file_unref);
   g_clear_pointer (&priv->title, g_free);
   g_clear_object (&priv->diagnostician);
   g_clear_object (&priv->file);
@@ -1056,6 +1659,8 @@ ide_buffer_finalize (GObject *object)
 
   ide_clear_weak_pointer (&priv->context);
 
+  g_clear_pointer (&priv->chunks, g_ptr_array_unref);
+
   G_OBJECT_CLASS (ide_buffer_parent_class)->finalize (object);
 
   EGG_COUNTER_DEC (instances);
@@ -1097,6 +1702,10 @@ ide_buffer_get_property (GObject    *object,
       g_value_set_boolean (value, ide_buffer_get_highlight_diagnostics (self));
       break;
 
+    case PROP_LARGE_FILE_MODE:
+      g_value_set_boolean (value, ide_buffer_get_large_file_mode (self));
+      break;
+
     case PROP_READ_ONLY:
       g_value_set_boolean (value, ide_buffer_get_read_only (self));
       break;
@@ -1206,6 +1815,13 @@ ide_buffer_class_init (IdeBufferClass *klass)
                           TRUE,
                           (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  properties [PROP_LARGE_FILE_MODE] =
+    g_param_spec_boolean ("large-file-mode",
+                          "Large File Mode",
+                          "If the buffer is paging in a file too large to load at once.",
+                          FALSE,
+                          (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   properties [PROP_READ_ONLY] =
     g_param_spec_boolean ("read-only",
                           "Read Only",
@@ -1301,6 +1917,8 @@ ide_buffer_init (IdeBuffer *self)
 
   priv->highlight_diagnostics = TRUE;
 
+  priv->chunks = _ide_buffer_chunks_new ();
+
   priv->file_signals = egg_signal_group_new (IDE_TYPE_FILE);
   egg_signal_group_connect_object (priv->file_signals,
                                    "notify::language",
@@ -1313,7 +1931,8 @@ ide_buffer_init (IdeBuffer *self)
                                    self,
                                    G_CONNECT_SWAPPED);
 
-  priv->diagnostics_line_cache = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->line_flags = ide_line_flags_store_new ();
+  priv->applied_diagnostics = g_ptr_array_new_with_free_func (applied_diagnostic_free);
 
   EGG_COUNTER_INC (instances);
 
@@ -1435,62 +2054,47 @@ ide_buffer_get_line_flags (IdeBuffer *self,
                            guint      line)
 {
   IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
-  IdeBufferLineFlags flags = 0;
-  IdeBufferLineChange change = 0;
 
-  if (priv->diagnostics_line_cache)
-    {
-      gpointer key = GINT_TO_POINTER (line);
-      gpointer value;
+  g_return_val_if_fail (IDE_IS_BUFFER (self), 0);
 
-      value = g_hash_table_lookup (priv->diagnostics_line_cache, key);
+  if (priv->line_flags == NULL)
+    return 0;
 
-      switch (GPOINTER_TO_INT (value))
-        {
-        case IDE_DIAGNOSTIC_FATAL:
-        case IDE_DIAGNOSTIC_ERROR:
-          flags |= IDE_BUFFER_LINE_FLAGS_ERROR;
-          break;
-
-        case IDE_DIAGNOSTIC_DEPRECATED:
-        case IDE_DIAGNOSTIC_WARNING:
-          flags |= IDE_BUFFER_LINE_FLAGS_WARNING;
-          break;
-
-        case IDE_DIAGNOSTIC_NOTE:
-          flags |= IDE_BUFFER_LINE_FLAGS_NOTE;
-          break;
-
-        default:
-          break;
-        }
-    }
+  return ide_buffer_line_flags_normalize (ide_line_flags_store_get (priv->line_flags, line));
+}
 
-  if (priv->change_monitor)
-    {
-      GtkTextIter iter;
+/**
+ * ide_buffer_get_line_flags_range:
+ * @self: A #IdeBuffer.
+ * @first_line: the first buffer line number.
+ * @n_lines: the number of lines.
+ * @flags: (out caller-allocates) (array length=n_lines): the flags of each line.
+ *
+ * Like ide_buffer_get_line_flags() but fetches @n_lines lines at once, which
+ * is cheaper when drawing the visible region of a gutter.
+ */
+void
+ide_buffer_get_line_flags_range (IdeBuffer          *self,
+                                 guint               first_line,
+                                 guint               n_lines,
+                                 IdeBufferLineFlags *flags)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  guint i;
 
-      gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (self), &iter, line);
-      change = ide_buffer_change_monitor_get_change (priv->change_monitor, &iter);
+  g_return_if_fail (IDE_IS_BUFFER (self));
+  g_return_if_fail (n_lines == 0 || flags != NULL);
 
-      switch (change)
-        {
-        case IDE_BUFFER_LINE_CHANGE_ADDED:
-          flags |= IDE_BUFFER_LINE_FLAGS_ADDED;
-          break;
-
-        case IDE_BUFFER_LINE_CHANGE_CHANGED:
-          flags |= IDE_BUFFER_LINE_FLAGS_CHANGED;
-          break;
-
-        case IDE_BUFFER_LINE_CHANGE_DELETED:
-        case IDE_BUFFER_LINE_CHANGE_NONE:
-        default:
-          break;
-        }
+  if (priv->line_flags == NULL)
+    {
+      memset (flags, 0, sizeof *flags * n_lines);
+      return;
     }
 
-  return flags;
+  ide_line_flags_store_get_range (priv->line_flags, first_line, n_lines, (guint *)flags);
+
+  for (i = 0; i < n_lines; i++)
+    flags [i] = ide_buffer_line_flags_normalize (flags [i]);
 }
 
 /**
@@ -1610,35 +2214,34 @@ ide_buffer_get_diagnostic_at_iter (IdeBuffer         *self,
   return NULL;
 }
 
-static gboolean
-ide_buffer_can_do_newline_hack (IdeBuffer *self,
-                                guint      len)
+/**
+ * ide_buffer_get_snapshot:
+ * @self: A #IdeBuffer.
+ *
+ * Gets an immutable snapshot of the buffer contents. Creating a snapshot does
+ * not copy the buffer text, and the snapshot may be handed to another thread
+ * while the buffer continues to be edited.
+ *
+ * If #GtkSourceBuffer:implicit-trailing-newline is set, the snapshot will
+ * contain the trailing newline.
+ *
+ * Returns: (transfer full): An #IdeBufferSnapshot.
+ */
+IdeBufferSnapshot *
+ide_buffer_get_snapshot (IdeBuffer *self)
 {
-  guint next_pow2;
-
-  g_assert (IDE_IS_BUFFER (self));
-
-  /*
-   * If adding two bytes to our length (one for \n and one for \0) is still under the next
-   * power of two, then we can avoid making a copy of the buffer when saving the buffer
-   * to our drafts.
-   *
-   * HACK: This relies on the fact that GtkTextBuffer returns a GString allocated string
-   *       which grows the string in powers of two.
-   */
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  gboolean trailing_newline;
 
-  if ((len == 0) || (len & (len - 1)) == 0)
-    return FALSE;
+  g_return_val_if_fail (IDE_IS_BUFFER (self), NULL);
 
-  next_pow2 = len;
-  next_pow2 |= next_pow2 >> 1;
-  next_pow2 |= next_pow2 >> 2;
-  next_pow2 |= next_pow2 >> 4;
-  next_pow2 |= next_pow2 >> 8;
-  next_pow2 |= next_pow2 >> 16;
-  next_pow2++;
+  if (priv->snapshot == NULL)
+    {
+      trailing_newline = gtk_source_buffer_get_implicit_trailing_newline (GTK_SOURCE_BUFFER (self));
+      priv->snapshot = _ide_buffer_snapshot_new (priv->chunks, priv->change_count, trailing_newline);
+    }
 
-  return ((len + 2) < next_pow2);
+  return ide_buffer_snapshot_ref (priv->snapshot);
 }
 
 /**
@@ -1662,48 +2265,21 @@ ide_buffer_get_content (IdeBuffer *self)
 
   g_return_val_if_fail (IDE_IS_BUFFER (self), NULL);
 
+  /*
+   * The buffer only contains the pages viewed so far, and is never modified,
+   * so the mapped file is both cheaper and more correct than the buffer text.
+   */
+  if (priv->large_file != NULL)
+    return g_mapped_file_get_bytes (priv->large_file);
+
   if (!priv->content)
     {
+      g_autoptr(IdeBufferSnapshot) snapshot = NULL;
       IdeUnsavedFiles *unsaved_files;
-      gchar *text;
-      GtkTextIter begin;
-      GtkTextIter end;
       GFile *gfile = NULL;
-      gsize len;
 
-      gtk_text_buffer_get_bounds (GTK_TEXT_BUFFER (self), &begin, &end);
-      text = gtk_text_buffer_get_text (GTK_TEXT_BUFFER (self), &begin, &end, TRUE);
-
-      /*
-       * If implicit newline is set, add a \n in place of the \0 and avoid duplicating the buffer.
-       * Make sure to track length beforehand, since we would overwrite afterwards. Since
-       * conversion to \r\n is dealth with during save operations, this should be fine for both.
-       * The unsaved files will restore to a buffer, for which \n is acceptable.
-       */
-      len = strlen (text);
-      if (gtk_source_buffer_get_implicit_trailing_newline (GTK_SOURCE_BUFFER (self)))
-        {
-          if (!ide_buffer_can_do_newline_hack (self, len))
-            {
-              gchar *copy;
-
-              copy = g_malloc (len + 2);
-              memcpy (copy, text, len);
-              g_free (text);
-              text = copy;
-            }
-
-          text [len] = '\n';
-          text [++len] = '\0';
-        }
-
-      /*
-       * We pass a buffer that is longer than the length we tell GBytes about.
-       * This way, compilers that don't want to see the trailing \0 can ignore
-       * that data, but compilers that rely on valid C strings can also rely
-       * on the buffer to be valid.
-       */
-      priv->content = g_bytes_new_take (text, len);
+      snapshot = ide_buffer_get_snapshot (self);
+      priv->content = ide_buffer_snapshot_get_bytes (snapshot);
 
       if ((priv->context != NULL) &&
           (priv->file != NULL) &&
@@ -1953,6 +2529,265 @@ _ide_buffer_set_read_only (IdeBuffer *self,
     }
 }
 
+/*
+ * Drops the expensive per-buffer machinery (semantic highlighting, the VCS
+ * change monitor and diagnostics) until the buffer is first displayed. This
+ * is used while restoring a session so that dozens of buffers do not all
+ * start parsing at once.
+ */
+void
+_ide_buffer_defer_features (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  if (priv->deferred)
+    return;
+
+  priv->deferred = TRUE;
+
+  ide_clear_source (&priv->diagnose_timeout);
+
+  if (priv->highlight_engine != NULL)
+    {
+      g_object_run_dispose (G_OBJECT (priv->highlight_engine));
+      g_clear_object (&priv->highlight_engine);
+    }
+
+  ide_buffer_reload_change_monitor (self);
+}
+
+static gboolean
+ide_buffer_materialize_cb (gpointer user_data)
+{
+  IdeBuffer *self = user_data;
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_BUFFER (self));
+
+  priv->materialize_handler = 0;
+
+  if (!priv->deferred)
+    IDE_RETURN (G_SOURCE_REMOVE);
+
+  priv->deferred = FALSE;
+
+  if (priv->large_file == NULL)
+    priv->highlight_engine = ide_highlight_engine_new (self);
+
+  ide_buffer_reload_change_monitor (self);
+
+  if (priv->highlight_diagnostics && priv->diagnostics_dirty)
+    ide_buffer_queue_diagnose (self);
+
+  IDE_RETURN (G_SOURCE_REMOVE);
+}
+
+/*
+ * Called by views when they display the buffer. Restores anything that was
+ * dropped by _ide_buffer_defer_features(). This happens from an idle so it
+ * is safe to call while drawing.
+ */
+void
+_ide_buffer_queue_materialize (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  if (priv->deferred && priv->materialize_handler == 0)
+    priv->materialize_handler = g_idle_add (ide_buffer_materialize_cb, self);
+}
+
+/**
+ * ide_buffer_get_large_file_mode:
+ * @self: A #IdeBuffer.
+ *
+ * Gets the #IdeBuffer:large-file-mode property. This is %TRUE when the file
+ * was larger than the #IdeBufferManager:max-file-size and its contents are
+ * paged into the buffer on demand. Such buffers are read-only and have most
+ * per-buffer features, such as highlighting and diagnostics, disabled.
+ *
+ * Returns: %TRUE if the #IdeBuffer is in large file mode.
+ */
+gboolean
+ide_buffer_get_large_file_mode (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), FALSE);
+
+  return priv->large_file != NULL;
+}
+
+void
+_ide_buffer_set_large_file (IdeBuffer   *self,
+                            GMappedFile *mapped_file)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  gboolean was_large_file;
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  was_large_file = (priv->large_file != NULL);
+
+  if (mapped_file != NULL)
+    g_mapped_file_ref (mapped_file);
+  g_clear_pointer (&priv->large_file, g_mapped_file_unref);
+  g_clear_pointer (&priv->content, g_bytes_unref);
+  priv->large_file = mapped_file;
+  priv->large_file_offset = 0;
+
+  if (mapped_file != NULL)
+    {
+      /*
+       * Only the pages that have been viewed are ever inserted into the
+       * GtkTextBuffer, so everything that wants to walk the whole buffer is
+       * disabled. The buffer is also read-only so that we never write a
+       * truncated copy of the file back to disk.
+       */
+      gtk_source_buffer_set_highlight_syntax (GTK_SOURCE_BUFFER (self), FALSE);
+      gtk_source_buffer_set_highlight_matching_brackets (GTK_SOURCE_BUFFER (self), FALSE);
+
+      if (priv->diagnose_timeout != 0)
+        {
+          g_source_remove (priv->diagnose_timeout);
+          priv->diagnose_timeout = 0;
+        }
+
+      ide_buffer_clear_diagnostics (self);
+      ide_buffer_reload_change_monitor (self);
+
+      if (priv->highlight_engine != NULL)
+        {
+          g_object_run_dispose (G_OBJECT (priv->highlight_engine));
+          g_clear_object (&priv->highlight_engine);
+        }
+
+      g_clear_object (&priv->symbol_resolver_adapter);
+
+      _ide_buffer_set_read_only (self, TRUE);
+
+      gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (self));
+      gtk_text_buffer_set_text (GTK_TEXT_BUFFER (self), "", 0);
+      gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (self));
+    }
+  else if (was_large_file)
+    {
+      gtk_source_buffer_set_highlight_syntax (GTK_SOURCE_BUFFER (self), TRUE);
+
+      if (!priv->deferred)
+        priv->highlight_engine = ide_highlight_engine_new (self);
+      priv->symbol_resolver_adapter = ide_extension_adapter_new (priv->context,
+                                                                 NULL,
+                                                                 IDE_TYPE_SYMBOL_RESOLVER,
+                                                                 "Symbol-Resolver-Languages",
+                                                                 NULL);
+      g_object_notify (G_OBJECT (self), "language");
+
+      ide_buffer_reload_change_monitor (self);
+    }
+
+  if (was_large_file != (mapped_file != NULL))
+    g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_LARGE_FILE_MODE]);
+}
+
+/*
+ * Replaces invalid sequences with U+FFFD so that binary-ish data in a large
+ * file can still be displayed.
+ */
+static gchar *
+make_valid_utf8 (const gchar *str,
+                 gsize        len)
+{
+  GString *string;
+  const gchar *end;
+
+  string = g_string_sized_new (len + 1);
+
+  while (!g_utf8_validate (str, len, &end))
+    {
+      g_string_append_len (string, str, end - str);
+      g_string_append (string, "\357\277\275");
+      len -= (end - str) + 1;
+      str = end + 1;
+    }
+
+  g_string_append_len (string, str, len);
+
+  return g_string_free (string, FALSE);
+}
+
+/*
+ * Appends the next page of the mapped file to the buffer. Pages are cut at
+ * the last newline so that we never split a line (or a UTF-8 sequence)
+ * between two pages, unless a single line is longer than the page itself.
+ *
+ * Returns: %TRUE if there is more content left to load.
+ */
+gboolean
+_ide_buffer_load_large_file_page (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  g_autofree gchar *valid = NULL;
+  const gchar *contents;
+  const gchar *page;
+  const gchar *nl;
+  GtkTextIter iter;
+  gboolean modified;
+  gsize length;
+  gsize page_len;
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), FALSE);
+
+  if (priv->large_file == NULL)
+    return FALSE;
+
+  contents = g_mapped_file_get_contents (priv->large_file);
+  length = g_mapped_file_get_length (priv->large_file);
+
+  if (contents == NULL || priv->large_file_offset >= length)
+    return FALSE;
+
+  page = contents + priv->large_file_offset;
+  page_len = MIN (LARGE_FILE_PAGE_SIZE, length - priv->large_file_offset);
+
+  if (priv->large_file_offset + page_len < length)
+    {
+      for (nl = page + page_len - 1; nl > page; nl--)
+        {
+          if (*nl == '\n')
+            {
+              page_len = nl - page + 1;
+              break;
+            }
+        }
+    }
+
+  priv->large_file_offset += page_len;
+
+  if (!g_utf8_validate (page, page_len, NULL))
+    {
+      valid = make_valid_utf8 (page, page_len);
+      page = valid;
+      page_len = strlen (valid);
+    }
+
+  modified = gtk_text_buffer_get_modified (GTK_TEXT_BUFFER (self));
+
+  gtk_source_buffer_begin_not_undoable_action (GTK_SOURCE_BUFFER (self));
+  gtk_text_buffer_get_end_iter (GTK_TEXT_BUFFER (self), &iter);
+  gtk_text_buffer_insert (GTK_TEXT_BUFFER (self), &iter, page, page_len);
+  gtk_source_buffer_end_not_undoable_action (GTK_SOURCE_BUFFER (self));
+
+  gtk_text_buffer_set_modified (GTK_TEXT_BUFFER (self), modified);
+
+  return priv->large_file_offset < length;
+}
+
 /**
  * ide_buffer_get_changed_on_volume:
  * @self: A #IdeBuffer.
@@ -58,9 +58,15 @@ IdeContext         *ide_buffer_get_context                   (IdeBuffer
 IdeDiagnostic      *ide_buffer_get_diagnostic_at_iter        (IdeBuffer            *self,
                                                               const GtkTextIter    *iter);
 IdeFile            *ide_buffer_get_file                      (IdeBuffer            *self);
+gboolean            ide_buffer_get_large_file_mode           (IdeBuffer            *self);
 IdeBufferLineFlags  ide_buffer_get_line_flags                (IdeBuffer            *self,
                                                               guint                 line);
+void                ide_buffer_get_line_flags_range          (IdeBuffer            *self,
+                                                              guint                 first_line,
+                                                              guint                 n_lines,
+                                                              IdeBufferLineFlags   *flags);
 gboolean            ide_buffer_get_read_only                 (IdeBuffer            *self);
+IdeBufferSnapshot  *ide_buffer_get_snapshot                  (IdeBuffer            *self);
 gboolean            ide_buffer_get_highlight_diagnostics     (IdeBuffer            *self);
 const gchar        *ide_buffer_get_style_scheme_name         (IdeBuffer            *self);
 const gchar        *ide_buffer_get_title                     (IdeBuffer            *self);
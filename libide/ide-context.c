@@ -21,7 +21,9 @@
 #include <glib/gi18n.h>
 #include <libpeas/peas.h>
 
+#include "ide-application.h"
 #include "ide-async-helper.h"
+#include "ide-back-forward-item.h"
 #include "ide-back-forward-list.h"
 #include "ide-back-forward-list-private.h"
 #include "ide-buffer-manager.h"
@@ -30,6 +32,7 @@
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-device-manager.h"
+#include "ide-file.h"
 #include "ide-global.h"
 #include "ide-internal.h"
 #include "ide-project.h"
@@ -43,12 +46,14 @@
 #include "ide-source-snippets-manager.h"
 #include "ide-unsaved-file.h"
 #include "ide-unsaved-files.h"
+#include "ide-uri.h"
 #include "ide-vcs.h"
 #include "ide-recent-projects.h"
 
 #include "doap/ide-doap.h"
 
-#define RESTORE_FILES_MAX_FILES 20
+#define RESTORE_FILES_MAX_FILES    100
+#define RESTORE_FILES_MAX_PARALLEL 4
 
 struct _IdeContext
 {
@@ -955,6 +960,12 @@ ide_context_init_build_system_cb (GObject      *object,
 
   self->build_system = g_object_ref (build_system);
 
+  /* Load plugins deferred until this build system is in use. */
+  if (IDE_IS_APPLICATION (g_application_get_default ()))
+    ide_application_activate_plugins (IDE_APPLICATION_DEFAULT,
+                                      "Build-Systems",
+                                      G_OBJECT_TYPE_NAME (build_system));
+
   /* allow the build system to override the project file */
   g_object_get (self->build_system,
                 "project-file", &project_file,
@@ -1694,7 +1705,116 @@ ide_context_unload_finish (IdeContext    *self,
   IDE_RETURN (ret);
 }
 
-static gboolean restore_in_idle (gpointer user_data);
+typedef struct
+{
+  GPtrArray *files;
+  GFile     *focus;
+  gulong     load_buffer_handler;
+  guint      active;
+} Restore;
+
+typedef struct
+{
+  IdeUnsavedFile *file;
+  guint           rank;
+} RestoreRank;
+
+static void ide_context_restore_pump (GTask *task);
+
+static void
+restore_free (gpointer data)
+{
+  Restore *restore = data;
+
+  g_clear_pointer (&restore->files, g_ptr_array_unref);
+  g_clear_object (&restore->focus);
+  g_slice_free (Restore, restore);
+}
+
+static void
+collect_items (gpointer data,
+               gpointer user_data)
+{
+  g_ptr_array_add (user_data, data);
+}
+
+static gint
+compare_rank (gconstpointer a,
+              gconstpointer b)
+{
+  const RestoreRank *ra = a;
+  const RestoreRank *rb = b;
+
+  /* Highest priority last, so that it is popped first. */
+  if (ra->rank < rb->rank)
+    return 1;
+  else if (ra->rank > rb->rank)
+    return -1;
+  return 0;
+}
+
+/*
+ * Sorts the files to restore by how recently they were navigated to, using
+ * the back/forward history from the previous session. The file the user was
+ * last looking at is restored first.
+ */
+static void
+ide_context_restore_sort (IdeContext *self,
+                          GPtrArray  *files)
+{
+  g_autoptr(GPtrArray) items = NULL;
+  g_autoptr(GArray) ranks = NULL;
+  guint i;
+  guint j;
+
+  g_assert (IDE_IS_CONTEXT (self));
+  g_assert (files != NULL);
+
+  items = g_ptr_array_new ();
+  _ide_back_forward_list_foreach_recent (self->back_forward_list, collect_items, items);
+
+  ranks = g_array_sized_new (FALSE, FALSE, sizeof (RestoreRank), files->len);
+
+  for (i = 0; i < files->len; i++)
+    {
+      RestoreRank rank = { g_ptr_array_index (files, i), G_MAXUINT };
+      GFile *file = ide_unsaved_file_get_file (rank.file);
+
+      for (j = 0; j < items->len; j++)
+        {
+          IdeUri *uri = ide_back_forward_item_get_uri (g_ptr_array_index (items, j));
+
+          if (uri != NULL && ide_uri_is_file (uri, file))
+            {
+              rank.rank = j;
+              break;
+            }
+        }
+
+      g_array_append_val (ranks, rank);
+    }
+
+  g_array_sort (ranks, compare_rank);
+
+  for (i = 0; i < ranks->len; i++)
+    g_ptr_array_index (files, i) = g_array_index (ranks, RestoreRank, i).file;
+}
+
+static void
+ide_context_restore__load_buffer_cb (IdeContext       *self,
+                                     IdeBuffer        *buffer,
+                                     IdeBufferManager *buffer_manager)
+{
+  g_assert (IDE_IS_CONTEXT (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (IDE_IS_BUFFER_MANAGER (buffer_manager));
+
+  /*
+   * Restored buffers do not need highlighting, diagnostics or a change
+   * monitor until they are first displayed. The view will ask for them.
+   */
+  _ide_buffer_defer_features (buffer);
+}
 
 static void
 ide_context_restore__load_file_cb (GObject      *object,
@@ -1702,60 +1822,81 @@ ide_context_restore__load_file_cb (GObject      *object,
                                    gpointer      user_data)
 {
   IdeBufferManager *buffer_manager = (IdeBufferManager *)object;
+  g_autoptr(IdeBuffer) buffer = NULL;
   g_autoptr(GTask) task = user_data;
   g_autoptr(GError) error = NULL;
+  Restore *restore;
 
   g_assert (IDE_IS_BUFFER_MANAGER (buffer_manager));
   g_assert (G_IS_TASK (task));
 
-  if (!ide_buffer_manager_load_file_finish (buffer_manager, result, &error))
+  restore = g_task_get_task_data (task);
+  restore->active--;
+
+  if (!(buffer = ide_buffer_manager_load_file_finish (buffer_manager, result, &error)))
     {
       g_warning ("%s", error->message);
       /* TODO: add error into grouped error */
     }
+  else if (restore->focus != NULL &&
+           g_file_equal (restore->focus, ide_file_get_file (ide_buffer_get_file (buffer))))
+    {
+      /* Give the user something to work with while the rest loads. */
+      ide_buffer_manager_set_focus_buffer (buffer_manager, buffer);
+      g_clear_object (&restore->focus);
+    }
 
-  g_idle_add (restore_in_idle, g_object_ref (task));
+  ide_context_restore_pump (task);
 }
 
-static gboolean
-restore_in_idle (gpointer user_data)
+static void
+ide_context_restore_pump (GTask *task)
 {
-  g_autoptr(IdeFile) ifile = NULL;
-  g_autoptr(GTask) task = user_data;
-  IdeUnsavedFile *uf;
   IdeContext *self;
-  GPtrArray *ar;
-  GFile *file;
+  Restore *restore;
 
   g_assert (G_IS_TASK (task));
 
   self = g_task_get_source_object (task);
-  ar = g_task_get_task_data (task);
+  restore = g_task_get_task_data (task);
 
-  if (ar == NULL || ar->len == 0)
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    g_ptr_array_set_size (restore->files, 0);
+
+  if (restore->files->len == 0 && restore->active == 0)
     {
+      ide_clear_signal_handler (self->buffer_manager, &restore->load_buffer_handler);
       self->restoring = FALSE;
       g_task_return_boolean (task, TRUE);
-      return G_SOURCE_REMOVE;
+      return;
     }
 
-  g_assert (ar != NULL);
-  g_assert (ar->len > 0);
+  /*
+   * Keep a few loads in flight so that I/O for one file overlaps with
+   * creating the buffer and view for another, without flooding the main
+   * loop with file loader callbacks.
+   */
+  while (restore->files->len > 0 && restore->active < RESTORE_FILES_MAX_PARALLEL)
+    {
+      g_autoptr(IdeFile) ifile = NULL;
+      IdeUnsavedFile *uf;
+      GFile *file;
 
-  uf = g_ptr_array_index (ar, ar->len - 1);
-  file = ide_unsaved_file_get_file (uf);
-  ifile = ide_project_get_project_file (self->project, file);
-  g_ptr_array_remove_index (ar, ar->len - 1);
+      uf = g_ptr_array_index (restore->files, restore->files->len - 1);
+      file = ide_unsaved_file_get_file (uf);
+      ifile = ide_project_get_project_file (self->project, file);
+      g_ptr_array_remove_index (restore->files, restore->files->len - 1);
 
-  ide_buffer_manager_load_file_async (self->buffer_manager,
-                                      ifile,
-                                      FALSE,
-                                      NULL,
-                                      g_task_get_cancellable (task),
-                                      ide_context_restore__load_file_cb,
-                                      g_object_ref (task));
+      restore->active++;
 
-  return G_SOURCE_REMOVE;
+      ide_buffer_manager_load_file_async (self->buffer_manager,
+                                          ifile,
+                                          FALSE,
+                                          NULL,
+                                          g_task_get_cancellable (task),
+                                          ide_context_restore__load_file_cb,
+                                          g_object_ref (task));
+    }
 }
 
 void
@@ -1766,6 +1907,7 @@ ide_context_restore_async (IdeContext          *self,
 {
   g_autoptr(GTask) task = NULL;
   g_autoptr(GPtrArray) ar = NULL;
+  Restore *restore;
 
   g_return_if_fail (IDE_IS_CONTEXT (self));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
@@ -1806,9 +1948,21 @@ ide_context_restore_async (IdeContext          *self,
 
   self->restoring = TRUE;
 
-  g_task_set_task_data (task, g_ptr_array_ref (ar), (GDestroyNotify)g_ptr_array_unref);
+  ide_context_restore_sort (self, ar);
+
+  restore = g_slice_new0 (Restore);
+  restore->files = g_ptr_array_ref (ar);
+  restore->focus = g_object_ref (ide_unsaved_file_get_file (g_ptr_array_index (ar, ar->len - 1)));
+  restore->load_buffer_handler =
+    g_signal_connect_object (self->buffer_manager,
+                             "load-buffer",
+                             G_CALLBACK (ide_context_restore__load_buffer_cb),
+                             self,
+                             G_CONNECT_SWAPPED);
+
+  g_task_set_task_data (task, restore, restore_free);
 
-  g_idle_add (restore_in_idle, g_object_ref (task));
+  ide_context_restore_pump (task);
 }
 
 gboolean
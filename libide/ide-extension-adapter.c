@@ -20,11 +20,13 @@
 
 #include <glib/gi18n.h>
 
+#include "egg-counter.h"
 #include "egg-signal-group.h"
 
 #include "ide-extension-adapter.h"
 #include "ide-extension-util.h"
 #include "ide-macros.h"
+#include "ide-plugin-profile.h"
 
 struct _IdeExtensionAdapter
 {
@@ -45,6 +47,9 @@ struct _IdeExtensionAdapter
 
 G_DEFINE_TYPE (IdeExtensionAdapter, ide_extension_adapter, IDE_TYPE_OBJECT)
 
+EGG_DEFINE_COUNTER (Reloads, "IdeExtensionAdapter", "Reloads",
+                    "Number of times extension adapters resolved their extension.")
+
 enum {
   PROP_0,
   PROP_ENGINE,
@@ -109,40 +114,28 @@ ide_extension_adapter_set_extension (IdeExtensionAdapter *self,
 static void
 ide_extension_adapter_reload (IdeExtensionAdapter *self)
 {
-  const GList *plugins;
+  g_autoptr(GArray) matches = NULL;
   PeasPluginInfo *best_match = NULL;
   PeasExtension *extension = NULL;
-  gint best_match_priority = G_MININT;
 
   g_assert (IDE_IS_EXTENSION_ADAPTER (self));
 
+  EGG_COUNTER_INC (Reloads);
+
   if (!self->engine || !self->key || !self->value || !self->interface_type)
     {
       ide_extension_adapter_set_extension (self, NULL, NULL);
       return;
     }
 
-  plugins = peas_engine_get_plugin_list (self->engine);
+  /* Matches are sorted by priority, so the first is the best match. */
+  matches = ide_extension_util_lookup (self->engine,
+                                       self->interface_type,
+                                       self->key,
+                                       self->value);
 
-  for (; plugins; plugins = plugins->next)
-    {
-      PeasPluginInfo *plugin_info = plugins->data;
-      gint priority = 0;
-
-      if (ide_extension_util_can_use_plugin (self->engine,
-                                             plugin_info,
-                                             self->interface_type,
-                                             self->key,
-                                             self->value,
-                                             &priority))
-        {
-          if (priority > best_match_priority)
-            {
-              best_match = plugin_info;
-              best_match_priority = priority;
-            }
-        }
-    }
+  if (matches->len > 0)
+    best_match = g_array_index (matches, IdeExtensionMatch, 0).plugin_info;
 
 #if 0
   g_print ("Best match for %s=%s is %s\n",
@@ -160,6 +153,10 @@ ide_extension_adapter_reload (IdeExtensionAdapter *self)
   if (best_match != NULL)
     {
       IdeContext *context = ide_object_get_context (IDE_OBJECT (self));
+      const gchar *type_name = g_type_name (self->interface_type);
+      gint64 begin_time;
+
+      begin_time = ide_plugin_profile_begin (best_match, type_name);
 
       if (g_type_is_a (self->interface_type, IDE_TYPE_OBJECT))
         extension = peas_engine_create_extension (self->engine,
@@ -172,6 +169,8 @@ ide_extension_adapter_reload (IdeExtensionAdapter *self)
                                                   best_match,
                                                   self->interface_type,
                                                   NULL);
+
+      ide_plugin_profile_end (best_match, type_name, begin_time);
     }
 
   ide_extension_adapter_set_extension (self, best_match, extension);
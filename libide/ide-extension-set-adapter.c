@@ -20,10 +20,13 @@
 
 #include <glib/gi18n.h>
 
+#include "egg-counter.h"
+
 #include "ide-context.h"
 #include "ide-extension-set-adapter.h"
 #include "ide-extension-util.h"
 #include "ide-macros.h"
+#include "ide-plugin-profile.h"
 
 struct _IdeExtensionSetAdapter
 {
@@ -41,6 +44,9 @@ struct _IdeExtensionSetAdapter
 
 G_DEFINE_TYPE (IdeExtensionSetAdapter, ide_extension_set_adapter, IDE_TYPE_OBJECT)
 
+EGG_DEFINE_COUNTER (SetReloads, "IdeExtensionSetAdapter", "Reloads",
+                    "Number of times extension set adapters resolved their extensions.")
+
 enum {
   EXTENSION_ADDED,
   EXTENSION_REMOVED,
@@ -92,46 +98,69 @@ remove_extension (IdeExtensionSetAdapter *self,
 static void
 ide_extension_set_adapter_reload (IdeExtensionSetAdapter *self)
 {
+  g_autoptr(GArray) matches = NULL;
+  g_autoptr(GHashTable) usable = NULL;
+  g_autoptr(GPtrArray) stale = NULL;
+  GHashTableIter iter;
   IdeContext *context;
-  const GList *plugins;
+  const gchar *type_name;
+  gpointer key;
+  guint i;
 
   g_assert (IDE_IS_EXTENSION_SET_ADAPTER (self));
 
+  EGG_COUNTER_INC (SetReloads);
+
+  type_name = g_type_name (self->interface_type);
+
   context = ide_object_get_context (IDE_OBJECT (self));
-  plugins = peas_engine_get_plugin_list (self->engine);
+  matches = ide_extension_util_lookup (self->engine,
+                                       self->interface_type,
+                                       self->key,
+                                       self->value);
+  usable = g_hash_table_new (NULL, NULL);
 
-  for (; plugins; plugins = plugins->next)
+  for (i = 0; i < matches->len; i++)
     {
-      PeasPluginInfo *plugin_info = plugins->data;
-      gint priority;
-
-      if (ide_extension_util_can_use_plugin (self->engine,
-                                             plugin_info,
-                                             self->interface_type,
-                                             self->key,
-                                             self->value,
-                                             &priority))
-        {
-          if (!g_hash_table_lookup (self->extensions, plugin_info))
-            {
-              PeasExtension *exten;
-
-              exten = peas_engine_create_extension (self->engine,
-                                                    plugin_info,
-                                                    self->interface_type,
-                                                    "context", context,
-                                                    NULL);
-              add_extension (self, plugin_info, exten);
-            }
-        }
-      else
+      PeasPluginInfo *plugin_info = g_array_index (matches, IdeExtensionMatch, i).plugin_info;
+
+      g_hash_table_add (usable, plugin_info);
+
+      if (!g_hash_table_lookup (self->extensions, plugin_info))
         {
           PeasExtension *exten;
-
-          if ((exten = g_hash_table_lookup (self->extensions, plugin_info)))
-            remove_extension (self, plugin_info, exten);
+          gint64 begin_time;
+
+          begin_time = ide_plugin_profile_begin (plugin_info, type_name);
+          exten = peas_engine_create_extension (self->engine,
+                                                plugin_info,
+                                                self->interface_type,
+                                                "context", context,
+                                                NULL);
+          ide_plugin_profile_end (plugin_info, type_name, begin_time);
+          add_extension (self, plugin_info, exten);
         }
     }
+
+  /*
+   * Collect the extensions to remove first, as removing them while
+   * iterating would invalidate the iter.
+   */
+  stale = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, self->extensions);
+
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (usable, key))
+        g_ptr_array_add (stale, key);
+    }
+
+  for (i = 0; i < stale->len; i++)
+    {
+      PeasPluginInfo *plugin_info = g_ptr_array_index (stale, i);
+
+      remove_extension (self, plugin_info, g_hash_table_lookup (self->extensions, plugin_info));
+    }
 }
 
 static gboolean
@@ -158,6 +187,33 @@ ide_extension_set_adapter_queue_reload (IdeExtensionSetAdapter *self)
   self->reload_handler = g_timeout_add (0, ide_extension_set_adapter_do_reload, self);
 }
 
+static void
+ide_extension_set_adapter__engine_load_plugin (IdeExtensionSetAdapter *self,
+                                               PeasPluginInfo         *plugin_info,
+                                               PeasEngine             *engine)
+{
+  g_assert (IDE_IS_EXTENSION_SET_ADAPTER (self));
+  g_assert (plugin_info != NULL);
+  g_assert (PEAS_IS_ENGINE (engine));
+
+  /* Plugins activated on demand after startup must join existing sets. */
+  if (peas_engine_provides_extension (self->engine, plugin_info, self->interface_type))
+    ide_extension_set_adapter_queue_reload (self);
+}
+
+static void
+ide_extension_set_adapter__engine_unload_plugin (IdeExtensionSetAdapter *self,
+                                                 PeasPluginInfo         *plugin_info,
+                                                 PeasEngine             *engine)
+{
+  g_assert (IDE_IS_EXTENSION_SET_ADAPTER (self));
+  g_assert (plugin_info != NULL);
+  g_assert (PEAS_IS_ENGINE (engine));
+
+  if (g_hash_table_contains (self->extensions, plugin_info))
+    ide_extension_set_adapter_queue_reload (self);
+}
+
 static void
 ide_extension_set_adapter_set_engine (IdeExtensionSetAdapter *self,
                                       PeasEngine             *engine)
@@ -167,6 +223,16 @@ ide_extension_set_adapter_set_engine (IdeExtensionSetAdapter *self,
 
   if (g_set_object (&self->engine, engine))
     {
+      g_signal_connect_object (self->engine,
+                               "load-plugin",
+                               G_CALLBACK (ide_extension_set_adapter__engine_load_plugin),
+                               self,
+                               G_CONNECT_AFTER | G_CONNECT_SWAPPED);
+      g_signal_connect_object (self->engine,
+                               "unload-plugin",
+                               G_CALLBACK (ide_extension_set_adapter__engine_unload_plugin),
+                               self,
+                               G_CONNECT_AFTER | G_CONNECT_SWAPPED);
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ENGINE]);
       ide_extension_set_adapter_queue_reload (self);
     }
@@ -20,75 +20,261 @@
 
 #include <stdlib.h>
 
+#include "egg-counter.h"
+
 #include "ide-extension-util.h"
 
-gboolean
-ide_extension_util_can_use_plugin (PeasEngine     *engine,
-                                   PeasPluginInfo *plugin_info,
-                                   GType           interface_type,
-                                   const gchar    *key,
-                                   const gchar    *value,
-                                   gint           *priority)
+/*
+ * The capability index caches, per PeasEngine, which loaded plugins provide
+ * an interface and advertise a given key/value pair in their external data.
+ * Extension adapters are created for every buffer, so resolving them from
+ * the index avoids walking the plugin list and parsing external data each
+ * time. The index is discarded whenever a plugin is loaded or unloaded.
+ */
+typedef struct
+{
+  PeasEngine *engine;
+
+  /* "GType:key:value" to GArray of IdeExtensionMatch */
+  GHashTable *matches;
+
+  /* "module/GType" to GSettings for org.gnome.builder.extension-type */
+  GHashTable *settings;
+} ExtensionIndex;
+
+EGG_DEFINE_COUNTER (IndexHits, "IdeExtensionUtil", "Index Hits",
+                    "Number of extension lookups resolved from the capability index.")
+EGG_DEFINE_COUNTER (IndexMisses, "IdeExtensionUtil", "Index Misses",
+                    "Number of extension lookups that required scanning the plugin list.")
+EGG_DEFINE_COUNTER (IndexResets, "IdeExtensionUtil", "Index Resets",
+                    "Number of times the capability index was discarded due to plugin changes.")
+
+static void
+extension_index_free (gpointer data)
+{
+  ExtensionIndex *index = data;
+
+  g_clear_pointer (&index->matches, g_hash_table_unref);
+  g_clear_pointer (&index->settings, g_hash_table_unref);
+  g_slice_free (ExtensionIndex, index);
+}
+
+static void
+extension_index_reset (ExtensionIndex *index,
+                       PeasPluginInfo *plugin_info,
+                       PeasEngine     *engine)
+{
+  g_assert (index != NULL);
+  g_assert (PEAS_IS_ENGINE (engine));
+
+  g_hash_table_remove_all (index->matches);
+
+  EGG_COUNTER_INC (IndexResets);
+}
+
+static ExtensionIndex *
+extension_index_get (PeasEngine *engine)
+{
+  ExtensionIndex *index;
+
+  g_assert (PEAS_IS_ENGINE (engine));
+
+  index = g_object_get_data (G_OBJECT (engine), "IDE_EXTENSION_INDEX");
+
+  if (index == NULL)
+    {
+      index = g_slice_new0 (ExtensionIndex);
+      index->engine = engine;
+      index->matches = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              g_free,
+                                              (GDestroyNotify)g_array_unref);
+      index->settings = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               g_object_unref);
+
+      g_object_set_data_full (G_OBJECT (engine),
+                              "IDE_EXTENSION_INDEX",
+                              index,
+                              extension_index_free);
+
+      g_signal_connect_data (engine,
+                             "load-plugin",
+                             G_CALLBACK (extension_index_reset),
+                             index,
+                             NULL,
+                             (G_CONNECT_SWAPPED | G_CONNECT_AFTER));
+      g_signal_connect_data (engine,
+                             "unload-plugin",
+                             G_CALLBACK (extension_index_reset),
+                             index,
+                             NULL,
+                             (G_CONNECT_SWAPPED | G_CONNECT_AFTER));
+    }
+
+  return index;
+}
+
+static gboolean
+extension_index_is_enabled (ExtensionIndex *index,
+                            PeasPluginInfo *plugin_info,
+                            GType           interface_type)
+{
+  g_autofree gchar *settings_key = NULL;
+  GSettings *settings;
+
+  g_assert (index != NULL);
+  g_assert (plugin_info != NULL);
+
+  /*
+   * GSettings instances are comparatively expensive to create, so keep one
+   * around per module and interface. They track changes on their own.
+   */
+  settings_key = g_strdup_printf ("%s/%s",
+                                  peas_plugin_info_get_module_name (plugin_info),
+                                  g_type_name (interface_type));
+  settings = g_hash_table_lookup (index->settings, settings_key);
+
+  if (settings == NULL)
+    {
+      g_autofree gchar *path = NULL;
+
+      path = g_strdup_printf ("/org/gnome/builder/extension-types/%s/",
+                              settings_key);
+      settings = g_settings_new_with_path ("org.gnome.builder.extension-type", path);
+      g_hash_table_insert (index->settings, g_steal_pointer (&settings_key), settings);
+    }
+
+  return g_settings_get_boolean (settings, "enabled");
+}
+
+static gint
+compare_match (gconstpointer a,
+               gconstpointer b)
+{
+  const IdeExtensionMatch *ma = a;
+  const IdeExtensionMatch *mb = b;
+
+  return mb->priority - ma->priority;
+}
+
+static GArray *
+extension_index_build (ExtensionIndex *index,
+                       GType           interface_type,
+                       const gchar    *key,
+                       const gchar    *value)
 {
-  g_autofree gchar *path = NULL;
-  g_autoptr(GSettings) settings = NULL;
+  const GList *plugins;
+  GArray *ar;
+
+  g_assert (index != NULL);
 
-  g_return_val_if_fail (plugin_info != NULL, FALSE);
-  g_return_val_if_fail (g_type_is_a (interface_type, G_TYPE_INTERFACE), FALSE);
-  g_return_val_if_fail (priority != NULL, FALSE);
+  ar = g_array_new (FALSE, FALSE, sizeof (IdeExtensionMatch));
+  plugins = peas_engine_get_plugin_list (index->engine);
+
+  for (; plugins; plugins = plugins->next)
+    {
+      PeasPluginInfo *plugin_info = plugins->data;
+      IdeExtensionMatch match = { plugin_info, 0 };
 
-  *priority = 0;
+      if (!peas_plugin_info_is_loaded (plugin_info) ||
+          !peas_engine_provides_extension (index->engine, plugin_info, interface_type))
+        continue;
+
+      if (key != NULL)
+        {
+          g_autofree gchar *priority_name = NULL;
+          g_auto(GStrv) values_array = NULL;
+          const gchar *values;
+          const gchar *priority_value;
+
+          values = peas_plugin_info_get_external_data (plugin_info, key);
+          values_array = g_strsplit (values ? values : "", ",", 0);
+          if (!g_strv_contains ((const gchar * const *)values_array, value))
+            continue;
+
+          priority_name = g_strdup_printf ("%s-Priority", key);
+          priority_value = peas_plugin_info_get_external_data (plugin_info, priority_name);
+          if (priority_value != NULL)
+            match.priority = atoi (priority_value);
+        }
+
+      g_array_append_val (ar, match);
+    }
+
+  /* The sort is stable, so ties keep the plugin list ordering. */
+  g_array_sort (ar, compare_match);
+
+  return ar;
+}
+
+/**
+ * ide_extension_util_lookup:
+ * @engine: a #PeasEngine
+ * @interface_type: the #GType of the extension interface
+ * @key: (nullable): the external data key to match, such as
+ *   "X-Completion-Provider-Languages"
+ * @value: (nullable): the value that must be contained in @key
+ *
+ * Resolves the loaded and enabled plugins that can provide @interface_type
+ * for @key and @value, using the capability index of @engine.
+ *
+ * Returns: (transfer full): A #GArray of #IdeExtensionMatch sorted by
+ *   descending priority.
+ */
+GArray *
+ide_extension_util_lookup (PeasEngine  *engine,
+                           GType        interface_type,
+                           const gchar *key,
+                           const gchar *value)
+{
+  g_autofree gchar *index_key = NULL;
+  ExtensionIndex *index;
+  GArray *matches;
+  GArray *ret;
+  guint i;
+
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (interface_type), NULL);
+
+  ret = g_array_new (FALSE, FALSE, sizeof (IdeExtensionMatch));
 
   /*
    * If we are restricting by plugin info keyword, ensure we have enough
    * information to do so.
    */
   if ((key != NULL) && (value == NULL))
-    return FALSE;
+    return ret;
 
-  /*
-   * If the plugin isn't loaded, then we shouldn't use it.
-   */
-  if (!peas_plugin_info_is_loaded (plugin_info))
-    return FALSE;
+  index = extension_index_get (engine);
+  index_key = g_strdup_printf ("%s:%s:%s",
+                               g_type_name (interface_type),
+                               key ? key : "",
+                               value ? value : "");
 
-  /*
-   * If this plugin doesn't provide this type, we can't use it either.
-   */
-  if (!peas_engine_provides_extension (engine, plugin_info, interface_type))
-    return FALSE;
+  if (!(matches = g_hash_table_lookup (index->matches, index_key)))
+    {
+      matches = extension_index_build (index, interface_type, key, value);
+      g_hash_table_insert (index->matches, g_steal_pointer (&index_key), matches);
+      EGG_COUNTER_INC (IndexMisses);
+    }
+  else
+    {
+      EGG_COUNTER_INC (IndexHits);
+    }
 
   /*
-   * Check that the plugin provides the match value we are looking for.
-   * If key is NULL, then we aren't restricting by matching.
+   * Whether the plugin is enabled for this interface may change at any
+   * time, so that is checked on every lookup.
    */
-  if (key != NULL)
+  for (i = 0; i < matches->len; i++)
     {
-      g_autofree gchar *priority_name = NULL;
-      g_auto(GStrv) values_array = NULL;
-      const gchar *values;
-      const gchar *priority_value;
-
-      values = peas_plugin_info_get_external_data (plugin_info, key);
-      values_array = g_strsplit (values ? values : "", ",", 0);
-      if (!g_strv_contains ((const gchar * const *)values_array, value))
-        return FALSE;
-
-      priority_name = g_strdup_printf ("%s-Priority", key);
-      priority_value = peas_plugin_info_get_external_data (plugin_info, priority_name);
-      if (priority_value != NULL)
-        *priority = atoi (priority_value);
+      const IdeExtensionMatch *match = &g_array_index (matches, IdeExtensionMatch, i);
+
+      if (extension_index_is_enabled (index, match->plugin_info, interface_type))
+        g_array_append_val (ret, *match);
     }
 
-  /*
-   * Ensure the plugin type isn't disabled by checking our GSettings
-   * for the plugin type. There is an implicit plugin issue here, in that
-   * two modules using different plugin loaders could have the same module
-   * name. But we can enforce this issue socially.
-   */
-  path = g_strdup_printf ("/org/gnome/builder/extension-types/%s/%s/",
-                          peas_plugin_info_get_module_name (plugin_info),
-                          g_type_name (interface_type));
-  settings = g_settings_new_with_path ("org.gnome.builder.extension-type", path);
-  return g_settings_get_boolean (settings, "enabled");
+  return ret;
 }
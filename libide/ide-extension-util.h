@@ -23,12 +23,16 @@
 
 G_BEGIN_DECLS
 
-gboolean ide_extension_util_can_use_plugin (PeasEngine     *engine,
-                                            PeasPluginInfo *plugin_info,
-                                            GType           interface_type,
-                                            const gchar    *key,
-                                            const gchar    *value,
-                                            gint           *priority);
+typedef struct
+{
+  PeasPluginInfo *plugin_info;
+  gint            priority;
+} IdeExtensionMatch;
+
+GArray *ide_extension_util_lookup (PeasEngine  *engine,
+                                   GType        interface_type,
+                                   const gchar *key,
+                                   const gchar *value);
 
 G_END_DECLS
 
@@ -21,6 +21,7 @@
 #include <glib/gi18n.h>
 #include <string.h>
 
+#include "egg-counter.h"
 #include "egg-signal-group.h"
 
 #include "ide-debug.h"
@@ -50,6 +51,7 @@ struct _IdeHighlightEngine
   GSList         *public_tags;
 
   guint64         quanta_expiration;
+  gint64          invalidated_at;
 
   guint           work_timeout;
 
@@ -68,6 +70,15 @@ enum {
 static GParamSpec *properties [LAST_PROP];
 static GQuark      engineQuark;
 
+EGG_DEFINE_HISTOGRAM (TickTime,
+                      "IdeHighlightEngine",
+                      "Tick Time",
+                      "Time spent in a single highlight pass (usec).")
+EGG_DEFINE_HISTOGRAM (InvalidateToHighlight,
+                      "IdeHighlightEngine",
+                      "Edit To Highlight",
+                      "Time from an edit until highlighting is current (usec).")
+
 static gboolean
 get_invalidation_area (GtkTextIter *begin,
                        GtkTextIter *end)
@@ -302,6 +313,7 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   GtkTextIter invalid_begin;
   GtkTextIter invalid_end;
   GSList *tags_iter;
+  gint64 begin_time;
 
   IDE_PROBE;
 
@@ -311,7 +323,8 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   g_assert (self->invalid_begin != NULL);
   g_assert (self->invalid_end != NULL);
 
-  self->quanta_expiration = g_get_monotonic_time () + HIGHLIGHT_QUANTA_USEC;
+  begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
+  self->quanta_expiration = begin_time + HIGHLIGHT_QUANTA_USEC;
 
   buffer = GTK_TEXT_BUFFER (self->buffer);
 
@@ -343,6 +356,8 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   if (gtk_text_iter_compare (&iter, &invalid_end) >= 0)
     IDE_GOTO (up_to_date);
 
+  EGG_HISTOGRAM_TIMER_END (TickTime, begin_time);
+
   /* Stop processing until further instruction if no movement was made */
   if (gtk_text_iter_equal (&iter, &invalid_begin))
     return FALSE;
@@ -352,10 +367,18 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   return TRUE;
 
 up_to_date:
+  EGG_HISTOGRAM_TIMER_END (TickTime, begin_time);
+
   gtk_text_buffer_get_start_iter (buffer, &iter);
   gtk_text_buffer_move_mark (buffer, self->invalid_begin, &iter);
   gtk_text_buffer_move_mark (buffer, self->invalid_end, &iter);
 
+  if (self->invalidated_at != 0)
+    {
+      EGG_HISTOGRAM_TIMER_END (InvalidateToHighlight, self->invalidated_at);
+      self->invalidated_at = 0;
+    }
+
   return FALSE;
 }
 
@@ -413,6 +436,9 @@ invalidate_and_highlight (IdeHighlightEngine *self,
       gtk_text_buffer_get_iter_at_mark (text_buffer, &begin_tmp, self->invalid_begin);
       gtk_text_buffer_get_iter_at_mark (text_buffer, &end_tmp, self->invalid_end);
 
+      if (self->invalidated_at == 0)
+        self->invalidated_at = EGG_HISTOGRAM_TIMER_BEGIN ();
+
       if (gtk_text_iter_equal (&begin_tmp, &end_tmp))
         {
           gtk_text_buffer_move_mark (text_buffer, self->invalid_begin, begin);
@@ -43,6 +43,9 @@ struct _IdeHighlightIndex
 
   GStringChunk  *strings;
   GHashTable    *index;
+
+  /* Indexes whose keys we borrow, see ide_highlight_index_merge(). */
+  GPtrArray     *merged;
 };
 
 IdeHighlightIndex *
@@ -103,6 +106,47 @@ ide_highlight_index_lookup (IdeHighlightIndex *self,
   return g_hash_table_lookup (self->index, word);
 }
 
+/**
+ * ide_highlight_index_merge:
+ * @self: An #IdeHighlightIndex.
+ * @other: An #IdeHighlightIndex to merge into @self.
+ *
+ * Adds all of the words from @other to @self. Words already in @self keep
+ * their existing tag.
+ *
+ * @self keeps a reference to @other and shares its strings rather than
+ * copying them, so @other must not be modified after it has been merged.
+ * This makes it cheap to build an index from a number of shared indexes,
+ * such as those for commonly included headers.
+ */
+void
+ide_highlight_index_merge (IdeHighlightIndex *self,
+                           IdeHighlightIndex *other)
+{
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_assert (self);
+  g_assert (other);
+  g_assert (self != other);
+
+  if (self->merged == NULL)
+    self->merged = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_highlight_index_unref);
+  g_ptr_array_add (self->merged, ide_highlight_index_ref (other));
+
+  g_hash_table_iter_init (&iter, other->index);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (!g_hash_table_contains (self->index, key))
+        {
+          g_hash_table_insert (self->index, key, value);
+          self->count++;
+        }
+    }
+}
+
 IdeHighlightIndex *
 ide_highlight_index_ref (IdeHighlightIndex *self)
 {
@@ -121,6 +165,7 @@ ide_highlight_index_finalize (IdeHighlightIndex *self)
 
   g_string_chunk_free (self->strings);
   g_hash_table_unref (self->index);
+  g_clear_pointer (&self->merged, g_ptr_array_unref);
   g_free (self);
 
   EGG_COUNTER_DEC (instances);
@@ -26,29 +26,52 @@
 #include "ide-diagnostic.h"
 #include "ide-types.h"
 #include "ide-settings.h"
+#include "ide-source-search-index.h"
 #include "ide-source-view.h"
 #include "ide-source-view-mode.h"
 #include "ide-symbol.h"
 #include "ide-highlight-engine.h"
+#include "ide-word-completion-provider.h"
 
 G_BEGIN_DECLS
 
 void                _ide_battery_monitor_init               (void);
 void                _ide_battery_monitor_shutdown           (void);
+void                _ide_buffer_defer_features              (IdeBuffer             *self);
+void                _ide_buffer_queue_materialize           (IdeBuffer             *self);
 void                _ide_buffer_set_changed_on_volume       (IdeBuffer             *self,
                                                              gboolean               changed_on_volume);
+void                _ide_buffer_set_diagnostics             (IdeBuffer             *self,
+                                                             IdeDiagnostics        *diagnostics);
 gboolean            _ide_buffer_get_loading                 (IdeBuffer             *self);
+gboolean            _ide_buffer_load_large_file_page        (IdeBuffer             *self);
+void                _ide_buffer_set_large_file              (IdeBuffer             *self,
+                                                             GMappedFile           *mapped_file);
 void                _ide_buffer_set_loading                 (IdeBuffer             *self,
                                                              gboolean               loading);
 void                _ide_buffer_set_mtime                   (IdeBuffer             *self,
                                                              const GTimeVal        *mtime);
 void                _ide_buffer_set_read_only               (IdeBuffer             *buffer,
                                                              gboolean               read_only);
+GPtrArray          *_ide_buffer_chunks_new                  (void);
+void                _ide_buffer_chunks_insert               (GPtrArray             *chunks,
+                                                             gsize                  offset,
+                                                             const gchar           *text,
+                                                             gsize                  len);
+void                _ide_buffer_chunks_delete               (GPtrArray             *chunks,
+                                                             gsize                  begin,
+                                                             gsize                  end);
+IdeBufferSnapshot  *_ide_buffer_snapshot_new                (GPtrArray             *chunks,
+                                                             gsize                  change_count,
+                                                             gboolean               trailing_newline);
 void                _ide_buffer_manager_reclaim             (IdeBufferManager      *self,
                                                              IdeBuffer             *buffer);
 void                _ide_build_system_set_project_file      (IdeBuildSystem        *self,
                                                              GFile                 *project_file);
 gboolean            _ide_context_is_restoring               (IdeContext            *self);
+gboolean            _ide_editorconfig_section_matches       (const gchar           *directory,
+                                                             const gchar           *name,
+                                                             const gchar           *path);
 const gchar        *_ide_file_get_content_type              (IdeFile               *self);
 GtkSourceFile      *_ide_file_set_content_type              (IdeFile               *self,
                                                              const gchar           *content_type);
@@ -68,6 +91,7 @@ IdeSettings        *_ide_settings_new                       (IdeContext
                                                              const gchar           *relative_path,
                                                              gboolean               ignore_project_settings);
 GtkTextMark        *_ide_source_view_get_scroll_mark        (IdeSourceView         *self);
+IdeSourceSearchIndex *_ide_source_view_get_search_index     (IdeSourceView         *self);
 gboolean            _ide_source_view_mode_do_event          (IdeSourceViewMode     *mode,
                                                              GdkEventKey           *event,
                                                              gboolean              *remove);
@@ -83,6 +107,12 @@ IdeUnsavedFile     *_ide_unsaved_file_new                   (GFile
                                                              GBytes                *content,
                                                              const gchar           *temp_path,
                                                              gint64                 sequence);
+void                _ide_word_completion_provider_add_project_word
+                                                            (IdeWordCompletionProvider *self,
+                                                             const gchar           *word,
+                                                             guint                  count);
+gchar             **_ide_word_completion_provider_complete  (IdeWordCompletionProvider *self,
+                                                             const gchar           *prefix);
 void                _ide_highlighter_set_highlighter_engine (IdeHighlighter        *highlighter,
                                                              IdeHighlightEngine    *highlight_engine);
 const gchar        *_ide_source_view_get_mode_name          (IdeSourceView         *self);
@@ -35,6 +35,10 @@ struct _IdeLineChangeGutterRenderer
   GdkRGBA                 rgba_added;
   GdkRGBA                 rgba_changed;
 
+  /* Flags of the lines being drawn, filled in by begin() */
+  GArray                 *line_flags;
+  guint                   first_line;
+
   guint                   rgba_added_set : 1;
   guint                   rgba_changed_set : 1;
 };
@@ -194,6 +198,47 @@ ide_line_change_gutter_renderer_notify_view (IdeLineChangeGutterRenderer *self)
   connect_view (self);
 }
 
+static void
+ide_line_change_gutter_renderer_begin (GtkSourceGutterRenderer *renderer,
+                                       cairo_t                 *cr,
+                                       GdkRectangle            *bg_area,
+                                       GdkRectangle            *cell_area,
+                                       GtkTextIter             *begin,
+                                       GtkTextIter             *end)
+{
+  IdeLineChangeGutterRenderer *self = (IdeLineChangeGutterRenderer *)renderer;
+  GtkTextBuffer *buffer;
+  guint n_lines;
+
+  g_assert (IDE_IS_LINE_CHANGE_GUTTER_RENDERER (self));
+
+  g_array_set_size (self->line_flags, 0);
+
+  buffer = gtk_text_iter_get_buffer (begin);
+
+  if (!IDE_IS_BUFFER (buffer))
+    return;
+
+  self->first_line = gtk_text_iter_get_line (begin);
+  n_lines = gtk_text_iter_get_line (end) - self->first_line + 1;
+
+  g_array_set_size (self->line_flags, n_lines);
+  ide_buffer_get_line_flags_range (IDE_BUFFER (buffer),
+                                   self->first_line,
+                                   n_lines,
+                                   (IdeBufferLineFlags *)(gpointer)self->line_flags->data);
+}
+
+static void
+ide_line_change_gutter_renderer_end (GtkSourceGutterRenderer *renderer)
+{
+  IdeLineChangeGutterRenderer *self = (IdeLineChangeGutterRenderer *)renderer;
+
+  g_assert (IDE_IS_LINE_CHANGE_GUTTER_RENDERER (self));
+
+  g_array_set_size (self->line_flags, 0);
+}
+
 static void
 ide_line_change_gutter_renderer_draw (GtkSourceGutterRenderer      *renderer,
                                       cairo_t                      *cr,
@@ -225,7 +270,11 @@ ide_line_change_gutter_renderer_draw (GtkSourceGutterRenderer      *renderer,
     return;
 
   lineno = gtk_text_iter_get_line (begin);
-  flags = ide_buffer_get_line_flags (IDE_BUFFER (buffer), lineno);
+
+  if (lineno >= self->first_line && lineno - self->first_line < self->line_flags->len)
+    flags = g_array_index (self->line_flags, IdeBufferLineFlags, lineno - self->first_line);
+  else
+    flags = ide_buffer_get_line_flags (IDE_BUFFER (buffer), lineno);
 
   if ((flags & IDE_BUFFER_LINE_FLAGS_ADDED) != 0)
     rgba = self->rgba_added_set ? &self->rgba_added : &rgbaAdded;
@@ -249,6 +298,16 @@ ide_line_change_gutter_renderer_dispose (GObject *object)
   G_OBJECT_CLASS (ide_line_change_gutter_renderer_parent_class)->dispose (object);
 }
 
+static void
+ide_line_change_gutter_renderer_finalize (GObject *object)
+{
+  IdeLineChangeGutterRenderer *self = (IdeLineChangeGutterRenderer *)object;
+
+  g_clear_pointer (&self->line_flags, g_array_unref);
+
+  G_OBJECT_CLASS (ide_line_change_gutter_renderer_parent_class)->finalize (object);
+}
+
 static void
 ide_line_change_gutter_renderer_class_init (IdeLineChangeGutterRendererClass *klass)
 {
@@ -256,8 +315,11 @@ ide_line_change_gutter_renderer_class_init (IdeLineChangeGutterRendererClass *kl
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->dispose = ide_line_change_gutter_renderer_dispose;
+  object_class->finalize = ide_line_change_gutter_renderer_finalize;
 
+  renderer_class->begin = ide_line_change_gutter_renderer_begin;
   renderer_class->draw = ide_line_change_gutter_renderer_draw;
+  renderer_class->end = ide_line_change_gutter_renderer_end;
 
   gdk_rgba_parse (&rgbaAdded, "#8ae234");
   gdk_rgba_parse (&rgbaChanged, "#fcaf3e");
@@ -266,6 +328,8 @@ ide_line_change_gutter_renderer_class_init (IdeLineChangeGutterRendererClass *kl
 static void
 ide_line_change_gutter_renderer_init (IdeLineChangeGutterRenderer *self)
 {
+  self->line_flags = g_array_new (FALSE, FALSE, sizeof (IdeBufferLineFlags));
+
   g_signal_connect (self,
                     "notify::view",
                     G_CALLBACK (ide_line_change_gutter_renderer_notify_view),
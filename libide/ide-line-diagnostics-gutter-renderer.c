@@ -21,19 +21,72 @@
 
 struct _IdeLineDiagnosticsGutterRenderer
 {
-  GtkSourceGutterRendererPixbuf parent_instance;
+  GtkSourceGutterRendererPixbuf  parent_instance;
+
+  /* Flags of the lines being drawn, filled in by begin() */
+  GArray                        *line_flags;
+  guint                          first_line;
 };
 
 G_DEFINE_TYPE (IdeLineDiagnosticsGutterRenderer,
                ide_line_diagnostics_gutter_renderer,
                GTK_SOURCE_TYPE_GUTTER_RENDERER_PIXBUF)
 
+static void
+ide_line_diagnostics_gutter_renderer_begin (GtkSourceGutterRenderer *renderer,
+                                            cairo_t                 *cr,
+                                            GdkRectangle            *bg_area,
+                                            GdkRectangle            *cell_area,
+                                            GtkTextIter             *begin,
+                                            GtkTextIter             *end)
+{
+  IdeLineDiagnosticsGutterRenderer *self = (IdeLineDiagnosticsGutterRenderer *)renderer;
+  GtkTextBuffer *buffer;
+  guint n_lines;
+
+  g_assert (IDE_IS_LINE_DIAGNOSTICS_GUTTER_RENDERER (self));
+
+  if (GTK_SOURCE_GUTTER_RENDERER_CLASS (ide_line_diagnostics_gutter_renderer_parent_class)->begin)
+    GTK_SOURCE_GUTTER_RENDERER_CLASS (ide_line_diagnostics_gutter_renderer_parent_class)->
+      begin (renderer, cr, bg_area, cell_area, begin, end);
+
+  g_array_set_size (self->line_flags, 0);
+
+  buffer = gtk_text_iter_get_buffer (begin);
+
+  if (!IDE_IS_BUFFER (buffer))
+    return;
+
+  self->first_line = gtk_text_iter_get_line (begin);
+  n_lines = gtk_text_iter_get_line (end) - self->first_line + 1;
+
+  g_array_set_size (self->line_flags, n_lines);
+  ide_buffer_get_line_flags_range (IDE_BUFFER (buffer),
+                                   self->first_line,
+                                   n_lines,
+                                   (IdeBufferLineFlags *)(gpointer)self->line_flags->data);
+}
+
+static void
+ide_line_diagnostics_gutter_renderer_end (GtkSourceGutterRenderer *renderer)
+{
+  IdeLineDiagnosticsGutterRenderer *self = (IdeLineDiagnosticsGutterRenderer *)renderer;
+
+  g_assert (IDE_IS_LINE_DIAGNOSTICS_GUTTER_RENDERER (self));
+
+  g_array_set_size (self->line_flags, 0);
+
+  if (GTK_SOURCE_GUTTER_RENDERER_CLASS (ide_line_diagnostics_gutter_renderer_parent_class)->end)
+    GTK_SOURCE_GUTTER_RENDERER_CLASS (ide_line_diagnostics_gutter_renderer_parent_class)->end (renderer);
+}
+
 static void
 ide_line_diagnostics_gutter_renderer_query_data (GtkSourceGutterRenderer      *renderer,
                                                  GtkTextIter                  *begin,
                                                  GtkTextIter                  *end,
                                                  GtkSourceGutterRendererState  state)
 {
+  IdeLineDiagnosticsGutterRenderer *self = (IdeLineDiagnosticsGutterRenderer *)renderer;
   GtkTextBuffer *buffer;
   IdeBufferLineFlags flags;
   const gchar *icon_name = NULL;
@@ -49,7 +102,12 @@ ide_line_diagnostics_gutter_renderer_query_data (GtkSourceGutterRenderer      *r
     return;
 
   line = gtk_text_iter_get_line (begin);
-  flags = ide_buffer_get_line_flags (IDE_BUFFER (buffer), line);
+
+  if (line >= self->first_line && line - self->first_line < self->line_flags->len)
+    flags = g_array_index (self->line_flags, IdeBufferLineFlags, line - self->first_line);
+  else
+    flags = ide_buffer_get_line_flags (IDE_BUFFER (buffer), line);
+
   flags &= IDE_BUFFER_LINE_FLAGS_DIAGNOSTICS_MASK;
 
   if (flags == 0)
@@ -69,15 +127,31 @@ ide_line_diagnostics_gutter_renderer_query_data (GtkSourceGutterRenderer      *r
     g_object_set (renderer, "pixbuf", NULL, NULL);
 }
 
+static void
+ide_line_diagnostics_gutter_renderer_finalize (GObject *object)
+{
+  IdeLineDiagnosticsGutterRenderer *self = (IdeLineDiagnosticsGutterRenderer *)object;
+
+  g_clear_pointer (&self->line_flags, g_array_unref);
+
+  G_OBJECT_CLASS (ide_line_diagnostics_gutter_renderer_parent_class)->finalize (object);
+}
+
 static void
 ide_line_diagnostics_gutter_renderer_class_init (IdeLineDiagnosticsGutterRendererClass *klass)
 {
   GtkSourceGutterRendererClass *renderer_class = GTK_SOURCE_GUTTER_RENDERER_CLASS (klass);
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = ide_line_diagnostics_gutter_renderer_finalize;
 
+  renderer_class->begin = ide_line_diagnostics_gutter_renderer_begin;
+  renderer_class->end = ide_line_diagnostics_gutter_renderer_end;
   renderer_class->query_data = ide_line_diagnostics_gutter_renderer_query_data;
 }
 
 static void
 ide_line_diagnostics_gutter_renderer_init (IdeLineDiagnosticsGutterRenderer *self)
 {
+  self->line_flags = g_array_new (FALSE, FALSE, sizeof (IdeBufferLineFlags));
 }
@@ -0,0 +1,439 @@
+/* ide-line-flags-store.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-line-flags-store"
+
+#include <string.h>
+
+#include "ide-line-flags-store.h"
+
+/*
+ * IdeLineFlagsStore holds per-line flag bits for a buffer as a sorted array
+ * of runs. Each run covers an inclusive range of lines that share the same
+ * non-zero flags, and neighbouring runs with equal flags are merged, so a
+ * buffer with a handful of diagnostics and changed hunks only needs a
+ * handful of runs no matter how many lines it has.
+ *
+ * Several producers share the store by owning disjoint bits of the flags
+ * (diagnostics, version control changes). A producer replaces its layer by
+ * clearing its mask and adding its ranges again.
+ *
+ * Inserting or deleting lines shifts the runs that follow, so the flags stay
+ * attached to the right lines until their producer recomputes them.
+ */
+
+typedef struct
+{
+  guint begin;
+  guint end;
+  guint flags;
+} LineRun;
+
+struct _IdeLineFlagsStore
+{
+  GArray *runs;
+};
+
+IdeLineFlagsStore *
+ide_line_flags_store_new (void)
+{
+  IdeLineFlagsStore *self;
+
+  self = g_slice_new0 (IdeLineFlagsStore);
+  self->runs = g_array_new (FALSE, FALSE, sizeof (LineRun));
+
+  return self;
+}
+
+void
+ide_line_flags_store_free (IdeLineFlagsStore *self)
+{
+  if (self != NULL)
+    {
+      g_clear_pointer (&self->runs, g_array_unref);
+      g_slice_free (IdeLineFlagsStore, self);
+    }
+}
+
+/*
+ * Appends a run to @runs, dropping it when it has no flags and merging it
+ * into the previous run when they touch and share the same flags.
+ */
+static void
+push_run (GArray *runs,
+          guint   begin,
+          guint   end,
+          guint   flags)
+{
+  LineRun run = { begin, end, flags };
+
+  g_assert (begin <= end);
+
+  if (flags == 0)
+    return;
+
+  if (runs->len > 0)
+    {
+      LineRun *last = &g_array_index (runs, LineRun, runs->len - 1);
+
+      g_assert (last->end < begin);
+
+      if (last->flags == flags && last->end + 1 == begin)
+        {
+          last->end = end;
+          return;
+        }
+    }
+
+  g_array_append_val (runs, run);
+}
+
+/* Returns the index of the first run ending at or after @line. */
+static guint
+find_run (IdeLineFlagsStore *self,
+          guint              line)
+{
+  guint lo = 0;
+  guint hi = self->runs->len;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (g_array_index (self->runs, LineRun, mid).end < line)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+guint
+ide_line_flags_store_get (IdeLineFlagsStore *self,
+                          guint              line)
+{
+  const LineRun *run;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, 0);
+
+  i = find_run (self, line);
+
+  if (i == self->runs->len)
+    return 0;
+
+  run = &g_array_index (self->runs, LineRun, i);
+
+  return run->begin <= line ? run->flags : 0;
+}
+
+/**
+ * ide_line_flags_store_get_range:
+ * @flags: (array length=n_lines): location for the flags of each line
+ *
+ * Fills @flags with the flags of @n_lines lines starting at @first_line.
+ * This walks the runs once, which is cheaper than a lookup per line when
+ * drawing a gutter.
+ */
+void
+ide_line_flags_store_get_range (IdeLineFlagsStore *self,
+                                guint              first_line,
+                                guint              n_lines,
+                                guint             *flags)
+{
+  guint last_line;
+  guint i;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (n_lines == 0 || flags != NULL);
+
+  if (n_lines == 0)
+    return;
+
+  memset (flags, 0, sizeof *flags * n_lines);
+
+  last_line = first_line + n_lines - 1;
+
+  for (i = find_run (self, first_line); i < self->runs->len; i++)
+    {
+      const LineRun *run = &g_array_index (self->runs, LineRun, i);
+      guint begin;
+      guint end;
+      guint line;
+
+      if (run->begin > last_line)
+        break;
+
+      begin = MAX (run->begin, first_line);
+      end = MIN (run->end, last_line);
+
+      for (line = begin; line <= end; line++)
+        flags [line - first_line] = run->flags;
+    }
+}
+
+/*
+ * Replaces the flags of every line from @begin_line to @end_line inclusive
+ * with (flags & ~@clear) | @set.
+ *
+ * Only the runs overlapping the range change, plus the run on either side
+ * which the result may merge with. Those are rebuilt into a small array and
+ * spliced back in place, so the cost does not grow with the number of runs
+ * elsewhere in the buffer.
+ */
+static void
+update_range (IdeLineFlagsStore *self,
+              guint              begin_line,
+              guint              end_line,
+              guint              clear,
+              guint              set)
+{
+  GArray *runs;
+  guint first;
+  guint last;
+  guint next;
+  guint i;
+
+  g_assert (self != NULL);
+  g_assert (begin_line <= end_line);
+
+  /* The overlapping runs are [i, last) */
+  i = find_run (self, begin_line);
+  for (last = i; last < self->runs->len; last++)
+    if (g_array_index (self->runs, LineRun, last).begin > end_line)
+      break;
+
+  first = i > 0 ? i - 1 : i;
+  if (last < self->runs->len)
+    last++;
+
+  runs = g_array_sized_new (FALSE, FALSE, sizeof (LineRun), last - first + 2);
+
+  /* The first line of the new range that no existing run has covered yet */
+  next = begin_line;
+
+  for (i = first; i < last; i++)
+    {
+      const LineRun *run = &g_array_index (self->runs, LineRun, i);
+
+      if (run->end < begin_line)
+        {
+          push_run (runs, run->begin, run->end, run->flags);
+          continue;
+        }
+
+      if (run->begin > end_line)
+        {
+          if (next <= end_line)
+            {
+              push_run (runs, next, end_line, set);
+              next = end_line + 1;
+            }
+
+          push_run (runs, run->begin, run->end, run->flags);
+          continue;
+        }
+
+      if (run->begin > next)
+        push_run (runs, next, run->begin - 1, set);
+
+      if (run->begin < begin_line)
+        push_run (runs, run->begin, begin_line - 1, run->flags);
+
+      push_run (runs,
+                MAX (run->begin, begin_line),
+                MIN (run->end, end_line),
+                (run->flags & ~clear) | set);
+
+      if (run->end > end_line)
+        push_run (runs, end_line + 1, run->end, run->flags);
+
+      next = MIN (run->end, end_line) + 1;
+    }
+
+  if (next <= end_line)
+    push_run (runs, next, end_line, set);
+
+  /*
+   * The outer runs keep their far edge and flags, so the result can not
+   * merge with the runs beyond them.
+   */
+  if (last > first)
+    g_array_remove_range (self->runs, first, last - first);
+  if (runs->len > 0)
+    g_array_insert_vals (self->runs, first, runs->data, runs->len);
+
+  g_array_unref (runs);
+}
+
+/**
+ * ide_line_flags_store_add:
+ *
+ * Sets @flags on every line from @begin_line to @end_line inclusive, in
+ * addition to the flags those lines already have.
+ */
+void
+ide_line_flags_store_add (IdeLineFlagsStore *self,
+                          guint              begin_line,
+                          guint              end_line,
+                          guint              flags)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (begin_line <= end_line);
+
+  if (flags != 0)
+    update_range (self, begin_line, end_line, 0, flags);
+}
+
+/**
+ * ide_line_flags_store_remove:
+ *
+ * Removes the bits in @mask from every line from @begin_line to @end_line
+ * inclusive.
+ */
+void
+ide_line_flags_store_remove (IdeLineFlagsStore *self,
+                             guint              begin_line,
+                             guint              end_line,
+                             guint              mask)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (begin_line <= end_line);
+
+  if (mask != 0)
+    update_range (self, begin_line, end_line, mask, 0);
+}
+
+/**
+ * ide_line_flags_store_clear:
+ *
+ * Removes the bits in @mask from every line.
+ */
+void
+ide_line_flags_store_clear (IdeLineFlagsStore *self,
+                            guint              mask)
+{
+  GArray *runs;
+  guint i;
+
+  g_return_if_fail (self != NULL);
+
+  runs = g_array_sized_new (FALSE, FALSE, sizeof (LineRun), self->runs->len);
+
+  for (i = 0; i < self->runs->len; i++)
+    {
+      const LineRun *run = &g_array_index (self->runs, LineRun, i);
+
+      push_run (runs, run->begin, run->end, run->flags & ~mask);
+    }
+
+  g_array_unref (self->runs);
+  self->runs = runs;
+}
+
+/**
+ * ide_line_flags_store_insert_lines:
+ *
+ * Inserts @n_lines lines before @line. Runs at or after @line move down,
+ * and a run that spans across @line grows to cover the new lines.
+ */
+void
+ide_line_flags_store_insert_lines (IdeLineFlagsStore *self,
+                                   guint              line,
+                                   guint              n_lines)
+{
+  guint i;
+
+  g_return_if_fail (self != NULL);
+
+  if (n_lines == 0)
+    return;
+
+  for (i = find_run (self, line); i < self->runs->len; i++)
+    {
+      LineRun *run = &g_array_index (self->runs, LineRun, i);
+
+      if (run->begin >= line)
+        run->begin += n_lines;
+      run->end += n_lines;
+    }
+}
+
+/**
+ * ide_line_flags_store_delete_lines:
+ *
+ * Removes the @n_lines lines starting at @line. Their flags are dropped and
+ * the runs that follow move up.
+ */
+void
+ide_line_flags_store_delete_lines (IdeLineFlagsStore *self,
+                                   guint              line,
+                                   guint              n_lines)
+{
+  GArray *runs;
+  guint limit;
+  guint i;
+
+  g_return_if_fail (self != NULL);
+
+  if (n_lines == 0)
+    return;
+
+  /* First line after the deleted range */
+  limit = line + n_lines;
+
+  i = find_run (self, line);
+
+  /* Nothing at or after the deleted lines, nothing moves */
+  if (i == self->runs->len)
+    return;
+
+  runs = g_array_sized_new (FALSE, FALSE, sizeof (LineRun), self->runs->len);
+  g_array_append_vals (runs, self->runs->data, i);
+
+  for (; i < self->runs->len; i++)
+    {
+      const LineRun *run = &g_array_index (self->runs, LineRun, i);
+      guint begin;
+      guint end;
+
+      if (run->begin < line)
+        begin = run->begin;
+      else if (run->begin >= limit)
+        begin = run->begin - n_lines;
+      else
+        begin = line;
+
+      if (run->end >= limit)
+        end = run->end - n_lines;
+      else if (run->end >= line)
+        end = line - 1;
+      else
+        end = run->end;
+
+      /* Entirely inside the deleted lines */
+      if (run->begin >= line && run->end < limit)
+        continue;
+
+      push_run (runs, begin, end, run->flags);
+    }
+
+  g_array_unref (self->runs);
+  self->runs = runs;
+}
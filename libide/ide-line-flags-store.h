@@ -0,0 +1,57 @@
+/* ide-line-flags-store.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_LINE_FLAGS_STORE_H
+#define IDE_LINE_FLAGS_STORE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _IdeLineFlagsStore IdeLineFlagsStore;
+
+IdeLineFlagsStore *ide_line_flags_store_new          (void);
+void               ide_line_flags_store_free         (IdeLineFlagsStore *self);
+guint              ide_line_flags_store_get          (IdeLineFlagsStore *self,
+                                                      guint              line);
+void               ide_line_flags_store_get_range    (IdeLineFlagsStore *self,
+                                                      guint              first_line,
+                                                      guint              n_lines,
+                                                      guint             *flags);
+void               ide_line_flags_store_add          (IdeLineFlagsStore *self,
+                                                      guint              begin_line,
+                                                      guint              end_line,
+                                                      guint              flags);
+void               ide_line_flags_store_remove       (IdeLineFlagsStore *self,
+                                                      guint              begin_line,
+                                                      guint              end_line,
+                                                      guint              mask);
+void               ide_line_flags_store_clear        (IdeLineFlagsStore *self,
+                                                      guint              mask);
+void               ide_line_flags_store_insert_lines (IdeLineFlagsStore *self,
+                                                      guint              line,
+                                                      guint              n_lines);
+void               ide_line_flags_store_delete_lines (IdeLineFlagsStore *self,
+                                                      guint              line,
+                                                      guint              n_lines);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (IdeLineFlagsStore, ide_line_flags_store_free)
+
+G_END_DECLS
+
+#endif /* IDE_LINE_FLAGS_STORE_H */
@@ -0,0 +1,152 @@
+/* ide-plugin-profile.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-plugin-profile"
+
+#include "egg-counter.h"
+
+#include "ide-plugin-profile.h"
+#include "ide-trace.h"
+
+/*
+ * When profiling is enabled (see --profile-startup), the time spent loading
+ * each plugin and constructing each of its extensions is accumulated into a
+ * counter per plugin and phase, and entry/exit events are written to the
+ * trace buffer so they can be lined up with the rest of startup.
+ *
+ * Histograms across all plugins are always recorded, as they are cheap.
+ */
+
+typedef struct
+{
+  EggCounter counter;
+  guint      entry_site;
+  guint      exit_site;
+} PhaseProfile;
+
+EGG_DEFINE_HISTOGRAM (PluginLoad, "Plugins", "Load Time",
+                      "Time to load a plugin (usec).")
+EGG_DEFINE_HISTOGRAM (ExtensionConstruct, "Plugins", "Extension Construction",
+                      "Time to construct an extension provided by a plugin (usec).")
+
+static gboolean    enabled;
+static GHashTable *phases;
+
+gboolean
+ide_plugin_profile_get_enabled (void)
+{
+  return enabled;
+}
+
+void
+ide_plugin_profile_set_enabled (gboolean value)
+{
+  enabled = !!value;
+}
+
+static PhaseProfile *
+ide_plugin_profile_get_phase (PeasPluginInfo *plugin_info,
+                              const gchar    *phase)
+{
+  g_autofree gchar *name = NULL;
+  const gchar *module_name;
+  PhaseProfile *profile;
+
+  g_assert (plugin_info != NULL);
+  g_assert (phase != NULL);
+
+  module_name = peas_plugin_info_get_module_name (plugin_info);
+  name = g_strdup_printf ("%s (%s)", module_name, phase);
+
+  if (phases == NULL)
+    phases = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (!(profile = g_hash_table_lookup (phases, name)))
+    {
+      /*
+       * Counters and trace sites live for the rest of the process, as the
+       * counter arena and trace buffer keep pointers to them.
+       */
+      profile = g_new0 (PhaseProfile, 1);
+      profile->counter.category = "Plugin Profile";
+      profile->counter.name = g_intern_string (name);
+      profile->counter.description = "Time spent by the plugin in this phase (usec).";
+      egg_counter_arena_register (egg_counter_arena_get_default (), &profile->counter);
+
+      profile->entry_site = ide_trace_register_site (G_LOG_DOMAIN, module_name, 0,
+                                                     IDE_TRACE_ENTRY, phase);
+      profile->exit_site = ide_trace_register_site (G_LOG_DOMAIN, module_name, 0,
+                                                    IDE_TRACE_EXIT, phase);
+
+      g_hash_table_insert (phases, (gchar *)profile->counter.name, profile);
+    }
+
+  return profile;
+}
+
+/**
+ * ide_plugin_profile_begin:
+ * @plugin_info: the plugin doing the work
+ * @phase: "load", or the name of the extension type being constructed
+ *
+ * Marks the beginning of work done on behalf of @plugin_info.
+ *
+ * Returns: the begin time to pass to ide_plugin_profile_end().
+ */
+gint64
+ide_plugin_profile_begin (PeasPluginInfo *plugin_info,
+                          const gchar    *phase)
+{
+  g_return_val_if_fail (plugin_info != NULL, 0);
+  g_return_val_if_fail (phase != NULL, 0);
+
+  if (enabled)
+    ide_trace_record (ide_plugin_profile_get_phase (plugin_info, phase)->entry_site);
+
+  return g_get_monotonic_time ();
+}
+
+void
+ide_plugin_profile_end (PeasPluginInfo *plugin_info,
+                        const gchar    *phase,
+                        gint64          begin_time)
+{
+  PhaseProfile *profile;
+  gint64 elapsed;
+
+  g_return_if_fail (plugin_info != NULL);
+  g_return_if_fail (phase != NULL);
+
+  elapsed = g_get_monotonic_time () - begin_time;
+
+  if (g_strcmp0 (phase, "load") == 0)
+    EGG_HISTOGRAM_RECORD (PluginLoad, elapsed);
+  else
+    EGG_HISTOGRAM_RECORD (ExtensionConstruct, elapsed);
+
+  if (!enabled)
+    return;
+
+  profile = ide_plugin_profile_get_phase (plugin_info, phase);
+
+  ide_trace_record (profile->exit_site);
+
+  egg_counter_add (&profile->counter, elapsed);
+
+  g_debug ("%s took %"G_GINT64_FORMAT" usec", profile->counter.name, elapsed);
+}
@@ -0,0 +1,36 @@
+/* ide-plugin-profile.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_PLUGIN_PROFILE_H
+#define IDE_PLUGIN_PROFILE_H
+
+#include <libpeas/peas.h>
+
+G_BEGIN_DECLS
+
+gboolean ide_plugin_profile_get_enabled (void);
+void     ide_plugin_profile_set_enabled (gboolean        enabled);
+gint64   ide_plugin_profile_begin       (PeasPluginInfo *plugin_info,
+                                         const gchar    *phase);
+void     ide_plugin_profile_end         (PeasPluginInfo *plugin_info,
+                                         const gchar    *phase,
+                                         gint64          begin_time);
+
+G_END_DECLS
+
+#endif /* IDE_PLUGIN_PROFILE_H */
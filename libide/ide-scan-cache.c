@@ -0,0 +1,1389 @@
+/* ide-scan-cache.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-scan-cache"
+
+#include <gtksourceview/gtksource.h>
+#include <string.h>
+
+#include "ide-debug.h"
+#include "ide-scan-cache.h"
+
+/**
+ * SECTION:ide-scan-cache
+ * @title: IdeScanCache
+ * @short_description: Incremental line state for comments, strings, and brackets
+ *
+ * #IdeScanCache keeps a small amount of lexer state for every line of a
+ * #GtkTextBuffer: the state at the start of the line (inside a comment,
+ * a string, etc) and the net change and minimum of bracket depth within
+ * the line. The state is invalidated from the first edited line and is
+ * lazily recomputed up to the line that is queried. Lines after the edit
+ * whose start state did not change are not rescanned.
+ *
+ * Bracket depth is kept in a randomized balanced tree over lines, keyed by
+ * position, so that finding the bracket enclosing a position is O(log n)
+ * in the number of lines, plus scanning the two lines involved. Lines
+ * added or removed by an edit are spliced into the tree in O(log n) rather
+ * than rebuilding it.
+ *
+ * Indenters and cursor movements should use this rather than walking
+ * the buffer character by character from the cursor.
+ */
+
+#define MAX_PAIRS 3
+
+typedef enum
+{
+  STATE_CODE,
+  STATE_LINE_COMMENT,
+  STATE_BLOCK_COMMENT,
+  STATE_VERBATIM,
+  STATE_STRING_DQ,
+  STATE_STRING_SQ,
+  STATE_TRIPLE_DQ,
+  STATE_TRIPLE_SQ,
+} ScanState;
+
+typedef struct
+{
+  const gchar * const *languages;
+  const gchar         *line_comment;
+  const gchar         *block_begin;
+  const gchar         *block_end;
+  const gchar         *verbatim_begin;
+  const gchar         *verbatim_end;
+  const gchar         *pairs;
+  guint                strings : 1;
+  guint                triple_quotes : 1;
+} ScanSyntax;
+
+typedef struct
+{
+  gint32 delta [MAX_PAIRS];
+  gint32 min [MAX_PAIRS];
+  guint8 start_state;
+  guint8 end_state;
+  guint8 scanned : 1;
+  guint8 opens_region : 1;
+} LineInfo;
+
+typedef struct _TreeNode TreeNode;
+
+struct _TreeNode
+{
+  TreeNode *left;
+  TreeNode *right;
+  guint     size;
+  gint32    line_delta [MAX_PAIRS];
+  gint32    line_min [MAX_PAIRS];
+  gint32    sum [MAX_PAIRS];
+  gint32    min [MAX_PAIRS];
+};
+
+typedef struct
+{
+  gsize    offset;
+  gboolean is_open;
+} BracketEvent;
+
+typedef struct
+{
+  guint8 state;
+  gsize  region_begin;
+  gint32 delta [MAX_PAIRS];
+  gint32 min [MAX_PAIRS];
+  guint  continued : 1;
+} ScanResult;
+
+struct _IdeScanCache
+{
+  GObject           parent_instance;
+
+  /* Unowned, the buffer owns us */
+  GtkTextBuffer    *buffer;
+
+  const ScanSyntax *syntax;
+  guint             n_pairs;
+
+  GArray           *lines;
+  guint             n_valid;
+
+  TreeNode         *tree;
+
+  guint             edit_line;
+  gint              edit_line_count;
+
+  guint             tree_dirty : 1;
+};
+
+G_DEFINE_TYPE (IdeScanCache, ide_scan_cache, G_TYPE_OBJECT)
+
+static const gchar *c_languages[] = {
+  "c", "chdr", "cpp", "objc", "vala", "js", "java", "c-sharp", "rust", "go", NULL
+};
+static const gchar *python_languages[] = { "python", "python3", NULL };
+static const gchar *xml_languages[] = { "xml", "html", "xslt", NULL };
+
+static const ScanSyntax syntaxes[] = {
+  { c_languages, "//", "/*", "*/", NULL, NULL, "(){}[]", TRUE, FALSE },
+  { python_languages, "#", NULL, NULL, NULL, NULL, "(){}[]", TRUE, TRUE },
+  { xml_languages, NULL, "<!--", "-->", "<![CDATA[", "]]>", "", FALSE, FALSE },
+};
+
+static inline gboolean
+has_prefix_at (const gchar *text,
+               gsize        len,
+               gsize        pos,
+               const gchar *prefix)
+{
+  gsize prefix_len;
+
+  if (prefix == NULL)
+    return FALSE;
+
+  prefix_len = strlen (prefix);
+
+  return (pos + prefix_len <= len) && (memcmp (text + pos, prefix, prefix_len) == 0);
+}
+
+/*
+ * Scans a single line (or a prefix of it) starting in @state. If @events is
+ * set, the brackets of pair @pair are appended to it in order.
+ */
+static void
+scan_line (const ScanSyntax *syntax,
+           const gchar      *text,
+           gsize             len,
+           guint8            state,
+           guint             pair,
+           GArray           *events,
+           ScanResult       *result)
+{
+  gsize pos = 0;
+
+  g_assert (syntax != NULL);
+  g_assert (text != NULL);
+  g_assert (result != NULL);
+
+  memset (result, 0, sizeof *result);
+  result->region_begin = G_MAXSIZE;
+
+  while (pos < len)
+    {
+      gchar ch = text [pos];
+      gchar quote;
+
+      switch (state)
+        {
+        case STATE_CODE:
+          if (has_prefix_at (text, len, pos, syntax->line_comment))
+            {
+              state = STATE_LINE_COMMENT;
+              result->region_begin = pos;
+              pos = len;
+            }
+          else if (has_prefix_at (text, len, pos, syntax->block_begin))
+            {
+              state = STATE_BLOCK_COMMENT;
+              result->region_begin = pos;
+              pos += strlen (syntax->block_begin);
+            }
+          else if (has_prefix_at (text, len, pos, syntax->verbatim_begin))
+            {
+              state = STATE_VERBATIM;
+              result->region_begin = pos;
+              pos += strlen (syntax->verbatim_begin);
+            }
+          else if (syntax->strings && (ch == '"' || ch == '\''))
+            {
+              result->region_begin = pos;
+
+              if (syntax->triple_quotes &&
+                  (pos + 2 < len) &&
+                  (text [pos + 1] == ch) &&
+                  (text [pos + 2] == ch))
+                {
+                  state = (ch == '"') ? STATE_TRIPLE_DQ : STATE_TRIPLE_SQ;
+                  pos += 3;
+                }
+              else
+                {
+                  state = (ch == '"') ? STATE_STRING_DQ : STATE_STRING_SQ;
+                  pos++;
+                }
+            }
+          else
+            {
+              const gchar *found = (ch != 0) ? strchr (syntax->pairs, ch) : NULL;
+
+              if (found != NULL)
+                {
+                  guint idx = found - syntax->pairs;
+                  guint p = idx / 2;
+                  gboolean is_open = (idx % 2) == 0;
+
+                  result->delta [p] += is_open ? 1 : -1;
+                  result->min [p] = MIN (result->min [p], result->delta [p]);
+
+                  if (events != NULL && p == pair)
+                    {
+                      BracketEvent ev = { pos, is_open };
+                      g_array_append_val (events, ev);
+                    }
+                }
+
+              pos++;
+            }
+          break;
+
+        case STATE_LINE_COMMENT:
+          pos = len;
+          break;
+
+        case STATE_BLOCK_COMMENT:
+          if (has_prefix_at (text, len, pos, syntax->block_end))
+            {
+              state = STATE_CODE;
+              pos += strlen (syntax->block_end);
+            }
+          else
+            pos++;
+          break;
+
+        case STATE_VERBATIM:
+          if (has_prefix_at (text, len, pos, syntax->verbatim_end))
+            {
+              state = STATE_CODE;
+              pos += strlen (syntax->verbatim_end);
+            }
+          else
+            pos++;
+          break;
+
+        case STATE_STRING_DQ:
+        case STATE_STRING_SQ:
+          quote = (state == STATE_STRING_DQ) ? '"' : '\'';
+          if (ch == '\\')
+            pos += 2;
+          else
+            {
+              if (ch == quote)
+                state = STATE_CODE;
+              pos++;
+            }
+          break;
+
+        case STATE_TRIPLE_DQ:
+        case STATE_TRIPLE_SQ:
+          quote = (state == STATE_TRIPLE_DQ) ? '"' : '\'';
+          if (ch == '\\')
+            pos += 2;
+          else if ((ch == quote) &&
+                   (pos + 2 < len) &&
+                   (text [pos + 1] == quote) &&
+                   (text [pos + 2] == quote))
+            {
+              state = STATE_CODE;
+              pos += 3;
+            }
+          else
+            pos++;
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  /* An escape as the last character continues the line */
+  result->continued = (pos > len);
+  result->state = state;
+}
+
+static IdeScanContext
+state_to_context (guint8 state)
+{
+  switch (state)
+    {
+    case STATE_LINE_COMMENT:
+      return IDE_SCAN_CONTEXT_LINE_COMMENT;
+
+    case STATE_BLOCK_COMMENT:
+      return IDE_SCAN_CONTEXT_BLOCK_COMMENT;
+
+    case STATE_VERBATIM:
+      return IDE_SCAN_CONTEXT_VERBATIM;
+
+    case STATE_STRING_DQ:
+    case STATE_STRING_SQ:
+    case STATE_TRIPLE_DQ:
+    case STATE_TRIPLE_SQ:
+      return IDE_SCAN_CONTEXT_STRING;
+
+    case STATE_CODE:
+    default:
+      return IDE_SCAN_CONTEXT_CODE;
+    }
+}
+
+static gchar *
+get_line_text (IdeScanCache *self,
+               guint         line,
+               gsize        *len)
+{
+  GtkTextIter begin;
+  GtkTextIter end;
+  gchar *text;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+  g_assert (len != NULL);
+
+  gtk_text_buffer_get_iter_at_line (self->buffer, &begin, line);
+  end = begin;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  text = gtk_text_iter_get_slice (&begin, &end);
+  *len = strlen (text);
+
+  return text;
+}
+
+static inline guint
+tree_node_size (const TreeNode *node)
+{
+  return node != NULL ? node->size : 0;
+}
+
+/*
+ * Recomputes the aggregates of @node from its children. The minimum of
+ * every line includes the empty prefix, so an empty subtree is (0, 0).
+ */
+static void
+tree_node_pull (TreeNode *node)
+{
+  guint p;
+
+  node->size = 1 + tree_node_size (node->left) + tree_node_size (node->right);
+
+  for (p = 0; p < MAX_PAIRS; p++)
+    {
+      gint32 sum = 0;
+      gint32 min = 0;
+
+      if (node->left != NULL)
+        {
+          sum = node->left->sum [p];
+          min = node->left->min [p];
+        }
+
+      min = MIN (min, sum + node->line_min [p]);
+      sum += node->line_delta [p];
+
+      if (node->right != NULL)
+        {
+          min = MIN (min, sum + node->right->min [p]);
+          sum += node->right->sum [p];
+        }
+
+      node->sum [p] = sum;
+      node->min [p] = min;
+    }
+}
+
+static void
+tree_node_set_line (TreeNode       *node,
+                    const LineInfo *info)
+{
+  if (info->scanned)
+    {
+      memcpy (node->line_delta, info->delta, sizeof node->line_delta);
+      memcpy (node->line_min, info->min, sizeof node->line_min);
+    }
+  else
+    {
+      memset (node->line_delta, 0, sizeof node->line_delta);
+      memset (node->line_min, 0, sizeof node->line_min);
+    }
+}
+
+static void
+tree_free (TreeNode *node)
+{
+  if (node != NULL)
+    {
+      tree_free (node->left);
+      tree_free (node->right);
+      g_slice_free (TreeNode, node);
+    }
+}
+
+/*
+ * Builds a balanced subtree for @n_lines lines starting at @line.
+ */
+static TreeNode *
+tree_build (IdeScanCache *self,
+            guint         line,
+            guint         n_lines)
+{
+  TreeNode *node;
+  guint half;
+
+  if (n_lines == 0)
+    return NULL;
+
+  half = n_lines / 2;
+
+  node = g_slice_new0 (TreeNode);
+  node->left = tree_build (self, line, half);
+  node->right = tree_build (self, line + half + 1, n_lines - half - 1);
+  tree_node_set_line (node, &g_array_index (self->lines, LineInfo, line + half));
+  tree_node_pull (node);
+
+  return node;
+}
+
+/*
+ * Concatenates @left and @right. The root is chosen with probability
+ * proportional to the subtree sizes, which keeps the expected depth
+ * logarithmic no matter the order of edits.
+ */
+static TreeNode *
+tree_merge (TreeNode *left,
+            TreeNode *right)
+{
+  if (left == NULL)
+    return right;
+
+  if (right == NULL)
+    return left;
+
+  if ((guint)g_random_int_range (0, left->size + right->size) < left->size)
+    {
+      left->right = tree_merge (left->right, right);
+      tree_node_pull (left);
+      return left;
+    }
+  else
+    {
+      right->left = tree_merge (left, right->left);
+      tree_node_pull (right);
+      return right;
+    }
+}
+
+/*
+ * Splits @node so that the first @n_lines lines end up in @left and the
+ * rest in @right.
+ */
+static void
+tree_split (TreeNode  *node,
+            guint      n_lines,
+            TreeNode **left,
+            TreeNode **right)
+{
+  guint left_size;
+
+  if (node == NULL)
+    {
+      *left = NULL;
+      *right = NULL;
+      return;
+    }
+
+  left_size = tree_node_size (node->left);
+
+  if (n_lines <= left_size)
+    {
+      tree_split (node->left, n_lines, left, &node->left);
+      tree_node_pull (node);
+      *right = node;
+    }
+  else
+    {
+      tree_split (node->right, n_lines - left_size - 1, &node->right, right);
+      tree_node_pull (node);
+      *left = node;
+    }
+}
+
+static void
+tree_set_line (TreeNode       *node,
+               guint           line,
+               const LineInfo *info)
+{
+  guint left_size;
+
+  g_assert (node != NULL);
+
+  left_size = tree_node_size (node->left);
+
+  if (line < left_size)
+    tree_set_line (node->left, line, info);
+  else if (line > left_size)
+    tree_set_line (node->right, line - left_size - 1, info);
+  else
+    tree_node_set_line (node, info);
+
+  tree_node_pull (node);
+}
+
+static void
+tree_update (IdeScanCache *self,
+             guint         line)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+  g_assert (line < tree_node_size (self->tree));
+
+  tree_set_line (self->tree, line, &g_array_index (self->lines, LineInfo, line));
+}
+
+/*
+ * Inserts @n_lines lines at @line, or removes them if @n_lines is negative.
+ * The lines must already have been inserted into (or must still be in)
+ * self->lines.
+ */
+static void
+tree_splice (IdeScanCache *self,
+             guint         line,
+             gint          n_lines)
+{
+  TreeNode *left = NULL;
+  TreeNode *right = NULL;
+  TreeNode *middle = NULL;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  tree_split (self->tree, line, &left, &right);
+
+  if (n_lines > 0)
+    {
+      middle = tree_build (self, line, n_lines);
+      self->tree = tree_merge (tree_merge (left, middle), right);
+    }
+  else
+    {
+      TreeNode *rest = right;
+
+      tree_split (rest, -n_lines, &middle, &right);
+      tree_free (middle);
+      self->tree = tree_merge (left, right);
+    }
+}
+
+static void
+ensure_tree (IdeScanCache *self)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  if (!self->tree_dirty)
+    return;
+
+  g_clear_pointer (&self->tree, tree_free);
+  self->tree = tree_build (self, 0, self->lines->len);
+
+  self->tree_dirty = FALSE;
+}
+
+static gint
+tree_prefix_sum (IdeScanCache *self,
+                 guint         pair,
+                 guint         line)
+{
+  const TreeNode *node = self->tree;
+  gint sum = 0;
+
+  while (node != NULL && line > 0)
+    {
+      guint left_size = tree_node_size (node->left);
+
+      if (line <= left_size)
+        {
+          node = node->left;
+          continue;
+        }
+
+      if (node->left != NULL)
+        sum += node->left->sum [pair];
+      sum += node->line_delta [pair];
+
+      line -= left_size + 1;
+      node = node->right;
+    }
+
+  return sum;
+}
+
+/*
+ * Finds the last line before @limit in which the running depth drops
+ * below @target at some point. @first is the line number of the first
+ * line in @node and @offset the depth before it.
+ */
+static gint
+tree_find_last (const TreeNode *node,
+                guint           pair,
+                guint           first,
+                guint           limit,
+                gint            offset,
+                gint            target)
+{
+  guint line;
+  gint before;
+  gint ret;
+
+  if (node == NULL || first >= limit)
+    return -1;
+
+  if (first + node->size <= limit && offset + node->min [pair] >= target)
+    return -1;
+
+  line = first + tree_node_size (node->left);
+  before = offset + (node->left != NULL ? node->left->sum [pair] : 0);
+
+  ret = tree_find_last (node->right, pair, line + 1, limit, before + node->line_delta [pair], target);
+  if (ret >= 0)
+    return ret;
+
+  if (line < limit && before + node->line_min [pair] < target)
+    return line;
+
+  return tree_find_last (node->left, pair, first, limit, offset, target);
+}
+
+/*
+ * Finds the first line in [@from, @end) in which the running depth drops
+ * below @target at some point. @first is the line number of the first
+ * line in @node and @offset the depth before it.
+ */
+static gint
+tree_find_first (const TreeNode *node,
+                 guint           pair,
+                 guint           first,
+                 guint           from,
+                 guint           end,
+                 gint            offset,
+                 gint            target)
+{
+  guint line;
+  gint before;
+  gint ret;
+
+  if (node == NULL || first + node->size <= from || first >= end)
+    return -1;
+
+  if (first >= from && first + node->size <= end && offset + node->min [pair] >= target)
+    return -1;
+
+  line = first + tree_node_size (node->left);
+  before = offset + (node->left != NULL ? node->left->sum [pair] : 0);
+
+  ret = tree_find_first (node->left, pair, first, from, end, offset, target);
+  if (ret >= 0)
+    return ret;
+
+  if (line >= from && line < end && before + node->line_min [pair] < target)
+    return line;
+
+  return tree_find_first (node->right, pair, line + 1, from, end, before + node->line_delta [pair], target);
+}
+
+static void
+ensure_valid (IdeScanCache *self,
+              guint         line)
+{
+  guint8 state;
+  guint i;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+  g_assert (self->syntax != NULL);
+
+  if (self->lines->len == 0)
+    return;
+
+  if (line >= self->lines->len)
+    line = self->lines->len - 1;
+
+  if (line < self->n_valid)
+    return;
+
+  if (self->n_valid == 0)
+    state = STATE_CODE;
+  else
+    state = g_array_index (self->lines, LineInfo, self->n_valid - 1).end_state;
+
+  for (i = self->n_valid; i <= line; i++)
+    {
+      LineInfo *info = &g_array_index (self->lines, LineInfo, i);
+      g_autofree gchar *text = NULL;
+      ScanResult result;
+      gsize len;
+
+      /*
+       * Lines after an edit keep their previous results. If they start in
+       * the same state as before, the results are still correct.
+       */
+      if (info->scanned && info->start_state == state)
+        {
+          state = info->end_state;
+          continue;
+        }
+
+      text = get_line_text (self, i, &len);
+      scan_line (self->syntax, text, len, state, 0, NULL, &result);
+
+      info->start_state = state;
+
+      if (result.state == STATE_LINE_COMMENT)
+        info->end_state = STATE_CODE;
+      else if ((result.state == STATE_STRING_DQ || result.state == STATE_STRING_SQ) && !result.continued)
+        info->end_state = STATE_CODE;
+      else
+        info->end_state = result.state;
+
+      info->opens_region = (info->end_state != STATE_CODE) && (result.region_begin != G_MAXSIZE);
+
+      memcpy (info->delta, result.delta, sizeof info->delta);
+      memcpy (info->min, result.min, sizeof info->min);
+      info->scanned = TRUE;
+
+      if (!self->tree_dirty)
+        tree_update (self, i);
+
+      state = info->end_state;
+    }
+
+  self->n_valid = line + 1;
+}
+
+static GArray *
+scan_line_events (IdeScanCache *self,
+                  guint         line,
+                  gsize         len_limit,
+                  guint         pair)
+{
+  g_autofree gchar *text = NULL;
+  const LineInfo *info;
+  ScanResult result;
+  GArray *events;
+  gsize len;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+  g_assert (line < self->n_valid);
+
+  info = &g_array_index (self->lines, LineInfo, line);
+  text = get_line_text (self, line, &len);
+  events = g_array_new (FALSE, FALSE, sizeof (BracketEvent));
+
+  scan_line (self->syntax, text, MIN (len, len_limit), info->start_state, pair, events, &result);
+
+  return events;
+}
+
+/*
+ * Finds the last open bracket in @events that raised the depth to @target
+ * and was not closed again before the end of @events.
+ */
+static gboolean
+find_last_open (GArray *events,
+                gint    start_value,
+                gint    target,
+                gsize  *offset)
+{
+  gboolean found = FALSE;
+  gint value = start_value;
+  guint i;
+
+  for (i = 0; i < events->len; i++)
+    {
+      const BracketEvent *ev = &g_array_index (events, BracketEvent, i);
+
+      if (ev->is_open)
+        {
+          if (value + 1 == target)
+            {
+              found = TRUE;
+              *offset = ev->offset;
+            }
+          value++;
+        }
+      else
+        {
+          value--;
+          if (value < target)
+            found = FALSE;
+        }
+    }
+
+  return found;
+}
+
+static gboolean
+find_pair (IdeScanCache *self,
+           gunichar      ch,
+           guint        *pair,
+           gboolean     *is_open)
+{
+  const gchar *found;
+
+  if (ch == 0 || ch > 0x7F)
+    return FALSE;
+
+  if (!(found = strchr (self->syntax->pairs, (gchar)ch)))
+    return FALSE;
+
+  *pair = (found - self->syntax->pairs) / 2;
+  *is_open = ((found - self->syntax->pairs) % 2) == 0;
+
+  return TRUE;
+}
+
+static void
+ide_scan_cache_reload (IdeScanCache *self)
+{
+  GtkSourceLanguage *language = NULL;
+  const gchar *lang_id = NULL;
+  guint i;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  self->syntax = NULL;
+  self->n_pairs = 0;
+
+  if (GTK_SOURCE_IS_BUFFER (self->buffer))
+    language = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (self->buffer));
+
+  if (language != NULL)
+    lang_id = gtk_source_language_get_id (language);
+
+  for (i = 0; lang_id != NULL && i < G_N_ELEMENTS (syntaxes); i++)
+    {
+      if (g_strv_contains (syntaxes [i].languages, lang_id))
+        {
+          self->syntax = &syntaxes [i];
+          self->n_pairs = strlen (syntaxes [i].pairs) / 2;
+          break;
+        }
+    }
+
+  g_array_set_size (self->lines, 0);
+  g_array_set_size (self->lines, gtk_text_buffer_get_line_count (self->buffer));
+
+  self->n_valid = 0;
+  self->tree_dirty = TRUE;
+}
+
+static void
+ide_scan_cache_invalidate_line (IdeScanCache *self,
+                                guint         line)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  if (line < self->lines->len)
+    g_array_index (self->lines, LineInfo, line).scanned = FALSE;
+
+  self->n_valid = MIN (self->n_valid, line);
+}
+
+static void
+ide_scan_cache_apply_edit (IdeScanCache *self)
+{
+  gint delta;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  delta = gtk_text_buffer_get_line_count (self->buffer) - self->edit_line_count;
+
+  /*
+   * Lines inserted or removed by the edit are added or dropped right after
+   * the edited line. Everything after that has the same text as before, so
+   * we keep the old results and let ensure_valid() decide if they still
+   * apply.
+   */
+  if (delta > 0)
+    {
+      g_autofree LineInfo *zeroed = g_new0 (LineInfo, delta);
+
+      g_array_insert_vals (self->lines, self->edit_line + 1, zeroed, delta);
+
+      if (!self->tree_dirty)
+        tree_splice (self, self->edit_line + 1, delta);
+    }
+  else if (delta < 0)
+    {
+      g_array_remove_range (self->lines, self->edit_line + 1, -delta);
+
+      if (!self->tree_dirty)
+        tree_splice (self, self->edit_line + 1, delta);
+    }
+
+  ide_scan_cache_invalidate_line (self, self->edit_line);
+}
+
+static void
+ide_scan_cache_before_insert_text (IdeScanCache  *self,
+                                   GtkTextIter   *location,
+                                   const gchar   *text,
+                                   gint           len,
+                                   GtkTextBuffer *buffer)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  self->edit_line = gtk_text_iter_get_line (location);
+  self->edit_line_count = gtk_text_buffer_get_line_count (buffer);
+}
+
+static void
+ide_scan_cache_after_insert_text (IdeScanCache  *self,
+                                  GtkTextIter   *location,
+                                  const gchar   *text,
+                                  gint           len,
+                                  GtkTextBuffer *buffer)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  ide_scan_cache_apply_edit (self);
+}
+
+static void
+ide_scan_cache_before_delete_range (IdeScanCache  *self,
+                                    GtkTextIter   *begin,
+                                    GtkTextIter   *end,
+                                    GtkTextBuffer *buffer)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  self->edit_line = MIN (gtk_text_iter_get_line (begin), gtk_text_iter_get_line (end));
+  self->edit_line_count = gtk_text_buffer_get_line_count (buffer);
+}
+
+static void
+ide_scan_cache_after_delete_range (IdeScanCache  *self,
+                                   GtkTextIter   *begin,
+                                   GtkTextIter   *end,
+                                   GtkTextBuffer *buffer)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  ide_scan_cache_apply_edit (self);
+}
+
+static void
+ide_scan_cache_insert_object (IdeScanCache  *self,
+                              GtkTextIter   *location,
+                              gpointer       object,
+                              GtkTextBuffer *buffer)
+{
+  g_assert (IDE_IS_SCAN_CACHE (self));
+
+  ide_scan_cache_invalidate_line (self, gtk_text_iter_get_line (location));
+}
+
+static void
+ide_scan_cache_finalize (GObject *object)
+{
+  IdeScanCache *self = (IdeScanCache *)object;
+
+  g_clear_pointer (&self->lines, g_array_unref);
+  g_clear_pointer (&self->tree, tree_free);
+
+  self->buffer = NULL;
+
+  G_OBJECT_CLASS (ide_scan_cache_parent_class)->finalize (object);
+}
+
+static void
+ide_scan_cache_class_init (IdeScanCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = ide_scan_cache_finalize;
+}
+
+static void
+ide_scan_cache_init (IdeScanCache *self)
+{
+  self->lines = g_array_new (FALSE, TRUE, sizeof (LineInfo));
+  self->tree_dirty = TRUE;
+}
+
+/**
+ * ide_scan_cache_get_for_buffer:
+ * @buffer: A #GtkTextBuffer
+ *
+ * Gets the #IdeScanCache for @buffer, creating it if necessary. The cache
+ * is owned by @buffer.
+ *
+ * Returns: (transfer none) (nullable): An #IdeScanCache or %NULL if the
+ *   language of @buffer is not supported.
+ */
+IdeScanCache *
+ide_scan_cache_get_for_buffer (GtkTextBuffer *buffer)
+{
+  IdeScanCache *self;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), NULL);
+
+  self = g_object_get_data (G_OBJECT (buffer), "IDE_SCAN_CACHE");
+
+  if (self == NULL)
+    {
+      self = g_object_new (IDE_TYPE_SCAN_CACHE, NULL);
+      self->buffer = buffer;
+
+      g_signal_connect_object (buffer,
+                               "insert-text",
+                               G_CALLBACK (ide_scan_cache_before_insert_text),
+                               self,
+                               G_CONNECT_SWAPPED);
+      g_signal_connect_object (buffer,
+                               "insert-text",
+                               G_CALLBACK (ide_scan_cache_after_insert_text),
+                               self,
+                               G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+      g_signal_connect_object (buffer,
+                               "delete-range",
+                               G_CALLBACK (ide_scan_cache_before_delete_range),
+                               self,
+                               G_CONNECT_SWAPPED);
+      g_signal_connect_object (buffer,
+                               "delete-range",
+                               G_CALLBACK (ide_scan_cache_after_delete_range),
+                               self,
+                               G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+      g_signal_connect_object (buffer,
+                               "insert-pixbuf",
+                               G_CALLBACK (ide_scan_cache_insert_object),
+                               self,
+                               G_CONNECT_SWAPPED);
+      g_signal_connect_object (buffer,
+                               "insert-child-anchor",
+                               G_CALLBACK (ide_scan_cache_insert_object),
+                               self,
+                               G_CONNECT_SWAPPED);
+      g_signal_connect_object (buffer,
+                               "notify::language",
+                               G_CALLBACK (ide_scan_cache_reload),
+                               self,
+                               G_CONNECT_SWAPPED);
+
+      ide_scan_cache_reload (self);
+
+      g_object_set_data_full (G_OBJECT (buffer), "IDE_SCAN_CACHE", self, g_object_unref);
+    }
+
+  return (self->syntax != NULL) ? self : NULL;
+}
+
+/**
+ * ide_scan_cache_get_context:
+ * @self: An #IdeScanCache
+ * @iter: A #GtkTextIter
+ * @region_begin: (out) (optional): A location for the start of the
+ *   comment or string containing @iter.
+ *
+ * Determines whether the position at @iter is inside of a comment, string,
+ * or code. The character at @iter is not taken into account, so a position
+ * directly after the end of a comment is considered code.
+ *
+ * If @iter is not within code and @region_begin is set, it will be placed
+ * at the start of the comment or string.
+ *
+ * Returns: An #IdeScanContext.
+ */
+IdeScanContext
+ide_scan_cache_get_context (IdeScanCache      *self,
+                            const GtkTextIter *iter,
+                            GtkTextIter       *region_begin)
+{
+  g_autofree gchar *text = NULL;
+  const LineInfo *info;
+  IdeScanContext context;
+  ScanResult result;
+  guint line;
+  gsize index;
+  gsize len;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SCAN_CACHE (self), IDE_SCAN_CONTEXT_CODE);
+  g_return_val_if_fail (iter != NULL, IDE_SCAN_CONTEXT_CODE);
+  g_return_val_if_fail (self->syntax != NULL, IDE_SCAN_CONTEXT_CODE);
+
+  line = gtk_text_iter_get_line (iter);
+  index = gtk_text_iter_get_line_index (iter);
+
+  ensure_valid (self, line);
+
+  info = &g_array_index (self->lines, LineInfo, line);
+  text = get_line_text (self, line, &len);
+
+  scan_line (self->syntax, text, MIN (index, len), info->start_state, 0, NULL, &result);
+
+  context = state_to_context (result.state);
+
+  if (context == IDE_SCAN_CONTEXT_CODE || region_begin == NULL)
+    return context;
+
+  if (result.region_begin != G_MAXSIZE)
+    {
+      gtk_text_buffer_get_iter_at_line_index (self->buffer, region_begin, line, result.region_begin);
+      return context;
+    }
+
+  /* The region started on a previous line, find where. */
+  gtk_text_buffer_get_start_iter (self->buffer, region_begin);
+
+  for (i = line; i > 0; i--)
+    {
+      const LineInfo *prev = &g_array_index (self->lines, LineInfo, i - 1);
+
+      if (prev->opens_region)
+        {
+          g_autofree gchar *prev_text = NULL;
+          gsize prev_len;
+
+          prev_text = get_line_text (self, i - 1, &prev_len);
+          scan_line (self->syntax, prev_text, prev_len, prev->start_state, 0, NULL, &result);
+
+          if (result.region_begin != G_MAXSIZE)
+            gtk_text_buffer_get_iter_at_line_index (self->buffer, region_begin, i - 1, result.region_begin);
+
+          break;
+        }
+    }
+
+  return context;
+}
+
+static gboolean
+backward_find_unmatched_pair (IdeScanCache *self,
+                              GtkTextIter  *iter,
+                              guint         pair,
+                              guint         depth)
+{
+  g_autoptr(GArray) events = NULL;
+  gsize found_offset = 0;
+  guint line;
+  gsize index;
+  gint start_value;
+  gint value;
+  gint target;
+  gint found_line;
+  guint i;
+
+  g_assert (IDE_IS_SCAN_CACHE (self));
+  g_assert (pair < self->n_pairs);
+
+  line = gtk_text_iter_get_line (iter);
+  index = gtk_text_iter_get_line_index (iter);
+
+  ensure_valid (self, line);
+  ensure_tree (self);
+
+  start_value = tree_prefix_sum (self, pair, line);
+  events = scan_line_events (self, line, index, pair);
+
+  value = start_value;
+  for (i = 0; i < events->len; i++)
+    value += g_array_index (events, BracketEvent, i).is_open ? 1 : -1;
+
+  /* The depth we are looking for is right after the open bracket */
+  target = value - (gint)depth + 1;
+
+  if (find_last_open (events, start_value, target, &found_offset))
+    {
+      gtk_text_buffer_get_iter_at_line_index (self->buffer, iter, line, found_offset);
+      return TRUE;
+    }
+
+  /* Nothing in this line, find the last line that dropped below target */
+  found_line = tree_find_last (self->tree, pair, 0, line, 0, target);
+
+  if (found_line < 0)
+    return FALSE;
+
+  g_clear_pointer (&events, g_array_unref);
+  events = scan_line_events (self, found_line, G_MAXSIZE, pair);
+
+  start_value = tree_prefix_sum (self, pair, found_line);
+
+  if (!find_last_open (events, start_value, target, &found_offset))
+    return FALSE;
+
+  gtk_text_buffer_get_iter_at_line_index (self->buffer, iter, found_line, found_offset);
+
+  return TRUE;
+}
+
+/**
+ * ide_scan_cache_backward_find_unmatched:
+ * @self: An #IdeScanCache
+ * @iter: A #GtkTextIter
+ * @open_char: the opening bracket such as '{', or 0 for any bracket
+ * @depth: the number of enclosing levels, 1 for the innermost
+ *
+ * Moves @iter backward to the opening bracket that encloses @iter,
+ * skipping over comments, strings, and balanced brackets. The character
+ * at @iter is not considered.
+ *
+ * Returns: %TRUE if @iter was moved; otherwise %FALSE and @iter is unchanged.
+ */
+gboolean
+ide_scan_cache_backward_find_unmatched (IdeScanCache *self,
+                                        GtkTextIter  *iter,
+                                        gunichar      open_char,
+                                        guint         depth)
+{
+  gboolean is_open = FALSE;
+  gboolean ret = FALSE;
+  guint pair;
+
+  g_return_val_if_fail (IDE_IS_SCAN_CACHE (self), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (depth > 0, FALSE);
+
+  if (self->syntax == NULL)
+    return FALSE;
+
+  if (open_char == 0)
+    {
+      GtkTextIter best = *iter;
+
+      for (pair = 0; pair < self->n_pairs; pair++)
+        {
+          GtkTextIter copy = *iter;
+
+          if (backward_find_unmatched_pair (self, &copy, pair, depth) &&
+              (!ret || gtk_text_iter_compare (&copy, &best) > 0))
+            {
+              best = copy;
+              ret = TRUE;
+            }
+        }
+
+      if (ret)
+        *iter = best;
+
+      return ret;
+    }
+
+  if (!find_pair (self, open_char, &pair, &is_open) || !is_open)
+    return FALSE;
+
+  return backward_find_unmatched_pair (self, iter, pair, depth);
+}
+
+/**
+ * ide_scan_cache_forward_find_unmatched:
+ * @self: An #IdeScanCache
+ * @iter: A #GtkTextIter
+ * @close_char: the closing bracket such as '}'
+ * @depth: the number of enclosing levels, 1 for the innermost
+ *
+ * Moves @iter forward to the closing bracket that encloses @iter, skipping
+ * over comments, strings, and balanced brackets. The character at @iter is
+ * considered.
+ *
+ * Returns: %TRUE if @iter was moved; otherwise %FALSE and @iter is unchanged.
+ */
+gboolean
+ide_scan_cache_forward_find_unmatched (IdeScanCache *self,
+                                       GtkTextIter  *iter,
+                                       gunichar      close_char,
+                                       guint         depth)
+{
+  g_autoptr(GArray) events = NULL;
+  gboolean is_open = TRUE;
+  guint pair;
+  guint line;
+  gsize index;
+  gint value;
+  gint target;
+  gint found_line;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SCAN_CACHE (self), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (depth > 0, FALSE);
+
+  if (self->syntax == NULL)
+    return FALSE;
+
+  if (!find_pair (self, close_char, &pair, &is_open) || is_open)
+    return FALSE;
+
+  line = gtk_text_iter_get_line (iter);
+  index = gtk_text_iter_get_line_index (iter);
+
+  /* Forward searches may need everything after @iter */
+  ensure_valid (self, G_MAXUINT);
+  ensure_tree (self);
+
+  events = scan_line_events (self, line, G_MAXSIZE, pair);
+
+  value = tree_prefix_sum (self, pair, line);
+  for (i = 0; i < events->len; i++)
+    {
+      const BracketEvent *ev = &g_array_index (events, BracketEvent, i);
+
+      if (ev->offset >= index)
+        break;
+
+      value += ev->is_open ? 1 : -1;
+    }
+
+  /* The depth right after the closing bracket we are looking for */
+  target = value - (gint)depth + 1;
+
+  for (; i < events->len; i++)
+    {
+      const BracketEvent *ev = &g_array_index (events, BracketEvent, i);
+
+      value += ev->is_open ? 1 : -1;
+
+      if (value < target)
+        {
+          gtk_text_buffer_get_iter_at_line_index (self->buffer, iter, line, ev->offset);
+          return TRUE;
+        }
+    }
+
+  found_line = tree_find_first (self->tree, pair, 0, line + 1, self->lines->len, 0, target);
+
+  if (found_line < 0)
+    return FALSE;
+
+  g_clear_pointer (&events, g_array_unref);
+  events = scan_line_events (self, found_line, G_MAXSIZE, pair);
+
+  value = tree_prefix_sum (self, pair, found_line);
+  for (i = 0; i < events->len; i++)
+    {
+      const BracketEvent *ev = &g_array_index (events, BracketEvent, i);
+
+      value += ev->is_open ? 1 : -1;
+
+      if (value < target)
+        {
+          gtk_text_buffer_get_iter_at_line_index (self->buffer, iter, found_line, ev->offset);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
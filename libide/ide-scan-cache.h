@@ -0,0 +1,54 @@
+/* ide-scan-cache.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_SCAN_CACHE_H
+#define IDE_SCAN_CACHE_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define IDE_TYPE_SCAN_CACHE (ide_scan_cache_get_type())
+
+G_DECLARE_FINAL_TYPE (IdeScanCache, ide_scan_cache, IDE, SCAN_CACHE, GObject)
+
+typedef enum
+{
+  IDE_SCAN_CONTEXT_CODE,
+  IDE_SCAN_CONTEXT_LINE_COMMENT,
+  IDE_SCAN_CONTEXT_BLOCK_COMMENT,
+  IDE_SCAN_CONTEXT_STRING,
+  IDE_SCAN_CONTEXT_VERBATIM,
+} IdeScanContext;
+
+IdeScanCache   *ide_scan_cache_get_for_buffer          (GtkTextBuffer     *buffer);
+IdeScanContext  ide_scan_cache_get_context             (IdeScanCache      *self,
+                                                        const GtkTextIter *iter,
+                                                        GtkTextIter       *region_begin);
+gboolean        ide_scan_cache_backward_find_unmatched (IdeScanCache      *self,
+                                                        GtkTextIter       *iter,
+                                                        gunichar           open_char,
+                                                        guint              depth);
+gboolean        ide_scan_cache_forward_find_unmatched  (IdeScanCache      *self,
+                                                        GtkTextIter       *iter,
+                                                        gunichar           close_char,
+                                                        guint              depth);
+
+G_END_DECLS
+
+#endif /* IDE_SCAN_CACHE_H */
@@ -18,24 +18,59 @@
 
 #define G_LOG_DOMAIN "ide-search-context"
 
+#include "egg-counter.h"
+
 #include "ide-debug.h"
 #include "ide-search-context.h"
 #include "ide-search-provider.h"
 #include "ide-search-result.h"
 
+/*
+ * Providers are not populated back to back from ide_search_context_execute().
+ * Each one is started from its own idle callback so that keystrokes (which
+ * cancel the context) are processed in between, and providers that have not
+ * been started yet when that happens are skipped entirely. Providers are free
+ * to complete asynchronously, typically after matching on a worker thread
+ * against an immutable snapshot of their index.
+ *
+ * Results are forwarded as they arrive, so the omni search display merges
+ * them incrementally. If some providers are still running after
+ * LATENCY_BUDGET_MSEC, "completed" is emitted early so that the display can
+ * show what we have, and again once the stragglers finish.
+ */
+#define LATENCY_BUDGET_MSEC 150
+
 struct _IdeSearchContext
 {
   IdeObject     parent_instance;
 
   GCancellable *cancellable;
   GList        *providers;
+  GList        *to_dispatch;
+  GHashTable   *begin_times;
+  gchar        *search_terms;
   gsize         max_results;
   guint         in_progress;
+  guint         dispatch_source;
+  guint         budget_source;
   guint         executed : 1;
 };
 
 G_DEFINE_TYPE (IdeSearchContext, ide_search_context, IDE_TYPE_OBJECT)
 
+EGG_DEFINE_COUNTER (StaleResults,
+                    "Search",
+                    "Stale Results",
+                    "Results dropped because the search was cancelled.")
+EGG_DEFINE_COUNTER (SkippedProviders,
+                    "Search",
+                    "Skipped Providers",
+                    "Providers not started because the search was cancelled.")
+EGG_DEFINE_COUNTER (OverBudget,
+                    "Search",
+                    "Over Budget",
+                    "Providers that did not complete within the latency budget.")
+
 enum {
   COMPLETED,
   COUNT_SET,
@@ -54,16 +89,81 @@ ide_search_context_get_completed (IdeSearchContext *self)
   return (self->in_progress == 0);
 }
 
+/*
+ * Histograms are registered per provider type the first time it completes a
+ * search, so they show up as Search/<TypeName> in egg-counter.
+ */
+static EggHistogram *
+get_provider_histogram (IdeSearchProvider *provider)
+{
+  static GHashTable *histograms;
+  EggHistogram *histogram;
+  GType type;
+
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+
+  if (histograms == NULL)
+    histograms = g_hash_table_new (NULL, NULL);
+
+  type = G_OBJECT_TYPE (provider);
+
+  if (!(histogram = g_hash_table_lookup (histograms, GSIZE_TO_POINTER (type))))
+    {
+      histogram = g_new0 (EggHistogram, 1);
+      histogram->counter.category = "Search";
+      histogram->counter.name = g_type_name (type);
+      histogram->counter.description = "Time for the provider to complete a search (usec).";
+      egg_counter_arena_register_histogram (egg_counter_arena_get_default (), histogram);
+      g_hash_table_insert (histograms, GSIZE_TO_POINTER (type), histogram);
+    }
+
+  return histogram;
+}
+
+static void
+ide_search_context_clear_sources (IdeSearchContext *self)
+{
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+
+  if (self->dispatch_source != 0)
+    {
+      g_source_remove (self->dispatch_source);
+      self->dispatch_source = 0;
+    }
+
+  if (self->budget_source != 0)
+    {
+      g_source_remove (self->budget_source);
+      self->budget_source = 0;
+    }
+}
+
 void
 ide_search_context_provider_completed (IdeSearchContext  *self,
                                        IdeSearchProvider *provider)
 {
+  gpointer begin_time;
+
   g_return_if_fail (IDE_IS_SEARCH_CONTEXT (self));
   g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
   g_return_if_fail (g_list_find (self->providers, provider));
+  g_return_if_fail (self->in_progress > 0);
+
+  if (g_hash_table_lookup_extended (self->begin_times, provider, NULL, &begin_time))
+    {
+      egg_histogram_record (get_provider_histogram (provider),
+                            g_get_monotonic_time () - *(gint64 *)begin_time);
+      g_hash_table_remove (self->begin_times, provider);
+    }
 
   if (--self->in_progress == 0)
-    g_signal_emit (self, signals [COMPLETED], 0);
+    {
+      ide_search_context_clear_sources (self);
+
+      /* Nobody is interested in the results of a stale search */
+      if (!g_cancellable_is_cancelled (self->cancellable))
+        g_signal_emit (self, signals [COMPLETED], 0);
+    }
 }
 
 /**
@@ -91,6 +191,12 @@ ide_search_context_add_result (IdeSearchContext  *self,
   g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
   g_return_if_fail (IDE_IS_SEARCH_RESULT (result));
 
+  if (g_cancellable_is_cancelled (self->cancellable))
+    {
+      EGG_COUNTER_INC (StaleResults);
+      return;
+    }
+
   g_signal_emit (self, signals [RESULT_ADDED], 0, provider, result);
 }
 
@@ -103,6 +209,9 @@ ide_search_context_remove_result (IdeSearchContext  *self,
   g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
   g_return_if_fail (IDE_IS_SEARCH_RESULT (result));
 
+  if (g_cancellable_is_cancelled (self->cancellable))
+    return;
+
   g_signal_emit (self, signals [RESULT_REMOVED], 0, provider, result);
 }
 
@@ -117,13 +226,74 @@ ide_search_context_set_provider_count (IdeSearchContext  *self,
   g_signal_emit (self, signals [COUNT_SET], 0, provider, count);
 }
 
+static gint
+compare_provider_priority (gconstpointer a,
+                           gconstpointer b)
+{
+  return ide_search_provider_get_priority ((IdeSearchProvider *)a) -
+         ide_search_provider_get_priority ((IdeSearchProvider *)b);
+}
+
+static gboolean
+ide_search_context_budget_cb (gpointer user_data)
+{
+  IdeSearchContext *self = user_data;
+
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+
+  self->budget_source = 0;
+
+  if (self->in_progress > 0 && !g_cancellable_is_cancelled (self->cancellable))
+    {
+      IDE_TRACE_MSG ("%u providers over budget", self->in_progress);
+      EGG_COUNTER_ADD (OverBudget, self->in_progress);
+
+      /* Let the display show the results we have so far */
+      g_signal_emit (self, signals [COMPLETED], 0);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+ide_search_context_dispatch_cb (gpointer user_data)
+{
+  IdeSearchContext *self = user_data;
+  g_autoptr(IdeSearchProvider) provider = NULL;
+  gint64 *begin_time;
+
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+
+  if (self->to_dispatch == NULL)
+    {
+      self->dispatch_source = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  provider = g_object_ref (self->to_dispatch->data);
+  self->to_dispatch = g_list_delete_link (self->to_dispatch, self->to_dispatch);
+
+  if (self->to_dispatch == NULL)
+    self->dispatch_source = 0;
+
+  begin_time = g_new (gint64, 1);
+  *begin_time = g_get_monotonic_time ();
+  g_hash_table_insert (self->begin_times, provider, begin_time);
+
+  ide_search_provider_populate (provider,
+                                self,
+                                self->search_terms,
+                                self->max_results,
+                                self->cancellable);
+
+  return self->to_dispatch ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
 void
 ide_search_context_execute (IdeSearchContext *self,
                             const gchar      *search_terms,
                             gsize             max_results)
 {
-  GList *iter;
-
   IDE_ENTRY;
 
   g_return_if_fail (IDE_IS_SEARCH_CONTEXT (self));
@@ -133,6 +303,7 @@ ide_search_context_execute (IdeSearchContext *self,
   self->executed = TRUE;
   self->in_progress = g_list_length (self->providers);
   self->max_results = max_results;
+  self->search_terms = g_strdup (search_terms);
 
   if (!self->in_progress)
     {
@@ -140,14 +311,18 @@ ide_search_context_execute (IdeSearchContext *self,
       IDE_EXIT;
     }
 
-  for (iter = self->providers; iter; iter = iter->next)
-    {
-      ide_search_provider_populate (iter->data,
-                                    self,
-                                    search_terms,
-                                    max_results,
-                                    self->cancellable);
-    }
+  /* Start providers in the order their results are displayed */
+  self->to_dispatch = g_list_sort (g_list_copy (self->providers),
+                                   compare_provider_priority);
+  self->dispatch_source = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                           ide_search_context_dispatch_cb,
+                                           g_object_ref (self),
+                                           g_object_unref);
+  self->budget_source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                            LATENCY_BUDGET_MSEC,
+                                            ide_search_context_budget_cb,
+                                            g_object_ref (self),
+                                            g_object_unref);
 
   IDE_EXIT;
 }
@@ -155,10 +330,34 @@ ide_search_context_execute (IdeSearchContext *self,
 void
 ide_search_context_cancel (IdeSearchContext *self)
 {
+  GList *skipped;
+  GList *iter;
+
   g_return_if_fail (IDE_IS_SEARCH_CONTEXT (self));
 
   if (!g_cancellable_is_cancelled (self->cancellable))
     g_cancellable_cancel (self->cancellable);
+
+  if (self->budget_source != 0)
+    {
+      g_source_remove (self->budget_source);
+      self->budget_source = 0;
+    }
+
+  /*
+   * Providers that have not been started yet are completed now, the rest
+   * will notice the cancellable and complete on their own.
+   */
+  skipped = self->to_dispatch;
+  self->to_dispatch = NULL;
+
+  for (iter = skipped; iter; iter = iter->next)
+    {
+      EGG_COUNTER_INC (SkippedProviders);
+      ide_search_context_provider_completed (self, iter->data);
+    }
+
+  g_list_free (skipped);
 }
 
 void
@@ -179,10 +378,15 @@ ide_search_context_finalize (GObject *object)
   IdeSearchContext *self = (IdeSearchContext *)object;
   GList *copy;
 
+  ide_search_context_clear_sources (self);
+
   copy = self->providers, self->providers = NULL;
   g_list_foreach (copy, (GFunc)g_object_unref, NULL);
   g_list_free (copy);
 
+  g_clear_pointer (&self->to_dispatch, g_list_free);
+  g_clear_pointer (&self->begin_times, g_hash_table_unref);
+  g_clear_pointer (&self->search_terms, g_free);
   g_clear_object (&self->cancellable);
 
   G_OBJECT_CLASS (ide_search_context_parent_class)->finalize (object);
@@ -242,6 +446,7 @@ static void
 ide_search_context_init (IdeSearchContext *self)
 {
   self->cancellable = g_cancellable_new ();
+  self->begin_times = g_hash_table_new_full (NULL, NULL, NULL, g_free);
 }
 
 gsize
@@ -0,0 +1,1160 @@
+/* ide-source-search-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-source-search-index"
+
+#include <string.h>
+
+#include "ide-debug.h"
+#include "ide-source-search-index.h"
+#include "ide-thread-pool.h"
+
+/*
+ * IdeSourceSearchIndex keeps the offsets of every occurrence of the search
+ * text within a buffer, sorted by position.
+ *
+ * When the search settings change, a snapshot of the buffer is scanned on
+ * the indexer thread pool. Literal searches use memchr() to find candidate
+ * positions, everything else falls back to GRegex. The snapshot is reused
+ * until the buffer changes, so refining the search text does not copy the
+ * buffer again.
+ *
+ * Edits shift the offsets of the following matches and drop the matches
+ * they touch. The edited lines are rescanned from an idle callback, which
+ * only looks at those few lines. Edits that happen while a full scan is
+ * running are replayed on top of the scan results when it completes.
+ */
+
+#define CANCEL_CHECK_INTERVAL (1 << 16)
+
+typedef struct
+{
+  gint begin;
+  gint end;
+} Match;
+
+typedef struct
+{
+  gint offset;
+  gint removed;
+  gint inserted;
+} Edit;
+
+typedef struct
+{
+  GBytes   *snapshot;
+  gchar    *needle;
+  GRegex   *regex;
+  gint      needle_chars;
+  gint      base_offset;
+  guint     sequence;
+  guint     case_sensitive : 1;
+  guint     at_word_boundaries : 1;
+} ScanRequest;
+
+struct _IdeSourceSearchIndex
+{
+  GObject                  parent_instance;
+
+  /* Weak pointer, the buffer outlives the view owning us */
+  GtkTextBuffer           *buffer;
+  GtkSourceSearchSettings *settings;
+
+  /* Sorted, non-overlapping matches in character offsets */
+  GArray                  *matches;
+
+  /* Ranges (as Match) that need to be rescanned after edits */
+  GArray                  *dirty;
+
+  /* Edits made while a full scan is in flight */
+  GArray                  *pending_edits;
+
+  GBytes                  *snapshot;
+  GCancellable            *cancellable;
+
+  gchar                   *needle;
+  GRegex                  *regex;
+  gint                     needle_chars;
+  guint                    needle_lines;
+
+  guint                    sequence;
+  guint                    flush_handler;
+
+  gint                     count;
+
+  guint                    case_sensitive : 1;
+  guint                    at_word_boundaries : 1;
+  guint                    scanning : 1;
+};
+
+G_DEFINE_TYPE (IdeSourceSearchIndex, ide_source_search_index, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_OCCURRENCES_COUNT,
+  LAST_PROP
+};
+
+enum {
+  CHANGED,
+  LAST_SIGNAL
+};
+
+static GParamSpec *properties [LAST_PROP];
+static guint signals [LAST_SIGNAL];
+
+static void
+scan_request_free (gpointer data)
+{
+  ScanRequest *request = data;
+
+  g_clear_pointer (&request->snapshot, g_bytes_unref);
+  g_clear_pointer (&request->needle, g_free);
+  g_clear_pointer (&request->regex, g_regex_unref);
+  g_slice_free (ScanRequest, request);
+}
+
+static inline gboolean
+is_word_char (gunichar ch)
+{
+  return g_unichar_isalnum (ch) || (ch == '_');
+}
+
+static gboolean
+is_at_word_boundaries (const gchar *text,
+                       gsize        len,
+                       const gchar *begin,
+                       const gchar *end)
+{
+  if (begin > text)
+    {
+      const gchar *prev = g_utf8_find_prev_char (text, begin);
+
+      if (prev != NULL && is_word_char (g_utf8_get_char (prev)))
+        return FALSE;
+    }
+
+  if (end < text + len && is_word_char (g_utf8_get_char (end)))
+    return FALSE;
+
+  return TRUE;
+}
+
+static const gchar *
+find_first_byte (const gchar *p,
+                 const gchar *end,
+                 gchar        lower,
+                 gchar        upper)
+{
+  const gchar *a;
+  const gchar *b;
+
+  if (lower == upper)
+    return memchr (p, lower, end - p);
+
+  a = memchr (p, lower, end - p);
+  b = memchr (p, upper, (a ? a : end) - p);
+
+  return b ? b : a;
+}
+
+/*
+ * Scans @text for @request, appending the matches to @matches. Character
+ * offsets are computed incrementally between matches so the text is only
+ * walked once. Safe to call from a worker thread.
+ */
+static gboolean
+scan_text (const ScanRequest *request,
+           const gchar       *text,
+           gsize              len,
+           GArray            *matches,
+           GCancellable      *cancellable)
+{
+  const gchar *counted = text;
+  gint char_offset = request->base_offset;
+  guint iterations = 0;
+
+  g_assert (request != NULL);
+  g_assert (text != NULL);
+  g_assert (matches != NULL);
+
+  if (request->regex == NULL)
+    {
+      const gchar *needle = request->needle;
+      const gchar *end = text + len;
+      const gchar *p = text;
+      gsize needle_len = strlen (needle);
+      gchar lower;
+      gchar upper;
+
+      if (needle_len == 0)
+        return TRUE;
+
+      /* Caseless literals only take this path when the needle is ASCII */
+      lower = request->case_sensitive ? needle [0] : g_ascii_tolower (needle [0]);
+      upper = request->case_sensitive ? needle [0] : g_ascii_toupper (needle [0]);
+
+      while ((p < end) && (p = find_first_byte (p, end, lower, upper)))
+        {
+          if ((gsize)(end - p) < needle_len)
+            break;
+
+          if ((++iterations % CANCEL_CHECK_INTERVAL) == 0 &&
+              g_cancellable_is_cancelled (cancellable))
+            return FALSE;
+
+          if ((request->case_sensitive ?
+               memcmp (p, needle, needle_len) == 0 :
+               g_ascii_strncasecmp (p, needle, needle_len) == 0) &&
+              (!request->at_word_boundaries ||
+               is_at_word_boundaries (text, len, p, p + needle_len)))
+            {
+              Match match;
+
+              char_offset += g_utf8_strlen (counted, p - counted);
+              counted = p;
+
+              match.begin = char_offset;
+              match.end = char_offset + request->needle_chars;
+              g_array_append_val (matches, match);
+
+              p += needle_len;
+            }
+          else
+            {
+              p++;
+            }
+        }
+    }
+  else
+    {
+      g_autoptr(GMatchInfo) match_info = NULL;
+
+      g_regex_match_full (request->regex, text, len, 0, 0, &match_info, NULL);
+
+      for (; g_match_info_matches (match_info); g_match_info_next (match_info, NULL))
+        {
+          gint begin_pos;
+          gint end_pos;
+          Match match;
+
+          if ((++iterations % CANCEL_CHECK_INTERVAL) == 0 &&
+              g_cancellable_is_cancelled (cancellable))
+            return FALSE;
+
+          if (!g_match_info_fetch_pos (match_info, 0, &begin_pos, &end_pos) ||
+              (begin_pos == end_pos))
+            continue;
+
+          if (request->at_word_boundaries &&
+              !is_at_word_boundaries (text, len, text + begin_pos, text + end_pos))
+            continue;
+
+          char_offset += g_utf8_strlen (counted, text + begin_pos - counted);
+          counted = text + begin_pos;
+
+          match.begin = char_offset;
+          match.end = char_offset + g_utf8_strlen (text + begin_pos, end_pos - begin_pos);
+          g_array_append_val (matches, match);
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+ide_source_search_index_scan_worker (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  ScanRequest *request = task_data;
+  g_autoptr(GArray) matches = NULL;
+  const gchar *text;
+  gsize len;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (request != NULL);
+
+  text = g_bytes_get_data (request->snapshot, &len);
+  matches = g_array_new (FALSE, FALSE, sizeof (Match));
+
+  if (!scan_text (request, text, len, matches, cancellable))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_CANCELLED,
+                               "The search was cancelled");
+      return;
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&matches), (GDestroyNotify)g_array_unref);
+}
+
+/* Index of the first match whose end is >= @offset */
+static guint
+lower_bound_end (GArray *matches,
+                 gint    offset)
+{
+  guint lo = 0;
+  guint hi = matches->len;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (g_array_index (matches, Match, mid).end < offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/* Index of the first match whose begin is > @offset */
+static guint
+upper_bound_begin (GArray *matches,
+                   gint    offset)
+{
+  guint lo = 0;
+  guint hi = matches->len;
+
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+
+      if (g_array_index (matches, Match, mid).begin <= offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static void
+apply_edit (GArray     *matches,
+            const Edit *edit)
+{
+  gint edit_end = edit->offset + edit->removed;
+  gint delta = edit->inserted - edit->removed;
+  guint first;
+  guint last;
+  guint i;
+
+  /*
+   * Matches touching the edit might no longer match (or might now be at a
+   * word boundary), so drop them. They are within the dirty range and will
+   * be found again when it is rescanned.
+   */
+  first = lower_bound_end (matches, edit->offset);
+  last = upper_bound_begin (matches, edit_end);
+
+  if (last > first)
+    g_array_remove_range (matches, first, last - first);
+
+  if (delta != 0)
+    {
+      for (i = first; i < matches->len; i++)
+        {
+          Match *match = &g_array_index (matches, Match, i);
+
+          match->begin += delta;
+          match->end += delta;
+        }
+    }
+}
+
+static void
+apply_edit_to_dirty (GArray     *dirty,
+                     const Edit *edit)
+{
+  gint edit_end = edit->offset + edit->removed;
+  gint delta = edit->inserted - edit->removed;
+  Match range;
+  guint i;
+
+  for (i = 0; i < dirty->len; i++)
+    {
+      Match *r = &g_array_index (dirty, Match, i);
+
+      if (r->end < edit->offset)
+        continue;
+
+      if (r->begin > edit_end)
+        {
+          r->begin += delta;
+          r->end += delta;
+        }
+      else
+        {
+          r->begin = MIN (r->begin, edit->offset);
+          r->end = (r->end > edit_end) ? r->end + delta : edit->offset + edit->inserted;
+        }
+    }
+
+  range.begin = edit->offset;
+  range.end = edit->offset + edit->inserted;
+  g_array_append_val (dirty, range);
+}
+
+static gint
+compare_match (gconstpointer a,
+               gconstpointer b)
+{
+  const Match *ma = a;
+  const Match *mb = b;
+
+  return ma->begin - mb->begin;
+}
+
+static void
+ide_source_search_index_set_count (IdeSourceSearchIndex *self,
+                                   gint                  count)
+{
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  if (self->count != count)
+    {
+      self->count = count;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_OCCURRENCES_COUNT]);
+    }
+}
+
+static void
+ide_source_search_index_rescan_range (IdeSourceSearchIndex *self,
+                                      gint                  begin_offset,
+                                      gint                  end_offset)
+{
+  g_autoptr(GArray) found = NULL;
+  g_autofree gchar *text = NULL;
+  ScanRequest request = { 0 };
+  GtkTextIter begin;
+  GtkTextIter end;
+  guint first;
+  guint last;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  gtk_text_buffer_get_iter_at_offset (self->buffer, &begin, begin_offset);
+  gtk_text_buffer_get_iter_at_offset (self->buffer, &end, end_offset);
+
+  /* Rescan whole lines, plus enough context for multi-line needles */
+  gtk_text_iter_set_line_offset (&begin, 0);
+  if (self->needle_lines > 0)
+    gtk_text_iter_backward_lines (&begin, self->needle_lines);
+  if (self->needle_lines > 0)
+    gtk_text_iter_forward_lines (&end, self->needle_lines);
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  begin_offset = gtk_text_iter_get_offset (&begin);
+  end_offset = gtk_text_iter_get_offset (&end);
+
+  text = gtk_text_iter_get_slice (&begin, &end);
+  found = g_array_new (FALSE, FALSE, sizeof (Match));
+
+  request.needle = self->needle;
+  request.regex = self->regex;
+  request.needle_chars = self->needle_chars;
+  request.base_offset = begin_offset;
+  request.case_sensitive = self->case_sensitive;
+  request.at_word_boundaries = self->at_word_boundaries;
+
+  scan_text (&request, text, strlen (text), found, NULL);
+
+  /* Replace every match overlapping the rescanned range */
+  first = lower_bound_end (self->matches, begin_offset + 1);
+  last = upper_bound_begin (self->matches, end_offset - 1);
+
+  if (last > first)
+    g_array_remove_range (self->matches, first, last - first);
+
+  if (found->len > 0)
+    g_array_insert_vals (self->matches, first, found->data, found->len);
+}
+
+static gboolean
+ide_source_search_index_flush (gpointer data)
+{
+  IdeSourceSearchIndex *self = data;
+  guint i;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  self->flush_handler = 0;
+
+  if (self->scanning || self->buffer == NULL || self->dirty->len == 0)
+    IDE_RETURN (G_SOURCE_REMOVE);
+
+  g_array_sort (self->dirty, compare_match);
+
+  for (i = 0; i < self->dirty->len; )
+    {
+      Match range = g_array_index (self->dirty, Match, i);
+
+      /* Merge overlapping ranges so each line is scanned once */
+      for (i++; i < self->dirty->len; i++)
+        {
+          const Match *next = &g_array_index (self->dirty, Match, i);
+
+          if (next->begin > range.end + 1)
+            break;
+
+          range.end = MAX (range.end, next->end);
+        }
+
+      ide_source_search_index_rescan_range (self, range.begin, range.end);
+    }
+
+  g_array_set_size (self->dirty, 0);
+
+  ide_source_search_index_set_count (self, self->matches->len);
+  g_signal_emit (self, signals [CHANGED], 0);
+
+  IDE_RETURN (G_SOURCE_REMOVE);
+}
+
+static void
+ide_source_search_index_queue_flush (IdeSourceSearchIndex *self)
+{
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  if (self->flush_handler == 0 && !self->scanning)
+    self->flush_handler = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 20,
+                                           ide_source_search_index_flush,
+                                           g_object_ref (self),
+                                           g_object_unref);
+}
+
+static void
+ide_source_search_index_scan_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+  g_autoptr(IdeSourceSearchIndex) self = user_data;
+  g_autoptr(GArray) matches = NULL;
+  GTask *task = (GTask *)result;
+  ScanRequest *request;
+  guint i;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+  g_assert (G_IS_TASK (task));
+
+  request = g_task_get_task_data (task);
+
+  /* Ignore results from a scan that was restarted */
+  if (request->sequence != self->sequence)
+    IDE_EXIT;
+
+  self->scanning = FALSE;
+  g_clear_object (&self->cancellable);
+
+  if (!(matches = g_task_propagate_pointer (task, NULL)))
+    {
+      g_array_set_size (self->pending_edits, 0);
+      IDE_EXIT;
+    }
+
+  for (i = 0; i < self->pending_edits->len; i++)
+    apply_edit (matches, &g_array_index (self->pending_edits, Edit, i));
+  g_array_set_size (self->pending_edits, 0);
+
+  g_array_unref (self->matches);
+  self->matches = g_steal_pointer (&matches);
+
+  IDE_TRACE_MSG ("Found %u matches", self->matches->len);
+
+  if (self->dirty->len > 0)
+    {
+      ide_source_search_index_flush (self);
+      IDE_EXIT;
+    }
+
+  ide_source_search_index_set_count (self, self->matches->len);
+  g_signal_emit (self, signals [CHANGED], 0);
+
+  IDE_EXIT;
+}
+
+static void
+ide_source_search_index_restart (IdeSourceSearchIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+  ScanRequest *request;
+  const gchar *search_text;
+  gboolean regex_enabled;
+  const gchar *p;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  if (self->cancellable != NULL)
+    {
+      g_cancellable_cancel (self->cancellable);
+      g_clear_object (&self->cancellable);
+    }
+
+  self->sequence++;
+  self->scanning = FALSE;
+
+  g_array_set_size (self->matches, 0);
+  g_array_set_size (self->dirty, 0);
+  g_array_set_size (self->pending_edits, 0);
+
+  g_clear_pointer (&self->needle, g_free);
+  g_clear_pointer (&self->regex, g_regex_unref);
+
+  search_text = gtk_source_search_settings_get_search_text (self->settings);
+
+  if (self->buffer == NULL || search_text == NULL || search_text [0] == '\0')
+    {
+      ide_source_search_index_set_count (self, 0);
+      g_signal_emit (self, signals [CHANGED], 0);
+      IDE_EXIT;
+    }
+
+  self->needle = g_strdup (search_text);
+  self->needle_chars = g_utf8_strlen (search_text, -1);
+  self->case_sensitive = gtk_source_search_settings_get_case_sensitive (self->settings);
+  self->at_word_boundaries = gtk_source_search_settings_get_at_word_boundaries (self->settings);
+  regex_enabled = gtk_source_search_settings_get_regex_enabled (self->settings);
+
+  self->needle_lines = 0;
+  for (p = search_text; *p; p++)
+    if (*p == '\n')
+      self->needle_lines++;
+
+  /* Literals that can't be compared bytewise go through GRegex */
+  if (regex_enabled || (!self->case_sensitive && !g_str_is_ascii (search_text)))
+    {
+      g_autofree gchar *escaped = NULL;
+      GRegexCompileFlags flags = G_REGEX_MULTILINE | G_REGEX_OPTIMIZE;
+
+      if (!self->case_sensitive)
+        flags |= G_REGEX_CASELESS;
+
+      if (!regex_enabled)
+        search_text = escaped = g_regex_escape_string (search_text, -1);
+
+      self->regex = g_regex_new (search_text, flags, 0, NULL);
+
+      if (self->regex == NULL)
+        {
+          /*
+           * Invalid regex while the user is still typing. Drop the needle too
+           * so edits are ignored until the next valid restart rather than
+           * rescanning with the pattern as a literal.
+           */
+          g_clear_pointer (&self->needle, g_free);
+          self->needle_lines = 0;
+          ide_source_search_index_set_count (self, 0);
+          g_signal_emit (self, signals [CHANGED], 0);
+          IDE_EXIT;
+        }
+    }
+
+  if (self->snapshot == NULL)
+    {
+      GtkTextIter begin;
+      GtkTextIter end;
+      gchar *text;
+
+      gtk_text_buffer_get_bounds (self->buffer, &begin, &end);
+      text = gtk_text_iter_get_slice (&begin, &end);
+      self->snapshot = g_bytes_new_take (text, strlen (text));
+    }
+
+  request = g_slice_new0 (ScanRequest);
+  request->snapshot = g_bytes_ref (self->snapshot);
+  request->needle = g_strdup (self->needle);
+  request->regex = self->regex ? g_regex_ref (self->regex) : NULL;
+  request->needle_chars = self->needle_chars;
+  request->base_offset = 0;
+  request->sequence = self->sequence;
+  request->case_sensitive = self->case_sensitive;
+  request->at_word_boundaries = self->at_word_boundaries;
+
+  self->cancellable = g_cancellable_new ();
+  self->scanning = TRUE;
+
+  ide_source_search_index_set_count (self, -1);
+
+  task = g_task_new (self, self->cancellable, ide_source_search_index_scan_cb, g_object_ref (self));
+  g_task_set_task_data (task, request, scan_request_free);
+  g_task_set_check_cancellable (task, FALSE);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, ide_source_search_index_scan_worker);
+
+  IDE_EXIT;
+}
+
+static void
+ide_source_search_index_record_edit (IdeSourceSearchIndex *self,
+                                     const Edit           *edit)
+{
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+  g_assert (edit != NULL);
+
+  g_clear_pointer (&self->snapshot, g_bytes_unref);
+
+  if (self->needle == NULL)
+    return;
+
+  apply_edit (self->matches, edit);
+  apply_edit_to_dirty (self->dirty, edit);
+
+  if (self->scanning)
+    g_array_append_val (self->pending_edits, *edit);
+  else
+    ide_source_search_index_queue_flush (self);
+}
+
+static void
+ide_source_search_index_insert_text (IdeSourceSearchIndex *self,
+                                     GtkTextIter          *location,
+                                     const gchar          *text,
+                                     gint                  len,
+                                     GtkTextBuffer        *buffer)
+{
+  Edit edit;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  edit.offset = gtk_text_iter_get_offset (location);
+  edit.removed = 0;
+  edit.inserted = g_utf8_strlen (text, len);
+
+  ide_source_search_index_record_edit (self, &edit);
+}
+
+static void
+ide_source_search_index_delete_range (IdeSourceSearchIndex *self,
+                                      GtkTextIter          *begin,
+                                      GtkTextIter          *end,
+                                      GtkTextBuffer        *buffer)
+{
+  gint begin_offset;
+  gint end_offset;
+  Edit edit;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  begin_offset = gtk_text_iter_get_offset (begin);
+  end_offset = gtk_text_iter_get_offset (end);
+
+  edit.offset = MIN (begin_offset, end_offset);
+  edit.removed = ABS (end_offset - begin_offset);
+  edit.inserted = 0;
+
+  ide_source_search_index_record_edit (self, &edit);
+}
+
+static void
+ide_source_search_index_insert_object (IdeSourceSearchIndex *self,
+                                       GtkTextIter          *location,
+                                       gpointer              object,
+                                       GtkTextBuffer        *buffer)
+{
+  Edit edit;
+
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  /* Pixbufs and child anchors take up a single character */
+  edit.offset = gtk_text_iter_get_offset (location);
+  edit.removed = 0;
+  edit.inserted = 1;
+
+  ide_source_search_index_record_edit (self, &edit);
+}
+
+static void
+ide_source_search_index_settings_notify (IdeSourceSearchIndex    *self,
+                                         GParamSpec              *pspec,
+                                         GtkSourceSearchSettings *settings)
+{
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (self));
+
+  ide_source_search_index_restart (self);
+}
+
+static void
+ide_source_search_index_dispose (GObject *object)
+{
+  IdeSourceSearchIndex *self = (IdeSourceSearchIndex *)object;
+
+  if (self->cancellable != NULL)
+    {
+      g_cancellable_cancel (self->cancellable);
+      g_clear_object (&self->cancellable);
+    }
+
+  if (self->flush_handler != 0)
+    {
+      g_source_remove (self->flush_handler);
+      self->flush_handler = 0;
+    }
+
+  if (self->buffer != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->buffer, self);
+      g_object_remove_weak_pointer (G_OBJECT (self->buffer), (gpointer *)&self->buffer);
+      self->buffer = NULL;
+    }
+
+  if (self->settings != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->settings, self);
+      g_clear_object (&self->settings);
+    }
+
+  G_OBJECT_CLASS (ide_source_search_index_parent_class)->dispose (object);
+}
+
+static void
+ide_source_search_index_finalize (GObject *object)
+{
+  IdeSourceSearchIndex *self = (IdeSourceSearchIndex *)object;
+
+  g_clear_pointer (&self->matches, g_array_unref);
+  g_clear_pointer (&self->dirty, g_array_unref);
+  g_clear_pointer (&self->pending_edits, g_array_unref);
+  g_clear_pointer (&self->snapshot, g_bytes_unref);
+  g_clear_pointer (&self->needle, g_free);
+  g_clear_pointer (&self->regex, g_regex_unref);
+
+  G_OBJECT_CLASS (ide_source_search_index_parent_class)->finalize (object);
+}
+
+static void
+ide_source_search_index_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  IdeSourceSearchIndex *self = IDE_SOURCE_SEARCH_INDEX (object);
+
+  switch (prop_id)
+    {
+    case PROP_OCCURRENCES_COUNT:
+      g_value_set_int (value, self->count);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+ide_source_search_index_class_init (IdeSourceSearchIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = ide_source_search_index_dispose;
+  object_class->finalize = ide_source_search_index_finalize;
+  object_class->get_property = ide_source_search_index_get_property;
+
+  properties [PROP_OCCURRENCES_COUNT] =
+    g_param_spec_int ("occurrences-count",
+                      "Occurrences Count",
+                      "The number of matches, or -1 if the buffer is still being scanned.",
+                      -1,
+                      G_MAXINT,
+                      0,
+                      (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, LAST_PROP, properties);
+
+  /**
+   * IdeSourceSearchIndex::changed:
+   *
+   * The "changed" signal is emitted when the set of matches changes, such as
+   * when a scan completes or edited lines have been rescanned.
+   */
+  signals [CHANGED] =
+    g_signal_new ("changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  0);
+}
+
+static void
+ide_source_search_index_init (IdeSourceSearchIndex *self)
+{
+  self->matches = g_array_new (FALSE, FALSE, sizeof (Match));
+  self->dirty = g_array_new (FALSE, FALSE, sizeof (Match));
+  self->pending_edits = g_array_new (FALSE, FALSE, sizeof (Edit));
+}
+
+IdeSourceSearchIndex *
+ide_source_search_index_new (GtkTextBuffer           *buffer,
+                             GtkSourceSearchSettings *settings)
+{
+  IdeSourceSearchIndex *self;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), NULL);
+  g_return_val_if_fail (GTK_SOURCE_IS_SEARCH_SETTINGS (settings), NULL);
+
+  self = g_object_new (IDE_TYPE_SOURCE_SEARCH_INDEX, NULL);
+  self->settings = g_object_ref (settings);
+  self->buffer = buffer;
+  g_object_add_weak_pointer (G_OBJECT (buffer), (gpointer *)&self->buffer);
+
+  g_signal_connect_object (buffer,
+                           "insert-text",
+                           G_CALLBACK (ide_source_search_index_insert_text),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (buffer,
+                           "delete-range",
+                           G_CALLBACK (ide_source_search_index_delete_range),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (buffer,
+                           "insert-pixbuf",
+                           G_CALLBACK (ide_source_search_index_insert_object),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (buffer,
+                           "insert-child-anchor",
+                           G_CALLBACK (ide_source_search_index_insert_object),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  g_signal_connect_object (settings,
+                           "notify::search-text",
+                           G_CALLBACK (ide_source_search_index_settings_notify),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (settings,
+                           "notify::case-sensitive",
+                           G_CALLBACK (ide_source_search_index_settings_notify),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (settings,
+                           "notify::at-word-boundaries",
+                           G_CALLBACK (ide_source_search_index_settings_notify),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (settings,
+                           "notify::regex-enabled",
+                           G_CALLBACK (ide_source_search_index_settings_notify),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  ide_source_search_index_restart (self);
+
+  return self;
+}
+
+/**
+ * ide_source_search_index_get_occurrences_count:
+ *
+ * Returns: the number of matches, or -1 if the buffer is still being scanned.
+ */
+gint
+ide_source_search_index_get_occurrences_count (IdeSourceSearchIndex *self)
+{
+  g_return_val_if_fail (IDE_IS_SOURCE_SEARCH_INDEX (self), -1);
+
+  return self->count;
+}
+
+/**
+ * ide_source_search_index_get_occurrence_position:
+ *
+ * Like gtk_source_search_context_get_occurrence_position(), gets the
+ * position of the match at @match_begin and @match_end.
+ *
+ * Returns: the 1-based position of the match, 0 if it is not a match, or -1
+ *   if the buffer is still being scanned.
+ */
+gint
+ide_source_search_index_get_occurrence_position (IdeSourceSearchIndex *self,
+                                                 const GtkTextIter    *match_begin,
+                                                 const GtkTextIter    *match_end)
+{
+  gint begin_offset;
+  gint end_offset;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SOURCE_SEARCH_INDEX (self), -1);
+  g_return_val_if_fail (match_begin != NULL, -1);
+  g_return_val_if_fail (match_end != NULL, -1);
+
+  if (self->count < 0)
+    return -1;
+
+  begin_offset = gtk_text_iter_get_offset (match_begin);
+  end_offset = gtk_text_iter_get_offset (match_end);
+
+  i = upper_bound_begin (self->matches, begin_offset);
+
+  if (i > 0)
+    {
+      const Match *match = &g_array_index (self->matches, Match, i - 1);
+
+      if (match->begin == begin_offset && match->end == end_offset)
+        return i;
+    }
+
+  return 0;
+}
+
+static void
+get_match_iters (IdeSourceSearchIndex *self,
+                 guint                 index,
+                 GtkTextIter          *match_begin,
+                 GtkTextIter          *match_end)
+{
+  const Match *match = &g_array_index (self->matches, Match, index);
+
+  if (match_begin != NULL)
+    gtk_text_buffer_get_iter_at_offset (self->buffer, match_begin, match->begin);
+
+  if (match_end != NULL)
+    gtk_text_buffer_get_iter_at_offset (self->buffer, match_end, match->end);
+}
+
+/**
+ * ide_source_search_index_forward:
+ *
+ * Finds the first match starting at or after @iter, wrapping around if
+ * enabled by the search settings.
+ *
+ * Returns: %TRUE if a match was found.
+ */
+gboolean
+ide_source_search_index_forward (IdeSourceSearchIndex *self,
+                                 const GtkTextIter    *iter,
+                                 GtkTextIter          *match_begin,
+                                 GtkTextIter          *match_end)
+{
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SOURCE_SEARCH_INDEX (self), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  if (self->buffer == NULL || self->matches->len == 0)
+    return FALSE;
+
+  i = upper_bound_begin (self->matches, gtk_text_iter_get_offset (iter) - 1);
+
+  if (i == self->matches->len)
+    {
+      if (!gtk_source_search_settings_get_wrap_around (self->settings))
+        return FALSE;
+      i = 0;
+    }
+
+  get_match_iters (self, i, match_begin, match_end);
+
+  return TRUE;
+}
+
+/**
+ * ide_source_search_index_backward:
+ *
+ * Finds the last match ending at or before @iter, wrapping around if
+ * enabled by the search settings.
+ *
+ * Returns: %TRUE if a match was found.
+ */
+gboolean
+ide_source_search_index_backward (IdeSourceSearchIndex *self,
+                                  const GtkTextIter    *iter,
+                                  GtkTextIter          *match_begin,
+                                  GtkTextIter          *match_end)
+{
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SOURCE_SEARCH_INDEX (self), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  if (self->buffer == NULL || self->matches->len == 0)
+    return FALSE;
+
+  i = lower_bound_end (self->matches, gtk_text_iter_get_offset (iter) + 1);
+
+  if (i == 0)
+    {
+      if (!gtk_source_search_settings_get_wrap_around (self->settings))
+        return FALSE;
+      i = self->matches->len;
+    }
+
+  get_match_iters (self, i - 1, match_begin, match_end);
+
+  return TRUE;
+}
+
+/**
+ * ide_source_search_index_foreach_in_range:
+ * @func: (scope call): a function to call for each match
+ *
+ * Calls @func for each match overlapping @begin and @end. This only looks
+ * at the matches in the range, so it is suitable for use while drawing.
+ *
+ * Returns: the number of matches in the range.
+ */
+guint
+ide_source_search_index_foreach_in_range (IdeSourceSearchIndex        *self,
+                                          const GtkTextIter           *begin,
+                                          const GtkTextIter           *end,
+                                          IdeSourceSearchIndexForeach  func,
+                                          gpointer                     user_data)
+{
+  gint end_offset;
+  guint count = 0;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_SOURCE_SEARCH_INDEX (self), 0);
+  g_return_val_if_fail (begin != NULL, 0);
+  g_return_val_if_fail (end != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  if (self->buffer == NULL)
+    return 0;
+
+  end_offset = gtk_text_iter_get_offset (end);
+
+  for (i = lower_bound_end (self->matches, gtk_text_iter_get_offset (begin));
+       i < self->matches->len;
+       i++)
+    {
+      GtkTextIter match_begin;
+      GtkTextIter match_end;
+
+      if (g_array_index (self->matches, Match, i).begin > end_offset)
+        break;
+
+      get_match_iters (self, i, &match_begin, &match_end);
+      func (&match_begin, &match_end, user_data);
+      count++;
+    }
+
+  return count;
+}
@@ -0,0 +1,56 @@
+/* ide-source-search-index.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_SOURCE_SEARCH_INDEX_H
+#define IDE_SOURCE_SEARCH_INDEX_H
+
+#include <gtksourceview/gtksource.h>
+
+G_BEGIN_DECLS
+
+#define IDE_TYPE_SOURCE_SEARCH_INDEX (ide_source_search_index_get_type())
+
+G_DECLARE_FINAL_TYPE (IdeSourceSearchIndex, ide_source_search_index, IDE, SOURCE_SEARCH_INDEX, GObject)
+
+typedef void (*IdeSourceSearchIndexForeach) (const GtkTextIter *match_begin,
+                                             const GtkTextIter *match_end,
+                                             gpointer           user_data);
+
+IdeSourceSearchIndex *ide_source_search_index_new                     (GtkTextBuffer               *buffer,
+                                                                       GtkSourceSearchSettings     *settings);
+gint                  ide_source_search_index_get_occurrences_count   (IdeSourceSearchIndex        *self);
+gint                  ide_source_search_index_get_occurrence_position (IdeSourceSearchIndex        *self,
+                                                                       const GtkTextIter           *match_begin,
+                                                                       const GtkTextIter           *match_end);
+gboolean              ide_source_search_index_forward                 (IdeSourceSearchIndex        *self,
+                                                                       const GtkTextIter           *iter,
+                                                                       GtkTextIter                 *match_begin,
+                                                                       GtkTextIter                 *match_end);
+gboolean              ide_source_search_index_backward                (IdeSourceSearchIndex        *self,
+                                                                       const GtkTextIter           *iter,
+                                                                       GtkTextIter                 *match_begin,
+                                                                       GtkTextIter                 *match_end);
+guint                 ide_source_search_index_foreach_in_range        (IdeSourceSearchIndex        *self,
+                                                                       const GtkTextIter           *begin,
+                                                                       const GtkTextIter           *end,
+                                                                       IdeSourceSearchIndexForeach  func,
+                                                                       gpointer                     user_data);
+
+G_END_DECLS
+
+#endif /* IDE_SOURCE_SEARCH_INDEX_H */
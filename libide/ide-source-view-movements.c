@@ -24,6 +24,7 @@
 #include "ide-enums.h"
 #include "ide-internal.h"
 #include "ide-cairo.h"
+#include "ide-scan-cache.h"
 #include "ide-source-iter.h"
 #include "ide-source-view-movements.h"
 #include "ide-text-iter.h"
@@ -912,6 +913,7 @@ match_char_with_depth (GtkTextIter      *iter,
                        gboolean          string_mode)
 {
   MatchingBracketState state;
+  IdeScanCache *cache = NULL;
   GtkTextIter limit;
   gboolean ret;
 
@@ -919,6 +921,16 @@ match_char_with_depth (GtkTextIter      *iter,
   g_return_val_if_fail ((left_char == right_char && string_mode) ||
                         (left_char != right_char && !string_mode), FALSE);
 
+  /*
+   * Brackets within comments and strings are skipped by the scan cache, so
+   * only use it when starting from code. Otherwise we would never find the
+   * match of a bracket inside a comment.
+   */
+  if (!string_mode && depth > 0 &&
+      (cache = ide_scan_cache_get_for_buffer (gtk_text_iter_get_buffer (iter))) &&
+      ide_scan_cache_get_context (cache, iter, NULL) != IDE_SCAN_CONTEXT_CODE)
+    cache = NULL;
+
   state.jump_from = left_char;
   state.jump_to = right_char;
   state.direction = direction;
@@ -944,6 +956,8 @@ match_char_with_depth (GtkTextIter      *iter,
           gtk_text_iter_set_line_offset (&limit, 0);
           ret = _ide_text_iter_backward_find_char (iter, bracket_predicate, &state, &limit);
         }
+      else if (cache != NULL)
+        ret = ide_scan_cache_backward_find_unmatched (cache, iter, left_char, depth);
       else
         ret = _ide_text_iter_backward_find_char (iter, bracket_predicate, &state, NULL);
     }
@@ -954,6 +968,16 @@ match_char_with_depth (GtkTextIter      *iter,
           gtk_text_iter_forward_to_line_end (&limit);
           ret = _ide_text_iter_forward_find_char (iter, bracket_predicate, &state, &limit);
         }
+      else if (cache != NULL)
+        {
+          GtkTextIter next = *iter;
+
+          /* Like the predicate search, start after the character at @iter */
+          ret = gtk_text_iter_forward_char (&next) &&
+                ide_scan_cache_forward_find_unmatched (cache, &next, right_char, depth);
+          if (ret)
+            *iter = next;
+        }
       else
         ret = _ide_text_iter_forward_find_char (iter, bracket_predicate, &state, NULL);
     }
@@ -54,6 +54,7 @@
 #include "ide-pango.h"
 #include "ide-rgba.h"
 #include "ide-source-range.h"
+#include "ide-source-search-index.h"
 #include "ide-source-snippet.h"
 #include "ide-source-snippet-chunk.h"
 #include "ide-source-snippet-completion-provider.h"
@@ -114,6 +115,7 @@ typedef struct
   GQueue                      *snippets;
   GtkSourceCompletionProvider *snippets_provider;
   GtkSourceSearchContext      *search_context;
+  IdeSourceSearchIndex        *search_index;
   EggAnimation                *hadj_animation;
   EggAnimation                *vadj_animation;
 
@@ -147,6 +149,7 @@ typedef struct
 
   GdkRGBA                      bubble_color1;
   GdkRGBA                      bubble_color2;
+  GdkRGBA                      search_match_color;
 
   guint                        font_scale;
 
@@ -165,10 +168,13 @@ typedef struct
   guint                        in_replay_macro : 1;
   guint                        insert_mark_cleared : 1;
   guint                        insert_matching_brace : 1;
+  guint                        large_file_mode : 1;
   guint                        overwrite_braces : 1;
   guint                        recording_macro : 1;
   guint                        rubberband_search : 1;
+  guint                        rubberband_pending : 1;
   guint                        scrolling_to_scroll_mark : 1;
+  guint                        search_highlight : 1;
   guint                        show_grid_lines : 1;
   guint                        show_line_changes : 1;
   guint                        show_line_diagnostics : 1;
@@ -738,7 +744,7 @@ ide_source_view_reload_word_completion (IdeSourceView *self)
     {
       IdeBufferManager *bufmgr;
       GtkSourceCompletion *completion;
-      GtkSourceCompletionWords *words;
+      GtkSourceCompletionProvider *words;
       GList *list;
 
       bufmgr = ide_context_get_buffer_manager (context);
@@ -747,13 +753,9 @@ ide_source_view_reload_word_completion (IdeSourceView *self)
       list = gtk_source_completion_get_providers (completion);
 
       if (priv->enable_word_completion && !g_list_find (list, words))
-        gtk_source_completion_add_provider (completion,
-                                            GTK_SOURCE_COMPLETION_PROVIDER (words),
-                                            NULL);
+        gtk_source_completion_add_provider (completion, words, NULL);
       else if (!priv->enable_word_completion && g_list_find (list, words))
-        gtk_source_completion_remove_provider (completion,
-                                               GTK_SOURCE_COMPLETION_PROVIDER (words),
-                                               NULL);
+        gtk_source_completion_remove_provider (completion, words, NULL);
     }
 }
 
@@ -995,11 +997,13 @@ ide_source_view__buffer_notify_style_scheme_cb (IdeSourceView *self,
       gdk_rgba_parse (&color, background);
       ide_rgba_shade (&color, &priv->bubble_color1, 0.8);
       ide_rgba_shade (&color, &priv->bubble_color2, 1.1);
+      priv->search_match_color = color;
     }
   else
     {
       gdk_rgba_parse (&priv->bubble_color1, "#edd400");
       gdk_rgba_parse (&priv->bubble_color2, "#fce94f");
+      gdk_rgba_parse (&priv->search_match_color, "#fce94f");
     }
 }
 
@@ -1028,12 +1032,34 @@ ide_source_view__search_settings_notify_search_text (IdeSourceView           *se
 
   search_text = gtk_source_search_settings_get_search_text (search_settings);
 
+  priv->rubberband_pending = FALSE;
+
   /*
    * If we have IdeSourceView:rubberband-search enabled, then we should try to
    * autoscroll to the next search result starting from our saved search mark.
    */
   if ((search_text != NULL) && (search_text [0] != '\0') &&
       priv->rubberband_search && (priv->rubberband_insert_mark != NULL))
+    {
+      /*
+       * The search index is rescanning in the background, so wait for it to
+       * finish rather than scanning the buffer here.
+       */
+      priv->rubberband_pending = TRUE;
+    }
+}
+
+static void
+ide_source_view__search_index_changed (IdeSourceView        *self,
+                                       IdeSourceSearchIndex *search_index)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+  g_assert (IDE_IS_SOURCE_SEARCH_INDEX (search_index));
+
+  if (priv->rubberband_pending &&
+      (ide_source_search_index_get_occurrences_count (search_index) >= 0))
     {
       GtkTextBuffer *buffer;
       GtkTextIter begin_iter;
@@ -1041,26 +1067,17 @@ ide_source_view__search_settings_notify_search_text (IdeSourceView           *se
       GtkTextIter match_end;
       gboolean search_succeeded;
 
+      priv->rubberband_pending = FALSE;
+
       buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self));
       gtk_text_buffer_get_iter_at_mark (buffer, &begin_iter, priv->rubberband_insert_mark);
 
-      switch (priv->search_direction)
-        {
-        case GTK_DIR_LEFT:
-        case GTK_DIR_UP:
-          search_succeeded = gtk_source_search_context_backward (priv->search_context, &begin_iter,
-                                                                 &match_begin, &match_end);
-          break;
-        case GTK_DIR_RIGHT:
-        case GTK_DIR_DOWN:
-          search_succeeded = gtk_source_search_context_forward (priv->search_context, &begin_iter,
-                                                                &match_begin, &match_end);
-          break;
-        case GTK_DIR_TAB_FORWARD:
-        case GTK_DIR_TAB_BACKWARD:
-        default:
-          g_return_if_reached ();
-        }
+      if (priv->search_direction == GTK_DIR_LEFT || priv->search_direction == GTK_DIR_UP)
+        search_succeeded = ide_source_search_index_backward (search_index, &begin_iter,
+                                                             &match_begin, &match_end);
+      else
+        search_succeeded = ide_source_search_index_forward (search_index, &begin_iter,
+                                                            &match_begin, &match_end);
 
       if (search_succeeded)
         {
@@ -1068,6 +1085,9 @@ ide_source_view__search_settings_notify_search_text (IdeSourceView           *se
           ide_source_view_scroll_mark_onscreen (self, priv->rubberband_mark, TRUE, 0.5, 0.5);
         }
     }
+
+  if (priv->search_highlight)
+    gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
 static void
@@ -1319,6 +1339,76 @@ ide_source_view__buffer_line_flags_changed_cb (IdeSourceView *self,
   IDE_EXIT;
 }
 
+static void
+ide_source_view__vadjustment_value_changed_cb (IdeSourceView *self,
+                                               GtkAdjustment *vadj)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+  gdouble page_size;
+
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+  g_assert (GTK_IS_ADJUSTMENT (vadj));
+
+  if (priv->buffer == NULL || !ide_buffer_get_large_file_mode (priv->buffer))
+    return;
+
+  /*
+   * Page in more of the file once we are within a few screens of the end of
+   * what has been loaded so far.
+   */
+  page_size = gtk_adjustment_get_page_size (vadj);
+  if (gtk_adjustment_get_value (vadj) + (page_size * 3) >= gtk_adjustment_get_upper (vadj))
+    _ide_buffer_load_large_file_page (priv->buffer);
+}
+
+static void
+ide_source_view_set_large_file_mode (IdeSourceView *self,
+                                     gboolean       large_file_mode)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+  GtkAdjustment *vadj;
+
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+
+  large_file_mode = !!large_file_mode;
+
+  if (large_file_mode == priv->large_file_mode)
+    return;
+
+  priv->large_file_mode = large_file_mode;
+
+  /* Large files are read-only and paged in as the user scrolls. */
+  gtk_text_view_set_editable (GTK_TEXT_VIEW (self), !large_file_mode);
+
+  vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (self));
+
+  if (large_file_mode)
+    g_signal_connect_object (vadj,
+                             "value-changed",
+                             G_CALLBACK (ide_source_view__vadjustment_value_changed_cb),
+                             self,
+                             G_CONNECT_SWAPPED);
+  else
+    g_signal_handlers_disconnect_by_func (vadj,
+                                          G_CALLBACK (ide_source_view__vadjustment_value_changed_cb),
+                                          self);
+}
+
+/*
+ * The buffer is usually bound before loading decides whether it is a large
+ * file, so follow the property rather than checking once at bind time.
+ */
+static void
+ide_source_view__buffer_notify_large_file_mode_cb (IdeSourceView *self,
+                                                   GParamSpec    *pspec,
+                                                   IdeBuffer     *buffer)
+{
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  ide_source_view_set_large_file_mode (self, ide_buffer_get_large_file_mode (buffer));
+}
+
 static void
 ide_source_view__buffer_loaded_cb (IdeSourceView *self,
                                    IdeBuffer     *buffer)
@@ -1500,12 +1590,25 @@ ide_source_view_bind_buffer (IdeSourceView  *self,
                                   "regex-enabled", FALSE,
                                   "case-sensitive", TRUE,
                                   NULL);
+  /*
+   * Matches are drawn from the search index, which scans off the main
+   * thread. Highlighting in GtkSourceSearchContext would scan the whole
+   * buffer again on the main loop to apply its tags.
+   */
   priv->search_context = g_object_new (GTK_SOURCE_TYPE_SEARCH_CONTEXT,
                                        "buffer", buffer,
-                                       "highlight", TRUE,
+                                       "highlight", FALSE,
                                        "settings", search_settings,
                                        NULL);
 
+  priv->search_index = ide_source_search_index_new (GTK_TEXT_BUFFER (buffer), search_settings);
+
+  g_signal_connect_object (priv->search_index,
+                           "changed",
+                           G_CALLBACK (ide_source_view__search_index_changed),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   g_signal_connect_object (search_settings,
                            "notify::search-text",
                            G_CALLBACK (ide_source_view__search_settings_notify_search_text),
@@ -1544,6 +1647,8 @@ ide_source_view_bind_buffer (IdeSourceView  *self,
                           g_action_map_lookup_action (G_ACTION_MAP (actions), "undo"), "enabled",
                           G_BINDING_SYNC_CREATE);
 
+  ide_source_view__buffer_notify_large_file_mode_cb (self, NULL, buffer);
+
   IDE_EXIT;
 }
 
@@ -1559,6 +1664,8 @@ ide_source_view_unbind_buffer (IdeSourceView  *self,
   if (priv->buffer == NULL)
     return;
 
+  ide_source_view_set_large_file_mode (self, FALSE);
+
   priv->scroll_mark = NULL;
 
   if (priv->completion_blocked)
@@ -1577,6 +1684,7 @@ ide_source_view_unbind_buffer (IdeSourceView  *self,
   egg_signal_group_set_target (priv->completion_providers_signals, NULL);
 
   g_clear_object (&priv->search_context);
+  g_clear_object (&priv->search_index);
   g_clear_object (&priv->indenter_adapter);
   g_clear_object (&priv->completion_providers);
 
@@ -2767,7 +2875,8 @@ ide_source_view_real_clear_search (IdeSourceView *self)
 
   g_assert (IDE_IS_SOURCE_VIEW (self));
 
-  gtk_source_search_context_set_highlight (priv->search_context, FALSE);
+  priv->search_highlight = FALSE;
+  gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
 static void
@@ -3518,7 +3627,11 @@ ide_source_view_real_move_search (IdeSourceView    *self,
       priv->search_direction = dir;
     }
 
-  gtk_source_search_context_set_highlight (priv->search_context, TRUE);
+  if (!priv->search_highlight)
+    {
+      priv->search_highlight = TRUE;
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
 
   settings = gtk_source_search_context_get_settings (priv->search_context);
 
@@ -4394,53 +4507,20 @@ add_match (GtkTextView       *text_view,
   g_warning ("Need to support complex matches (multi-line)");
 }
 
-static guint
-add_matches (GtkTextView            *text_view,
-             cairo_region_t         *region,
-             GtkSourceSearchContext *search_context,
-             const GtkTextIter      *begin,
-             const GtkTextIter      *end)
-{
-  GtkTextIter first_begin;
-  GtkTextIter new_begin;
-  GtkTextIter match_begin;
-  GtkTextIter match_end;
-  guint count = 0;
-
-  g_assert (GTK_IS_TEXT_VIEW (text_view));
-  g_assert (region);
-  g_assert (GTK_SOURCE_IS_SEARCH_CONTEXT (search_context));
-  g_assert (begin);
-  g_assert (end);
-
-  if (!gtk_source_search_context_forward (search_context,
-                                          begin,
-                                          &first_begin,
-                                          &match_end))
-    return 0;
-
-  add_match (text_view, region, &first_begin, &match_end);
-
-  for (;; )
-    {
-      gtk_text_iter_assign (&new_begin, &match_end);
-
-      if (gtk_source_search_context_forward (search_context,
-                                             &new_begin,
-                                             &match_begin,
-                                             &match_end) &&
-          (gtk_text_iter_compare (&match_begin, end) < 0) &&
-          (gtk_text_iter_compare (&first_begin, &match_begin) != 0))
-        {
-          add_match (text_view, region, &match_begin, &match_end);
-          count++;
-          continue;
-        }
+typedef struct
+{
+  GtkTextView    *text_view;
+  cairo_region_t *region;
+} AddMatchState;
 
-      break;
-    }
+static void
+add_match_cb (const GtkTextIter *match_begin,
+              const GtkTextIter *match_end,
+              gpointer           user_data)
+{
+  AddMatchState *state = user_data;
 
-  return count;
+  add_match (state->text_view, state->region, match_begin, match_end);
 }
 
 static void
@@ -4455,49 +4535,114 @@ get_shadow_color (IdeSourceView *self,
   rgba->alpha = 0.2;
 }
 
+/*
+ * Adds the matches within @area to @match_region and returns how many were
+ * added. @occurrences is set to the number of matches in the buffer.
+ */
+static guint
+ide_source_view_get_visible_matches (IdeSourceView      *self,
+                                     const GdkRectangle *area,
+                                     cairo_region_t     *match_region,
+                                     gint               *occurrences)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+  GtkTextView *text_view = (GtkTextView *)self;
+  AddMatchState state = { text_view, match_region };
+  GtkTextIter begin;
+  GtkTextIter end;
+  gint buffer_x = 0;
+  gint buffer_y = 0;
+
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+  g_assert (area != NULL);
+  g_assert (match_region != NULL);
+  g_assert (occurrences != NULL);
+
+  gtk_text_view_window_to_buffer_coords (text_view, GTK_TEXT_WINDOW_TEXT,
+                                         area->x, area->y, &buffer_x, &buffer_y);
+  gtk_text_view_get_iter_at_location (text_view, &begin, buffer_x, buffer_y);
+  gtk_text_view_get_iter_at_location (text_view, &end,
+                                      buffer_x + area->width,
+                                      buffer_y + area->height);
+
+  /*
+   * The search index already knows where the matches are. While it is
+   * still scanning there is nothing to draw yet; it emits "changed" once
+   * it is done.
+   */
+  *occurrences = ide_source_search_index_get_occurrences_count (priv->search_index);
+
+  if (*occurrences < 0)
+    {
+      *occurrences = 0;
+      return 0;
+    }
+
+  return ide_source_search_index_foreach_in_range (priv->search_index, &begin, &end,
+                                                   add_match_cb, &state);
+}
+
+static void
+ide_source_view_draw_search_matches (IdeSourceView *self,
+                                     cairo_t       *cr)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+  cairo_region_t *match_region;
+  GdkRectangle area;
+  gint occurrences;
+
+  g_assert (IDE_IS_SOURCE_VIEW (self));
+  g_assert (cr);
+
+  if (!priv->search_context || !priv->search_highlight)
+    return;
+
+  if (!gdk_cairo_get_clip_rectangle (cr, &area))
+    gtk_widget_get_allocation (GTK_WIDGET (self), &area);
+
+  match_region = cairo_region_create ();
+
+  if (ide_source_view_get_visible_matches (self, &area, match_region, &occurrences) > 0)
+    {
+      gdk_cairo_region (cr, match_region);
+      gdk_cairo_set_source_rgba (cr, &priv->search_match_color);
+      cairo_fill (cr);
+    }
+
+  cairo_region_destroy (match_region);
+}
+
 void
 ide_source_view_draw_search_bubbles (IdeSourceView *self,
                                      cairo_t       *cr)
 {
   IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
-  GtkTextView *text_view = (GtkTextView *)self;
   cairo_region_t *clip_region;
   cairo_region_t *match_region;
   GdkRectangle area;
-  GtkTextIter begin;
-  GtkTextIter end;
   cairo_rectangle_int_t r;
   guint count;
-  gint buffer_x = 0;
-  gint buffer_y = 0;
+  gint occurrences;
   gint n;
   gint i;
 
   g_return_if_fail (IDE_IS_SOURCE_VIEW (self));
-  g_return_if_fail (GTK_IS_TEXT_VIEW (text_view));
   g_return_if_fail (cr);
 
-  if (!priv->search_context || !gtk_source_search_context_get_highlight (priv->search_context))
+  if (!priv->search_context || !priv->search_highlight)
     return;
 
   if (!gdk_cairo_get_clip_rectangle (cr, &area))
     gtk_widget_get_allocation (GTK_WIDGET (self), &area);
 
-  gtk_text_view_window_to_buffer_coords (text_view, GTK_TEXT_WINDOW_TEXT,
-                                         area.x, area.y, &buffer_x, &buffer_y);
-  gtk_text_view_get_iter_at_location (text_view, &begin, buffer_x, buffer_y);
-  gtk_text_view_get_iter_at_location (text_view, &end,
-                                      buffer_x + area.width,
-                                      buffer_y + area.height);
-
   clip_region = cairo_region_create_rectangle (&area);
   match_region = cairo_region_create ();
-  count = add_matches (text_view, match_region, priv->search_context, &begin, &end);
+
+  count = ide_source_view_get_visible_matches (self, &area, match_region, &occurrences);
 
   cairo_region_subtract (clip_region, match_region);
 
-  if (priv->show_search_shadow &&
-      ((count > 0) || gtk_source_search_context_get_occurrences_count (priv->search_context) > 0))
+  if (priv->show_search_shadow && ((count > 0) || (occurrences > 0)))
     {
       GdkRGBA shadow;
 
@@ -4547,6 +4692,14 @@ ide_source_view_real_draw_layer (GtkTextView      *text_view,
           snippet = g_queue_peek_head (priv->snippets);
           ide_source_view_draw_snippet_chunks (self, snippet, cr);
         }
+
+      /* Bubbles already mark the matches, so only draw these without them */
+      if (!priv->show_search_bubbles)
+        {
+          cairo_save (cr);
+          ide_source_view_draw_search_matches (self, cr);
+          cairo_restore (cr);
+        }
     }
   else if (layer == GTK_TEXT_VIEW_LAYER_ABOVE)
     {
@@ -4575,9 +4728,16 @@ ide_source_view_real_draw (GtkWidget *widget,
 
   ret = GTK_WIDGET_CLASS (ide_source_view_parent_class)->draw (widget, cr);
 
+  /*
+   * Buffers restored from a previous session defer their expensive features
+   * until they are actually shown. Drawing is our signal for that.
+   */
+  if (priv->buffer != NULL)
+    _ide_buffer_queue_materialize (priv->buffer);
+
   if (priv->show_search_shadow &&
-      priv->search_context &&
-      (gtk_source_search_context_get_occurrences_count (priv->search_context) > 0))
+      priv->search_index &&
+      (ide_source_search_index_get_occurrences_count (priv->search_index) > 0))
     {
       GdkWindow *window;
       GdkRGBA shadow;
@@ -6593,6 +6753,11 @@ ide_source_view_init (IdeSourceView *self)
                                    G_CALLBACK (ide_source_view__buffer_loaded_cb),
                                    self,
                                    G_CONNECT_SWAPPED);
+  egg_signal_group_connect_object (priv->buffer_signals,
+                                   "notify::large-file-mode",
+                                   G_CALLBACK (ide_source_view__buffer_notify_large_file_mode_cb),
+                                   self,
+                                   G_CONNECT_SWAPPED);
   egg_signal_group_connect_object (priv->buffer_signals,
                                    "notify::has-selection",
                                    G_CALLBACK (ide_source_view__buffer_notify_has_selection_cb),
@@ -7946,6 +8111,16 @@ _ide_source_view_get_scroll_mark (IdeSourceView *self)
   return priv->scroll_mark;
 }
 
+IdeSourceSearchIndex *
+_ide_source_view_get_search_index (IdeSourceView *self)
+{
+  IdeSourceViewPrivate *priv = ide_source_view_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_SOURCE_VIEW (self), NULL);
+
+  return priv->search_index;
+}
+
 /**
  * ide_source_view_get_current_snippet:
  *
@@ -0,0 +1,100 @@
+/* ide-trace-private.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_TRACE_PRIVATE_H
+#define IDE_TRACE_PRIVATE_H
+
+#include <glib.h>
+
+#include "ide-trace.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Layout of the shared memory segment used by the tracing backend.
+ *
+ *   +----------------+---------------------+------------------------+
+ *   | IdeTraceHeader | IdeTraceSite[sites] | rings[rings]           |
+ *   +----------------+---------------------+------------------------+
+ *
+ * Each ring is an IdeTraceRingHeader followed by ring_size records. A ring
+ * is owned by a single thread which is the only writer. Readers copy
+ * records between (head - ring_size) and head, and then re-read head to
+ * discard anything that was overwritten while copying.
+ */
+
+#define IDE_TRACE_NAME_FORMAT "/IdeTrace-%u"
+#define IDE_TRACE_MAGIC       0x49445452
+#define IDE_TRACE_MAX_SITES   8192
+#define IDE_TRACE_MAX_RINGS   64
+#define IDE_TRACE_RING_SIZE   8192
+
+typedef struct
+{
+  guint32 magic;
+  guint32 size;
+  guint32 max_sites;
+  guint32 max_rings;
+  guint32 ring_size;
+  guint32 sites_offset;
+  guint32 rings_offset;
+  guint32 n_sites;
+  gint32  pid;
+  gchar   padding [28];
+} IdeTraceHeader;
+
+typedef struct
+{
+  gchar   domain [24];
+  gchar   func [72];
+  gchar   detail [24];
+  guint32 line;
+  guint32 type;
+} IdeTraceSite;
+
+typedef struct
+{
+  gint64  time;
+  guint32 site;
+  guint32 type;
+} IdeTraceRecord;
+
+typedef struct
+{
+  volatile gint32  tid;
+  gchar            name [20];
+  gint64           head;
+  gchar            padding [32];
+} IdeTraceRingHeader;
+
+G_STATIC_ASSERT (sizeof (IdeTraceHeader) == 64);
+G_STATIC_ASSERT (sizeof (IdeTraceSite) == 128);
+G_STATIC_ASSERT (sizeof (IdeTraceRecord) == 16);
+G_STATIC_ASSERT (sizeof (IdeTraceRingHeader) == 64);
+
+#define IDE_TRACE_RING_BYTES \
+  (sizeof (IdeTraceRingHeader) + (sizeof (IdeTraceRecord) * IDE_TRACE_RING_SIZE))
+
+#define IDE_TRACE_SHM_SIZE                                  \
+  (sizeof (IdeTraceHeader) +                                \
+   (sizeof (IdeTraceSite) * IDE_TRACE_MAX_SITES) +          \
+   (IDE_TRACE_RING_BYTES * IDE_TRACE_MAX_RINGS))
+
+G_END_DECLS
+
+#endif /* IDE_TRACE_PRIVATE_H */
@@ -0,0 +1,352 @@
+/* ide-trace.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-trace"
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+# include <sys/prctl.h>
+# include <sys/syscall.h>
+#endif
+
+#include "ide-debug.h"
+#include "ide-log.h"
+#include "ide-trace.h"
+#include "ide-trace-private.h"
+
+/*
+ * The tracing backend behind IDE_ENTRY, IDE_EXIT, IDE_GOTO, IDE_RETURN and
+ * IDE_PROBE. Instead of formatting a log message for every event, each
+ * thread appends a fixed-size binary record to its own ring buffer. The
+ * rings live in a shared memory segment, much like EggCounterArena, so
+ * that tools/ide-dump-trace can read them from another process while
+ * Builder is running.
+ *
+ * Writers never take a lock. Registering a call site takes a lock, but
+ * that only happens the first time the site is reached.
+ */
+
+#define TRACE_MEMORY_BARRIER __sync_synchronize()
+
+#define RING_AT(i) \
+  ((IdeTraceRingHeader *)(gpointer)(trace_rings + ((i) * IDE_TRACE_RING_BYTES)))
+#define RING_RECORDS(ring) \
+  ((IdeTraceRecord *)(gpointer)(((guint8 *)(ring)) + sizeof (IdeTraceRingHeader)))
+
+static IdeTraceHeader *trace_header;
+static IdeTraceSite   *trace_sites;
+static guint8         *trace_rings;
+
+static __thread IdeTraceRingHeader *thread_ring;
+static __thread gboolean            thread_ring_failed;
+
+static void ide_trace_release_ring (gpointer data);
+
+static GPrivate ring_private = G_PRIVATE_INIT (ide_trace_release_ring);
+
+G_LOCK_DEFINE_STATIC (sites_lock);
+
+static gint
+ide_trace_get_thread (void)
+{
+  gint tid;
+
+#ifdef __linux__
+  tid = (gint) syscall (SYS_gettid);
+#else
+  tid = GPOINTER_TO_INT (g_thread_self ());
+#endif
+
+  /* Zero marks a free ring */
+  return tid ? tid : 1;
+}
+
+static void
+ide_trace_atexit (void)
+{
+  gchar name [32];
+
+  g_snprintf (name, sizeof name, IDE_TRACE_NAME_FORMAT, (guint)getpid ());
+  shm_unlink (name);
+}
+
+static gpointer
+ide_trace_map (void)
+{
+  gpointer mem;
+  gchar name [32];
+  gint fd;
+
+  if (getenv ("IDE_TRACE_DISABLE_SHM"))
+    goto use_malloc;
+
+  g_snprintf (name, sizeof name, IDE_TRACE_NAME_FORMAT, (guint)getpid ());
+
+  if (-1 == (fd = shm_open (name, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR|S_IRGRP)))
+    goto use_malloc;
+
+  /* ftruncate() zero-fills, and pages are only backed once touched */
+  if (-1 == ftruncate (fd, IDE_TRACE_SHM_SIZE))
+    goto failure;
+
+  mem = mmap (NULL, IDE_TRACE_SHM_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED)
+    goto failure;
+
+  close (fd);
+  atexit (ide_trace_atexit);
+
+  return mem;
+
+failure:
+  shm_unlink (name);
+  close (fd);
+
+use_malloc:
+  g_warning ("Failed to allocate shared memory for tracing. "
+             "Traces will not be available to external processes.");
+
+  return g_malloc0 (IDE_TRACE_SHM_SIZE);
+}
+
+static void
+ide_trace_init (void)
+{
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      IdeTraceHeader *header = ide_trace_map ();
+
+      header->magic = IDE_TRACE_MAGIC;
+      header->max_sites = IDE_TRACE_MAX_SITES;
+      header->max_rings = IDE_TRACE_MAX_RINGS;
+      header->ring_size = IDE_TRACE_RING_SIZE;
+      header->sites_offset = sizeof (IdeTraceHeader);
+      header->rings_offset = sizeof (IdeTraceHeader) + (sizeof (IdeTraceSite) * IDE_TRACE_MAX_SITES);
+      header->pid = getpid ();
+
+      trace_sites = (IdeTraceSite *)(gpointer)((guint8 *)header + header->sites_offset);
+      trace_rings = (guint8 *)header + header->rings_offset;
+
+      TRACE_MEMORY_BARRIER;
+
+      /* Readers check size last */
+      header->size = IDE_TRACE_SHM_SIZE;
+      trace_header = header;
+
+      g_once_init_leave (&initialized, TRUE);
+    }
+}
+
+static void
+ide_trace_release_ring (gpointer data)
+{
+  IdeTraceRingHeader *ring = data;
+
+  g_atomic_int_set (&ring->tid, 0);
+}
+
+static IdeTraceRingHeader *
+ide_trace_claim_ring (void)
+{
+  gint tid = ide_trace_get_thread ();
+  guint i;
+
+  for (i = 0; i < IDE_TRACE_MAX_RINGS; i++)
+    {
+      IdeTraceRingHeader *ring = RING_AT (i);
+
+      if (g_atomic_int_compare_and_exchange (&ring->tid, 0, tid))
+        {
+          ring->head = 0;
+          memset (ring->name, 0, sizeof ring->name);
+#ifdef __linux__
+          prctl (PR_GET_NAME, ring->name, 0, 0, 0);
+#endif
+          g_private_set (&ring_private, ring);
+          return ring;
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * ide_trace_register_site:
+ * @domain: (nullable): the log domain of the call site
+ * @func: the function name of the call site
+ * @line: the line number of the call site
+ * @type: the kind of event recorded at the call site
+ * @detail: (nullable): extra information such as a goto label
+ *
+ * Registers a tracing call site. This is used by the tracing macros in
+ * ide-debug.h and should not be called directly.
+ *
+ * Returns: the site identifier to pass to ide_trace_record(), or
+ *   %IDE_TRACE_SITE_INVALID if there is no room left for another site.
+ */
+guint
+ide_trace_register_site (const gchar  *domain,
+                         const gchar  *func,
+                         guint         line,
+                         IdeTraceType  type,
+                         const gchar  *detail)
+{
+  IdeTraceSite *site;
+  guint id;
+
+  ide_trace_init ();
+
+  G_LOCK (sites_lock);
+
+  id = trace_header->n_sites;
+
+  if (id >= IDE_TRACE_MAX_SITES)
+    {
+      G_UNLOCK (sites_lock);
+      return IDE_TRACE_SITE_INVALID;
+    }
+
+  site = &trace_sites [id];
+  g_strlcpy (site->domain, domain ? domain : "", sizeof site->domain);
+  g_strlcpy (site->func, func, sizeof site->func);
+  g_strlcpy (site->detail, detail ? detail : "", sizeof site->detail);
+  site->line = line;
+  site->type = type;
+
+  TRACE_MEMORY_BARRIER;
+
+  trace_header->n_sites = id + 1;
+
+  G_UNLOCK (sites_lock);
+
+  return id + 1;
+}
+
+static void
+ide_trace_log (const gchar  *domain,
+               const gchar  *func,
+               guint         line,
+               IdeTraceType  type,
+               const gchar  *detail)
+{
+  switch (type)
+    {
+    case IDE_TRACE_ENTRY:
+      g_log (domain, G_LOG_LEVEL_TRACE, "ENTRY: %s():%d", func, line);
+      break;
+
+    case IDE_TRACE_EXIT:
+      g_log (domain, G_LOG_LEVEL_TRACE, " EXIT: %s():%d", func, line);
+      break;
+
+    case IDE_TRACE_GOTO:
+      g_log (domain, G_LOG_LEVEL_TRACE, " GOTO: %s():%d (%s)", func, line, detail);
+      break;
+
+    case IDE_TRACE_PROBE:
+    default:
+      g_log (domain, G_LOG_LEVEL_TRACE, "PROBE: %s():%d", func, line);
+      break;
+    }
+}
+
+/**
+ * ide_trace_log_site:
+ * @domain: (nullable): the log domain of the call site
+ * @func: the function name of the call site
+ * @line: the line number of the call site
+ * @type: the kind of event at the call site
+ * @detail: (nullable): extra information such as a goto label
+ *
+ * Logs an event for a call site that could not be registered, because the
+ * site table is full. Nothing is written to the ring buffers.
+ */
+void
+ide_trace_log_site (const gchar  *domain,
+                    const gchar  *func,
+                    guint         line,
+                    IdeTraceType  type,
+                    const gchar  *detail)
+{
+  if (G_UNLIKELY (ide_log_get_verbosity () >= 4))
+    ide_trace_log (domain, func, line, type, detail ? detail : "");
+}
+
+/**
+ * ide_trace_record:
+ * @site: a site identifier from ide_trace_register_site()
+ *
+ * Appends an event for @site to the calling thread's ring buffer. If the
+ * log verbosity includes trace messages, the event is also logged.
+ */
+void
+ide_trace_record (guint site)
+{
+  IdeTraceRingHeader *ring;
+  IdeTraceRecord *record;
+  gint64 head;
+
+  if (G_UNLIKELY (site == 0 || site > IDE_TRACE_MAX_SITES))
+    return;
+
+  if (G_UNLIKELY (thread_ring == NULL))
+    {
+      if (thread_ring_failed)
+        goto log;
+
+      if (!(thread_ring = ide_trace_claim_ring ()))
+        {
+          thread_ring_failed = TRUE;
+          goto log;
+        }
+    }
+
+  ring = thread_ring;
+  head = ring->head;
+
+  record = &RING_RECORDS (ring) [head % IDE_TRACE_RING_SIZE];
+  record->time = g_get_monotonic_time ();
+  record->site = site;
+  record->type = trace_sites [site - 1].type;
+
+  TRACE_MEMORY_BARRIER;
+
+  ring->head = head + 1;
+
+log:
+  if (G_UNLIKELY (ide_log_get_verbosity () >= 4))
+    {
+      const IdeTraceSite *info = &trace_sites [site - 1];
+
+      ide_trace_log (info->domain [0] ? info->domain : NULL,
+                     info->func, info->line, info->type, info->detail);
+    }
+}
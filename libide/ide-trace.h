@@ -0,0 +1,73 @@
+/* ide-trace.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_TRACE_H
+#define IDE_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  IDE_TRACE_ENTRY  = 1,
+  IDE_TRACE_EXIT   = 2,
+  IDE_TRACE_PROBE  = 3,
+  IDE_TRACE_GOTO   = 4,
+} IdeTraceType;
+
+/* Returned by ide_trace_register_site() once every site slot is taken. */
+#define IDE_TRACE_SITE_INVALID G_MAXUINT
+
+guint ide_trace_register_site (const gchar  *domain,
+                               const gchar  *func,
+                               guint         line,
+                               IdeTraceType  type,
+                               const gchar  *detail);
+void  ide_trace_record        (guint         site);
+void  ide_trace_log_site      (const gchar  *domain,
+                               const gchar  *func,
+                               guint         line,
+                               IdeTraceType  type,
+                               const gchar  *detail);
+
+/*
+ * Each call site is registered once, the first time any thread reaches it,
+ * and then only its id is written to the calling thread's ring buffer.
+ * Sites that could not be registered are still logged.
+ */
+#define IDE_TRACE_RECORD(_type, _detail)                                  \
+  G_STMT_START {                                                          \
+    static gsize _ide_trace_site;                                         \
+    if (g_once_init_enter (&_ide_trace_site))                             \
+      g_once_init_leave (&_ide_trace_site,                                \
+                         ide_trace_register_site (G_LOG_DOMAIN,           \
+                                                  G_STRFUNC,              \
+                                                  __LINE__,               \
+                                                  _type,                  \
+                                                  _detail));              \
+    if (G_LIKELY (_ide_trace_site != IDE_TRACE_SITE_INVALID))             \
+      ide_trace_record ((guint)_ide_trace_site);                          \
+    else                                                                  \
+      ide_trace_log_site (G_LOG_DOMAIN, G_STRFUNC, __LINE__,              \
+                          _type, _detail);                                \
+  } G_STMT_END
+
+G_END_DECLS
+
+#endif /* IDE_TRACE_H */
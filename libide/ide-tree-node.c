@@ -164,6 +164,26 @@ ide_tree_node_append (IdeTreeNode *node,
   _ide_tree_append (node->tree, node, child);
 }
 
+/**
+ * ide_tree_node_append_all:
+ * @node: A #IdeTreeNode.
+ * @children: (element-type Ide.TreeNode): An array of #IdeTreeNode.
+ *
+ * Appends all of @children to the list of children owned by @node, in
+ * order. This is much faster than appending or inserting each child
+ * individually, so builders adding many children should sort them first
+ * and insert them using this function.
+ */
+void
+ide_tree_node_append_all (IdeTreeNode *node,
+                          GPtrArray   *children)
+{
+  g_return_if_fail (IDE_IS_TREE_NODE (node));
+  g_return_if_fail (children != NULL);
+
+  _ide_tree_append_all (node->tree, node, children);
+}
+
 /**
  * ide_tree_node_prepend:
  * @node: A #IdeTreeNode.
@@ -26,6 +26,8 @@ G_BEGIN_DECLS
 IdeTreeNode    *ide_tree_node_new                   (void);
 void            ide_tree_node_append                (IdeTreeNode            *node,
                                                      IdeTreeNode            *child);
+void            ide_tree_node_append_all            (IdeTreeNode            *node,
+                                                     GPtrArray              *children);
 void            ide_tree_node_insert_sorted         (IdeTreeNode            *node,
                                                      IdeTreeNode            *child,
                                                      IdeTreeNodeCompareFunc  compare_func,
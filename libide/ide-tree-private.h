@@ -35,6 +35,9 @@ void         _ide_tree_append                  (IdeTree        *self,
 void         _ide_tree_prepend                 (IdeTree        *self,
                                                 IdeTreeNode    *node,
                                                 IdeTreeNode    *child);
+void         _ide_tree_append_all              (IdeTree        *self,
+                                                IdeTreeNode    *node,
+                                                GPtrArray      *children);
 void         _ide_tree_insert_sorted           (IdeTree        *self,
                                                 IdeTreeNode    *node,
                                                 IdeTreeNode    *child,
@@ -551,6 +551,68 @@ ide_tree_add (IdeTree     *self,
   g_object_unref (child);
 }
 
+void
+_ide_tree_append_all (IdeTree     *self,
+                      IdeTreeNode *node,
+                      GPtrArray   *children)
+{
+  IdeTreePrivate *priv = ide_tree_get_instance_private (self);
+  GtkTreeIter *parentptr = NULL;
+  GtkTreeIter parent;
+  gboolean valid = TRUE;
+  guint i;
+
+  g_return_if_fail (IDE_IS_TREE (self));
+  g_return_if_fail (IDE_IS_TREE_NODE (node));
+  g_return_if_fail (children != NULL);
+
+  /*
+   * Resolve the parent iter once for the whole batch. Looking it up for each
+   * child, as ide_tree_add() does, is linear in the number of siblings.
+   */
+  if (node != priv->root)
+    {
+      valid = _ide_tree_get_iter (self, node, &parent);
+      parentptr = &parent;
+    }
+
+  for (i = 0; i < children->len; i++)
+    {
+      IdeTreeNode *child = g_ptr_array_index (children, i);
+      GtkTreeIter iter;
+
+      g_assert (IDE_IS_TREE_NODE (child));
+
+      g_object_ref_sink (child);
+
+      if (valid)
+        {
+          _ide_tree_node_set_tree (child, self);
+          _ide_tree_node_set_parent (child, node);
+
+          gtk_tree_store_insert_with_values (priv->store, &iter, parentptr, -1,
+                                             0, child,
+                                             -1);
+
+          if (ide_tree_node_get_children_possible (child))
+            {
+              IdeTreeNode *dummy = g_object_ref_sink (ide_tree_node_new ());
+              GtkTreeIter dummy_iter;
+
+              gtk_tree_store_insert_with_values (priv->store, &dummy_iter, &iter, -1,
+                                                 0, dummy,
+                                                 -1);
+              g_object_unref (dummy);
+            }
+
+          if (node == priv->root)
+            _ide_tree_build_node (self, child);
+        }
+
+      g_object_unref (child);
+    }
+}
+
 void
 _ide_tree_insert_sorted (IdeTree                *self,
                          IdeTreeNode            *node,
@@ -35,6 +35,8 @@ typedef struct _IdeBufferChangeMonitor         IdeBufferChangeMonitor;
 
 typedef struct _IdeBufferManager               IdeBufferManager;
 
+typedef struct _IdeBufferSnapshot              IdeBufferSnapshot;
+
 typedef struct _IdeBuilder                     IdeBuilder;
 
 typedef struct _IdeBuildResult                 IdeBuildResult;
@@ -0,0 +1,1197 @@
+/* ide-word-completion-provider.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-word-completion-provider"
+
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "egg-counter.h"
+
+#include "ide-buffer.h"
+#include "ide-buffer-snapshot.h"
+#include "ide-completion-provider.h"
+#include "ide-context.h"
+#include "ide-debug.h"
+#include "ide-internal.h"
+#include "ide-macros.h"
+#include "ide-vcs.h"
+#include "ide-word-completion-provider.h"
+
+#include "trie.h"
+
+/*
+ * Words shorter than WORD_MIN_LEN are cheaper to type than to pick from a
+ * list, and very long words are almost always generated data.
+ */
+#define WORD_MIN_LEN        3
+#define WORD_MAX_LEN        64
+#define PREFIX_MIN_LEN      2
+
+/*
+ * Project words stop being added once the index holds this many distinct
+ * words. Words from open buffers are not subject to it, so they are always
+ * proposed no matter how large the project is.
+ */
+#define MAX_WORDS           50000
+#define MAX_RESULTS         50
+
+#define INDEX_MAX_FILE_SIZE (256 * 1024)
+#define INDEX_MAX_BYTES     (64 * 1024 * 1024)
+#define MERGE_BATCH_SIZE    2000
+
+typedef struct
+{
+  GStringChunk *strings;
+  GHashTable   *counts;
+} WordCounts;
+
+struct _IdeWordCompletionProvider
+{
+  IdeObject       parent_instance;
+
+  /*
+   * Maps a word to the number of times it has been seen, stored directly as
+   * the value of the trie node. Open buffers are counted on top of their
+   * on-disk contents, which favors words near what the user is working on.
+   */
+  Trie           *words;
+  guint           n_words;
+
+  /* IdeBuffer to BufferState for every registered buffer. */
+  GHashTable     *buffers;
+
+  GSettings      *settings;
+  GCancellable   *cancellable;
+
+  /* Project word counts being merged into @words from an idle callback. */
+  WordCounts     *merge;
+  GHashTableIter  merge_iter;
+  guint           merge_handler;
+
+  guint           loaded : 1;
+  guint           indexed : 1;
+};
+
+typedef struct
+{
+  IdeWordCompletionProvider *self;
+  IdeBuffer                 *buffer;
+  GHashTable                *words;
+  gint                       delta;
+  guint                      line;
+  guint                      scanning : 1;
+} BufferState;
+
+typedef struct
+{
+  IdeVcs     *vcs;
+  GFile      *directory;
+  WordCounts *counts;
+  gsize       n_bytes;
+} IndexState;
+
+typedef struct
+{
+  gchar *word;
+  guint  count;
+} Candidate;
+
+typedef struct
+{
+  const gchar *word;
+  GArray      *candidates;
+} Populate;
+
+typedef void (*WordFunc) (const gchar *word,
+                          gpointer     user_data);
+
+static void provider_iface_init  (GtkSourceCompletionProviderIface *iface);
+static void buffer_state_rescan  (BufferState                      *state);
+
+G_DEFINE_TYPE_WITH_CODE (IdeWordCompletionProvider,
+                         ide_word_completion_provider,
+                         IDE_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GTK_SOURCE_TYPE_COMPLETION_PROVIDER, provider_iface_init)
+                         G_IMPLEMENT_INTERFACE (IDE_TYPE_COMPLETION_PROVIDER, NULL))
+
+EGG_DEFINE_COUNTER (Words, "IdeWordCompletionProvider", "Words",
+                    "The number of distinct words in the word completion index.")
+
+static inline gboolean
+is_word_char (guchar ch)
+{
+  /* Bytes of multi-byte characters are treated as part of the word. */
+  return g_ascii_isalnum (ch) || ch == '_' || ch >= 0x80;
+}
+
+static void
+foreach_word (const gchar *text,
+              gsize        len,
+              WordFunc     func,
+              gpointer     user_data)
+{
+  gchar word [WORD_MAX_LEN + 1];
+  const gchar *end = text + len;
+  const gchar *iter = text;
+
+  while (iter < end)
+    {
+      const gchar *begin;
+      gsize word_len;
+
+      if (!is_word_char (*iter))
+        {
+          iter++;
+          continue;
+        }
+
+      begin = iter;
+
+      while (iter < end && is_word_char (*iter))
+        iter++;
+
+      word_len = iter - begin;
+
+      if (word_len < WORD_MIN_LEN || word_len > WORD_MAX_LEN || g_ascii_isdigit (*begin))
+        continue;
+
+      memcpy (word, begin, word_len);
+      word [word_len] = '\0';
+
+      func (word, user_data);
+    }
+}
+
+static WordCounts *
+word_counts_new (void)
+{
+  WordCounts *counts;
+
+  counts = g_slice_new0 (WordCounts);
+  counts->strings = g_string_chunk_new (16 * 1024);
+  counts->counts = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return counts;
+}
+
+static void
+word_counts_free (gpointer data)
+{
+  WordCounts *counts = data;
+
+  g_clear_pointer (&counts->counts, g_hash_table_unref);
+  g_clear_pointer (&counts->strings, g_string_chunk_free);
+  g_slice_free (WordCounts, counts);
+}
+
+static void
+word_counts_add (const gchar *word,
+                 gpointer     user_data)
+{
+  WordCounts *counts = user_data;
+  gpointer key;
+  gpointer value;
+
+  if (g_hash_table_lookup_extended (counts->counts, word, &key, &value))
+    {
+      g_hash_table_insert (counts->counts, key, GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + 1));
+      return;
+    }
+
+  if (g_hash_table_size (counts->counts) >= MAX_WORDS)
+    return;
+
+  key = g_string_chunk_insert (counts->strings, word);
+  g_hash_table_insert (counts->counts, key, GUINT_TO_POINTER (1));
+}
+
+static void
+ide_word_completion_provider_adjust (IdeWordCompletionProvider *self,
+                                     const gchar               *word,
+                                     gint                       delta)
+{
+  guint count;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (word != NULL);
+
+  count = GPOINTER_TO_UINT (trie_lookup (self->words, word));
+
+  if (delta > 0)
+    {
+      if (count == 0)
+        {
+          self->n_words++;
+          EGG_COUNTER_INC (Words);
+        }
+
+      trie_insert (self->words, word, GUINT_TO_POINTER (count + delta));
+    }
+  else if (count > 0)
+    {
+      if (count <= (guint)-delta)
+        {
+          trie_remove (self->words, word);
+          self->n_words--;
+          EGG_COUNTER_DEC (Words);
+        }
+      else
+        {
+          trie_insert (self->words, word, GUINT_TO_POINTER (count + delta));
+        }
+    }
+}
+
+void
+_ide_word_completion_provider_add_project_word (IdeWordCompletionProvider *self,
+                                                const gchar               *word,
+                                                guint                      count)
+{
+  g_return_if_fail (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_return_if_fail (word != NULL);
+  g_return_if_fail (count > 0);
+
+  /*
+   * Only project words are capped, and only new ones. Buffer words always
+   * get in, so what the user is typing is proposed even once the project
+   * scan has filled the index.
+   */
+  if (self->n_words >= MAX_WORDS && trie_lookup (self->words, word) == NULL)
+    return;
+
+  ide_word_completion_provider_adjust (self, word, count);
+}
+
+static void
+buffer_state_free (gpointer data)
+{
+  BufferState *state = data;
+
+  g_clear_pointer (&state->words, g_hash_table_unref);
+  g_slice_free (BufferState, state);
+}
+
+static gboolean
+buffer_state_is_tracking (BufferState *state)
+{
+  /*
+   * While loading, the contents are replaced wholesale and we rescan once
+   * the buffer has loaded. While scanning, the worker result will include
+   * the edit (or be discarded because the change count moved).
+   */
+  return !state->scanning && !_ide_buffer_get_loading (state->buffer);
+}
+
+static void
+buffer_state_adjust_word (const gchar *word,
+                          gpointer     user_data)
+{
+  BufferState *state = user_data;
+  guint count;
+
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (state->words, word));
+
+  if (state->delta > 0)
+    g_hash_table_insert (state->words, g_strdup (word), GUINT_TO_POINTER (count + 1));
+  else if (count > 1)
+    g_hash_table_insert (state->words, g_strdup (word), GUINT_TO_POINTER (count - 1));
+  else if (count == 1)
+    g_hash_table_remove (state->words, word);
+  else
+    return;
+
+  ide_word_completion_provider_adjust (state->self, word, state->delta);
+}
+
+static void
+buffer_state_adjust_lines (BufferState *state,
+                           guint        first_line,
+                           guint        last_line,
+                           gint         delta)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  g_assert (state != NULL);
+  g_assert (first_line <= last_line);
+
+  gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (state->buffer), &begin, first_line);
+  gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (state->buffer), &end, last_line);
+
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  text = gtk_text_iter_get_text (&begin, &end);
+
+  state->delta = delta;
+  foreach_word (text, strlen (text), buffer_state_adjust_word, state);
+}
+
+static void
+buffer_state_insert_text (GtkTextBuffer *buffer,
+                          GtkTextIter   *location,
+                          const gchar   *text,
+                          gint           len,
+                          BufferState   *state)
+{
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (location != NULL);
+  g_assert (state != NULL);
+
+  /*
+   * Remove the words of the line we are about to modify, and add back the
+   * words of every line touched once the text has been inserted. This keeps
+   * the per-edit cost proportional to the size of the edit.
+   */
+  if (buffer_state_is_tracking (state))
+    {
+      state->line = gtk_text_iter_get_line (location);
+      buffer_state_adjust_lines (state, state->line, state->line, -1);
+    }
+}
+
+static void
+buffer_state_insert_text_after (GtkTextBuffer *buffer,
+                                GtkTextIter   *location,
+                                const gchar   *text,
+                                gint           len,
+                                BufferState   *state)
+{
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (location != NULL);
+  g_assert (state != NULL);
+
+  if (buffer_state_is_tracking (state))
+    buffer_state_adjust_lines (state, state->line, gtk_text_iter_get_line (location), 1);
+}
+
+static void
+buffer_state_delete_range (GtkTextBuffer *buffer,
+                           GtkTextIter   *begin,
+                           GtkTextIter   *end,
+                           BufferState   *state)
+{
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (begin != NULL);
+  g_assert (end != NULL);
+  g_assert (state != NULL);
+
+  /* GtkTextBuffer orders @begin and @end before emitting the signal. */
+  if (buffer_state_is_tracking (state))
+    buffer_state_adjust_lines (state,
+                               gtk_text_iter_get_line (begin),
+                               gtk_text_iter_get_line (end),
+                               -1);
+}
+
+static void
+buffer_state_delete_range_after (GtkTextBuffer *buffer,
+                                 GtkTextIter   *begin,
+                                 GtkTextIter   *end,
+                                 BufferState   *state)
+{
+  guint line;
+
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (begin != NULL);
+  g_assert (end != NULL);
+  g_assert (state != NULL);
+
+  if (buffer_state_is_tracking (state))
+    {
+      line = gtk_text_iter_get_line (begin);
+      buffer_state_adjust_lines (state, line, line, 1);
+    }
+}
+
+static void
+ide_word_completion_provider_scan_buffer_worker (GTask        *task,
+                                                 gpointer      source_object,
+                                                 gpointer      task_data,
+                                                 GCancellable *cancellable)
+{
+  IdeBufferSnapshot *snapshot = task_data;
+  g_autoptr(GBytes) bytes = NULL;
+  WordCounts *counts;
+  const gchar *data;
+  gsize len;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (source_object));
+  g_assert (snapshot != NULL);
+
+  bytes = ide_buffer_snapshot_get_bytes (snapshot);
+  data = g_bytes_get_data (bytes, &len);
+
+  counts = word_counts_new ();
+  foreach_word (data, len, word_counts_add, counts);
+
+  g_task_return_pointer (task, counts, word_counts_free);
+}
+
+static void
+ide_word_completion_provider_scan_buffer_cb (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)object;
+  g_autoptr(IdeBuffer) buffer = user_data;
+  IdeBufferSnapshot *snapshot;
+  GHashTableIter iter;
+  BufferState *state;
+  WordCounts *counts;
+  gpointer key;
+  gpointer value;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (G_IS_TASK (result));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  counts = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  if (counts == NULL)
+    return;
+
+  state = g_hash_table_lookup (self->buffers, buffer);
+  snapshot = g_task_get_task_data (G_TASK (result));
+
+  if (state == NULL || !state->scanning)
+    {
+      word_counts_free (counts);
+      return;
+    }
+
+  state->scanning = FALSE;
+
+  /*
+   * Edits made while we were scanning were not tracked, so if the buffer
+   * moved on we need to scan the new contents instead.
+   */
+  if (ide_buffer_snapshot_get_change_count (snapshot) != ide_buffer_get_change_count (buffer))
+    {
+      word_counts_free (counts);
+      buffer_state_rescan (state);
+      return;
+    }
+
+  g_hash_table_iter_init (&iter, counts->counts);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_hash_table_insert (state->words, g_strdup (key), value);
+      ide_word_completion_provider_adjust (self, key, GPOINTER_TO_UINT (value));
+    }
+
+  word_counts_free (counts);
+}
+
+static void
+buffer_state_remove_words (BufferState *state)
+{
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_assert (state != NULL);
+
+  g_hash_table_iter_init (&iter, state->words);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    ide_word_completion_provider_adjust (state->self, key, -(gint)GPOINTER_TO_UINT (value));
+
+  g_hash_table_remove_all (state->words);
+}
+
+static void
+buffer_state_rescan (BufferState *state)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (state != NULL);
+
+  if (state->scanning)
+    return;
+
+  buffer_state_remove_words (state);
+
+  state->scanning = TRUE;
+
+  task = g_task_new (state->self,
+                     state->self->cancellable,
+                     ide_word_completion_provider_scan_buffer_cb,
+                     g_object_ref (state->buffer));
+  g_task_set_task_data (task,
+                        ide_buffer_get_snapshot (state->buffer),
+                        (GDestroyNotify)ide_buffer_snapshot_unref);
+  g_task_run_in_thread (task, ide_word_completion_provider_scan_buffer_worker);
+}
+
+static void
+index_state_free (gpointer data)
+{
+  IndexState *state = data;
+
+  g_clear_object (&state->vcs);
+  g_clear_object (&state->directory);
+  g_clear_pointer (&state->counts, word_counts_free);
+  g_slice_free (IndexState, state);
+}
+
+static void
+index_file (IndexState   *state,
+            GFile        *file,
+            GCancellable *cancellable)
+{
+  g_autofree gchar *contents = NULL;
+  gsize len;
+
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (file));
+
+  if (!g_file_load_contents (file, cancellable, &contents, &len, NULL, NULL))
+    return;
+
+  state->n_bytes += len;
+
+  /* Skip anything that does not look like text. */
+  if (memchr (contents, '\0', len) != NULL || !g_utf8_validate (contents, len, NULL))
+    return;
+
+  foreach_word (contents, len, word_counts_add, state->counts);
+}
+
+static void
+index_directory (IndexState   *state,
+                 GFile        *directory,
+                 GCancellable *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  gpointer file_info_ptr;
+
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (ide_vcs_is_ignored (state->vcs, directory, NULL))
+    return;
+
+  enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                          G_FILE_ATTRIBUTE_STANDARD_TYPE","
+                                          G_FILE_ATTRIBUTE_STANDARD_SIZE","
+                                          G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable,
+                                          NULL);
+
+  if (enumerator == NULL)
+    return;
+
+  while (state->n_bytes < INDEX_MAX_BYTES &&
+         (file_info_ptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    {
+      g_autoptr(GFileInfo) file_info = file_info_ptr;
+      g_autoptr(GFile) file = NULL;
+      GFileType file_type;
+
+      if (g_file_info_get_is_hidden (file_info))
+        continue;
+
+      file = g_file_get_child (directory, g_file_info_get_name (file_info));
+      file_type = g_file_info_get_file_type (file_info);
+
+      if (file_type == G_FILE_TYPE_DIRECTORY)
+        index_directory (state, file, cancellable);
+      else if (file_type == G_FILE_TYPE_REGULAR &&
+               g_file_info_get_size (file_info) <= INDEX_MAX_FILE_SIZE &&
+               !ide_vcs_is_ignored (state->vcs, file, NULL))
+        index_file (state, file, cancellable);
+    }
+}
+
+static void
+ide_word_completion_provider_index_worker (GTask        *task,
+                                           gpointer      source_object,
+                                           gpointer      task_data,
+                                           GCancellable *cancellable)
+{
+  IndexState *state = task_data;
+  WordCounts *counts;
+  GTimer *timer;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (source_object));
+  g_assert (state != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  timer = g_timer_new ();
+
+  index_directory (state, state->directory, cancellable);
+
+  g_debug ("Indexed %"G_GSIZE_FORMAT" bytes of project words in %lf seconds",
+           state->n_bytes, g_timer_elapsed (timer, NULL));
+  g_timer_destroy (timer);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  counts = state->counts;
+  state->counts = NULL;
+
+  g_task_return_pointer (task, counts, word_counts_free);
+}
+
+static gboolean
+ide_word_completion_provider_merge_cb (gpointer user_data)
+{
+  IdeWordCompletionProvider *self = user_data;
+  gpointer key;
+  gpointer value;
+  guint i;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (self->merge != NULL);
+
+  for (i = 0; i < MERGE_BATCH_SIZE; i++)
+    {
+      if (!g_hash_table_iter_next (&self->merge_iter, &key, &value))
+        {
+          g_clear_pointer (&self->merge, word_counts_free);
+          self->merge_handler = 0;
+          return G_SOURCE_REMOVE;
+        }
+
+      _ide_word_completion_provider_add_project_word (self, key, GPOINTER_TO_UINT (value));
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+ide_word_completion_provider_index_cb (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)object;
+  WordCounts *counts;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (G_IS_TASK (result));
+
+  counts = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  if (counts == NULL)
+    IDE_EXIT;
+
+  g_assert (self->merge == NULL);
+
+  /*
+   * Merge into the trie in small batches so that large projects do not
+   * stall the main loop.
+   */
+  self->merge = counts;
+  g_hash_table_iter_init (&self->merge_iter, counts->counts);
+  self->merge_handler = g_idle_add_full (G_PRIORITY_LOW,
+                                         ide_word_completion_provider_merge_cb,
+                                         self,
+                                         NULL);
+
+  IDE_EXIT;
+}
+
+static void
+ide_word_completion_provider_index_project (IdeWordCompletionProvider *self)
+{
+  g_autoptr(GTask) task = NULL;
+  IndexState *state;
+  IdeContext *context;
+  IdeVcs *vcs;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+
+  if (self->indexed || !self->loaded)
+    IDE_EXIT;
+
+  if (!g_settings_get_boolean (self->settings, "word-completion"))
+    IDE_EXIT;
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+
+  self->indexed = TRUE;
+
+  state = g_slice_new0 (IndexState);
+  state->vcs = g_object_ref (vcs);
+  state->directory = g_object_ref (ide_vcs_get_working_directory (vcs));
+  state->counts = word_counts_new ();
+
+  task = g_task_new (self, self->cancellable, ide_word_completion_provider_index_cb, NULL);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+  g_task_set_task_data (task, state, index_state_free);
+  g_task_run_in_thread (task, ide_word_completion_provider_index_worker);
+
+  IDE_EXIT;
+}
+
+static void
+ide_word_completion_provider_context_loaded (IdeWordCompletionProvider *self,
+                                             IdeContext                *context)
+{
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (IDE_IS_CONTEXT (context));
+
+  self->loaded = TRUE;
+
+  ide_word_completion_provider_index_project (self);
+}
+
+static void
+ide_word_completion_provider_constructed (GObject *object)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)object;
+  IdeContext *context;
+
+  G_OBJECT_CLASS (ide_word_completion_provider_parent_class)->constructed (object);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+
+  g_signal_connect_object (context,
+                           "loaded",
+                           G_CALLBACK (ide_word_completion_provider_context_loaded),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  /* Defer indexing the project until word completion is enabled. */
+  g_signal_connect_object (self->settings,
+                           "changed::word-completion",
+                           G_CALLBACK (ide_word_completion_provider_index_project),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static void
+ide_word_completion_provider_dispose (GObject *object)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)object;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_cancellable_cancel (self->cancellable);
+
+  ide_clear_source (&self->merge_handler);
+  g_clear_pointer (&self->merge, word_counts_free);
+
+  g_hash_table_iter_init (&iter, self->buffers);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_signal_handlers_disconnect_by_data (key, value);
+
+  g_hash_table_remove_all (self->buffers);
+
+  G_OBJECT_CLASS (ide_word_completion_provider_parent_class)->dispose (object);
+}
+
+static void
+ide_word_completion_provider_finalize (GObject *object)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)object;
+
+  g_clear_pointer (&self->words, trie_destroy);
+  g_clear_pointer (&self->buffers, g_hash_table_unref);
+  g_clear_object (&self->settings);
+  g_clear_object (&self->cancellable);
+
+  EGG_COUNTER_SUB (Words, self->n_words);
+
+  G_OBJECT_CLASS (ide_word_completion_provider_parent_class)->finalize (object);
+}
+
+static void
+ide_word_completion_provider_class_init (IdeWordCompletionProviderClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = ide_word_completion_provider_constructed;
+  object_class->dispose = ide_word_completion_provider_dispose;
+  object_class->finalize = ide_word_completion_provider_finalize;
+}
+
+static void
+ide_word_completion_provider_init (IdeWordCompletionProvider *self)
+{
+  self->words = trie_new (NULL);
+  self->buffers = g_hash_table_new_full (NULL, NULL, NULL, buffer_state_free);
+  self->settings = g_settings_new ("org.gnome.builder.code-insight");
+  self->cancellable = g_cancellable_new ();
+}
+
+IdeWordCompletionProvider *
+ide_word_completion_provider_new (IdeContext *context)
+{
+  g_return_val_if_fail (IDE_IS_CONTEXT (context), NULL);
+
+  return g_object_new (IDE_TYPE_WORD_COMPLETION_PROVIDER,
+                       "context", context,
+                       NULL);
+}
+
+/**
+ * ide_word_completion_provider_register_buffer:
+ *
+ * Starts tracking the words of @buffer. The initial contents are scanned
+ * from a snapshot on a worker thread, after which the index is updated
+ * from the regions touched by each insertion and deletion.
+ */
+void
+ide_word_completion_provider_register_buffer (IdeWordCompletionProvider *self,
+                                              IdeBuffer                 *buffer)
+{
+  BufferState *state;
+
+  g_return_if_fail (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_return_if_fail (IDE_IS_BUFFER (buffer));
+
+  if (g_hash_table_contains (self->buffers, buffer))
+    return;
+
+  state = g_slice_new0 (BufferState);
+  state->self = self;
+  state->buffer = buffer;
+  state->words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_hash_table_insert (self->buffers, buffer, state);
+
+  g_signal_connect (buffer,
+                    "insert-text",
+                    G_CALLBACK (buffer_state_insert_text),
+                    state);
+  g_signal_connect_after (buffer,
+                          "insert-text",
+                          G_CALLBACK (buffer_state_insert_text_after),
+                          state);
+  g_signal_connect (buffer,
+                    "delete-range",
+                    G_CALLBACK (buffer_state_delete_range),
+                    state);
+  g_signal_connect_after (buffer,
+                          "delete-range",
+                          G_CALLBACK (buffer_state_delete_range_after),
+                          state);
+  g_signal_connect_swapped (buffer,
+                            "loaded",
+                            G_CALLBACK (buffer_state_rescan),
+                            state);
+
+  buffer_state_rescan (state);
+}
+
+/**
+ * ide_word_completion_provider_cancel:
+ * @self: An #IdeWordCompletionProvider
+ *
+ * Cancels the background scan of the project. The scan holds a reference
+ * to @self, so the owner must call this when it is done with the provider.
+ */
+void
+ide_word_completion_provider_cancel (IdeWordCompletionProvider *self)
+{
+  g_return_if_fail (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+
+  g_cancellable_cancel (self->cancellable);
+}
+
+void
+ide_word_completion_provider_unregister_buffer (IdeWordCompletionProvider *self,
+                                                IdeBuffer                 *buffer)
+{
+  BufferState *state;
+
+  g_return_if_fail (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_return_if_fail (IDE_IS_BUFFER (buffer));
+
+  if (!(state = g_hash_table_lookup (self->buffers, buffer)))
+    return;
+
+  g_signal_handlers_disconnect_by_data (buffer, state);
+  buffer_state_remove_words (state);
+  g_hash_table_remove (self->buffers, buffer);
+}
+
+static void
+candidate_clear (gpointer data)
+{
+  Candidate *candidate = data;
+
+  g_clear_pointer (&candidate->word, g_free);
+}
+
+static gint
+candidate_compare (gconstpointer a,
+                   gconstpointer b)
+{
+  const Candidate *ca = a;
+  const Candidate *cb = b;
+  gsize len_a;
+  gsize len_b;
+
+  if (ca->count != cb->count)
+    return ca->count > cb->count ? -1 : 1;
+
+  len_a = strlen (ca->word);
+  len_b = strlen (cb->word);
+
+  if (len_a != len_b)
+    return len_a < len_b ? -1 : 1;
+
+  return strcmp (ca->word, cb->word);
+}
+
+/*
+ * populate->candidates is a binary heap of at most MAX_RESULTS entries with
+ * the worst ranked candidate at the root, so every match can be considered
+ * while only the best ones are kept.
+ */
+static void
+candidates_sift_up (GArray *heap,
+                    guint   pos)
+{
+  Candidate *data = (Candidate *)(gpointer)heap->data;
+
+  while (pos > 0)
+    {
+      guint parent = (pos - 1) / 2;
+      Candidate tmp;
+
+      if (candidate_compare (&data [parent], &data [pos]) >= 0)
+        break;
+
+      tmp = data [parent];
+      data [parent] = data [pos];
+      data [pos] = tmp;
+      pos = parent;
+    }
+}
+
+static void
+candidates_sift_down (GArray *heap,
+                      guint   pos)
+{
+  Candidate *data = (Candidate *)(gpointer)heap->data;
+
+  for (;;)
+    {
+      guint worst = pos;
+      guint left = pos * 2 + 1;
+      guint right = pos * 2 + 2;
+      Candidate tmp;
+
+      if (left < heap->len && candidate_compare (&data [left], &data [worst]) > 0)
+        worst = left;
+
+      if (right < heap->len && candidate_compare (&data [right], &data [worst]) > 0)
+        worst = right;
+
+      if (worst == pos)
+        break;
+
+      tmp = data [worst];
+      data [worst] = data [pos];
+      data [pos] = tmp;
+      pos = worst;
+    }
+}
+
+static gboolean
+collect_candidate (Trie        *trie,
+                   const gchar *key,
+                   gpointer     value,
+                   gpointer     user_data)
+{
+  Populate *populate = user_data;
+  GArray *heap = populate->candidates;
+  Candidate candidate;
+
+  /* The word being typed is in the index too, but is not interesting. */
+  if (g_str_equal (key, populate->word))
+    return FALSE;
+
+  candidate.word = (gchar *)key;
+  candidate.count = GPOINTER_TO_UINT (value);
+
+  if (heap->len < MAX_RESULTS)
+    {
+      candidate.word = g_strdup (key);
+      g_array_append_val (heap, candidate);
+      candidates_sift_up (heap, heap->len - 1);
+    }
+  else if (candidate_compare (&candidate, &g_array_index (heap, Candidate, 0)) < 0)
+    {
+      Candidate *root = &g_array_index (heap, Candidate, 0);
+
+      g_free (root->word);
+      root->word = g_strdup (key);
+      root->count = candidate.count;
+      candidates_sift_down (heap, 0);
+    }
+
+  return FALSE;
+}
+
+static GArray *
+ide_word_completion_provider_collect (IdeWordCompletionProvider *self,
+                                      const gchar               *word)
+{
+  Populate populate;
+  GArray *candidates;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (word != NULL);
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (Candidate));
+  g_array_set_clear_func (candidates, candidate_clear);
+
+  /*
+   * Rank every word sharing the prefix by how often it occurs, keeping the
+   * best MAX_RESULTS in a heap. Shorter words win ties since they are more
+   * likely to be the stem of the longer ones.
+   */
+  populate.word = word;
+  populate.candidates = candidates;
+  trie_traverse (self->words, word, G_PRE_ORDER, G_TRAVERSE_LEAVES, -1,
+                 collect_candidate, &populate);
+
+  g_array_sort (candidates, candidate_compare);
+
+  return candidates;
+}
+
+gchar **
+_ide_word_completion_provider_complete (IdeWordCompletionProvider *self,
+                                        const gchar               *prefix)
+{
+  g_autoptr(GArray) candidates = NULL;
+  GPtrArray *ar;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_WORD_COMPLETION_PROVIDER (self), NULL);
+  g_return_val_if_fail (prefix != NULL, NULL);
+
+  candidates = ide_word_completion_provider_collect (self, prefix);
+  ar = g_ptr_array_new ();
+
+  for (i = 0; i < candidates->len; i++)
+    g_ptr_array_add (ar, g_strdup (g_array_index (candidates, Candidate, i).word));
+  g_ptr_array_add (ar, NULL);
+
+  return (gchar **)g_ptr_array_free (ar, FALSE);
+}
+
+static gchar *
+ide_word_completion_provider_get_name (GtkSourceCompletionProvider *provider)
+{
+  return g_strdup (_("Words"));
+}
+
+static gboolean
+ide_word_completion_provider_match (GtkSourceCompletionProvider *provider,
+                                    GtkSourceCompletionContext  *context)
+{
+  GtkSourceCompletionActivation activation;
+  GtkTextIter iter;
+  gunichar ch;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (provider));
+  g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (context));
+
+  if (!gtk_source_completion_context_get_iter (context, &iter))
+    return FALSE;
+
+  activation = gtk_source_completion_context_get_activation (context);
+
+  if (activation == GTK_SOURCE_COMPLETION_ACTIVATION_INTERACTIVE)
+    {
+      if (gtk_text_iter_starts_line (&iter) || !gtk_text_iter_backward_char (&iter))
+        return FALSE;
+
+      ch = gtk_text_iter_get_char (&iter);
+
+      if (!g_unichar_isalnum (ch) && ch != '_')
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+ide_word_completion_provider_populate (GtkSourceCompletionProvider *provider,
+                                       GtkSourceCompletionContext  *context)
+{
+  IdeWordCompletionProvider *self = (IdeWordCompletionProvider *)provider;
+  g_autofree gchar *word = NULL;
+  g_autoptr(GArray) candidates = NULL;
+  GList *list = NULL;
+  guint i;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_WORD_COMPLETION_PROVIDER (self));
+  g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (context));
+
+  word = ide_completion_provider_context_current_word (context);
+
+  if (word == NULL || strlen (word) < PREFIX_MIN_LEN)
+    {
+      gtk_source_completion_context_add_proposals (context, provider, NULL, TRUE);
+      IDE_EXIT;
+    }
+
+  candidates = ide_word_completion_provider_collect (self, word);
+
+  for (i = candidates->len; i > 0; i--)
+    {
+      const Candidate *candidate = &g_array_index (candidates, Candidate, i - 1);
+      GtkSourceCompletionItem *item;
+
+      item = g_object_new (GTK_SOURCE_TYPE_COMPLETION_ITEM,
+                           "label", candidate->word,
+                           "text", candidate->word,
+                           NULL);
+      list = g_list_prepend (list, item);
+    }
+
+  gtk_source_completion_context_add_proposals (context, provider, list, TRUE);
+
+  g_list_free_full (list, g_object_unref);
+
+  IDE_EXIT;
+}
+
+static void
+provider_iface_init (GtkSourceCompletionProviderIface *iface)
+{
+  iface->get_name = ide_word_completion_provider_get_name;
+  iface->match = ide_word_completion_provider_match;
+  iface->populate = ide_word_completion_provider_populate;
+}
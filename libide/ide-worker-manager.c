@@ -21,6 +21,7 @@
 #include <gio/gio.h>
 #include <gio/gunixsocketaddress.h>
 #include <glib/gi18n.h>
+#include <libpeas/peas.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -36,9 +37,17 @@ struct _IdeWorkerManager
   GObject      parent_instance;
 
   GDBusServer *dbus_server;
-  GHashTable  *plugin_name_to_worker;
+  GHashTable  *plugin_name_to_pool;
 };
 
+/*
+ * Each worker plugin gets a pool of processes. A plugin may request more
+ * than one process with "X-Worker-Pool-Size=N" in its .plugin file, which
+ * is capped at the number of processors. Processes are spawned lazily as
+ * proxies are requested, and each request is given the process with the
+ * fewest live proxies.
+ */
+
 G_DEFINE_TYPE (IdeWorkerManager, ide_worker_manager, G_TYPE_OBJECT)
 
 EGG_DEFINE_COUNTER (instances, "IdeWorkerManager", "Instances", "Number of IdeWorkerManager instances")
@@ -64,16 +73,22 @@ ide_worker_manager_new_connection_cb (IdeWorkerManager *self,
   if ((credentials == NULL) || (-1 == g_credentials_get_unix_pid (credentials, NULL)))
     IDE_RETURN (FALSE);
 
-  g_hash_table_iter_init (&iter, self->plugin_name_to_worker);
+  g_hash_table_iter_init (&iter, self->plugin_name_to_pool);
 
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
-      IdeWorkerProcess *process = value;
+      GPtrArray *pool = value;
+      guint i;
 
-      if (ide_worker_process_matches_credentials (process, credentials))
+      for (i = 0; i < pool->len; i++)
         {
-          ide_worker_process_set_connection (process, connection);
-          IDE_RETURN (TRUE);
+          IdeWorkerProcess *process = g_ptr_array_index (pool, i);
+
+          if (ide_worker_process_matches_credentials (process, credentials))
+            {
+              ide_worker_process_set_connection (process, connection);
+              IDE_RETURN (TRUE);
+            }
         }
     }
 
@@ -155,7 +170,7 @@ ide_worker_manager_finalize (GObject *object)
 {
   IdeWorkerManager *self = (IdeWorkerManager *)object;
 
-  g_clear_pointer (&self->plugin_name_to_worker, g_hash_table_unref);
+  g_clear_pointer (&self->plugin_name_to_pool, g_hash_table_unref);
   g_clear_object (&self->dbus_server);
 
   G_OBJECT_CLASS (ide_worker_manager_parent_class)->finalize (object);
@@ -177,25 +192,64 @@ ide_worker_manager_init (IdeWorkerManager *self)
 {
   EGG_COUNTER_INC (instances);
 
-  self->plugin_name_to_worker =
+  self->plugin_name_to_pool =
     g_hash_table_new_full (g_str_hash,
                            g_str_equal,
                            g_free,
-                           ide_worker_manager_force_exit_worker);
+                           (GDestroyNotify)g_ptr_array_unref);
+}
+
+static guint
+ide_worker_manager_get_pool_size (IdeWorkerManager *self,
+                                  const gchar      *plugin_name)
+{
+  PeasPluginInfo *plugin_info;
+  const gchar *str;
+  guint64 pool_size = 1;
+
+  g_assert (IDE_IS_WORKER_MANAGER (self));
+  g_assert (plugin_name != NULL);
+
+  plugin_info = peas_engine_get_plugin_info (peas_engine_get_default (), plugin_name);
+
+  if (plugin_info != NULL &&
+      (str = peas_plugin_info_get_external_data (plugin_info, "Worker-Pool-Size")))
+    pool_size = g_ascii_strtoull (str, NULL, 10);
+
+  return CLAMP (pool_size, 1, g_get_num_processors ());
 }
 
 static IdeWorkerProcess *
 ide_worker_manager_get_worker_process (IdeWorkerManager *self,
                                        const gchar      *plugin_name)
 {
-  IdeWorkerProcess *worker_process;
+  IdeWorkerProcess *worker_process = NULL;
+  GPtrArray *pool;
+  guint i;
 
   g_assert (IDE_IS_WORKER_MANAGER (self));
   g_assert (plugin_name != NULL);
 
-  worker_process = g_hash_table_lookup (self->plugin_name_to_worker, plugin_name);
+  pool = g_hash_table_lookup (self->plugin_name_to_pool, plugin_name);
+
+  if (pool == NULL)
+    {
+      pool = g_ptr_array_new_with_free_func (ide_worker_manager_force_exit_worker);
+      g_hash_table_insert (self->plugin_name_to_pool, g_strdup (plugin_name), pool);
+    }
+
+  for (i = 0; i < pool->len; i++)
+    {
+      IdeWorkerProcess *process = g_ptr_array_index (pool, i);
+
+      if (worker_process == NULL ||
+          ide_worker_process_get_load (process) < ide_worker_process_get_load (worker_process))
+        worker_process = process;
+    }
 
-  if (worker_process == NULL)
+  if (worker_process == NULL ||
+      (ide_worker_process_get_load (worker_process) > 0 &&
+       pool->len < ide_worker_manager_get_pool_size (self, plugin_name)))
     {
       g_autofree gchar *address = NULL;
 
@@ -204,7 +258,7 @@ ide_worker_manager_get_worker_process (IdeWorkerManager *self,
                                  g_dbus_server_get_guid (self->dbus_server));
 
       worker_process = ide_worker_process_new ("gnome-builder-worker", plugin_name, address);
-      g_hash_table_insert (self->plugin_name_to_worker, g_strdup (plugin_name), worker_process);
+      g_ptr_array_add (pool, worker_process);
       ide_worker_process_run (worker_process);
     }
 
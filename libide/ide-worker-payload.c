@@ -0,0 +1,230 @@
+/* ide-worker-payload.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-worker-payload"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "egg-counter.h"
+
+#include "ide-worker-payload.h"
+
+/*
+ * Large payloads, such as buffer contents or result sets, are expensive to
+ * marshal through GVariant and copy across the D-Bus socket. Instead, they
+ * are written once to an anonymous memory file whose descriptor travels
+ * with the message in a #GUnixFDList. The peer maps it read-only.
+ *
+ * The payload is always a "v" so that both sides can accept either form.
+ */
+
+#ifndef MFD_CLOEXEC
+# define MFD_CLOEXEC       0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+# define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+EGG_DEFINE_COUNTER (InlinePayloads, "IdeWorkerPayload", "Inline",
+                    "Number of worker payloads sent inline.")
+EGG_DEFINE_COUNTER (SharedPayloads, "IdeWorkerPayload", "Shared",
+                    "Number of worker payloads sent through shared memory.")
+EGG_DEFINE_COUNTER (SharedBytes, "IdeWorkerPayload", "Shared Bytes",
+                    "Number of bytes sent through shared memory.")
+
+static gint
+ide_worker_payload_create_fd (void)
+{
+  gint fd = -1;
+
+#if defined(__linux__) && defined(__NR_memfd_create)
+  fd = syscall (__NR_memfd_create, "ide-worker-payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
+
+  if (fd == -1)
+    {
+      g_autofree gchar *name = NULL;
+
+      /* Fallback to an unlinked temporary file. */
+      if (-1 != (fd = g_file_open_tmp ("ide-worker-payload-XXXXXX", &name, NULL)))
+        g_unlink (name);
+    }
+
+  return fd;
+}
+
+static gboolean
+ide_worker_payload_write (gint           fd,
+                          const guint8  *data,
+                          gsize          len,
+                          GError       **error)
+{
+  g_assert (fd != -1);
+  g_assert (data != NULL || len == 0);
+
+  while (len > 0)
+    {
+      gssize n_written;
+
+      n_written = write (fd, data, len);
+
+      if (n_written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_set_error_literal (error,
+                               G_IO_ERROR,
+                               g_io_error_from_errno (errno),
+                               g_strerror (errno));
+          return FALSE;
+        }
+
+      data += n_written;
+      len -= n_written;
+    }
+
+#ifdef F_ADD_SEALS
+  /*
+   * Seal the contents so the peer can map them without worrying about us
+   * truncating the file underneath it. This fails harmlessly for the
+   * temporary file fallback.
+   */
+  fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+  return TRUE;
+}
+
+/**
+ * ide_worker_payload_new:
+ * @bytes: the contents of the payload
+ * @fd_list: (allow-none): the #GUnixFDList to send along with the message
+ * @error: (allow-none): a location for a #GError, or %NULL
+ *
+ * Creates a payload to embed within a D-Bus message to or from a worker.
+ *
+ * If @bytes is larger than %IDE_WORKER_PAYLOAD_INLINE_MAX and @fd_list is
+ * provided, the contents are placed in shared memory and only a handle to
+ * the descriptor within @fd_list is embedded. Otherwise, the contents are
+ * embedded directly.
+ *
+ * Returns: (transfer none): A new floating #GVariant of type "v", or %NULL
+ *   upon failure.
+ */
+GVariant *
+ide_worker_payload_new (GBytes       *bytes,
+                        GUnixFDList  *fd_list,
+                        GError      **error)
+{
+  const guint8 *data;
+  gsize len;
+  gint handle;
+  gint fd;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (!fd_list || G_IS_UNIX_FD_LIST (fd_list), NULL);
+
+  data = g_bytes_get_data (bytes, &len);
+
+  if (fd_list == NULL || len < IDE_WORKER_PAYLOAD_INLINE_MAX)
+    goto send_inline;
+
+  if (-1 == (fd = ide_worker_payload_create_fd ()))
+    goto send_inline;
+
+  if (!ide_worker_payload_write (fd, data, len, error))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  handle = g_unix_fd_list_append (fd_list, fd, error);
+  close (fd);
+
+  if (handle == -1)
+    return NULL;
+
+  EGG_COUNTER_INC (SharedPayloads);
+  EGG_COUNTER_ADD (SharedBytes, len);
+
+  return g_variant_new_variant (g_variant_new_handle (handle));
+
+send_inline:
+  EGG_COUNTER_INC (InlinePayloads);
+
+  return g_variant_new_variant (g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, bytes, TRUE));
+}
+
+/**
+ * ide_worker_payload_get_bytes:
+ * @payload: a payload created with ide_worker_payload_new()
+ * @fd_list: (allow-none): the #GUnixFDList received along with the message
+ * @error: (allow-none): a location for a #GError, or %NULL
+ *
+ * Retrieves the contents of a payload created by the peer with
+ * ide_worker_payload_new(). Shared memory payloads are mapped read-only
+ * rather than copied.
+ *
+ * Returns: (transfer full): A #GBytes or %NULL upon failure.
+ */
+GBytes *
+ide_worker_payload_get_bytes (GVariant     *payload,
+                              GUnixFDList  *fd_list,
+                              GError      **error)
+{
+  g_autoptr(GVariant) inner = NULL;
+  g_autoptr(GMappedFile) mapped = NULL;
+  gint fd;
+
+  g_return_val_if_fail (payload != NULL, NULL);
+  g_return_val_if_fail (!fd_list || G_IS_UNIX_FD_LIST (fd_list), NULL);
+
+  if (g_variant_is_of_type (payload, G_VARIANT_TYPE_VARIANT))
+    inner = g_variant_get_variant (payload);
+  else
+    inner = g_variant_ref (payload);
+
+  if (g_variant_is_of_type (inner, G_VARIANT_TYPE_BYTESTRING))
+    return g_variant_get_data_as_bytes (inner);
+
+  if (!g_variant_is_of_type (inner, G_VARIANT_TYPE_HANDLE) || fd_list == NULL)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_DATA,
+                   "Invalid worker payload of type \"%s\"",
+                   g_variant_get_type_string (inner));
+      return NULL;
+    }
+
+  if (-1 == (fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (inner), error)))
+    return NULL;
+
+  mapped = g_mapped_file_new_from_fd (fd, FALSE, error);
+  close (fd);
+
+  if (mapped == NULL)
+    return NULL;
+
+  return g_mapped_file_get_bytes (mapped);
+}
@@ -0,0 +1,41 @@
+/* ide-worker-payload.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_WORKER_PAYLOAD_H
+#define IDE_WORKER_PAYLOAD_H
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Payloads smaller than this are sent inline within the D-Bus message.
+ */
+#define IDE_WORKER_PAYLOAD_INLINE_MAX (64 * 1024)
+
+GVariant *ide_worker_payload_new       (GBytes       *bytes,
+                                        GUnixFDList  *fd_list,
+                                        GError      **error);
+GBytes   *ide_worker_payload_get_bytes (GVariant     *payload,
+                                        GUnixFDList  *fd_list,
+                                        GError      **error);
+
+G_END_DECLS
+
+#endif /* IDE_WORKER_PAYLOAD_H */
@@ -37,14 +37,29 @@ struct _IdeWorkerProcess
   GSubprocess     *subprocess;
   GDBusConnection *connection;
   GPtrArray       *tasks;
+  GPtrArray       *proxies;
   IdeWorker       *worker;
 
+  gint64           spawned_at;
+  guint            backoff_msec;
+  guint            respawn_source;
+
   guint            quit : 1;
 };
 
+/*
+ * A worker that exits sooner than STABLE_USEC after being spawned is
+ * considered to be crashing, and is respawned with an exponential backoff
+ * so that a broken worker does not spin.
+ */
+#define STABLE_USEC       (10 * G_USEC_PER_SEC)
+#define MIN_BACKOFF_MSEC  250
+#define MAX_BACKOFF_MSEC  (30 * 1000)
+
 G_DEFINE_TYPE (IdeWorkerProcess, ide_worker_process, G_TYPE_OBJECT)
 
 EGG_DEFINE_COUNTER (instances, "IdeWorkerProcess", "Instances", "Number of IdeWorkerProcess instances")
+EGG_DEFINE_COUNTER (crashes, "IdeWorkerProcess", "Crashes", "Number of worker processes that exited unexpectedly")
 
 enum {
   PROP_0,
@@ -56,7 +71,23 @@ enum {
 
 static GParamSpec *gParamSpecs [LAST_PROP];
 
-static void ide_worker_process_respawn (IdeWorkerProcess *self);
+static void ide_worker_process_respawn         (IdeWorkerProcess *self);
+static void ide_worker_process_forget_proxies (IdeWorkerProcess *self);
+
+static gboolean
+ide_worker_process_respawn_timeout (gpointer data)
+{
+  IdeWorkerProcess *self = data;
+
+  g_assert (IDE_IS_WORKER_PROCESS (self));
+
+  self->respawn_source = 0;
+
+  if (!self->quit && self->subprocess == NULL)
+    ide_worker_process_respawn (self);
+
+  return G_SOURCE_REMOVE;
+}
 
 IdeWorkerProcess *
 ide_worker_process_new (const gchar *argv0,
@@ -98,10 +129,45 @@ ide_worker_process_wait_check_cb (GObject      *object,
   if (!g_subprocess_wait_check_finish (subprocess, result, &error))
     g_critical ("%s", error->message);
 
+  /* We may have already been replaced by ide_worker_process_quit() */
+  if (self->subprocess != subprocess)
+    IDE_EXIT;
+
   g_clear_object (&self->subprocess);
+  g_clear_object (&self->connection);
 
-  if (!self->quit)
-    ide_worker_process_respawn (self);
+  /*
+   * Proxies to the exited process are dead even if their owners have not
+   * released them yet, so they no longer count toward our load.
+   */
+  ide_worker_process_forget_proxies (self);
+
+  if (self->quit)
+    IDE_EXIT;
+
+  EGG_COUNTER_INC (crashes);
+
+  if (g_get_monotonic_time () - self->spawned_at >= STABLE_USEC)
+    self->backoff_msec = 0;
+  else if (self->backoff_msec == 0)
+    self->backoff_msec = MIN_BACKOFF_MSEC;
+  else
+    self->backoff_msec = MIN (self->backoff_msec * 2, MAX_BACKOFF_MSEC);
+
+  if (self->backoff_msec == 0)
+    {
+      ide_worker_process_respawn (self);
+      IDE_EXIT;
+    }
+
+  g_debug ("Worker \"%s\" exited early, respawning in %u msec",
+           self->plugin_name, self->backoff_msec);
+
+  self->respawn_source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                             self->backoff_msec,
+                                             ide_worker_process_respawn_timeout,
+                                             g_object_ref (self),
+                                             g_object_unref);
 
   IDE_EXIT;
 }
@@ -147,6 +213,7 @@ ide_worker_process_respawn (IdeWorkerProcess *self)
     }
 
   self->subprocess = g_object_ref (subprocess);
+  self->spawned_at = g_get_monotonic_time ();
 
   g_subprocess_wait_check_async (subprocess,
                                  NULL,
@@ -188,6 +255,12 @@ ide_worker_process_quit (IdeWorkerProcess *self)
 
   self->quit = TRUE;
 
+  if (self->respawn_source != 0)
+    {
+      g_source_remove (self->respawn_source);
+      self->respawn_source = 0;
+    }
+
   if (self->subprocess != NULL)
     {
       if (!g_subprocess_get_if_exited (self->subprocess))
@@ -211,15 +284,44 @@ ide_worker_process_dispose (GObject *object)
   G_OBJECT_CLASS (ide_worker_process_parent_class)->dispose (object);
 }
 
+static void
+ide_worker_process_proxy_finalized (gpointer  data,
+                                    GObject  *where_the_object_was)
+{
+  IdeWorkerProcess *self = data;
+
+  g_assert (IDE_IS_WORKER_PROCESS (self));
+
+  g_ptr_array_remove_fast (self->proxies, where_the_object_was);
+}
+
+static void
+ide_worker_process_forget_proxies (IdeWorkerProcess *self)
+{
+  guint i;
+
+  g_assert (IDE_IS_WORKER_PROCESS (self));
+
+  for (i = 0; i < self->proxies->len; i++)
+    g_object_weak_unref (g_ptr_array_index (self->proxies, i),
+                         ide_worker_process_proxy_finalized,
+                         self);
+
+  g_ptr_array_set_size (self->proxies, 0);
+}
+
 static void
 ide_worker_process_finalize (GObject *object)
 {
   IdeWorkerProcess *self = (IdeWorkerProcess *)object;
 
+  ide_worker_process_forget_proxies (self);
+
   g_clear_pointer (&self->argv0, g_free);
   g_clear_pointer (&self->plugin_name, g_free);
   g_clear_pointer (&self->dbus_address, g_free);
   g_clear_pointer (&self->tasks, g_ptr_array_unref);
+  g_clear_pointer (&self->proxies, g_ptr_array_unref);
   g_clear_object (&self->connection);
   g_clear_object (&self->subprocess);
   g_clear_object (&self->worker);
@@ -321,6 +423,8 @@ static void
 ide_worker_process_init (IdeWorkerProcess *self)
 {
   EGG_COUNTER_INC (instances);
+
+  self->proxies = g_ptr_array_new ();
 }
 
 gboolean
@@ -379,6 +483,10 @@ ide_worker_process_create_proxy_for_task (IdeWorkerProcess *self,
       IDE_EXIT;
     }
 
+  /* Track live proxies so the worker manager can balance load. */
+  g_ptr_array_add (self->proxies, proxy);
+  g_object_weak_ref (G_OBJECT (proxy), ide_worker_process_proxy_finalized, self);
+
   g_task_return_pointer (task, proxy, g_object_unref);
 
   IDE_EXIT;
@@ -439,6 +547,22 @@ ide_worker_process_get_proxy_async (IdeWorkerProcess    *self,
   IDE_EXIT;
 }
 
+/**
+ * ide_worker_process_get_load:
+ *
+ * Gets the number of proxies to this worker that are still alive, plus the
+ * number of proxy requests waiting for the worker to connect.
+ *
+ * Returns: the load on the worker.
+ */
+guint
+ide_worker_process_get_load (IdeWorkerProcess *self)
+{
+  g_return_val_if_fail (IDE_IS_WORKER_PROCESS (self), 0);
+
+  return self->proxies->len + (self->tasks ? self->tasks->len : 0);
+}
+
 GDBusProxy *
 ide_worker_process_get_proxy_finish (IdeWorkerProcess  *self,
                                      GAsyncResult      *result,
@@ -34,6 +34,7 @@ void              ide_worker_process_run                 (IdeWorkerProcess     *
 void              ide_worker_process_quit                (IdeWorkerProcess     *self);
 gpointer          ide_worker_process_create_proxy        (IdeWorkerProcess     *self,
                                                           GError              **error);
+guint             ide_worker_process_get_load            (IdeWorkerProcess     *self);
 gboolean          ide_worker_process_matches_credentials (IdeWorkerProcess     *self,
                                                           GCredentials         *credentials);
 void              ide_worker_process_set_connection      (IdeWorkerProcess     *self,
@@ -37,6 +37,7 @@ G_BEGIN_DECLS
 #include "ide-buffer.h"
 #include "ide-buffer-change-monitor.h"
 #include "ide-buffer-manager.h"
+#include "ide-buffer-snapshot.h"
 #include "ide-completion-item.h"
 #include "ide-completion-provider.h"
 #include "ide-completion-results.h"
@@ -80,6 +81,7 @@ G_BEGIN_DECLS
 #include "ide-project-item.h"
 #include "ide-recent-projects.h"
 #include "ide-refactory.h"
+#include "ide-scan-cache.h"
 #include "ide-script.h"
 #include "ide-script-manager.h"
 #include "ide-search-context.h"
@@ -22,9 +22,6 @@
 
 #include "ide-template-base.h"
 
-#define TIMEOUT_INTERVAL_MSEC 17
-#define TIMEOUT_DURATION_MSEC  2
-
 typedef struct
 {
   TmplTemplateLocator *locator;
@@ -36,21 +33,33 @@ typedef struct
 typedef struct
 {
   GFile        *file;
-  GInputStream *stream;
   TmplScope    *scope;
   GFile        *destination;
   TmplTemplate *template;
-  gchar        *result;
   gint          mode;
 } FileExpansion;
 
 typedef struct
 {
   GArray    *files;
-  guint      index;
   guint      completed;
 } ExpansionTask;
 
+typedef struct
+{
+  TmplTemplate *template;
+  guint64       mtime;
+} CachedTemplate;
+
+/*
+ * Parsed templates are immutable and may be expanded from multiple threads,
+ * so we keep them around keyed by uri. Generating the same kind of project
+ * again does not need to re-parse anything. Templates found on disk are
+ * validated against their modification time before reuse.
+ */
+static GHashTable *template_cache;
+static GMutex      template_cache_mutex;
+
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (IdeTemplateBase, ide_template_base, G_TYPE_OBJECT)
 
 enum {
@@ -168,11 +177,85 @@ clear_file_expansion (gpointer data)
   FileExpansion *expansion = data;
 
   g_clear_object (&expansion->file);
-  g_clear_object (&expansion->stream);
   g_clear_pointer (&expansion->scope, tmpl_scope_unref);
   g_clear_object (&expansion->destination);
   g_clear_object (&expansion->template);
-  g_clear_pointer (&expansion->result, g_free);
+}
+
+static void
+cached_template_free (gpointer data)
+{
+  CachedTemplate *cached = data;
+
+  g_clear_object (&cached->template);
+  g_slice_free (CachedTemplate, cached);
+}
+
+static guint64
+get_template_mtime (GFile        *file,
+                    GCancellable *cancellable)
+{
+  g_autoptr(GFileInfo) info = NULL;
+
+  g_assert (G_IS_FILE (file));
+
+  /* Resources are compiled into the binary and can never change. */
+  if (g_file_has_uri_scheme (file, "resource"))
+    return 0;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NONE,
+                            cancellable,
+                            NULL);
+
+  if (info == NULL)
+    return 0;
+
+  return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+}
+
+static TmplTemplate *
+ide_template_base_lookup_cached (GFile   *file,
+                                 guint64  mtime)
+{
+  g_autofree gchar *uri = NULL;
+  TmplTemplate *ret = NULL;
+  CachedTemplate *cached;
+
+  g_assert (G_IS_FILE (file));
+
+  uri = g_file_get_uri (file);
+
+  g_mutex_lock (&template_cache_mutex);
+  if (template_cache != NULL &&
+      (cached = g_hash_table_lookup (template_cache, uri)) &&
+      cached->mtime == mtime)
+    ret = g_object_ref (cached->template);
+  g_mutex_unlock (&template_cache_mutex);
+
+  return ret;
+}
+
+static void
+ide_template_base_insert_cached (GFile        *file,
+                                 guint64       mtime,
+                                 TmplTemplate *template)
+{
+  CachedTemplate *cached;
+
+  g_assert (G_IS_FILE (file));
+  g_assert (TMPL_IS_TEMPLATE (template));
+
+  cached = g_slice_new0 (CachedTemplate);
+  cached->template = g_object_ref (template);
+  cached->mtime = mtime;
+
+  g_mutex_lock (&template_cache_mutex);
+  if (template_cache == NULL)
+    template_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, cached_template_free);
+  g_hash_table_insert (template_cache, g_file_get_uri (file), cached);
+  g_mutex_unlock (&template_cache_mutex);
 }
 
 static void
@@ -280,10 +363,23 @@ ide_template_base_parse_worker (GTask        *task,
       FileExpansion *fexp = &g_array_index (priv->files, FileExpansion, i);
       g_autoptr(TmplTemplate) template = NULL;
       GError *error = NULL;
+      guint64 mtime = 0;
 
       if (fexp->template != NULL)
         continue;
 
+      /*
+       * Includes are resolved by the locator at parse time, so we can only
+       * share parsed templates when no locator is in use.
+       */
+      if (priv->locator == NULL)
+        {
+          mtime = get_template_mtime (fexp->file, cancellable);
+
+          if ((fexp->template = ide_template_base_lookup_cached (fexp->file, mtime)))
+            continue;
+        }
+
       template = tmpl_template_new (priv->locator);
 
       if (!tmpl_template_parse_file (template, fexp->file, cancellable, &error))
@@ -292,6 +388,9 @@ ide_template_base_parse_worker (GTask        *task,
           return;
         }
 
+      if (priv->locator == NULL)
+        ide_template_base_insert_cached (fexp->file, mtime, template);
+
       fexp->template = g_object_ref (template);
     }
 
@@ -325,54 +424,57 @@ ide_template_base_parse_finish (IdeTemplateBase  *self,
 }
 
 static void
-ide_template_base_replace_cb (GObject      *object,
-                              GAsyncResult *result,
-                              gpointer      user_data)
+ide_template_base_expand_worker (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
 {
-  GFile *file = (GFile *)object;
-  g_autoptr(GTask) task = user_data;
+  FileExpansion *fexp = task_data;
+  g_autoptr(GFileOutputStream) stream = NULL;
+  g_autoptr(TmplScope) scope = NULL;
   GError *error = NULL;
-  ExpansionTask *expansion;
-  FileExpansion *fexp = NULL;
-  guint i;
 
-  g_assert (G_IS_FILE (file));
-  g_assert (G_IS_ASYNC_RESULT (result));
   g_assert (G_IS_TASK (task));
-
-  expansion = g_task_get_task_data (task);
-
-  g_assert (expansion != NULL);
-  g_assert (expansion->files != NULL);
-
-  expansion->completed++;
+  g_assert (IDE_IS_TEMPLATE_BASE (source_object));
+  g_assert (fexp != NULL);
+  g_assert (TMPL_IS_TEMPLATE (fexp->template));
+  g_assert (G_IS_FILE (fexp->destination));
 
   /*
-   * Complete the file replacement operation.
+   * fexp->scope is a private copy made on the main thread, but wrap it in a
+   * child scope so that new definitions do not leak into it either.
    */
-  if (!g_file_replace_contents_finish (file, result, NULL, &error))
+  scope = tmpl_scope_new_with_parent (fexp->scope);
+
+  stream = g_file_replace (fexp->destination,
+                           NULL,
+                           FALSE,
+                           G_FILE_CREATE_REPLACE_DESTINATION,
+                           cancellable,
+                           &error);
+
+  if (stream == NULL)
     {
-      if (!g_task_get_completed (task))
-        g_task_return_error (task, error);
-      else
-        g_error_free (error);
+      g_task_return_error (task, error);
       return;
     }
 
-  /*
-   * Locate the FileExpansion. We could remove this by tracking some
-   * state in the callback, but that is more complex than it's worth
-   * since we share the task between all the callbacks.
-   */
-  for (i = 0; i < expansion->files->len; i++)
+  if (!tmpl_template_expand (fexp->template, G_OUTPUT_STREAM (stream), scope, cancellable, &error))
     {
-      FileExpansion *item = &g_array_index (expansion->files, FileExpansion, i);
+      g_autoptr(GCancellable) abort = g_cancellable_new ();
 
-      if (g_file_equal (item->destination, file))
-        {
-          fexp = item;
-          break;
-        }
+      /* Closing with a cancelled cancellable discards the partial file. */
+      g_cancellable_cancel (abort);
+      g_output_stream_close (G_OUTPUT_STREAM (stream), abort, NULL);
+
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (!g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, &error))
+    {
+      g_task_return_error (task, error);
+      return;
     }
 
   /*
@@ -381,29 +483,29 @@ ide_template_base_replace_cb (GObject      *object,
    * This still works for things like FUSE, so much as they support
    * the posix chmod() API.
    */
-  if ((fexp != NULL) && (fexp->mode != 0) && g_file_is_native (file))
+  if ((fexp->mode != 0) && g_file_is_native (fexp->destination))
     {
-      g_autofree gchar *path = g_file_get_path (file);
+      g_autofree gchar *path = g_file_get_path (fexp->destination);
 
       if (0 != g_chmod (path, fexp->mode))
         g_warning ("chmod(\"%s\", 0%o) failed with: %s",
                    path, fexp->mode, strerror (errno));
     }
 
-  if (expansion->completed == expansion->files->len)
-    {
-      if (!g_task_get_completed (task))
-        g_task_return_boolean (task, TRUE);
-    }
+  g_task_return_boolean (task, TRUE);
 }
 
-static gboolean
-ide_template_base_expand (GTask *task)
+static void
+ide_template_base_expand_cb (GObject      *object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
 {
+  g_autoptr(GTask) task = user_data;
   ExpansionTask *expansion;
-  gint64 end;
-  gint64 now;
+  GError *error = NULL;
 
+  g_assert (IDE_IS_TEMPLATE_BASE (object));
+  g_assert (G_IS_TASK (result));
   g_assert (G_IS_TASK (task));
 
   expansion = g_task_get_task_data (task);
@@ -411,83 +513,22 @@ ide_template_base_expand (GTask *task)
   g_assert (expansion != NULL);
   g_assert (expansion->files != NULL);
 
-  /*
-   * We will only run for up to 2 milliseconds before we want to yield
-   * back to the main loop and schedule future expansions as low-priority
-   * so that we do not block the frame-clock;
-   */
-  for (end = (now = g_get_monotonic_time ()) + ((G_USEC_PER_SEC / 1000) * TIMEOUT_DURATION_MSEC);
-       now < end;
-       now = g_get_monotonic_time ())
-    {
-      FileExpansion *fexp;
-      GError *error = NULL;
-
-      g_assert (expansion->index <= expansion->files->len);
-
-      if (expansion->index == expansion->files->len)
-        break;
-
-      fexp = &g_array_index (expansion->files, FileExpansion, expansion->index);
-
-      g_assert (fexp != NULL);
-      g_assert (fexp->template != NULL);
-      g_assert (fexp->scope != NULL);
-      g_assert (fexp->result == NULL);
-
-      fexp->result = tmpl_template_expand_string (fexp->template, fexp->scope, &error);
-
-      if (fexp->result == NULL)
-        {
-          g_task_return_error (task, error);
-          return G_SOURCE_REMOVE;
-        }
+  expansion->completed++;
 
-      expansion->index++;
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      if (!g_task_get_completed (task))
+        g_task_return_error (task, error);
+      else
+        g_error_free (error);
+      return;
     }
 
-  /*
-   * If we have completed expanding all the templates, we need to start
-   * writing the results to the destination files asynchronously, and in
-   * parallel. When all of the async operations have completed, we will
-   * cleanup and complete the task.
-   */
-  if (expansion->index == expansion->files->len)
+  if (expansion->completed == expansion->files->len)
     {
-      guint i;
-
-      expansion->completed = 0;
-
-      //ide_template_base_make_directories (task);
-
-      for (i = 0; i < expansion->files->len; i++)
-        {
-          g_autoptr(GFile) directory = NULL;
-          FileExpansion *fexp;
-
-          fexp = &g_array_index (expansion->files, FileExpansion, i);
-
-          g_assert (fexp != NULL);
-          g_assert (G_IS_FILE (fexp->destination));
-          g_assert (fexp->result != NULL);
-
-          directory = g_file_get_parent (fexp->destination);
-
-          g_file_replace_contents_async (fexp->destination,
-                                         fexp->result,
-                                         strlen (fexp->result),
-                                         NULL,
-                                         FALSE,
-                                         G_FILE_CREATE_REPLACE_DESTINATION,
-                                         g_task_get_cancellable (task),
-                                         ide_template_base_replace_cb,
-                                         g_object_ref (task));
-        }
-
-      return G_SOURCE_REMOVE;
+      if (!g_task_get_completed (task))
+        g_task_return_boolean (task, TRUE);
     }
-
-  return G_SOURCE_CONTINUE;
 }
 
 static void
@@ -497,7 +538,9 @@ ide_template_base_expand_parse_cb (GObject      *object,
 {
   IdeTemplateBase *self = (IdeTemplateBase *)object;
   g_autoptr(GTask) task = user_data;
+  ExpansionTask *expansion;
   GError *error = NULL;
+  guint i;
 
   g_assert (IDE_IS_TEMPLATE_BASE (self));
 
@@ -507,11 +550,38 @@ ide_template_base_expand_parse_cb (GObject      *object,
       return;
     }
 
-  g_timeout_add_full (G_PRIORITY_LOW,
-                      TIMEOUT_INTERVAL_MSEC,
-                      (GSourceFunc)ide_template_base_expand,
-                      g_object_ref (task),
-                      g_object_unref);
+  expansion = g_task_get_task_data (task);
+
+  g_assert (expansion != NULL);
+  g_assert (expansion->files != NULL);
+
+  expansion->completed = 0;
+
+  /*
+   * Each file is expanded on its own worker thread, straight into the
+   * destination stream. The templates are already parsed and compiled.
+   * Scopes are often shared between files and symbols are mutable (and not
+   * locked), so each worker gets its own deep copy made here on the main
+   * thread.
+   */
+  for (i = 0; i < expansion->files->len; i++)
+    {
+      FileExpansion *fexp = &g_array_index (expansion->files, FileExpansion, i);
+      g_autoptr(GTask) file_task = NULL;
+      TmplScope *copy;
+
+      file_task = g_task_new (self,
+                              g_task_get_cancellable (task),
+                              ide_template_base_expand_cb,
+                              g_object_ref (task));
+      g_task_set_task_data (file_task, fexp, NULL);
+
+      copy = tmpl_scope_copy (fexp->scope);
+      tmpl_scope_unref (fexp->scope);
+      fexp->scope = copy;
+
+      g_task_run_in_thread (file_task, ide_template_base_expand_worker);
+    }
 }
 
 static void
@@ -553,22 +623,17 @@ ide_template_base_expand_all_async (IdeTemplateBase     *self,
 
   task_data = g_new0 (ExpansionTask, 1);
   task_data->files = priv->files;
-  task_data->index = 0;
   task_data->completed = 0;
 
   /*
-   * The expand process will need to call tmpl_template_expand() and we want
-   * that to happen in the main loop so that all scoped objects need not be
-   * thread-safe.
-   *
-   * Therefore, the first step is to asynchronously load all of the templates
-   * from storage. After that, we will expand the templates into memory,
-   * being careful about how long we run per-cycle in the main-loop. If we
-   * run too long, we risk adding jitter to the frame-clock and causing UI
-   * elements to feel sluggish.
+   * The first step is to create the destination directories and then
+   * asynchronously load (or reuse previously parsed) templates. Parsing
+   * compiles each template, so expansion never needs to touch the node tree.
    *
-   * Once we have all of our templates expanded, we progress to asynchronously
-   * write them to the requested underlying storage.
+   * Once we have all of our templates parsed, each file is expanded in
+   * parallel on a worker thread, writing directly to its destination.
+   * Nothing is expanded on the main loop, so large projects do not add
+   * jitter to the frame-clock.
    */
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_task_data (task, task_data, g_free);
@@ -642,10 +707,8 @@ ide_template_base_add_resource (IdeTemplateBase *self,
   uri = g_strdup_printf ("resource://%s", resource_path);
 
   expansion.file = g_file_new_for_uri (uri);
-  expansion.stream = NULL;
   expansion.scope = scope ? tmpl_scope_ref (scope) : tmpl_scope_new ();
   expansion.destination = g_object_ref (destination);
-  expansion.result = NULL;
   expansion.mode = mode;
 
   g_array_append_val (priv->files, expansion);
@@ -674,10 +737,8 @@ ide_template_base_add_path (IdeTemplateBase *self,
     }
 
   expansion.file = g_file_new_for_path (path);
-  expansion.stream = NULL;
   expansion.scope = scope ? tmpl_scope_ref (scope) : tmpl_scope_new ();
   expansion.destination = g_object_ref (destination);
-  expansion.result = NULL;
   expansion.mode = mode;
 
   g_array_append_val (priv->files, expansion);
@@ -20,10 +20,30 @@
 
 #include <glib/gi18n.h>
 #include <ide.h>
+#include <string.h>
 
 #include "ide-autotools-project-miner.h"
 
-#define MAX_MINE_DEPTH 5
+#define MAX_MINE_DEPTH      5
+#define MAX_MINE_IO_THREADS 4
+#define MINER_CACHE_VERSION 1
+
+/*
+ * The miner cache is stored as a GVariant of the form
+ *
+ *   (ua{s(tssas)})
+ *
+ * The leading integer is MINER_CACHE_VERSION. Each entry is keyed by the
+ * directory uri and contains the directory mtime, the name of the autotools
+ * file found within it (or ""), the name of the .doap file (or ""), and the
+ * names of the child directories that should be descended into.
+ *
+ * If the mtime of a directory has not changed since the last crawl, its
+ * children have not been added, removed, or renamed, so we can skip the
+ * (expensive) enumeration and reuse the cached entry.
+ */
+#define MINER_CACHE_FORMAT       "(ua{s(tssas)})"
+#define MINER_CACHE_ENTRY_FORMAT "(tssas)"
 
 struct _IdeAutotoolsProjectMiner
 {
@@ -31,6 +51,34 @@ struct _IdeAutotoolsProjectMiner
   GFile   *root_directory;
 };
 
+typedef struct
+{
+  guint64   mtime;
+  gchar    *build_file;
+  gchar    *doap_file;
+  gchar   **subdirs;
+} MinerCacheEntry;
+
+typedef struct
+{
+  IdeAutotoolsProjectMiner *self;
+  GCancellable             *cancellable;
+  GThreadPool              *pool;
+  GHashTable               *old_cache;
+  GHashTable               *new_cache;
+  GMutex                    mutex;
+  GCond                     cond;
+  volatile gint             pending;
+  volatile gint             n_enumerated;
+  volatile gint             n_cached;
+} MineState;
+
+typedef struct
+{
+  GFile *directory;
+  guint  depth;
+} MineJob;
+
 static void project_miner_iface_init (IdeProjectMinerInterface *iface);
 
 G_DEFINE_TYPE_EXTENDED (IdeAutotoolsProjectMiner, ide_autotools_project_miner, G_TYPE_OBJECT, 0,
@@ -44,83 +92,205 @@ enum {
 
 static GParamSpec *properties [LAST_PROP];
 
-static IdeDoap *
-ide_autotools_project_miner_find_doap (IdeAutotoolsProjectMiner *self,
-                                       GCancellable             *cancellable,
-                                       GFile                    *directory)
+static void
+miner_cache_entry_free (gpointer data)
 {
-  g_autoptr(GFileEnumerator) enumerator = NULL;
-  GFileInfo *file_info = NULL;
+  MinerCacheEntry *entry = data;
 
-  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
-  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
-  g_assert (G_IS_FILE (directory));
+  if (entry != NULL)
+    {
+      g_free (entry->build_file);
+      g_free (entry->doap_file);
+      g_strfreev (entry->subdirs);
+      g_slice_free (MinerCacheEntry, entry);
+    }
+}
 
-  enumerator = g_file_enumerate_children (directory,
-                                          G_FILE_ATTRIBUTE_STANDARD_NAME,
-                                          G_FILE_QUERY_INFO_NONE,
-                                          cancellable,
-                                          NULL);
-  if (!enumerator)
-    return NULL;
+static gchar *
+ide_autotools_project_miner_get_cache_path (GFile *root_directory)
+{
+  g_autofree gchar *uri = NULL;
+  g_autofree gchar *hash = NULL;
+  g_autofree gchar *name = NULL;
+
+  g_assert (G_IS_FILE (root_directory));
+
+  uri = g_file_get_uri (root_directory);
+  hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+  name = g_strdup_printf ("%s.cache", hash);
+
+  return g_build_filename (g_get_user_cache_dir (),
+                           ide_get_program_name (),
+                           "autotools-project-miner",
+                           name,
+                           NULL);
+}
+
+static GHashTable *
+ide_autotools_project_miner_load_cache (const gchar *path)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariantIter) iter = NULL;
+  GHashTable *cache;
+  gchar *contents = NULL;
+  const gchar *uri;
+  const gchar *build_file;
+  const gchar *doap_file;
+  gchar **subdirs;
+  guint64 mtime;
+  gsize len = 0;
+  guint version = 0;
+
+  g_assert (path != NULL);
+
+  cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, miner_cache_entry_free);
+
+  if (!g_file_get_contents (path, &contents, &len, NULL))
+    return cache;
+
+  variant = g_variant_new_from_data (G_VARIANT_TYPE (MINER_CACHE_FORMAT),
+                                     contents, len, FALSE, g_free, contents);
+  g_variant_ref_sink (variant);
 
-  while ((file_info = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+  if (!g_variant_is_normal_form (variant))
     {
-      g_autofree gchar *name = NULL;
+      g_warning ("Corrupted autotools project miner cache at %s, ignoring", path);
+      return cache;
+    }
 
-      name = g_strdup (g_file_info_get_name (file_info));
+  g_variant_get (variant, "(ua{s(tssas)})", &version, &iter);
 
-      g_clear_object (&file_info);
+  if (version != MINER_CACHE_VERSION)
+    return cache;
 
-      if (name != NULL && g_str_has_suffix (name, ".doap"))
-        {
-          g_autoptr(GFile) doap_file = g_file_get_child (directory, name);
-          IdeDoap *doap = ide_doap_new ();
+  while (g_variant_iter_next (iter, "{&s(t&s&s^as)}", &uri, &mtime, &build_file, &doap_file, &subdirs))
+    {
+      MinerCacheEntry *entry;
 
-          if (!ide_doap_load_from_file (doap, doap_file, cancellable, NULL))
-            {
-              g_object_unref (doap);
-              continue;
-            }
+      entry = g_slice_new0 (MinerCacheEntry);
+      entry->mtime = mtime;
+      entry->build_file = *build_file ? g_strdup (build_file) : NULL;
+      entry->doap_file = *doap_file ? g_strdup (doap_file) : NULL;
+      entry->subdirs = subdirs;
 
-          return doap;
-        }
+      g_hash_table_insert (cache, g_strdup (uri), entry);
     }
 
-  return NULL;
+  return cache;
+}
+
+static void
+ide_autotools_project_miner_save_cache (const gchar *path,
+                                        GHashTable  *cache)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *dir = NULL;
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  const gchar *uri;
+  MinerCacheEntry *entry;
+
+  g_assert (path != NULL);
+  g_assert (cache != NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(tssas)}"));
+
+  g_hash_table_iter_init (&iter, cache);
+
+  while (g_hash_table_iter_next (&iter, (gpointer *)&uri, (gpointer *)&entry))
+    {
+      static const gchar *empty[] = { NULL };
+
+      g_variant_builder_add (&builder, "{s(tss^as)}",
+                             uri,
+                             entry->mtime,
+                             entry->build_file ?: "",
+                             entry->doap_file ?: "",
+                             entry->subdirs ?: (gchar **)empty);
+    }
+
+  variant = g_variant_new ("(ua{s(tssas)})", MINER_CACHE_VERSION, &builder);
+  g_variant_ref_sink (variant);
+
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0750) != 0)
+    {
+      g_warning ("Failed to create autotools project miner cache directory %s", dir);
+      return;
+    }
+
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (variant),
+                            g_variant_get_size (variant),
+                            &error))
+    g_warning ("Failed to save autotools project miner cache: %s", error->message);
+}
+
+static IdeDoap *
+ide_autotools_project_miner_load_doap (IdeAutotoolsProjectMiner *self,
+                                       GCancellable             *cancellable,
+                                       GFile                    *directory,
+                                       const gchar              *doap_file)
+{
+  g_autoptr(GFile) file = NULL;
+  IdeDoap *doap;
+
+  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+  g_assert (G_IS_FILE (directory));
+  g_assert (doap_file != NULL);
+
+  file = g_file_get_child (directory, doap_file);
+  doap = ide_doap_new ();
+
+  if (!ide_doap_load_from_file (doap, file, cancellable, NULL))
+    g_clear_object (&doap);
+
+  return doap;
 }
 
 static void
 ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
                                         GCancellable             *cancellable,
                                         GFile                    *directory,
-                                        GFileInfo                *file_info)
+                                        const gchar              *filename,
+                                        const gchar              *doap_file)
 {
   g_autofree gchar *uri = NULL;
   g_autofree gchar *name = NULL;
   g_autoptr(GFile) file = NULL;
+  g_autoptr(GFileInfo) file_info = NULL;
   g_autoptr(GFile) index_file = NULL;
   g_autoptr(GFileInfo) index_info = NULL;
   g_autoptr(IdeProjectInfo) project_info = NULL;
   g_autoptr(GDateTime) last_modified_at = NULL;
   g_autoptr(IdeDoap) doap = NULL;
-  const gchar *filename;
   const gchar *shortdesc = NULL;
   gchar **languages = NULL;
-  guint64 mtime;
+  guint64 mtime = 0;
 
   IDE_ENTRY;
 
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
   g_assert (G_IS_FILE (directory));
-  g_assert (G_IS_FILE_INFO (file_info));
+  g_assert (filename != NULL);
 
   uri = g_file_get_uri (directory);
   g_debug ("Discovered autotools project at %s", uri);
 
-  mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  file = g_file_get_child (directory, filename);
+  file_info = g_file_query_info (file,
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                 G_FILE_QUERY_INFO_NONE,
+                                 cancellable,
+                                 NULL);
+  if (file_info != NULL)
+    mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
 
-  doap = ide_autotools_project_miner_find_doap (self, cancellable, directory);
+  if (doap_file != NULL)
+    doap = ide_autotools_project_miner_load_doap (self, cancellable, directory, doap_file);
 
   /*
    * If there is a git repo, trust the .git/index file for time info,
@@ -137,8 +307,6 @@ ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
 
   last_modified_at = g_date_time_new_from_unix_local (mtime);
 
-  filename = g_file_info_get_attribute_byte_string (file_info, G_FILE_ATTRIBUTE_STANDARD_NAME);
-  file = g_file_get_child (directory, filename);
   name = g_file_get_basename (directory);
 
   if (doap != NULL)
@@ -171,73 +339,61 @@ ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
   IDE_EXIT;
 }
 
-static void
-ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
-                                            GFile                    *directory,
-                                            guint                     depth,
-                                            GCancellable             *cancellable)
+static MinerCacheEntry *
+ide_autotools_project_miner_enumerate (IdeAutotoolsProjectMiner *self,
+                                       GFile                    *directory,
+                                       guint64                   mtime,
+                                       GCancellable             *cancellable)
 {
   g_autoptr(GFileEnumerator) file_enum = NULL;
-  g_autoptr(GPtrArray) directories = NULL;
+  g_autoptr(GPtrArray) subdirs = NULL;
+  MinerCacheEntry *entry;
   gpointer file_info_ptr;
 
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
   g_assert (G_IS_FILE (directory));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  if (depth == MAX_MINE_DEPTH)
-    return;
-
-#ifdef IDE_ENABLE_TRACE
-  {
-    g_autofree gchar *uri = NULL;
-
-    uri = g_file_get_uri (directory);
-    IDE_TRACE_MSG ("Mining directory %s", uri);
-  }
-#endif
-
   file_enum = g_file_enumerate_children (directory,
                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
-                                         G_FILE_ATTRIBUTE_STANDARD_TYPE","
-                                         G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                         G_FILE_ATTRIBUTE_STANDARD_TYPE,
                                          G_FILE_QUERY_INFO_NONE,
                                          cancellable,
                                          NULL);
 
   if (file_enum == NULL)
-    return;
+    return NULL;
+
+  entry = g_slice_new0 (MinerCacheEntry);
+  entry->mtime = mtime;
+
+  subdirs = g_ptr_array_new_with_free_func (g_free);
 
   while ((file_info_ptr = g_file_enumerator_next_file (file_enum, cancellable, NULL)))
     {
       g_autoptr(GFileInfo) file_info = file_info_ptr;
       const gchar *filename;
       GFileType file_type;
-      GFile *child;
 
       file_type = g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_STANDARD_TYPE);
       filename = g_file_info_get_attribute_byte_string (file_info, G_FILE_ATTRIBUTE_STANDARD_NAME);
 
-      if (filename && filename [0] == '.')
+      if (filename == NULL || filename [0] == '.')
         continue;
 
       switch (file_type)
         {
         case G_FILE_TYPE_DIRECTORY:
-          if (directories == NULL)
-            directories = g_ptr_array_new_with_free_func (g_object_unref);
-          child = g_file_get_child (directory, filename);
-          g_ptr_array_add (directories, child);
+          g_ptr_array_add (subdirs, g_strdup (filename));
           break;
 
         case G_FILE_TYPE_REGULAR:
-          if ((0 == g_strcmp0 (filename, "configure.ac")) ||
-              (0 == g_strcmp0 (filename, "configure.in")))
-            {
-              ide_autotools_project_miner_discovered (self, cancellable, directory, file_info);
-              g_clear_object (&file_info);
-              return;
-            }
+          if (entry->build_file == NULL &&
+              ((0 == g_strcmp0 (filename, "configure.ac")) ||
+               (0 == g_strcmp0 (filename, "configure.in"))))
+            entry->build_file = g_strdup (filename);
+          else if (entry->doap_file == NULL && g_str_has_suffix (filename, ".doap"))
+            entry->doap_file = g_strdup (filename);
           break;
 
         case G_FILE_TYPE_UNKNOWN:
@@ -250,16 +406,129 @@ ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
         }
     }
 
-  if (directories != NULL)
+  /* We never descend into projects, so there is no need to remember children. */
+  if (entry->build_file == NULL)
+    {
+      g_ptr_array_add (subdirs, NULL);
+      entry->subdirs = (gchar **)g_ptr_array_free (g_steal_pointer (&subdirs), FALSE);
+    }
+
+  return entry;
+}
+
+static void mine_state_push (MineState *state,
+                             GFile     *directory,
+                             guint      depth);
+
+static void
+mine_state_complete (MineState *state)
+{
+  g_mutex_lock (&state->mutex);
+  if (g_atomic_int_dec_and_test (&state->pending))
+    g_cond_signal (&state->cond);
+  g_mutex_unlock (&state->mutex);
+}
+
+static void
+ide_autotools_project_miner_mine_directory (gpointer data,
+                                            gpointer user_data)
+{
+  MineJob *job = data;
+  MineState *state = user_data;
+  IdeAutotoolsProjectMiner *self = state->self;
+  g_autoptr(GFileInfo) dir_info = NULL;
+  g_autofree gchar *uri = NULL;
+  MinerCacheEntry *entry = NULL;
+  MinerCacheEntry *cached;
+  guint64 mtime;
+
+  g_assert (job != NULL);
+  g_assert (G_IS_FILE (job->directory));
+  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+
+  if (g_cancellable_is_cancelled (state->cancellable))
+    goto finish;
+
+  uri = g_file_get_uri (job->directory);
+
+  IDE_TRACE_MSG ("Mining directory %s", uri);
+
+  dir_info = g_file_query_info (job->directory,
+                                G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                G_FILE_QUERY_INFO_NONE,
+                                state->cancellable,
+                                NULL);
+  if (dir_info == NULL)
+    goto finish;
+
+  mtime = g_file_info_get_attribute_uint64 (dir_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+  /* old_cache is read-only while the crawl is active, so no locking is needed. */
+  cached = g_hash_table_lookup (state->old_cache, uri);
+
+  if (cached != NULL && cached->mtime == mtime)
+    {
+      entry = g_slice_new0 (MinerCacheEntry);
+      entry->mtime = cached->mtime;
+      entry->build_file = g_strdup (cached->build_file);
+      entry->doap_file = g_strdup (cached->doap_file);
+      entry->subdirs = g_strdupv (cached->subdirs);
+      g_atomic_int_inc (&state->n_cached);
+    }
+  else
+    {
+      entry = ide_autotools_project_miner_enumerate (self, job->directory, mtime, state->cancellable);
+      g_atomic_int_inc (&state->n_enumerated);
+    }
+
+  if (entry == NULL)
+    goto finish;
+
+  if (entry->build_file != NULL)
+    ide_autotools_project_miner_discovered (self,
+                                            state->cancellable,
+                                            job->directory,
+                                            entry->build_file,
+                                            entry->doap_file);
+  else if (entry->subdirs != NULL && job->depth + 1 < MAX_MINE_DEPTH)
     {
-      gsize i;
+      guint i;
 
-      for (i = 0; i < directories->len; i++)
+      for (i = 0; entry->subdirs [i]; i++)
         {
-          GFile *child = g_ptr_array_index (directories, i);
-          ide_autotools_project_miner_mine_directory (self, child, depth + 1, cancellable);
+          g_autoptr(GFile) child = g_file_get_child (job->directory, entry->subdirs [i]);
+
+          mine_state_push (state, child, job->depth + 1);
         }
     }
+
+  g_mutex_lock (&state->mutex);
+  g_hash_table_insert (state->new_cache, g_steal_pointer (&uri), entry);
+  g_mutex_unlock (&state->mutex);
+
+finish:
+  g_object_unref (job->directory);
+  g_slice_free (MineJob, job);
+
+  mine_state_complete (state);
+}
+
+static void
+mine_state_push (MineState *state,
+                 GFile     *directory,
+                 guint      depth)
+{
+  MineJob *job;
+
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+
+  job = g_slice_new0 (MineJob);
+  job->directory = g_object_ref (directory);
+  job->depth = depth;
+
+  g_atomic_int_inc (&state->pending);
+  g_thread_pool_push (state->pool, job, NULL);
 }
 
 static void
@@ -270,6 +539,10 @@ ide_autotools_project_miner_worker (GTask        *task,
 {
   IdeAutotoolsProjectMiner *self = source_object;
   GFile *directory = task_data;
+  g_autofree gchar *cache_path = NULL;
+  GError *error = NULL;
+  MineState state = { 0 };
+  gint64 begin_time;
 
   IDE_ENTRY;
 
@@ -278,10 +551,61 @@ ide_autotools_project_miner_worker (GTask        *task,
   g_assert (G_IS_FILE (directory));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  ide_autotools_project_miner_mine_directory (self, directory, 0, cancellable);
+  begin_time = g_get_monotonic_time ();
+
+  cache_path = ide_autotools_project_miner_get_cache_path (directory);
+
+  state.self = self;
+  state.cancellable = cancellable;
+  state.old_cache = ide_autotools_project_miner_load_cache (cache_path);
+  state.new_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, miner_cache_entry_free);
+  g_mutex_init (&state.mutex);
+  g_cond_init (&state.cond);
+
+  /*
+   * Directory I/O is mostly latency bound (particularly on network mounts),
+   * so we crawl the tree with a small number of threads. The thread pool
+   * bounds how many stat()/readdir() requests are in flight at once.
+   */
+  state.pool = g_thread_pool_new (ide_autotools_project_miner_mine_directory,
+                                  &state,
+                                  MAX_MINE_IO_THREADS,
+                                  FALSE,
+                                  &error);
+
+  if (state.pool == NULL)
+    {
+      g_task_return_error (task, error);
+      goto cleanup;
+    }
+
+  mine_state_push (&state, directory, 0);
+
+  g_mutex_lock (&state.mutex);
+  while (g_atomic_int_get (&state.pending) > 0)
+    g_cond_wait (&state.cond, &state.mutex);
+  g_mutex_unlock (&state.mutex);
+
+  g_thread_pool_free (state.pool, FALSE, TRUE);
+
+  g_debug ("Mined %u directories (%d enumerated, %d cached) in %.3lf seconds",
+           g_hash_table_size (state.new_cache),
+           state.n_enumerated,
+           state.n_cached,
+           (g_get_monotonic_time () - begin_time) / (gdouble)G_USEC_PER_SEC);
+
+  /* A partial crawl would drop entries, so only persist complete results. */
+  if (!g_cancellable_is_cancelled (cancellable))
+    ide_autotools_project_miner_save_cache (cache_path, state.new_cache);
 
   g_task_return_boolean (task, TRUE);
 
+cleanup:
+  g_clear_pointer (&state.old_cache, g_hash_table_unref);
+  g_clear_pointer (&state.new_cache, g_hash_table_unref);
+  g_mutex_clear (&state.mutex);
+  g_cond_clear (&state.cond);
+
   IDE_EXIT;
 }
 
@@ -24,6 +24,7 @@
 #include "c-parse-helper.h"
 #include "ide-c-indenter.h"
 #include "ide-debug.h"
+#include "ide-scan-cache.h"
 #include "ide-source-view.h"
 
 #define ITER_INIT_LINE_START(iter, other) \
@@ -165,8 +166,19 @@ line_is_whitespace_until (GtkTextIter *iter)
 static gboolean is_special (const GtkTextIter *iter)
 {
   GtkSourceBuffer *buffer;
+  IdeScanCache *cache;
 
   buffer = GTK_SOURCE_BUFFER (gtk_text_iter_get_buffer (iter));
+
+  if ((cache = ide_scan_cache_get_for_buffer (GTK_TEXT_BUFFER (buffer))))
+    {
+      GtkTextIter after = *iter;
+
+      /* The scan cache answers for the position before @after */
+      gtk_text_iter_forward_char (&after);
+      return ide_scan_cache_get_context (cache, &after, NULL) != IDE_SCAN_CONTEXT_CODE;
+    }
+
   return (gtk_source_buffer_iter_has_context_class (buffer, iter, "string") ||
           gtk_source_buffer_iter_has_context_class (buffer, iter, "comment"));
 }
@@ -290,6 +302,7 @@ static gboolean
 backward_find_matching_char (GtkTextIter *iter,
                              gunichar     ch)
 {
+  IdeScanCache *cache;
   GtkTextIter copy;
   gunichar match = 0;
   gunichar cur;
@@ -310,6 +323,14 @@ backward_find_matching_char (GtkTextIter *iter,
     break;
   }
 
+  /*
+   * The scan cache already knows where comments and strings are, so it
+   * does not need to walk every character between here and the match.
+   */
+  if ((ch != '[') &&
+      (cache = ide_scan_cache_get_for_buffer (gtk_text_iter_get_buffer (iter))))
+    return ide_scan_cache_backward_find_unmatched (cache, iter, match, 1);
+
   gtk_text_iter_assign (&copy, iter);
 
   while (gtk_text_iter_backward_char (iter))
@@ -442,6 +463,7 @@ in_comment (const GtkTextIter *location,
             gint              *comment_type)
 {
   GtkSourceBuffer *buffer = GTK_SOURCE_BUFFER (gtk_text_iter_get_buffer (location));
+  IdeScanCache *cache;
   GtkTextIter iter = *location;
   GtkTextIter copy;
   gint type = COMMENT_NONE;
@@ -451,6 +473,31 @@ in_comment (const GtkTextIter *location,
   if (comment_type)
     *comment_type = COMMENT_NONE;
 
+  if ((cache = ide_scan_cache_get_for_buffer (GTK_TEXT_BUFFER (buffer))))
+    {
+      switch (ide_scan_cache_get_context (cache, location, match_begin))
+        {
+        case IDE_SCAN_CONTEXT_BLOCK_COMMENT:
+          type = COMMENT_C89;
+          break;
+
+        case IDE_SCAN_CONTEXT_LINE_COMMENT:
+          type = COMMENT_C99;
+          break;
+
+        case IDE_SCAN_CONTEXT_CODE:
+        case IDE_SCAN_CONTEXT_STRING:
+        case IDE_SCAN_CONTEXT_VERBATIM:
+        default:
+          IDE_RETURN (FALSE);
+        }
+
+      if (comment_type)
+        *comment_type = type;
+
+      IDE_RETURN (TRUE);
+    }
+
   /*
    * A rather esoteric set of heuristics to be able to determine if we are
    * actually in a GtkSourceView comment context.
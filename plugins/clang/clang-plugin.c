@@ -24,6 +24,7 @@
 #include "ide-clang-diagnostic-provider.h"
 #include "ide-clang-highlighter.h"
 #include "ide-clang-private.h"
+#include "ide-clang-search-provider.h"
 #include "ide-clang-service.h"
 #include "ide-clang-symbol-node.h"
 #include "ide-clang-symbol-resolver.h"
@@ -48,4 +49,7 @@ peas_register_types (PeasObjectModule *module)
   peas_object_module_register_extension_type (module,
                                               IDE_TYPE_COMPLETION_PROVIDER,
                                               IDE_TYPE_CLANG_COMPLETION_PROVIDER);
+  peas_object_module_register_extension_type (module,
+                                              IDE_TYPE_SEARCH_PROVIDER,
+                                              IDE_TYPE_CLANG_SEARCH_PROVIDER);
 }
@@ -370,6 +370,25 @@ ide_clang_completion_provider_code_complete_cb (GObject      *object,
   IDE_EXIT;
 }
 
+static void
+ide_clang_completion_provider_complete (IdeClangTranslationUnit *unit,
+                                        IdeClangCompletionState *state)
+{
+  GtkTextIter iter;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (unit));
+  g_assert (state != NULL);
+
+  gtk_source_completion_context_get_iter (state->context, &iter);
+
+  ide_clang_translation_unit_code_complete_async (unit,
+                                                  ide_file_get_file (state->file),
+                                                  &iter,
+                                                  NULL,
+                                                  ide_clang_completion_provider_code_complete_cb,
+                                                  state);
+}
+
 static void
 ide_clang_completion_provider_get_translation_unit_cb (GObject      *object,
                                                        GAsyncResult *result,
@@ -378,7 +397,6 @@ ide_clang_completion_provider_get_translation_unit_cb (GObject      *object,
   g_autoptr(IdeClangTranslationUnit) unit = NULL;
   IdeClangService *service = (IdeClangService *)object;
   IdeClangCompletionState *state = user_data;
-  GtkTextIter iter;
   GError *error = NULL;
 
   IDE_ENTRY;
@@ -412,14 +430,7 @@ ide_clang_completion_provider_get_translation_unit_cb (GObject      *object,
       IDE_EXIT;
     }
 
-  gtk_source_completion_context_get_iter (state->context, &iter);
-
-  ide_clang_translation_unit_code_complete_async (unit,
-                                                  ide_file_get_file (state->file),
-                                                  &iter,
-                                                  NULL,
-                                                  ide_clang_completion_provider_code_complete_cb,
-                                                  state);
+  ide_clang_completion_provider_complete (unit, state);
 
   IDE_EXIT;
 }
@@ -430,6 +441,7 @@ ide_clang_completion_provider_populate (GtkSourceCompletionProvider *provider,
 {
   IdeClangCompletionProvider *self = (IdeClangCompletionProvider *)provider;
   IdeClangCompletionState *state;
+  g_autoptr(IdeClangTranslationUnit) cached = NULL;
   g_autoptr(GtkSourceCompletion) completion = NULL;
   g_autofree gchar *line = NULL;
   g_autofree gchar *prefix = NULL;
@@ -530,6 +542,19 @@ ide_clang_completion_provider_populate (GtkSourceCompletionProvider *provider,
                            state->cancellable,
                            G_CONNECT_SWAPPED);
 
+  /*
+   * Waiting for a reparse after every keystroke makes completion feel slow.
+   * clang_codeCompleteAt() is given the unsaved buffers, so an older
+   * translation unit produces the same results for the code being typed.
+   * Complete against it now and let the reparse finish in the background.
+   */
+  if ((cached = ide_clang_service_get_cached_translation_unit (service, state->file)))
+    {
+      ide_clang_service_get_translation_unit_async (service, state->file, 0, NULL, NULL, NULL);
+      ide_clang_completion_provider_complete (cached, state);
+      IDE_EXIT;
+    }
+
   ide_clang_service_get_translation_unit_async (service,
                                                 state->file,
                                                 0,
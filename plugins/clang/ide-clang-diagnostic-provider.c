@@ -46,6 +46,27 @@ G_DEFINE_TYPE_EXTENDED (IdeClangDiagnosticProvider,
                         G_IMPLEMENT_INTERFACE (IDE_TYPE_DIAGNOSTIC_PROVIDER,
                                                diagnostic_provider_iface_init))
 
+static void
+get_diagnostics_cb (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  IdeClangTranslationUnit *tu = (IdeClangTranslationUnit *)object;
+  g_autoptr(GTask) task = user_data;
+  IdeDiagnostics *diagnostics;
+  GError *error = NULL;
+
+  diagnostics = ide_clang_translation_unit_get_diagnostics_for_file_finish (tu, result, &error);
+
+  if (!diagnostics)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_task_return_pointer (task, diagnostics, (GDestroyNotify)ide_diagnostics_unref);
+}
+
 static void
 get_translation_unit_cb (GObject      *object,
                          GAsyncResult *result,
@@ -54,7 +75,6 @@ get_translation_unit_cb (GObject      *object,
   IdeClangService *service = (IdeClangService *)object;
   g_autoptr(IdeClangTranslationUnit) tu = NULL;
   g_autoptr(GTask) task = user_data;
-  IdeDiagnostics *diagnostics;
   IdeFile *target;
   GFile *gfile;
   GError *error = NULL;
@@ -73,11 +93,11 @@ get_translation_unit_cb (GObject      *object,
   gfile = ide_file_get_file (target);
   g_assert (G_IS_FILE (gfile));
 
-  diagnostics = ide_clang_translation_unit_get_diagnostics_for_file (tu, gfile);
-
-  g_task_return_pointer (task,
-                         ide_diagnostics_ref (diagnostics),
-                         (GDestroyNotify)ide_diagnostics_unref);
+  ide_clang_translation_unit_get_diagnostics_for_file_async (tu,
+                                                             gfile,
+                                                             g_task_get_cancellable (task),
+                                                             get_diagnostics_cb,
+                                                             g_object_ref (task));
 }
 
 static gboolean
@@ -0,0 +1,1269 @@
+/* ide-clang-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-clang-index"
+
+#include <clang-c/Index.h>
+#include <errno.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "egg-counter.h"
+#include "fuzzy.h"
+
+#include "ide-build-system.h"
+#include "ide-clang-index.h"
+#include "ide-clang-search-result.h"
+#include "ide-completion-item.h"
+#include "ide-context.h"
+#include "ide-debug.h"
+#include "ide-file.h"
+#include "ide-global.h"
+#include "ide-project.h"
+#include "ide-search-reducer.h"
+#include "ide-source-location.h"
+#include "ide-symbol.h"
+#include "ide-thread-pool.h"
+#include "ide-vcs.h"
+
+/*
+ * The index is stored as one GVariant per source file beneath
+ * ~/.cache/gnome-builder/<project-id>/clang-index/. Each file contains the
+ * path and mtime of the source file that was indexed followed by every
+ * declaration, definition and reference found in it, keyed by USR.
+ *
+ * Keeping a file per translation unit means that reindexing a single file
+ * after it was saved only requires rewriting a single small file, and the
+ * in-memory tables only need to drop and re-add the entries for that file.
+ */
+#define INDEX_VERSION      "1"
+#define INDEX_FORMAT       "(sxa(ssuuuu))"
+#define INDEX_ENTRY_FORMAT "(ssuuuu)"
+#define INDEX_ENTRY_ITER   "(&s&suuuu)"
+
+struct _IdeClangIndex
+{
+  IdeObject     parent_instance;
+
+  GCancellable *cancellable;
+  gchar        *cache_dir;
+
+  /* path => FileInfo */
+  GHashTable   *files;
+
+  /*
+   * USR => GArray of Posting, one for every location of the USR in the
+   * project. Lookups only visit the locations of the USR they ask for.
+   */
+  GHashTable   *usrs;
+
+  /*
+   * Fuzzy index of symbol names. It is rebuilt from @files on the indexer
+   * thread pool once indexing goes idle, or when a search finds it stale.
+   */
+  Fuzzy        *fuzzy;
+
+  /* Paths waiting to be (re)indexed, and a set to avoid duplicates. */
+  GQueue        queue;
+  GHashTable   *queued;
+
+  guint         busy : 1;
+  guint         loaded : 1;
+  guint         fuzzy_dirty : 1;
+  guint         fuzzy_building : 1;
+};
+
+typedef struct
+{
+  gchar    *path;
+  gint64    mtime;
+  GVariant *entries;
+} FileInfo;
+
+typedef struct
+{
+  FileInfo *info;
+  guint32   flags;
+  guint32   line;
+  guint32   column;
+} Posting;
+
+typedef struct
+{
+  gchar      *cache_dir;
+  gchar      *root;
+  GPtrArray  *loaded;
+  GPtrArray  *stale;
+} LoadState;
+
+typedef struct
+{
+  gchar     *cache_dir;
+  gchar     *path;
+  gchar    **argv;
+  gint64     mtime;
+} IndexRequest;
+
+typedef struct
+{
+  GCancellable    *cancellable;
+  CXFile           main_file;
+  GVariantBuilder  builder;
+} IndexState;
+
+G_DEFINE_TYPE (IdeClangIndex, ide_clang_index, IDE_TYPE_OBJECT)
+
+EGG_DEFINE_COUNTER (IndexedFiles,
+                    "Clang",
+                    "Indexed Files",
+                    "Number of source files added to the cross-reference index.")
+EGG_DEFINE_HISTOGRAM (IndexTime,
+                      "Clang",
+                      "Index Time",
+                      "Time to index a single source file (usec).")
+
+static void ide_clang_index_pump        (IdeClangIndex *self);
+static void ide_clang_index_build_fuzzy (IdeClangIndex *self);
+
+static void
+file_info_free (gpointer data)
+{
+  FileInfo *info = data;
+
+  g_free (info->path);
+  g_clear_pointer (&info->entries, g_variant_unref);
+  g_slice_free (FileInfo, info);
+}
+
+static void
+load_state_free (gpointer data)
+{
+  LoadState *state = data;
+
+  g_free (state->cache_dir);
+  g_free (state->root);
+  g_clear_pointer (&state->loaded, g_ptr_array_unref);
+  g_clear_pointer (&state->stale, g_ptr_array_unref);
+  g_slice_free (LoadState, state);
+}
+
+static void
+index_request_free (gpointer data)
+{
+  IndexRequest *request = data;
+
+  g_free (request->cache_dir);
+  g_free (request->path);
+  g_strfreev (request->argv);
+  g_slice_free (IndexRequest, request);
+}
+
+static gboolean
+is_indexable (const gchar *path)
+{
+  static const gchar *suffixes[] = {
+    ".c", ".h", ".cc", ".hh", ".cpp", ".hpp", ".cxx", ".hxx", NULL
+  };
+  const gchar *dot;
+  gsize i;
+
+  if (path == NULL || !(dot = strrchr (path, '.')))
+    return FALSE;
+
+  for (i = 0; suffixes [i]; i++)
+    {
+      if (g_str_equal (dot, suffixes [i]))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gchar *
+get_cache_path (const gchar *cache_dir,
+                const gchar *path)
+{
+  g_autofree gchar *checksum = NULL;
+  g_autofree gchar *name = NULL;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, path, -1);
+  name = g_strdup_printf ("%s.gvariant", checksum);
+
+  return g_build_filename (cache_dir, name, NULL);
+}
+
+static gint64
+get_mtime (const gchar *path)
+{
+  GStatBuf st;
+
+  if (g_stat (path, &st) != 0)
+    return -1;
+
+  return st.st_mtime;
+}
+
+static IdeSymbolKind
+get_symbol_kind (CXIdxEntityKind kind)
+{
+  switch (kind)
+    {
+    case CXIdxEntity_Function:
+    case CXIdxEntity_CXXStaticMethod:
+      return IDE_SYMBOL_FUNCTION;
+
+    case CXIdxEntity_CXXInstanceMethod:
+    case CXIdxEntity_CXXConstructor:
+    case CXIdxEntity_CXXDestructor:
+    case CXIdxEntity_CXXConversionFunction:
+      return IDE_SYMBOL_METHOD;
+
+    case CXIdxEntity_Variable:
+    case CXIdxEntity_CXXStaticVariable:
+      return IDE_SYMBOL_VARIABLE;
+
+    case CXIdxEntity_Field:
+      return IDE_SYMBOL_FIELD;
+
+    case CXIdxEntity_Enum:
+      return IDE_SYMBOL_ENUM;
+
+    case CXIdxEntity_EnumConstant:
+      return IDE_SYMBOL_ENUM_VALUE;
+
+    case CXIdxEntity_Struct:
+      return IDE_SYMBOL_STRUCT;
+
+    case CXIdxEntity_Union:
+      return IDE_SYMBOL_UNION;
+
+    case CXIdxEntity_CXXClass:
+    case CXIdxEntity_CXXInterface:
+      return IDE_SYMBOL_CLASS;
+
+    case CXIdxEntity_Typedef:
+    case CXIdxEntity_CXXTypeAlias:
+      return IDE_SYMBOL_SCALAR;
+
+    default:
+      return IDE_SYMBOL_NONE;
+    }
+}
+
+static void
+index_state_add (IndexState            *state,
+                 const CXIdxEntityInfo *entity,
+                 CXIdxLoc               loc,
+                 IdeClangIndexFlags     flags)
+{
+  CXFile file = NULL;
+  unsigned line = 0;
+  unsigned column = 0;
+
+  g_assert (state != NULL);
+
+  if (entity == NULL || entity->USR == NULL || entity->USR [0] == '\0')
+    return;
+
+  clang_indexLoc_getFileLocation (loc, NULL, &file, &line, &column, NULL);
+
+  /*
+   * Only record locations within the file being indexed. Headers are indexed
+   * as their own unit so that each location is owned by exactly one cache
+   * file and can be replaced when that file changes.
+   */
+  if (file == NULL || file != state->main_file)
+    return;
+
+  g_variant_builder_add (&state->builder,
+                         INDEX_ENTRY_FORMAT,
+                         entity->USR,
+                         entity->name ? entity->name : "",
+                         (guint32)get_symbol_kind (entity->kind),
+                         (guint32)flags,
+                         (guint32)(line > 0 ? line - 1 : 0),
+                         (guint32)(column > 0 ? column - 1 : 0));
+}
+
+static int
+index_abort_query (CXClientData  client_data,
+                   void         *reserved)
+{
+  IndexState *state = client_data;
+
+  return g_cancellable_is_cancelled (state->cancellable);
+}
+
+static CXIdxClientFile
+index_entered_main_file (CXClientData  client_data,
+                         CXFile        main_file,
+                         void         *reserved)
+{
+  IndexState *state = client_data;
+
+  state->main_file = main_file;
+
+  return NULL;
+}
+
+static void
+index_declaration (CXClientData         client_data,
+                   const CXIdxDeclInfo *info)
+{
+  IndexState *state = client_data;
+  IdeClangIndexFlags flags;
+
+  flags = info->isDefinition ? IDE_CLANG_INDEX_DEFINITION : IDE_CLANG_INDEX_DECLARATION;
+  index_state_add (state, info->entityInfo, info->loc, flags);
+}
+
+static void
+index_entity_reference (CXClientData              client_data,
+                        const CXIdxEntityRefInfo *info)
+{
+  IndexState *state = client_data;
+
+  index_state_add (state, info->referencedEntity, info->loc, IDE_CLANG_INDEX_REFERENCE);
+}
+
+static IndexerCallbacks index_callbacks = {
+  .abortQuery = index_abort_query,
+  .enteredMainFile = index_entered_main_file,
+  .indexDeclaration = index_declaration,
+  .indexEntityReference = index_entity_reference,
+};
+
+static void
+ide_clang_index_index_worker (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+  g_autofree gchar *cache_path = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  IndexRequest *request = task_data;
+  IndexState state = { 0 };
+  CXIndexAction action;
+  CXIndex index;
+  gint64 begin_time;
+  gint argc;
+  gint ret;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_CLANG_INDEX (source_object));
+  g_assert (request != NULL);
+  g_assert (request->path != NULL);
+
+  state.cancellable = cancellable;
+  g_variant_builder_init (&state.builder, G_VARIANT_TYPE ("a" INDEX_ENTRY_FORMAT));
+
+  argc = request->argv ? g_strv_length (request->argv) : 0;
+
+  index = clang_createIndex (0, 0);
+  clang_CXIndex_setGlobalOptions (index, CXGlobalOpt_ThreadBackgroundPriorityForIndexing);
+  action = clang_IndexAction_create (index);
+
+  begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
+  ret = clang_indexSourceFile (action,
+                               &state,
+                               &index_callbacks,
+                               sizeof (index_callbacks),
+                               CXIndexOpt_SuppressRedundantRefs | CXIndexOpt_SuppressWarnings,
+                               request->path,
+                               (const char * const *)request->argv,
+                               argc,
+                               NULL,
+                               0,
+                               NULL,
+                               CXTranslationUnit_Incomplete);
+  EGG_HISTOGRAM_TIMER_END (IndexTime, begin_time);
+
+  clang_IndexAction_dispose (action);
+  clang_disposeIndex (index);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_variant_builder_clear (&state.builder);
+      return;
+    }
+
+  /*
+   * Don't record a file that failed to index as having no symbols, or we
+   * would never try it again until it is modified.
+   */
+  if (ret != 0)
+    {
+      g_variant_builder_clear (&state.builder);
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_FAILED,
+                               "Failed to index \"%s\" (error %d)",
+                               request->path, ret);
+      return;
+    }
+
+  variant = g_variant_ref_sink (g_variant_new (INDEX_FORMAT,
+                                               request->path,
+                                               request->mtime,
+                                               &state.builder));
+
+  EGG_COUNTER_INC (IndexedFiles);
+
+  /*
+   * Failing to persist the index is not fatal, we'll just have to index the
+   * file again the next time the project is loaded.
+   */
+  bytes = g_variant_get_data_as_bytes (variant);
+  cache_path = get_cache_path (request->cache_dir, request->path);
+  if (!g_file_set_contents (cache_path,
+                            g_bytes_get_data (bytes, NULL),
+                            g_bytes_get_size (bytes),
+                            &error))
+    g_warning ("%s", error->message);
+
+  g_task_return_pointer (task, g_steal_pointer (&variant), (GDestroyNotify)g_variant_unref);
+}
+
+static void
+ide_clang_index_remove_file (IdeClangIndex *self,
+                             const gchar   *path)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GVariantIter iter;
+  const gchar *usr;
+  FileInfo *info;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (path != NULL);
+
+  if (!(info = g_hash_table_lookup (self->files, path)))
+    return;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_variant_iter_init (&iter, info->entries);
+
+  while (g_variant_iter_next (&iter, INDEX_ENTRY_ITER, &usr, NULL, NULL, NULL, NULL, NULL))
+    {
+      GArray *postings;
+      guint i;
+      guint j;
+
+      if (!g_hash_table_add (seen, (gchar *)usr) ||
+          !(postings = g_hash_table_lookup (self->usrs, usr)))
+        continue;
+
+      /* Drop every posting of the file at once, keeping the others in order */
+      for (i = 0, j = 0; i < postings->len; i++)
+        {
+          if (g_array_index (postings, Posting, i).info != info)
+            g_array_index (postings, Posting, j++) = g_array_index (postings, Posting, i);
+        }
+
+      if (j == 0)
+        g_hash_table_remove (self->usrs, usr);
+      else
+        g_array_set_size (postings, j);
+    }
+
+  g_hash_table_remove (self->files, path);
+
+  self->fuzzy_dirty = TRUE;
+}
+
+static void
+ide_clang_index_merge (IdeClangIndex *self,
+                       GVariant      *variant)
+{
+  GVariantIter iter;
+  const gchar *usr;
+  FileInfo *info;
+  Posting posting;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (variant != NULL);
+
+  info = g_slice_new0 (FileInfo);
+  g_variant_get (variant, "(sx@a" INDEX_ENTRY_FORMAT ")",
+                 &info->path, &info->mtime, &info->entries);
+
+  ide_clang_index_remove_file (self, info->path);
+  g_hash_table_insert (self->files, info->path, info);
+
+  g_variant_iter_init (&iter, info->entries);
+
+  while (g_variant_iter_next (&iter, INDEX_ENTRY_ITER,
+                              &usr, NULL, NULL, &posting.flags, &posting.line, &posting.column))
+    {
+      GArray *postings;
+
+      if (!(postings = g_hash_table_lookup (self->usrs, usr)))
+        {
+          postings = g_array_new (FALSE, FALSE, sizeof (Posting));
+          g_hash_table_insert (self->usrs, g_strdup (usr), postings);
+        }
+
+      posting.info = info;
+      g_array_append_val (postings, posting);
+    }
+
+  self->fuzzy_dirty = TRUE;
+}
+
+static void
+ide_clang_index_index_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->busy = FALSE;
+
+  if (!(variant = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+      g_warning ("%s", error->message);
+    }
+  else
+    {
+      ide_clang_index_merge (self, variant);
+    }
+
+  ide_clang_index_pump (self);
+}
+
+static void
+ide_clang_index_get_build_flags_cb (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  IdeBuildSystem *build_system = (IdeBuildSystem *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+  IndexRequest *request;
+
+  g_assert (IDE_IS_BUILD_SYSTEM (build_system));
+  g_assert (G_IS_TASK (task));
+
+  request = g_task_get_task_data (task);
+  request->argv = ide_build_system_get_build_flags_finish (build_system, result, &error);
+
+  /* Headers rarely have flags of their own, index them with defaults. */
+  if (request->argv == NULL)
+    request->argv = g_new0 (gchar *, 1);
+
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, ide_clang_index_index_worker);
+}
+
+static void
+ide_clang_index_pump (IdeClangIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(IdeFile) file = NULL;
+  IdeBuildSystem *build_system;
+  IndexRequest *request;
+  IdeContext *context;
+  gchar *path;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+
+  /*
+   * Only a single file is indexed at a time. This is a background operation
+   * and should not compete with the translation units the user is waiting on.
+   */
+  if (self->busy || g_cancellable_is_cancelled (self->cancellable))
+    return;
+
+  if (!(path = g_queue_pop_head (&self->queue)))
+    {
+      /* Indexing went idle, catch the fuzzy index up with it. */
+      if (self->fuzzy_dirty)
+        ide_clang_index_build_fuzzy (self);
+      return;
+    }
+
+  g_hash_table_remove (self->queued, path);
+
+  request = g_slice_new0 (IndexRequest);
+  request->cache_dir = g_strdup (self->cache_dir);
+  request->path = path;
+  request->mtime = get_mtime (path);
+
+  if (request->mtime < 0)
+    {
+      ide_clang_index_remove_file (self, path);
+      index_request_free (request);
+      ide_clang_index_pump (self);
+      return;
+    }
+
+  self->busy = TRUE;
+
+  task = g_task_new (self, self->cancellable, ide_clang_index_index_cb, NULL);
+  g_task_set_task_data (task, request, index_request_free);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  build_system = ide_context_get_build_system (context);
+  file = ide_file_new_for_path (context, path);
+
+  ide_build_system_get_build_flags_async (build_system,
+                                          file,
+                                          self->cancellable,
+                                          ide_clang_index_get_build_flags_cb,
+                                          g_object_ref (task));
+}
+
+static void
+ide_clang_index_queue_path (IdeClangIndex *self,
+                            const gchar   *path)
+{
+  gchar *copy;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (path != NULL);
+
+  if (g_hash_table_contains (self->queued, path))
+    return;
+
+  copy = g_strdup (path);
+  g_hash_table_add (self->queued, copy);
+  g_queue_push_tail (&self->queue, g_strdup (copy));
+}
+
+/**
+ * ide_clang_index_queue_file:
+ * @self: An #IdeClangIndex
+ * @file: A #GFile
+ *
+ * Requests that @file is reindexed, typically because it was saved. Files
+ * that are not C or C++ sources are ignored.
+ */
+void
+ide_clang_index_queue_file (IdeClangIndex *self,
+                            GFile         *file)
+{
+  g_autofree gchar *path = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_INDEX (self));
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!(path = g_file_get_path (file)) || !is_indexable (path))
+    return;
+
+  ide_clang_index_queue_path (self, path);
+
+  if (self->loaded)
+    ide_clang_index_pump (self);
+}
+
+static void
+ide_clang_index_scan_directory (const gchar  *directory,
+                                GHashTable   *mtimes,
+                                GPtrArray    *stale,
+                                GCancellable *cancellable)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  if (!(dir = g_dir_open (directory, 0, NULL)))
+    return;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      g_autofree gchar *path = NULL;
+
+      /* Skip .git, .libs, .deps and friends. */
+      if (name [0] == '.')
+        continue;
+
+      path = g_build_filename (directory, name, NULL);
+
+      if (g_file_test (path, G_FILE_TEST_IS_SYMLINK))
+        continue;
+
+      if (g_file_test (path, G_FILE_TEST_IS_DIR))
+        {
+          ide_clang_index_scan_directory (path, mtimes, stale, cancellable);
+        }
+      else if (is_indexable (name))
+        {
+          gpointer cached;
+
+          if (!g_hash_table_lookup_extended (mtimes, path, NULL, &cached) ||
+              GPOINTER_TO_SIZE (cached) != (gsize)get_mtime (path))
+            g_ptr_array_add (stale, g_strdup (path));
+
+          g_hash_table_remove (mtimes, path);
+        }
+    }
+}
+
+static void
+ide_clang_index_load_worker (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable)
+{
+  g_autoptr(GHashTable) mtimes = NULL;
+  g_autoptr(GDir) dir = NULL;
+  LoadState *state = task_data;
+  const gchar *name;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_CLANG_INDEX (source_object));
+  g_assert (state != NULL);
+
+  /* path => mtime of every file found in the cache, owned by the variants */
+  mtimes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (g_mkdir_with_parents (state->cache_dir, 0750) != 0)
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               g_io_error_from_errno (errno),
+                               "%s", g_strerror (errno));
+      return;
+    }
+
+  if ((dir = g_dir_open (state->cache_dir, 0, NULL)))
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          g_autofree gchar *path = NULL;
+          g_autoptr(GMappedFile) mapped = NULL;
+          g_autoptr(GBytes) bytes = NULL;
+          GVariant *variant;
+          const gchar *source_path;
+          gint64 mtime;
+
+          if (!g_str_has_suffix (name, ".gvariant"))
+            continue;
+
+          path = g_build_filename (state->cache_dir, name, NULL);
+
+          if (!(mapped = g_mapped_file_new (path, FALSE, NULL)))
+            continue;
+
+          bytes = g_mapped_file_get_bytes (mapped);
+          variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (INDEX_FORMAT),
+                                                                  bytes, FALSE));
+          g_variant_get (variant, "(&sxa" INDEX_ENTRY_FORMAT ")", &source_path, &mtime, NULL);
+
+          if (!g_str_has_prefix (source_path, state->root) || get_mtime (source_path) < 0)
+            {
+              g_unlink (path);
+              g_variant_unref (variant);
+              continue;
+            }
+
+          g_hash_table_insert (mtimes, (gchar *)source_path, GSIZE_TO_POINTER (mtime));
+          g_ptr_array_add (state->loaded, variant);
+        }
+    }
+
+  ide_clang_index_scan_directory (state->root, mtimes, state->stale, cancellable);
+
+  /*
+   * Anything left over was not found while scanning the project tree, such as
+   * files that moved beneath a hidden directory. Drop them from the index.
+   */
+  for (i = state->loaded->len; i > 0; i--)
+    {
+      GVariant *variant = g_ptr_array_index (state->loaded, i - 1);
+      g_autofree gchar *path = NULL;
+      const gchar *source_path;
+
+      g_variant_get (variant, "(&sxa" INDEX_ENTRY_FORMAT ")", &source_path, NULL, NULL);
+
+      if (g_hash_table_contains (mtimes, source_path))
+        {
+          path = get_cache_path (state->cache_dir, source_path);
+          g_unlink (path);
+          g_hash_table_remove (mtimes, source_path);
+          g_ptr_array_remove_index_fast (state->loaded, i - 1);
+        }
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+ide_clang_index_load_cb (GObject      *object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+  g_autoptr(GError) error = NULL;
+  LoadState *state;
+  gsize i;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      IDE_EXIT;
+    }
+
+  state = g_task_get_task_data (G_TASK (result));
+
+  for (i = 0; i < state->loaded->len; i++)
+    {
+      GVariant *variant = g_ptr_array_index (state->loaded, i);
+      const gchar *path;
+
+      g_variant_get (variant, "(&sxa" INDEX_ENTRY_FORMAT ")", &path, NULL, NULL);
+
+      /* Don't replace entries from files indexed while we were loading. */
+      if (!g_hash_table_contains (self->files, path))
+        ide_clang_index_merge (self, variant);
+    }
+
+  for (i = 0; i < state->stale->len; i++)
+    ide_clang_index_queue_path (self, g_ptr_array_index (state->stale, i));
+
+  IDE_TRACE_MSG ("Loaded %u cached files, %u files to index",
+                 state->loaded->len, state->stale->len);
+
+  self->loaded = TRUE;
+
+  ide_clang_index_pump (self);
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_clang_index_load:
+ * @self: An #IdeClangIndex
+ *
+ * Loads the persisted index for the project and queues every C or C++ file
+ * within the project tree that has changed since it was last indexed.
+ */
+void
+ide_clang_index_load (IdeClangIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+  IdeContext *context;
+  LoadState *state;
+  IdeVcs *vcs;
+  GFile *workdir;
+
+  IDE_ENTRY;
+
+  g_return_if_fail (IDE_IS_CLANG_INDEX (self));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (context);
+  workdir = ide_vcs_get_working_directory (vcs);
+
+  state = g_slice_new0 (LoadState);
+  state->cache_dir = g_strdup (self->cache_dir);
+  state->root = g_file_get_path (workdir);
+  state->loaded = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+  state->stale = g_ptr_array_new_with_free_func (g_free);
+
+  task = g_task_new (self, self->cancellable, ide_clang_index_load_cb, NULL);
+  g_task_set_task_data (task, state, load_state_free);
+
+  if (state->root == NULL)
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_NOT_SUPPORTED,
+                               "Only local projects can be indexed");
+      IDE_EXIT;
+    }
+
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, ide_clang_index_load_worker);
+
+  IDE_EXIT;
+}
+
+/**
+ * ide_clang_index_lookup:
+ * @self: An #IdeClangIndex
+ * @usr: The unified symbol resolution of the symbol
+ * @flags: the kinds of locations to look for
+ *
+ * Looks up the locations within the project that declare, define or reference
+ * the symbol identified by @usr, depending on @flags. Only the locations of
+ * @usr are visited, so this is cheap enough to call from the main thread.
+ *
+ * Returns: (transfer container) (element-type Ide.SourceLocation): An array of
+ *   #IdeSourceLocation, which may be empty.
+ */
+GPtrArray *
+ide_clang_index_lookup (IdeClangIndex      *self,
+                        const gchar        *usr,
+                        IdeClangIndexFlags  flags)
+{
+  g_autoptr(IdeFile) file = NULL;
+  FileInfo *file_info = NULL;
+  GPtrArray *ret;
+  IdeContext *context;
+  GArray *postings;
+  gsize i;
+
+  g_return_val_if_fail (IDE_IS_CLANG_INDEX (self), NULL);
+  g_return_val_if_fail (usr != NULL, NULL);
+
+  ret = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_source_location_unref);
+
+  if (!(postings = g_hash_table_lookup (self->usrs, usr)))
+    return ret;
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+
+  for (i = 0; i < postings->len; i++)
+    {
+      const Posting *posting = &g_array_index (postings, Posting, i);
+
+      if ((posting->flags & flags) == 0)
+        continue;
+
+      /* Postings of a file are contiguous, so reuse the IdeFile */
+      if (posting->info != file_info)
+        {
+          g_clear_object (&file);
+          file_info = posting->info;
+          file = ide_file_new_for_path (context, file_info->path);
+        }
+
+      g_ptr_array_add (ret, ide_source_location_new (file, posting->line, posting->column, 0));
+    }
+
+  return ret;
+}
+
+static void
+ide_clang_index_build_fuzzy_worker (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *entries = task_data;
+  Fuzzy *fuzzy;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_CLANG_INDEX (source_object));
+  g_assert (entries != NULL);
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  fuzzy = fuzzy_new_with_free_func (FALSE, g_free);
+
+  fuzzy_begin_bulk_insert (fuzzy);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      GVariantIter viter;
+      const gchar *usr;
+      const gchar *name;
+      guint32 kind;
+      guint32 flags;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      g_variant_iter_init (&viter, g_ptr_array_index (entries, i));
+
+      while (g_variant_iter_next (&viter, INDEX_ENTRY_ITER,
+                                  &usr, &name, &kind, &flags, NULL, NULL))
+        {
+          if ((flags & IDE_CLANG_INDEX_REFERENCE) != 0 ||
+              kind == IDE_SYMBOL_NONE ||
+              name [0] == '\0' ||
+              g_hash_table_contains (seen, usr))
+            continue;
+
+          g_hash_table_add (seen, (gchar *)usr);
+          fuzzy_insert (fuzzy, name, g_strdup (usr));
+        }
+    }
+
+  fuzzy_end_bulk_insert (fuzzy);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      fuzzy_unref (fuzzy);
+      return;
+    }
+
+  g_task_return_pointer (task, fuzzy, (GDestroyNotify)fuzzy_unref);
+}
+
+static void
+ide_clang_index_build_fuzzy_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+  g_autoptr(GError) error = NULL;
+  Fuzzy *fuzzy;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->fuzzy_building = FALSE;
+
+  if (!(fuzzy = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      return;
+    }
+
+  g_clear_pointer (&self->fuzzy, fuzzy_unref);
+  self->fuzzy = fuzzy;
+
+  /* Files were merged while building, go again if indexing is idle. */
+  if (self->fuzzy_dirty && !self->busy && self->queue.length == 0)
+    ide_clang_index_build_fuzzy (self);
+}
+
+/*
+ * Rebuilds the fuzzy index on the indexer thread pool. The entries of each
+ * file are immutable GVariants, so the worker only needs a reference to
+ * them. Searches keep using the previous fuzzy index until this completes.
+ */
+static void
+ide_clang_index_build_fuzzy (IdeClangIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+  GHashTableIter iter;
+  GPtrArray *entries;
+  FileInfo *info;
+
+  g_assert (IDE_IS_CLANG_INDEX (self));
+
+  if (self->fuzzy_building || g_cancellable_is_cancelled (self->cancellable))
+    return;
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+
+  g_hash_table_iter_init (&iter, self->files);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&info))
+    g_ptr_array_add (entries, g_variant_ref (info->entries));
+
+  self->fuzzy_dirty = FALSE;
+  self->fuzzy_building = TRUE;
+
+  task = g_task_new (self, self->cancellable, ide_clang_index_build_fuzzy_cb, NULL);
+  g_task_set_task_data (task, entries, (GDestroyNotify)g_ptr_array_unref);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, ide_clang_index_build_fuzzy_worker);
+}
+
+/**
+ * ide_clang_index_populate:
+ * @self: An #IdeClangIndex
+ * @context: An #IdeSearchContext
+ * @provider: The #IdeSearchProvider to post results for
+ * @query: the search terms
+ *
+ * Adds the symbols within the project matching @query to @context.
+ */
+void
+ide_clang_index_populate (IdeClangIndex     *self,
+                          IdeSearchContext  *context,
+                          IdeSearchProvider *provider,
+                          const gchar       *query)
+{
+  g_auto(IdeSearchReducer) reducer = { 0 };
+  g_autoptr(GArray) ar = NULL;
+  IdeContext *icontext;
+  IdeVcs *vcs;
+  GFile *workdir;
+  gsize max_matches;
+  gsize i;
+
+  g_return_if_fail (IDE_IS_CLANG_INDEX (self));
+  g_return_if_fail (IDE_IS_SEARCH_CONTEXT (context));
+  g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
+  g_return_if_fail (query != NULL);
+
+  /*
+   * Never build the fuzzy index on the main thread. Until the first build
+   * completes there is nothing to search; after that a stale index is
+   * better than none.
+   */
+  if (self->fuzzy == NULL || self->fuzzy_dirty)
+    ide_clang_index_build_fuzzy (self);
+
+  if (self->fuzzy == NULL)
+    return;
+
+  icontext = ide_object_get_context (IDE_OBJECT (self));
+  vcs = ide_context_get_vcs (icontext);
+  workdir = ide_vcs_get_working_directory (vcs);
+  max_matches = ide_search_context_get_max_results (context);
+  ide_search_reducer_init (&reducer, context, provider, max_matches);
+
+  ar = fuzzy_match (self->fuzzy, query, max_matches);
+
+  for (i = 0; i < ar->len; i++)
+    {
+      g_autoptr(IdeClangSearchResult) result = NULL;
+      g_autoptr(GPtrArray) locations = NULL;
+      g_autofree gchar *markup = NULL;
+      g_autofree gchar *subtitle = NULL;
+      g_autofree gchar *relative = NULL;
+      IdeSourceLocation *location;
+      GFile *gfile;
+      FuzzyMatch *match;
+
+      match = &g_array_index (ar, FuzzyMatch, i);
+
+      if (!ide_search_reducer_accepts (&reducer, match->score))
+        continue;
+
+      locations = ide_clang_index_lookup (self, match->value, IDE_CLANG_INDEX_DEFINITION);
+      if (locations->len == 0)
+        {
+          g_ptr_array_unref (locations);
+          locations = ide_clang_index_lookup (self, match->value, IDE_CLANG_INDEX_DECLARATION);
+          if (locations->len == 0)
+            continue;
+        }
+
+      location = g_ptr_array_index (locations, 0);
+      gfile = ide_file_get_file (ide_source_location_get_file (location));
+      if (!(relative = g_file_get_relative_path (workdir, gfile)))
+        relative = g_file_get_path (gfile);
+      subtitle = g_strdup_printf ("%s:%u", relative, ide_source_location_get_line (location) + 1);
+      markup = ide_completion_item_fuzzy_highlight (match->key, query);
+
+      result = g_object_new (IDE_TYPE_CLANG_SEARCH_RESULT,
+                             "context", icontext,
+                             "provider", provider,
+                             "score", match->score,
+                             "title", markup,
+                             "subtitle", subtitle,
+                             "location", location,
+                             NULL);
+      ide_search_reducer_push (&reducer, IDE_SEARCH_RESULT (result));
+    }
+}
+
+/**
+ * ide_clang_index_cancel:
+ * @self: An #IdeClangIndex
+ *
+ * Stops indexing and drops any files still waiting to be indexed. Pending
+ * operations hold a reference to @self, so this must be called when the
+ * project is closed rather than relying on dispose.
+ */
+void
+ide_clang_index_cancel (IdeClangIndex *self)
+{
+  g_return_if_fail (IDE_IS_CLANG_INDEX (self));
+
+  g_cancellable_cancel (self->cancellable);
+
+  g_queue_foreach (&self->queue, (GFunc)g_free, NULL);
+  g_queue_clear (&self->queue);
+  g_hash_table_remove_all (self->queued);
+}
+
+static void
+ide_clang_index_constructed (GObject *object)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+  IdeContext *context;
+  IdeProject *project;
+
+  G_OBJECT_CLASS (ide_clang_index_parent_class)->constructed (object);
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  project = ide_context_get_project (context);
+
+  self->cache_dir = g_build_filename (g_get_user_cache_dir (),
+                                      ide_get_program_name (),
+                                      ide_project_get_id (project),
+                                      "clang-index",
+                                      INDEX_VERSION,
+                                      NULL);
+}
+
+static void
+ide_clang_index_dispose (GObject *object)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+
+  g_cancellable_cancel (self->cancellable);
+
+  G_OBJECT_CLASS (ide_clang_index_parent_class)->dispose (object);
+}
+
+static void
+ide_clang_index_finalize (GObject *object)
+{
+  IdeClangIndex *self = (IdeClangIndex *)object;
+
+  g_queue_foreach (&self->queue, (GFunc)g_free, NULL);
+  g_queue_clear (&self->queue);
+
+  g_clear_pointer (&self->queued, g_hash_table_unref);
+  g_clear_pointer (&self->usrs, g_hash_table_unref);
+  g_clear_pointer (&self->files, g_hash_table_unref);
+  g_clear_pointer (&self->fuzzy, fuzzy_unref);
+  g_clear_pointer (&self->cache_dir, g_free);
+  g_clear_object (&self->cancellable);
+
+  G_OBJECT_CLASS (ide_clang_index_parent_class)->finalize (object);
+}
+
+static void
+ide_clang_index_class_init (IdeClangIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = ide_clang_index_constructed;
+  object_class->dispose = ide_clang_index_dispose;
+  object_class->finalize = ide_clang_index_finalize;
+}
+
+static void
+ide_clang_index_init (IdeClangIndex *self)
+{
+  self->cancellable = g_cancellable_new ();
+  self->files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, file_info_free);
+  self->usrs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                      (GDestroyNotify)g_array_unref);
+  self->queued = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_queue_init (&self->queue);
+}
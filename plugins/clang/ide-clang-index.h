@@ -0,0 +1,53 @@
+/* ide-clang-index.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_CLANG_INDEX_H
+#define IDE_CLANG_INDEX_H
+
+#include "ide-object.h"
+#include "ide-search-context.h"
+#include "ide-search-provider.h"
+
+G_BEGIN_DECLS
+
+#define IDE_TYPE_CLANG_INDEX (ide_clang_index_get_type())
+
+G_DECLARE_FINAL_TYPE (IdeClangIndex, ide_clang_index, IDE, CLANG_INDEX, IdeObject)
+
+typedef enum
+{
+  IDE_CLANG_INDEX_DECLARATION = 1 << 0,
+  IDE_CLANG_INDEX_DEFINITION  = 1 << 1,
+  IDE_CLANG_INDEX_REFERENCE   = 1 << 2,
+} IdeClangIndexFlags;
+
+void       ide_clang_index_load       (IdeClangIndex      *self);
+void       ide_clang_index_cancel     (IdeClangIndex      *self);
+void       ide_clang_index_queue_file (IdeClangIndex      *self,
+                                       GFile              *file);
+GPtrArray *ide_clang_index_lookup     (IdeClangIndex      *self,
+                                       const gchar        *usr,
+                                       IdeClangIndexFlags  flags);
+void       ide_clang_index_populate   (IdeClangIndex      *self,
+                                       IdeSearchContext   *context,
+                                       IdeSearchProvider  *provider,
+                                       const gchar        *query);
+
+G_END_DECLS
+
+#endif /* IDE_CLANG_INDEX_H */
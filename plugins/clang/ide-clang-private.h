@@ -25,6 +25,7 @@
 
 #include "ide-clang-service.h"
 #include "ide-clang-symbol-node.h"
+#include "ide-clang-symbol-tree.h"
 #include "ide-clang-translation-unit.h"
 #include "ide-highlight-index.h"
 
@@ -38,10 +39,10 @@ IdeClangTranslationUnit *_ide_clang_translation_unit_new     (IdeContext
 void                     _ide_clang_dispose_string           (CXString           *str);
 IdeSymbolNode           *_ide_clang_symbol_node_new          (IdeContext         *context,
                                                               CXCursor            cursor);
-CXCursor                 _ide_clang_symbol_node_get_cursor   (IdeClangSymbolNode *self);
-GArray                  *_ide_clang_symbol_node_get_children (IdeClangSymbolNode *self);
+GPtrArray               *_ide_clang_symbol_node_get_children (IdeClangSymbolNode *self);
 void                     _ide_clang_symbol_node_set_children (IdeClangSymbolNode *self,
-                                                              GArray             *children);
+                                                              GPtrArray          *children);
+void                     _ide_clang_symbol_tree_build        (IdeClangSymbolTree *self);
 
 G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (CXString, _ide_clang_dispose_string)
 
@@ -0,0 +1,140 @@
+/* ide-clang-search-provider.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-clang-search-provider"
+
+#include <glib/gi18n.h>
+#include <ide.h>
+
+#include "ide-clang-index.h"
+#include "ide-clang-search-provider.h"
+#include "ide-clang-search-result.h"
+#include "ide-clang-service.h"
+
+struct _IdeClangSearchProvider
+{
+  IdeObject parent_instance;
+};
+
+static void search_provider_iface_init (IdeSearchProviderInterface *iface);
+
+G_DEFINE_TYPE_EXTENDED (IdeClangSearchProvider,
+                        ide_clang_search_provider,
+                        IDE_TYPE_OBJECT,
+                        0,
+                        G_IMPLEMENT_INTERFACE (IDE_TYPE_SEARCH_PROVIDER,
+                                               search_provider_iface_init))
+
+static const gchar *
+ide_clang_search_provider_get_verb (IdeSearchProvider *provider)
+{
+  return _("Symbols");
+}
+
+static gint
+ide_clang_search_provider_get_priority (IdeSearchProvider *provider)
+{
+  return 50;
+}
+
+static void
+ide_clang_search_provider_populate (IdeSearchProvider *provider,
+                                    IdeSearchContext  *context,
+                                    const gchar       *search_terms,
+                                    gsize              max_results,
+                                    GCancellable      *cancellable)
+{
+  IdeClangSearchProvider *self = (IdeClangSearchProvider *)provider;
+  IdeClangService *service;
+  IdeClangIndex *index;
+  IdeContext *icontext;
+
+  g_assert (IDE_IS_CLANG_SEARCH_PROVIDER (self));
+  g_assert (IDE_IS_SEARCH_CONTEXT (context));
+  g_assert (search_terms != NULL);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  icontext = ide_object_get_context (IDE_OBJECT (self));
+  service = ide_context_get_service_typed (icontext, IDE_TYPE_CLANG_SERVICE);
+
+  if (search_terms [0] != '\0' &&
+      service != NULL &&
+      (index = ide_clang_service_get_index (service)))
+    ide_clang_index_populate (index, context, provider, search_terms);
+
+  ide_search_context_provider_completed (context, provider);
+}
+
+static GtkWidget *
+ide_clang_search_provider_create_row (IdeSearchProvider *provider,
+                                      IdeSearchResult   *result)
+{
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (IDE_IS_SEARCH_RESULT (result));
+
+  return g_object_new (IDE_TYPE_OMNI_SEARCH_ROW,
+                       "icon-name", "lang-function-symbolic",
+                       "result", result,
+                       "visible", TRUE,
+                       NULL);
+}
+
+static void
+ide_clang_search_provider_activate (IdeSearchProvider *provider,
+                                    GtkWidget         *row,
+                                    IdeSearchResult   *result)
+{
+  IdeSourceLocation *location;
+  IdePerspective *editor;
+  GtkWidget *toplevel;
+
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (GTK_IS_WIDGET (row));
+  g_assert (IDE_IS_CLANG_SEARCH_RESULT (result));
+
+  toplevel = gtk_widget_get_toplevel (row);
+
+  if (!IDE_IS_WORKBENCH (toplevel))
+    return;
+
+  editor = ide_workbench_get_perspective_by_name (IDE_WORKBENCH (toplevel), "editor");
+  location = ide_clang_search_result_get_location (IDE_CLANG_SEARCH_RESULT (result));
+
+  if (editor != NULL && location != NULL)
+    ide_editor_perspective_focus_location (IDE_EDITOR_PERSPECTIVE (editor), location);
+}
+
+static void
+ide_clang_search_provider_class_init (IdeClangSearchProviderClass *klass)
+{
+}
+
+static void
+ide_clang_search_provider_init (IdeClangSearchProvider *self)
+{
+}
+
+static void
+search_provider_iface_init (IdeSearchProviderInterface *iface)
+{
+  iface->get_verb = ide_clang_search_provider_get_verb;
+  iface->get_priority = ide_clang_search_provider_get_priority;
+  iface->populate = ide_clang_search_provider_populate;
+  iface->create_row = ide_clang_search_provider_create_row;
+  iface->activate = ide_clang_search_provider_activate;
+}
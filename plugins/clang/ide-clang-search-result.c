@@ -0,0 +1,121 @@
+/* ide-clang-search-result.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ide-clang-search-result.h"
+
+struct _IdeClangSearchResult
+{
+  IdeSearchResult    parent_instance;
+  IdeSourceLocation *location;
+};
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  LAST_PROP
+};
+
+G_DEFINE_TYPE (IdeClangSearchResult, ide_clang_search_result, IDE_TYPE_SEARCH_RESULT)
+
+static GParamSpec *properties [LAST_PROP];
+
+/**
+ * ide_clang_search_result_get_location:
+ *
+ * Returns: (transfer none): An #IdeSourceLocation.
+ */
+IdeSourceLocation *
+ide_clang_search_result_get_location (IdeClangSearchResult *self)
+{
+  g_return_val_if_fail (IDE_IS_CLANG_SEARCH_RESULT (self), NULL);
+
+  return self->location;
+}
+
+static void
+ide_clang_search_result_finalize (GObject *object)
+{
+  IdeClangSearchResult *self = (IdeClangSearchResult *)object;
+
+  g_clear_pointer (&self->location, ide_source_location_unref);
+
+  G_OBJECT_CLASS (ide_clang_search_result_parent_class)->finalize (object);
+}
+
+static void
+ide_clang_search_result_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  IdeClangSearchResult *self = IDE_CLANG_SEARCH_RESULT (object);
+
+  switch (prop_id)
+    {
+    case PROP_LOCATION:
+      g_value_set_boxed (value, self->location);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+ide_clang_search_result_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  IdeClangSearchResult *self = IDE_CLANG_SEARCH_RESULT (object);
+
+  switch (prop_id)
+    {
+    case PROP_LOCATION:
+      self->location = g_value_dup_boxed (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+ide_clang_search_result_class_init (IdeClangSearchResultClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = ide_clang_search_result_finalize;
+  object_class->get_property = ide_clang_search_result_get_property;
+  object_class->set_property = ide_clang_search_result_set_property;
+
+  properties [PROP_LOCATION] =
+    g_param_spec_boxed ("location",
+                        "Location",
+                        "The location of the symbol definition.",
+                        IDE_TYPE_SOURCE_LOCATION,
+                        (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, LAST_PROP, properties);
+}
+
+static void
+ide_clang_search_result_init (IdeClangSearchResult *self)
+{
+}
@@ -24,8 +24,11 @@
 #include "egg-counter.h"
 #include "egg-task-cache.h"
 
+#include "ide-buffer.h"
+#include "ide-buffer-manager.h"
 #include "ide-clang-highlighter.h"
 #include "ide-build-system.h"
+#include "ide-clang-index.h"
 #include "ide-clang-private.h"
 #include "ide-clang-service.h"
 #include "ide-context.h"
@@ -42,9 +45,18 @@ struct _IdeClangService
 {
   IdeObject     parent_instance;
 
-  CXIndex       index;
-  GCancellable *cancellable;
-  EggTaskCache *units_cache;
+  CXIndex        index;
+  GCancellable  *cancellable;
+  EggTaskCache  *units_cache;
+  IdeClangIndex *xref_index;
+
+  /*
+   * Highlight contributions of included files, keyed by path, shared by all
+   * of the translation units that include them. Protected by header_mutex
+   * since translation units are parsed on the compiler thread pool.
+   */
+  GMutex         header_mutex;
+  GHashTable    *header_indexes;
 };
 
 typedef struct
@@ -60,9 +72,31 @@ typedef struct
 
 typedef struct
 {
+  IdeHighlightIndex *index;
+  time_t             mtime;
+} HeaderIndex;
+
+typedef struct
+{
+  IdeClangService   *self;
   IdeHighlightIndex *index;
   CXFile             file;
   const gchar       *filename;
+
+  /* Index that cursors of the current top-level declaration go into. */
+  IdeHighlightIndex *target;
+
+  /* CXFile => target index for that file, or NULL to skip it. */
+  GHashTable        *targets;
+  CXFile             last_file;
+  IdeHighlightIndex *last_target;
+
+  /* Paths of files with unsaved changes, these are never cached. */
+  GHashTable        *unsaved;
+
+  /* Header indexes to merge into @index, and path => HeaderIndex we created. */
+  GPtrArray         *merge;
+  GHashTable        *created;
 } IndexRequest;
 
 static void service_iface_init (IdeServiceInterface *iface);
@@ -74,6 +108,31 @@ EGG_DEFINE_COUNTER (ParseAttempts,
                     "Clang",
                     "Total Parse Attempts",
                     "Total number of attempts to create a translation unit.")
+EGG_DEFINE_HISTOGRAM (ParseTime,
+                      "Clang",
+                      "Parse Time",
+                      "Time to create a translation unit (usec).")
+EGG_DEFINE_HISTOGRAM (HighlightIndexTime,
+                      "Clang",
+                      "Highlight Index Time",
+                      "Time to build the highlight index for a translation unit (usec).")
+EGG_DEFINE_COUNTER (HeaderIndexHits,
+                    "Clang",
+                    "Header Index Hits",
+                    "Number of included files whose highlight index was reused.")
+EGG_DEFINE_COUNTER (HeaderIndexMisses,
+                    "Clang",
+                    "Header Index Misses",
+                    "Number of included files whose highlight index was built.")
+
+static void
+header_index_free (gpointer data)
+{
+  HeaderIndex *header = data;
+
+  g_clear_pointer (&header->index, ide_highlight_index_unref);
+  g_slice_free (HeaderIndex, header);
+}
 
 static void
 parse_request_free (gpointer data)
@@ -137,13 +196,106 @@ ide_clang_service_build_index_visitor (CXCursor     cursor,
 
       cxstr = clang_getCursorSpelling (cursor);
       word = clang_getCString (cxstr);
-      ide_highlight_index_insert (request->index, word, (gpointer)style_name);
+      ide_highlight_index_insert (request->target, word, (gpointer)style_name);
       clang_disposeString (cxstr);
     }
 
   return CXChildVisit_Continue;
 }
 
+static IdeHighlightIndex *
+ide_clang_service_get_header_target (IdeClangService *self,
+                                     IndexRequest    *request,
+                                     CXFile           file)
+{
+  g_auto(CXString) cxname = { 0 };
+  IdeHighlightIndex *target = NULL;
+  HeaderIndex *header;
+  const gchar *name;
+  gboolean cached = FALSE;
+  time_t mtime;
+
+  g_assert (IDE_IS_CLANG_SERVICE (self));
+  g_assert (request != NULL);
+
+  if (file == NULL || file == request->file)
+    return request->index;
+
+  if (g_hash_table_lookup_extended (request->targets, file, NULL, (gpointer *)&target))
+    return target;
+
+  cxname = clang_getFileName (file);
+  name = clang_getCString (cxname);
+  mtime = clang_getFileTime (file);
+
+  if (name == NULL || g_hash_table_contains (request->unsaved, name))
+    {
+      /* Contents may not match what is on disk, so don't share them. */
+      target = request->index;
+    }
+  else
+    {
+      g_mutex_lock (&self->header_mutex);
+      header = g_hash_table_lookup (self->header_indexes, name);
+      if (header != NULL && header->mtime == mtime)
+        {
+          g_ptr_array_add (request->merge, ide_highlight_index_ref (header->index));
+          cached = TRUE;
+        }
+      g_mutex_unlock (&self->header_mutex);
+
+      if (!cached)
+        {
+          header = g_slice_new0 (HeaderIndex);
+          header->index = ide_highlight_index_new ();
+          header->mtime = mtime;
+          g_hash_table_insert (request->created, g_strdup (name), header);
+          g_ptr_array_add (request->merge, ide_highlight_index_ref (header->index));
+          target = header->index;
+        }
+
+      if (cached)
+        EGG_COUNTER_INC (HeaderIndexHits);
+      else
+        EGG_COUNTER_INC (HeaderIndexMisses);
+    }
+
+  g_hash_table_insert (request->targets, file, target);
+
+  return target;
+}
+
+static enum CXChildVisitResult
+ide_clang_service_build_index_toplevel_visitor (CXCursor     cursor,
+                                                CXCursor     parent,
+                                                CXClientData user_data)
+{
+  IndexRequest *request = user_data;
+  IdeClangService *self = request->self;
+  CXSourceLocation location;
+  CXFile file = NULL;
+
+  g_assert (request != NULL);
+
+  location = clang_getCursorLocation (cursor);
+  clang_getSpellingLocation (location, &file, NULL, NULL, NULL);
+
+  /* Declarations from one file are usually adjacent. */
+  if (file != request->last_file)
+    {
+      request->last_file = file;
+      request->last_target = ide_clang_service_get_header_target (self, request, file);
+    }
+
+  /* The file has already been indexed by another translation unit. */
+  if (request->last_target == NULL)
+    return CXChildVisit_Continue;
+
+  request->target = request->last_target;
+
+  return ide_clang_service_build_index_visitor (cursor, parent, user_data);
+}
+
 static IdeHighlightIndex *
 ide_clang_service_build_index (IdeClangService   *self,
                                CXTranslationUnit  tu,
@@ -152,10 +304,18 @@ ide_clang_service_build_index (IdeClangService   *self,
   static const gchar *common_defines[] = {
     "NULL", "MIN", "MAX", "__LINE__", "__FILE__", NULL
   };
+  g_autoptr(GHashTable) targets = NULL;
+  g_autoptr(GHashTable) unsaved = NULL;
+  g_autoptr(GHashTable) created = NULL;
+  g_autoptr(GPtrArray) merge = NULL;
   IdeHighlightIndex *index;
-  IndexRequest client_data;
+  IndexRequest client_data = { 0 };
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
   CXCursor cursor;
   CXFile file;
+  gint64 begin_time;
   gsize i;
 
   g_assert (IDE_IS_CLANG_SERVICE (self));
@@ -166,11 +326,34 @@ ide_clang_service_build_index (IdeClangService   *self,
   if (file == NULL)
     return NULL;
 
+  begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
+
   index = ide_highlight_index_new ();
 
+  targets = g_hash_table_new (NULL, NULL);
+  unsaved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  created = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, header_index_free);
+  merge = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_highlight_index_unref);
+
+  for (i = 0; i < request->unsaved_files->len; i++)
+    {
+      IdeUnsavedFile *iuf = g_ptr_array_index (request->unsaved_files, i);
+      gchar *path = g_file_get_path (ide_unsaved_file_get_file (iuf));
+
+      if (path != NULL)
+        g_hash_table_add (unsaved, path);
+    }
+
+  client_data.self = self;
   client_data.index = index;
   client_data.file = file;
   client_data.filename = request->source_filename;
+  client_data.targets = targets;
+  client_data.unsaved = unsaved;
+  client_data.merge = merge;
+  client_data.created = created;
+  client_data.last_file = NULL;
+  client_data.last_target = index;
 
   /*
    * Add some common defines so they don't get changed by clang.
@@ -183,8 +366,27 @@ ide_clang_service_build_index (IdeClangService   *self,
   ide_highlight_index_insert (index, "g_auto", "c:storage-class");
   ide_highlight_index_insert (index, "g_autofree", "c:storage-class");
 
+  /*
+   * Only the main file is indexed on every parse. Everything pulled in from
+   * headers is indexed once per header (and modification time) and shared
+   * between all of the translation units that include it.
+   */
   cursor = clang_getTranslationUnitCursor (tu);
-  clang_visitChildren (cursor, ide_clang_service_build_index_visitor, &client_data);
+  clang_visitChildren (cursor, ide_clang_service_build_index_toplevel_visitor, &client_data);
+
+  g_mutex_lock (&self->header_mutex);
+  g_hash_table_iter_init (&iter, created);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_hash_table_iter_steal (&iter);
+      g_hash_table_insert (self->header_indexes, key, value);
+    }
+  g_mutex_unlock (&self->header_mutex);
+
+  for (i = 0; i < merge->len; i++)
+    ide_highlight_index_merge (index, g_ptr_array_index (merge, i));
+
+  EGG_HISTOGRAM_TIMER_END (HighlightIndexTime, begin_time);
 
   return index;
 }
@@ -215,6 +417,7 @@ ide_clang_service_parse_worker (GTask        *task,
   const gchar *detail_error = NULL;
   enum CXErrorCode code;
   GArray *ar = NULL;
+  gint64 begin_time;
   gsize i;
 
   g_assert (G_IS_TASK (task));
@@ -248,6 +451,7 @@ ide_clang_service_parse_worker (GTask        *task,
   argc = argv ? g_strv_length (request->command_line_args) : 0;
 
   EGG_COUNTER_INC (ParseAttempts);
+  begin_time = EGG_HISTOGRAM_TIMER_BEGIN ();
   code = clang_parseTranslationUnit2 (request->index,
                                       request->source_filename,
                                       argv, argc,
@@ -255,6 +459,7 @@ ide_clang_service_parse_worker (GTask        *task,
                                       ar->len,
                                       request->options,
                                       &tu);
+  EGG_HISTOGRAM_TIMER_END (ParseTime, begin_time);
 
   switch (code)
     {
@@ -545,6 +750,51 @@ ide_clang_service_get_translation_unit_finish (IdeClangService  *self,
   return g_task_propagate_pointer (task, error);
 }
 
+static void
+ide_clang_service_buffer_saved (IdeClangService  *self,
+                                IdeBuffer        *buffer,
+                                IdeBufferManager *buffer_manager)
+{
+  IdeFile *file;
+
+  g_assert (IDE_IS_CLANG_SERVICE (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+  g_assert (IDE_IS_BUFFER_MANAGER (buffer_manager));
+
+  file = ide_buffer_get_file (buffer);
+
+  if (self->xref_index != NULL && !ide_file_get_is_temporary (file))
+    ide_clang_index_queue_file (self->xref_index, ide_file_get_file (file));
+}
+
+static void
+ide_clang_service_context_loaded (IdeService *service)
+{
+  IdeClangService *self = (IdeClangService *)service;
+  IdeBufferManager *buffer_manager;
+  IdeContext *context;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_CLANG_SERVICE (self));
+
+  context = ide_object_get_context (IDE_OBJECT (self));
+  buffer_manager = ide_context_get_buffer_manager (context);
+
+  self->xref_index = g_object_new (IDE_TYPE_CLANG_INDEX,
+                                   "context", context,
+                                   NULL);
+  ide_clang_index_load (self->xref_index);
+
+  g_signal_connect_object (buffer_manager,
+                           "buffer-saved",
+                           G_CALLBACK (ide_clang_service_buffer_saved),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  IDE_EXIT;
+}
+
 static void
 ide_clang_service_start (IdeService *service)
 {
@@ -581,6 +831,10 @@ ide_clang_service_stop (IdeService *service)
 
   g_cancellable_cancel (self->cancellable);
   g_clear_object (&self->units_cache);
+
+  if (self->xref_index != NULL)
+    ide_clang_index_cancel (self->xref_index);
+  g_clear_object (&self->xref_index);
 }
 
 static void
@@ -591,6 +845,10 @@ ide_clang_service_dispose (GObject *object)
   IDE_ENTRY;
 
   g_clear_object (&self->units_cache);
+
+  if (self->xref_index != NULL)
+    ide_clang_index_cancel (self->xref_index);
+  g_clear_object (&self->xref_index);
   g_clear_object (&self->cancellable);
   g_clear_pointer (&self->index, clang_disposeIndex);
 
@@ -602,8 +860,13 @@ ide_clang_service_dispose (GObject *object)
 static void
 ide_clang_service_finalize (GObject *object)
 {
+  IdeClangService *self = (IdeClangService *)object;
+
   IDE_ENTRY;
 
+  g_clear_pointer (&self->header_indexes, g_hash_table_unref);
+  g_mutex_clear (&self->header_mutex);
+
   G_OBJECT_CLASS (ide_clang_service_parent_class)->finalize (object);
 
   IDE_EXIT;
@@ -621,6 +884,7 @@ ide_clang_service_class_init (IdeClangServiceClass *klass)
 static void
 service_iface_init (IdeServiceInterface *iface)
 {
+  iface->context_loaded = ide_clang_service_context_loaded;
   iface->start = ide_clang_service_start;
   iface->stop = ide_clang_service_stop;
 }
@@ -628,6 +892,9 @@ service_iface_init (IdeServiceInterface *iface)
 static void
 ide_clang_service_init (IdeClangService *self)
 {
+  g_mutex_init (&self->header_mutex);
+  self->header_indexes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, header_index_free);
 }
 
 /**
@@ -652,6 +919,23 @@ ide_clang_service_get_cached_translation_unit (IdeClangService *self,
   return cached ? g_object_ref (cached) : NULL;
 }
 
+/**
+ * ide_clang_service_get_index:
+ * @self: A #IdeClangService.
+ *
+ * Gets the project-wide cross-reference index. It is created once the
+ * context has loaded and is filled in the background.
+ *
+ * Returns: (transfer none) (nullable): An #IdeClangIndex or %NULL.
+ */
+IdeClangIndex *
+ide_clang_service_get_index (IdeClangService *self)
+{
+  g_return_val_if_fail (IDE_IS_CLANG_SERVICE (self), NULL);
+
+  return self->xref_index;
+}
+
 void
 _ide_clang_dispose_string (CXString *str)
 {
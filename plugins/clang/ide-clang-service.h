@@ -19,6 +19,7 @@
 #ifndef IDE_CLANG_SERVICE_H
 #define IDE_CLANG_SERVICE_H
 
+#include "ide-clang-index.h"
 #include "ide-clang-translation-unit.h"
 #include "ide-service.h"
 
@@ -39,6 +40,7 @@ IdeClangTranslationUnit *ide_clang_service_get_translation_unit_finish (IdeClang
                                                                         GError              **error);
 IdeClangTranslationUnit *ide_clang_service_get_cached_translation_unit (IdeClangService      *self,
                                                                         IdeFile              *file);
+IdeClangIndex           *ide_clang_service_get_index                   (IdeClangService      *self);
 
 G_END_DECLS
 
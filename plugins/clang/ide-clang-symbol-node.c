@@ -28,8 +28,8 @@ struct _IdeClangSymbolNode
 {
   IdeSymbolNode parent_instance;
 
-  CXCursor  cursor;
-  GArray   *children;
+  IdeSourceLocation *location;
+  GPtrArray         *children;
 };
 
 G_DEFINE_TYPE (IdeClangSymbolNode, ide_clang_symbol_node, IDE_TYPE_SYMBOL_NODE)
@@ -128,6 +128,49 @@ get_symbol_kind (CXCursor        cursor,
   return kind;
 }
 
+static IdeSourceLocation *
+create_location (IdeContext *context,
+                 CXCursor    cursor)
+{
+  IdeSourceLocation *ret;
+  const gchar *filename;
+  CXString cxfilename;
+  CXSourceLocation cxloc;
+  CXFile file;
+  GFile *gfile;
+  IdeFile *ifile;
+  guint line = 0;
+  guint line_offset = 0;
+
+  cxloc = clang_getCursorLocation (cursor);
+  clang_getFileLocation (cxloc, &file, &line, &line_offset, NULL);
+  cxfilename = clang_getFileName (file);
+  filename = clang_getCString (cxfilename);
+
+  /*
+   * TODO: Remove IdeFile from all this junk.
+   */
+
+  gfile = g_file_new_for_path (filename);
+  ifile = g_object_new (IDE_TYPE_FILE,
+                        "file", gfile,
+                        "context", context,
+                        NULL);
+
+  ret = ide_source_location_new (ifile, line-1, line_offset-1, 0);
+
+  g_clear_object (&ifile);
+  g_clear_object (&gfile);
+  clang_disposeString (cxfilename);
+
+  return ret;
+}
+
+/*
+ * Nodes are created by the translation unit's job thread. Everything we need
+ * from the cursor is copied out here so the main thread never has to touch
+ * the CXTranslationUnit while a completion may be running on it.
+ */
 IdeClangSymbolNode *
 _ide_clang_symbol_node_new (IdeContext *context,
                             CXCursor    cursor)
@@ -149,68 +192,42 @@ _ide_clang_symbol_node_new (IdeContext *context,
                        "name", ide_str_empty0 (name) ? _("anonymous") : name,
                        NULL);
 
-  self->cursor = cursor;
+  self->location = create_location (context, cursor);
 
   clang_disposeString (cxname);
 
   return self;
 }
 
-CXCursor
-_ide_clang_symbol_node_get_cursor (IdeClangSymbolNode *self)
-{
-  g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_NODE (self), clang_getNullCursor ());;
-
-  return self->cursor;
-}
-
 static IdeSourceLocation *
 ide_clang_symbol_node_get_location (IdeSymbolNode *symbol_node)
 {
   IdeClangSymbolNode *self = (IdeClangSymbolNode *)symbol_node;
-  IdeSourceLocation *ret;
-  IdeContext *context;
-  const gchar *filename;
-  CXString cxfilename;
-  CXSourceLocation cxloc;
-  CXFile file;
-  GFile *gfile;
-  IdeFile *ifile;
-  guint line = 0;
-  guint line_offset = 0;
 
   g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_NODE (self), NULL);
 
-  cxloc = clang_getCursorLocation (self->cursor);
-  clang_getFileLocation (cxloc, &file, &line, &line_offset, NULL);
-  cxfilename = clang_getFileName (file);
-  filename = clang_getCString (cxfilename);
-
-  /*
-   * TODO: Remove IdeFile from all this junk.
-   */
-
-  context = ide_object_get_context (IDE_OBJECT (self));
-  gfile = g_file_new_for_path (filename);
-  ifile = g_object_new (IDE_TYPE_FILE,
-                        "file", gfile,
-                        "context", context,
-                        NULL);
+  return ide_source_location_ref (self->location);
+}
 
-  ret = ide_source_location_new (ifile, line-1, line_offset-1, 0);
+static void
+ide_clang_symbol_node_finalize (GObject *object)
+{
+  IdeClangSymbolNode *self = (IdeClangSymbolNode *)object;
 
-  g_clear_object (&ifile);
-  g_clear_object (&gfile);
-  clang_disposeString (cxfilename);
+  g_clear_pointer (&self->location, ide_source_location_unref);
+  g_clear_pointer (&self->children, g_ptr_array_unref);
 
-  return ret;
+  G_OBJECT_CLASS (ide_clang_symbol_node_parent_class)->finalize (object);
 }
 
 static void
 ide_clang_symbol_node_class_init (IdeClangSymbolNodeClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   IdeSymbolNodeClass *node_class = IDE_SYMBOL_NODE_CLASS (klass);
 
+  object_class->finalize = ide_clang_symbol_node_finalize;
+
   node_class->get_location = ide_clang_symbol_node_get_location;
 }
 
@@ -219,7 +236,7 @@ ide_clang_symbol_node_init (IdeClangSymbolNode *self)
 {
 }
 
-GArray *
+GPtrArray *
 _ide_clang_symbol_node_get_children (IdeClangSymbolNode *self)
 {
   g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_NODE (self), NULL);
@@ -229,11 +246,11 @@ _ide_clang_symbol_node_get_children (IdeClangSymbolNode *self)
 
 void
 _ide_clang_symbol_node_set_children (IdeClangSymbolNode *self,
-                                     GArray             *children)
+                                     GPtrArray          *children)
 {
   g_return_if_fail (IDE_IS_CLANG_SYMBOL_NODE (self));
   g_return_if_fail (self->children == NULL);
   g_return_if_fail (children != NULL);
 
-  self->children = g_array_ref (children);
+  self->children = g_ptr_array_ref (children);
 }
@@ -19,6 +19,7 @@
 #define G_LOG_DOMAIN "clang-symbol-resolver"
 
 #include "ide-context.h"
+#include "ide-clang-index.h"
 #include "ide-clang-service.h"
 #include "ide-clang-symbol-resolver.h"
 #include "ide-debug.h"
@@ -37,6 +38,111 @@ G_DEFINE_TYPE_EXTENDED (IdeClangSymbolResolver, ide_clang_symbol_resolver, IDE_T
                         G_IMPLEMENT_INTERFACE (IDE_TYPE_SYMBOL_RESOLVER,
                                                symbol_resolver_iface_init))
 
+typedef struct
+{
+  IdeSourceLocation *location;
+  IdeSymbol         *symbol;
+} LookupSymbol;
+
+static void
+lookup_symbol_free (gpointer data)
+{
+  LookupSymbol *lookup = data;
+
+  g_clear_pointer (&lookup->location, ide_source_location_unref);
+  g_clear_pointer (&lookup->symbol, ide_symbol_unref);
+  g_slice_free (LookupSymbol, lookup);
+}
+
+static void
+ide_clang_symbol_resolver_lookup_usr_cb (GObject      *object,
+                                         GAsyncResult *result,
+                                         gpointer      user_data)
+{
+  IdeClangTranslationUnit *unit = (IdeClangTranslationUnit *)object;
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GPtrArray) definitions = NULL;
+  g_autofree gchar *usr = NULL;
+  IdeClangService *service;
+  IdeClangIndex *index;
+  IdeContext *context;
+  IdeSymbol *symbol;
+  LookupSymbol *lookup;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (unit));
+  g_assert (G_IS_TASK (task));
+
+  lookup = g_task_get_task_data (task);
+  symbol = lookup->symbol;
+
+  context = ide_object_get_context (IDE_OBJECT (g_task_get_source_object (task)));
+  service = ide_context_get_service_typed (context, IDE_TYPE_CLANG_SERVICE);
+
+  /*
+   * The translation unit only knows about the declarations it can see, which
+   * for anything implemented in another file is the prototype in a header.
+   * Ask the project index for the real definition.
+   */
+  if ((usr = ide_clang_translation_unit_lookup_usr_finish (unit, result, NULL)) &&
+      (index = ide_clang_service_get_index (service)) &&
+      (definitions = ide_clang_index_lookup (index, usr, IDE_CLANG_INDEX_DEFINITION)) &&
+      definitions->len > 0)
+    {
+      g_task_return_pointer (task,
+                             ide_symbol_new (ide_symbol_get_name (symbol),
+                                             ide_symbol_get_kind (symbol),
+                                             ide_symbol_get_flags (symbol),
+                                             ide_symbol_get_definition_location (symbol),
+                                             g_ptr_array_index (definitions, 0),
+                                             ide_symbol_get_canonical_location (symbol)),
+                             (GDestroyNotify)ide_symbol_unref);
+      return;
+    }
+
+  g_task_return_pointer (task, ide_symbol_ref (symbol), (GDestroyNotify)ide_symbol_unref);
+}
+
+static void
+ide_clang_symbol_resolver_lookup_symbol_cb2 (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data)
+{
+  IdeClangTranslationUnit *unit = (IdeClangTranslationUnit *)object;
+  g_autoptr(GTask) task = user_data;
+  IdeClangService *service;
+  IdeContext *context;
+  LookupSymbol *lookup;
+  GError *error = NULL;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (unit));
+  g_assert (G_IS_TASK (task));
+
+  lookup = g_task_get_task_data (task);
+
+  if (!(lookup->symbol = ide_clang_translation_unit_lookup_symbol_finish (unit, result, &error)))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  context = ide_object_get_context (IDE_OBJECT (g_task_get_source_object (task)));
+  service = ide_context_get_service_typed (context, IDE_TYPE_CLANG_SERVICE);
+
+  if (ide_clang_service_get_index (service) == NULL)
+    {
+      g_task_return_pointer (task,
+                             ide_symbol_ref (lookup->symbol),
+                             (GDestroyNotify)ide_symbol_unref);
+      return;
+    }
+
+  ide_clang_translation_unit_lookup_usr_async (unit,
+                                               lookup->location,
+                                               g_task_get_cancellable (task),
+                                               ide_clang_symbol_resolver_lookup_usr_cb,
+                                               g_object_ref (task));
+}
+
 static void
 ide_clang_symbol_resolver_lookup_symbol_cb (GObject      *object,
                                             GAsyncResult *result,
@@ -45,14 +151,13 @@ ide_clang_symbol_resolver_lookup_symbol_cb (GObject      *object,
   IdeClangService *service = (IdeClangService *)object;
   g_autoptr(IdeClangTranslationUnit) unit = NULL;
   g_autoptr(GTask) task = user_data;
-  g_autoptr(IdeSymbol) symbol = NULL;
-  IdeSourceLocation *location;
+  LookupSymbol *lookup;
   GError *error = NULL;
 
   g_assert (IDE_IS_CLANG_SERVICE (service));
   g_assert (G_IS_TASK (task));
 
-  location = g_task_get_task_data (task);
+  lookup = g_task_get_task_data (task);
 
   unit = ide_clang_service_get_translation_unit_finish (service, result, &error);
 
@@ -62,15 +167,11 @@ ide_clang_symbol_resolver_lookup_symbol_cb (GObject      *object,
       return;
     }
 
-  symbol = ide_clang_translation_unit_lookup_symbol (unit, location, &error);
-
-  if (symbol == NULL)
-    {
-      g_task_return_error (task, error);
-      return;
-    }
-
-  g_task_return_pointer (task, ide_symbol_ref (symbol), (GDestroyNotify)ide_symbol_unref);
+  ide_clang_translation_unit_lookup_symbol_async (unit,
+                                                  lookup->location,
+                                                  g_task_get_cancellable (task),
+                                                  ide_clang_symbol_resolver_lookup_symbol_cb2,
+                                                  g_object_ref (task));
 }
 
 static void
@@ -84,6 +185,7 @@ ide_clang_symbol_resolver_lookup_symbol_async (IdeSymbolResolver   *resolver,
   IdeClangService *service = NULL;
   IdeContext *context;
   IdeFile *file;
+  LookupSymbol *lookup;
   g_autoptr(GTask) task = NULL;
 
   IDE_ENTRY;
@@ -95,9 +197,11 @@ ide_clang_symbol_resolver_lookup_symbol_async (IdeSymbolResolver   *resolver,
   service = ide_context_get_service_typed (context, IDE_TYPE_CLANG_SERVICE);
   file = ide_source_location_get_file (location);
 
+  lookup = g_slice_new0 (LookupSymbol);
+  lookup->location = ide_source_location_ref (location);
+
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_set_task_data (task, ide_source_location_ref (location),
-                        (GDestroyNotify)ide_source_location_unref);
+  g_task_set_task_data (task, lookup, lookup_symbol_free);
 
   ide_clang_service_get_translation_unit_async (service,
                                                 file,
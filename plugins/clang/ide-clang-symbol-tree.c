@@ -31,7 +31,7 @@ struct _IdeClangSymbolTree
   IdeRefPtr *native;
   GFile     *file;
   gchar     *path;
-  GArray    *children;
+  GPtrArray *children;
 };
 
 typedef struct
@@ -135,58 +135,84 @@ count_recognizable_children (CXCursor     cursor,
   return CXChildVisit_Continue;
 }
 
-static guint
-ide_clang_symbol_tree_get_n_children (IdeSymbolTree *symbol_tree,
-                                      IdeSymbolNode *parent)
+static GPtrArray *
+ide_clang_symbol_tree_collect (IdeClangSymbolTree *self,
+                               IdeContext         *context,
+                               CXCursor            cursor)
 {
-  IdeClangSymbolTree *self = (IdeClangSymbolTree *)symbol_tree;
-  CXTranslationUnit tu;
-  CXCursor cursor;
   TraversalState state = { 0 };
-  GArray *children = NULL;
-  guint count;
+  GPtrArray *ret;
+  guint i;
 
-  g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_TREE (self), 0);
-  g_return_val_if_fail (!parent || IDE_IS_CLANG_SYMBOL_NODE (parent), 0);
-  g_return_val_if_fail (self->native != NULL, 0);
+  state.path = self->path;
+  state.children = g_array_new (FALSE, FALSE, sizeof (CXCursor));
 
-  if (parent == NULL)
-    children = self->children;
-  else
-    children = _ide_clang_symbol_node_get_children (IDE_CLANG_SYMBOL_NODE (parent));
+  clang_visitChildren (cursor,
+                       count_recognizable_children,
+                       &state);
 
-  if (children != NULL)
-    return children->len;
+  ret = g_ptr_array_new_with_free_func (g_object_unref);
 
-  if (parent == NULL)
-    {
-      tu = ide_ref_ptr_get (self->native);
-      cursor = clang_getTranslationUnitCursor (tu);
-    }
-  else
+  for (i = 0; i < state.children->len; i++)
     {
-      cursor = _ide_clang_symbol_node_get_cursor (IDE_CLANG_SYMBOL_NODE (parent));
+      IdeSymbolNode *node;
+      GPtrArray *children;
+      CXCursor child;
+
+      child = g_array_index (state.children, CXCursor, i);
+      node = _ide_clang_symbol_node_new (context, child);
+      children = ide_clang_symbol_tree_collect (self, context, child);
+      _ide_clang_symbol_node_set_children (IDE_CLANG_SYMBOL_NODE (node), children);
+      g_ptr_array_unref (children);
+
+      g_ptr_array_add (ret, node);
     }
 
-  children = g_array_new (FALSE, FALSE, sizeof (CXCursor));
+  g_array_unref (state.children);
 
-  state.path = self->path;
-  state.children = children;
+  return ret;
+}
 
-  clang_visitChildren (cursor,
-                       count_recognizable_children,
-                       &state);
+/*
+ * Walks the whole tree up front. This must be called from the translation
+ * unit's job thread, since the unit may be running a completion otherwise.
+ * Afterwards the tree can be browsed from the main thread without touching
+ * the native translation unit.
+ */
+void
+_ide_clang_symbol_tree_build (IdeClangSymbolTree *self)
+{
+  IdeContext *context;
+  CXTranslationUnit tu;
+  CXCursor cursor;
 
-  if (parent == NULL)
-    self->children = g_array_ref (children);
-  else
-    _ide_clang_symbol_node_set_children (IDE_CLANG_SYMBOL_NODE (parent), children);
+  g_return_if_fail (IDE_IS_CLANG_SYMBOL_TREE (self));
+  g_return_if_fail (self->native != NULL);
+  g_return_if_fail (self->children == NULL);
 
-  count = children->len;
+  context = ide_object_get_context (IDE_OBJECT (self));
+  tu = ide_ref_ptr_get (self->native);
+  cursor = clang_getTranslationUnitCursor (tu);
 
-  g_array_unref (children);
+  self->children = ide_clang_symbol_tree_collect (self, context, cursor);
+}
 
-  return count;
+static guint
+ide_clang_symbol_tree_get_n_children (IdeSymbolTree *symbol_tree,
+                                      IdeSymbolNode *parent)
+{
+  IdeClangSymbolTree *self = (IdeClangSymbolTree *)symbol_tree;
+  GPtrArray *children;
+
+  g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_TREE (self), 0);
+  g_return_val_if_fail (!parent || IDE_IS_CLANG_SYMBOL_NODE (parent), 0);
+
+  if (parent == NULL)
+    children = self->children;
+  else
+    children = _ide_clang_symbol_node_get_children (IDE_CLANG_SYMBOL_NODE (parent));
+
+  return children != NULL ? children->len : 0;
 }
 
 static IdeSymbolNode *
@@ -195,28 +221,18 @@ ide_clang_symbol_tree_get_nth_child (IdeSymbolTree *symbol_tree,
                                      guint          nth)
 {
   IdeClangSymbolTree *self = (IdeClangSymbolTree *)symbol_tree;
-  IdeContext *context;
-  GArray *children;
+  GPtrArray *children;
 
   g_return_val_if_fail (IDE_IS_CLANG_SYMBOL_TREE (self), NULL);
   g_return_val_if_fail (!parent || IDE_IS_SYMBOL_NODE (parent), NULL);
 
-  context = ide_object_get_context (IDE_OBJECT (self));
-
   if (parent == NULL)
     children = self->children;
   else
     children = _ide_clang_symbol_node_get_children (IDE_CLANG_SYMBOL_NODE (parent));
 
-  g_assert (children != NULL);
-
-  if (nth < children->len)
-    {
-      CXCursor cursor;
-
-      cursor = g_array_index (children, CXCursor, nth);
-      return _ide_clang_symbol_node_new (context, cursor);
-    }
+  if (children != NULL && nth < children->len)
+    return g_object_ref (g_ptr_array_index (children, nth));
 
   g_warning ("nth child %u is out of bounds", nth);
 
@@ -229,7 +245,7 @@ ide_clang_symbol_tree_finalize (GObject *object)
   IdeClangSymbolTree *self = (IdeClangSymbolTree *)object;
 
   g_clear_pointer (&self->native, ide_ref_ptr_unref);
-  g_clear_pointer (&self->children, g_array_unref);
+  g_clear_pointer (&self->children, g_ptr_array_unref);
 
   G_OBJECT_CLASS (ide_clang_symbol_tree_parent_class)->finalize (object);
 }
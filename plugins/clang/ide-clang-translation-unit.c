@@ -53,8 +53,28 @@ struct _IdeClangTranslationUnit
   GFile             *file;
   IdeHighlightIndex *index;
   GHashTable        *diagnostics;
+
+  /*
+   * libclang does not allow a CXTranslationUnit to be used from more than
+   * one thread at a time. Rather than occupying several compiler threads
+   * that would only wait on each other, every job touching the native unit
+   * (completion, diagnostics, symbol queries) is queued and drained in order
+   * by a single thread. The main thread never touches the native unit, so it
+   * is never stuck behind a running clang_codeCompleteAt().
+   *
+   * The diagnostics cache is only accessed from the draining thread.
+   */
+  GMutex             jobs_mutex;
+  GQueue             jobs;
+  guint              draining : 1;
 };
 
+typedef struct
+{
+  GTask           *task;
+  GTaskThreadFunc  func;
+} QueuedJob;
+
 typedef struct
 {
   GPtrArray *unsaved_files;
@@ -72,6 +92,9 @@ typedef struct
 
 G_DEFINE_TYPE (IdeClangTranslationUnit, ide_clang_translation_unit, IDE_TYPE_OBJECT)
 EGG_DEFINE_COUNTER (instances, "Clang", "Translation Units", "Number of clang translation units")
+EGG_DEFINE_COUNTER (QueuedJobs, "Clang", "Queued Jobs", "Number of jobs queued on a translation unit")
+EGG_DEFINE_COUNTER (StaleCompletions, "Clang", "Stale Completions",
+                    "Number of completions run against an older translation unit while it reparses")
 
 enum {
   PROP_0,
@@ -97,6 +120,77 @@ code_complete_state_free (gpointer data)
     }
 }
 
+static void
+ide_clang_translation_unit_drain_worker (GTask        *task,
+                                         gpointer      source_object,
+                                         gpointer      task_data,
+                                         GCancellable *cancellable)
+{
+  IdeClangTranslationUnit *self = source_object;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+
+  for (;;)
+    {
+      QueuedJob *job;
+
+      g_mutex_lock (&self->jobs_mutex);
+      if (!(job = g_queue_pop_head (&self->jobs)))
+        self->draining = FALSE;
+      g_mutex_unlock (&self->jobs_mutex);
+
+      if (job == NULL)
+        break;
+
+      if (!g_task_return_error_if_cancelled (job->task))
+        job->func (job->task,
+                   self,
+                   g_task_get_task_data (job->task),
+                   g_task_get_cancellable (job->task));
+
+      g_object_unref (job->task);
+      g_slice_free (QueuedJob, job);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+ide_clang_translation_unit_queue_task (IdeClangTranslationUnit *self,
+                                       GTask                   *task,
+                                       GTaskThreadFunc          func)
+{
+  QueuedJob *job;
+  gboolean dispatch;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (G_IS_TASK (task));
+  g_assert (func != NULL);
+
+  EGG_COUNTER_INC (QueuedJobs);
+
+  job = g_slice_new0 (QueuedJob);
+  job->task = g_object_ref (task);
+  job->func = func;
+
+  g_mutex_lock (&self->jobs_mutex);
+  g_queue_push_tail (&self->jobs, job);
+  dispatch = !self->draining;
+  self->draining = TRUE;
+  g_mutex_unlock (&self->jobs_mutex);
+
+  if (dispatch)
+    {
+      g_autoptr(GTask) drain = NULL;
+
+      drain = g_task_new (self, NULL, NULL, NULL);
+      ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER,
+                                 drain,
+                                 ide_clang_translation_unit_drain_worker);
+    }
+}
+
 /**
  * ide_clang_translation_unit_get_index:
  * @self: A #IdeClangTranslationUnit.
@@ -372,18 +466,15 @@ create_diagnostic (IdeClangTranslationUnit *self,
   return diag;
 }
 
-/**
- * ide_clang_translation_unit_get_diagnostics_for_file:
- *
- * Retrieves the diagnostics for the translation unit for a specific file.
- *
- * Returns: (transfer none) (nullable): An #IdeDiagnostics or %NULL.
+/*
+ * Must be called from the job thread, see queue_task().
  */
-IdeDiagnostics *
-ide_clang_translation_unit_get_diagnostics_for_file (IdeClangTranslationUnit *self,
-                                                     GFile                   *file)
+static IdeDiagnostics *
+ide_clang_translation_unit_load_diagnostics (IdeClangTranslationUnit *self,
+                                             GFile                   *file)
 {
-  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (G_IS_FILE (file));
 
   if (!g_hash_table_contains (self->diagnostics, file))
     {
@@ -460,17 +551,78 @@ ide_clang_translation_unit_get_diagnostics_for_file (IdeClangTranslationUnit *se
   return g_hash_table_lookup (self->diagnostics, file);
 }
 
+static void
+ide_clang_translation_unit_get_diagnostics_worker (GTask        *task,
+                                                   gpointer      source_object,
+                                                   gpointer      task_data,
+                                                   GCancellable *cancellable)
+{
+  IdeClangTranslationUnit *self = source_object;
+  IdeDiagnostics *diagnostics;
+  GFile *file = task_data;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (G_IS_FILE (file));
+
+  diagnostics = ide_clang_translation_unit_load_diagnostics (self, file);
+
+  g_task_return_pointer (task,
+                         ide_diagnostics_ref (diagnostics),
+                         (GDestroyNotify)ide_diagnostics_unref);
+}
+
+/**
+ * ide_clang_translation_unit_get_diagnostics_for_file_async:
+ * @self: A #IdeClangTranslationUnit.
+ * @file: The #GFile to retrieve diagnostics for.
+ * @cancellable: (nullable): A #GCancellable or %NULL.
+ * @callback: A callback to execute upon completion.
+ * @user_data: User data for @callback.
+ *
+ * Asynchronously retrieves the diagnostics of the translation unit that are
+ * located in @file. The work is queued behind any other job on the
+ * translation unit, such as a running completion.
+ */
+void
+ide_clang_translation_unit_get_diagnostics_for_file_async (IdeClangTranslationUnit *self,
+                                                           GFile                   *file,
+                                                           GCancellable            *cancellable,
+                                                           GAsyncReadyCallback      callback,
+                                                           gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_get_diagnostics_worker);
+}
+
 /**
- * ide_clang_translation_unit_get_diagnostics:
+ * ide_clang_translation_unit_get_diagnostics_for_file_finish:
+ * @self: A #IdeClangTranslationUnit.
+ * @result: A #GAsyncResult
+ * @error: (out) (nullable): A location for a #GError, or %NULL.
  *
- * Retrieves the diagnostics for the translation unit.
+ * Completes a call to ide_clang_translation_unit_get_diagnostics_for_file_async().
  *
- * Returns: (transfer none) (nullable): An #IdeDiagnostics or %NULL.
+ * Returns: (transfer full): An #IdeDiagnostics or %NULL upon failure.
  */
 IdeDiagnostics *
-ide_clang_translation_unit_get_diagnostics (IdeClangTranslationUnit *self)
+ide_clang_translation_unit_get_diagnostics_for_file_finish (IdeClangTranslationUnit  *self,
+                                                            GAsyncResult             *result,
+                                                            GError                  **error)
 {
-  return ide_clang_translation_unit_get_diagnostics_for_file (self, self->file);
+  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 gint64
@@ -498,10 +650,14 @@ ide_clang_translation_unit_finalize (GObject *object)
 
   IDE_ENTRY;
 
+  /* Queued jobs hold a reference to us, so the queue must be empty */
+  g_assert (g_queue_is_empty (&self->jobs));
+
   g_clear_pointer (&self->native, ide_ref_ptr_unref);
   g_clear_object (&self->file);
   g_clear_pointer (&self->index, ide_highlight_index_unref);
   g_clear_pointer (&self->diagnostics, g_hash_table_unref);
+  g_mutex_clear (&self->jobs_mutex);
 
   G_OBJECT_CLASS (ide_clang_translation_unit_parent_class)->finalize (object);
 
@@ -614,6 +770,9 @@ ide_clang_translation_unit_init (IdeClangTranslationUnit *self)
 {
   EGG_COUNTER_INC (instances);
 
+  g_mutex_init (&self->jobs_mutex);
+  g_queue_init (&self->jobs);
+
   self->diagnostics = g_hash_table_new_full ((GHashFunc)g_file_hash,
                                              (GEqualFunc)g_file_equal,
                                              g_object_unref,
@@ -640,13 +799,9 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
   g_assert (state);
   g_assert (state->unsaved_files);
 
+  /* We are the only user of the translation unit, see queue_task(). */
   tu = ide_ref_ptr_get (self->native);
 
-  /*
-   * FIXME: Not thread safe! We should probably add a "Pending" flag or something that is
-   *        similar to g_input_stream_set_pending().
-   */
-
   if (!state->path)
     {
       /* implausable to reach here, anyway */
@@ -657,6 +812,13 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
       return;
     }
 
+  /*
+   * clang_codeCompleteAt() reparses the translation unit with the unsaved
+   * files, which replaces the diagnostics it reports. Collect the diagnostics
+   * for the parse we were created from first (a no-op when they already are).
+   */
+  ide_clang_translation_unit_load_diagnostics (self, self->file);
+
   ufs = g_new0 (struct CXUnsavedFile, state->unsaved_files->len);
 
   for (i = 0; i < state->unsaved_files->len; i++)
@@ -748,16 +910,14 @@ ide_clang_translation_unit_code_complete_async (IdeClangTranslationUnit *self,
   state->line_offset = gtk_text_iter_get_line_offset (location);
   state->unsaved_files = ide_unsaved_files_to_array (unsaved_files);
 
-  /*
-   * TODO: Technically it is not safe for us to go run this in a thread. We need to ensure
-   *       that only one thread is dealing with this at a time.
-   */
-
   g_task_set_task_data (task, state, code_complete_state_free);
 
-  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER,
-                             task,
-                             ide_clang_translation_unit_code_complete_worker);
+  if (self->serial < ide_unsaved_files_get_sequence (unsaved_files))
+    EGG_COUNTER_INC (StaleCompletions);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_code_complete_worker);
 
   IDE_EXIT;
 }
@@ -881,10 +1041,9 @@ get_symbol_kind (CXCursor        cursor,
   return kind;
 }
 
-IdeSymbol *
-ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
-                                          IdeSourceLocation        *location,
-                                          GError                  **error)
+static IdeSymbol *
+lookup_symbol_at (IdeClangTranslationUnit *self,
+                  IdeSourceLocation       *location)
 {
   g_autofree gchar *filename = NULL;
   g_autofree gchar *workpath = NULL;
@@ -961,6 +1120,203 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
   IDE_RETURN (ret);
 }
 
+static void
+ide_clang_translation_unit_lookup_symbol_worker (GTask        *task,
+                                                 gpointer      source_object,
+                                                 gpointer      task_data,
+                                                 GCancellable *cancellable)
+{
+  IdeClangTranslationUnit *self = source_object;
+  IdeSourceLocation *location = task_data;
+  IdeSymbol *symbol;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (location != NULL);
+
+  if (!(symbol = lookup_symbol_at (self, location)))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_NOT_FOUND,
+                               _("Failed to locate symbol at location"));
+      return;
+    }
+
+  g_task_return_pointer (task, symbol, (GDestroyNotify)ide_symbol_unref);
+}
+
+/**
+ * ide_clang_translation_unit_lookup_symbol_async:
+ * @self: An #IdeClangTranslationUnit
+ * @location: An #IdeSourceLocation
+ * @cancellable: (nullable): A #GCancellable or %NULL.
+ * @callback: A callback to execute upon completion.
+ * @user_data: User data for @callback.
+ *
+ * Asynchronously looks up the symbol found at @location. The lookup is
+ * queued behind any other job on the translation unit.
+ */
+void
+ide_clang_translation_unit_lookup_symbol_async (IdeClangTranslationUnit *self,
+                                                IdeSourceLocation       *location,
+                                                GCancellable            *cancellable,
+                                                GAsyncReadyCallback      callback,
+                                                gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_return_if_fail (location != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task,
+                        ide_source_location_ref (location),
+                        (GDestroyNotify)ide_source_location_unref);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_lookup_symbol_worker);
+}
+
+/**
+ * ide_clang_translation_unit_lookup_symbol_finish:
+ * @self: An #IdeClangTranslationUnit
+ * @result: A #GAsyncResult
+ * @error: (out) (nullable): A location for a #GError, or %NULL.
+ *
+ * Completes a call to ide_clang_translation_unit_lookup_symbol_async().
+ *
+ * Returns: (transfer full): An #IdeSymbol or %NULL upon failure.
+ */
+IdeSymbol *
+ide_clang_translation_unit_lookup_symbol_finish (IdeClangTranslationUnit  *self,
+                                                 GAsyncResult             *result,
+                                                 GError                  **error)
+{
+  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static gchar *
+lookup_usr_at (IdeClangTranslationUnit *self,
+               IdeSourceLocation       *location)
+{
+  g_autofree gchar *filename = NULL;
+  g_auto(CXString) cxusr = { 0 };
+  CXTranslationUnit tu;
+  CXSourceLocation cxlocation;
+  CXCursor cursor;
+  CXCursor referenced;
+  CXFile cxfile;
+  const gchar *usr;
+  IdeFile *file;
+  GFile *gfile;
+
+  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_return_val_if_fail (location != NULL, NULL);
+
+  tu = ide_ref_ptr_get (self->native);
+
+  if (!(file = ide_source_location_get_file (location)) ||
+      !(gfile = ide_file_get_file (file)) ||
+      !(filename = g_file_get_path (gfile)) ||
+      !(cxfile = clang_getFile (tu, filename)))
+    return NULL;
+
+  cxlocation = clang_getLocation (tu, cxfile,
+                                  ide_source_location_get_line (location) + 1,
+                                  ide_source_location_get_line_offset (location) + 1);
+  cursor = clang_getCursor (tu, cxlocation);
+  if (clang_Cursor_isNull (cursor))
+    return NULL;
+
+  referenced = clang_getCursorReferenced (cursor);
+  if (!clang_Cursor_isNull (referenced))
+    cursor = referenced;
+
+  cxusr = clang_getCursorUSR (cursor);
+  usr = clang_getCString (cxusr);
+
+  if (usr == NULL || *usr == '\0')
+    return NULL;
+
+  return g_strdup (usr);
+}
+
+static void
+ide_clang_translation_unit_lookup_usr_worker (GTask        *task,
+                                              gpointer      source_object,
+                                              gpointer      task_data,
+                                              GCancellable *cancellable)
+{
+  IdeClangTranslationUnit *self = source_object;
+  IdeSourceLocation *location = task_data;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (location != NULL);
+
+  g_task_return_pointer (task, lookup_usr_at (self, location), g_free);
+}
+
+/**
+ * ide_clang_translation_unit_lookup_usr_async:
+ * @self: An #IdeClangTranslationUnit
+ * @location: An #IdeSourceLocation
+ * @cancellable: (nullable): A #GCancellable or %NULL.
+ * @callback: A callback to execute upon completion.
+ * @user_data: User data for @callback.
+ *
+ * Asynchronously gets the unified symbol resolution of the symbol referenced
+ * at @location. This can be used to locate the symbol in other translation
+ * units, such as with the project #IdeClangIndex.
+ */
+void
+ide_clang_translation_unit_lookup_usr_async (IdeClangTranslationUnit *self,
+                                             IdeSourceLocation       *location,
+                                             GCancellable            *cancellable,
+                                             GAsyncReadyCallback      callback,
+                                             gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_return_if_fail (location != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task,
+                        ide_source_location_ref (location),
+                        (GDestroyNotify)ide_source_location_unref);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_lookup_usr_worker);
+}
+
+/**
+ * ide_clang_translation_unit_lookup_usr_finish:
+ * @self: An #IdeClangTranslationUnit
+ * @result: A #GAsyncResult
+ * @error: (out) (nullable): A location for a #GError, or %NULL.
+ *
+ * Completes a call to ide_clang_translation_unit_lookup_usr_async().
+ *
+ * Returns: (transfer full) (nullable): A newly allocated string or %NULL.
+ */
+gchar *
+ide_clang_translation_unit_lookup_usr_finish (IdeClangTranslationUnit  *self,
+                                              GAsyncResult             *result,
+                                              GError                  **error)
+{
+  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 static IdeSymbol *
 create_symbol (CXCursor         cursor,
                GetSymbolsState *state)
@@ -1039,20 +1395,19 @@ sort_symbols_by_name (gconstpointer a,
                     ide_symbol_get_name (*bsym));
 }
 
-/**
- * ide_clang_translation_unit_get_symbols:
- *
- * Returns: (transfer container) (element-type IdeSymbol*): An array of #IdeSymbol.
- */
-GPtrArray *
-ide_clang_translation_unit_get_symbols (IdeClangTranslationUnit *self,
-                                        IdeFile                 *file)
+static void
+ide_clang_translation_unit_get_symbols_worker (GTask        *task,
+                                               gpointer      source_object,
+                                               gpointer      task_data,
+                                               GCancellable *cancellable)
 {
+  IdeClangTranslationUnit *self = source_object;
+  IdeFile *file = task_data;
   GetSymbolsState state = { 0 };
   CXCursor cursor;
 
-  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
-  g_return_val_if_fail (IDE_IS_FILE (file), NULL);
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (IDE_IS_FILE (file));
 
   state.ar = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_symbol_unref);
   state.file = file;
@@ -1067,7 +1422,60 @@ ide_clang_translation_unit_get_symbols (IdeClangTranslationUnit *self,
 
   g_free (state.path);
 
-  return state.ar;
+  g_task_return_pointer (task, state.ar, (GDestroyNotify)g_ptr_array_unref);
+}
+
+void
+ide_clang_translation_unit_get_symbols_async (IdeClangTranslationUnit *self,
+                                              IdeFile                 *file,
+                                              GCancellable            *cancellable,
+                                              GAsyncReadyCallback      callback,
+                                              gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_return_if_fail (IDE_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_get_symbols_worker);
+}
+
+/**
+ * ide_clang_translation_unit_get_symbols_finish:
+ *
+ * Returns: (transfer container) (element-type IdeSymbol*): An array of #IdeSymbol.
+ */
+GPtrArray *
+ide_clang_translation_unit_get_symbols_finish (IdeClangTranslationUnit  *self,
+                                               GAsyncResult             *result,
+                                               GError                  **error)
+{
+  g_return_val_if_fail (IDE_IS_CLANG_TRANSLATION_UNIT (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+ide_clang_translation_unit_get_symbol_tree_worker (GTask        *task,
+                                                   gpointer      source_object,
+                                                   gpointer      task_data,
+                                                   GCancellable *cancellable)
+{
+  IdeClangSymbolTree *symbol_tree = task_data;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (source_object));
+  g_assert (IDE_IS_CLANG_SYMBOL_TREE (symbol_tree));
+
+  _ide_clang_symbol_tree_build (symbol_tree);
+
+  g_task_return_pointer (task, g_object_ref (symbol_tree), g_object_unref);
 }
 
 void
@@ -1093,7 +1501,11 @@ ide_clang_translation_unit_get_symbol_tree_async (IdeClangTranslationUnit *self,
                               "native", self->native,
                               "file", file,
                               NULL);
-  g_task_return_pointer (task, symbol_tree, g_object_unref);
+  g_task_set_task_data (task, symbol_tree, g_object_unref);
+
+  ide_clang_translation_unit_queue_task (self,
+                                         task,
+                                         ide_clang_translation_unit_get_symbol_tree_worker);
 }
 
 IdeSymbolTree *
@@ -90,15 +90,15 @@ gb_command_manager_add_provider (GbCommandManager  *manager,
   g_ptr_array_sort (manager->providers, provider_compare_func);
 }
 
-GbCommand *
-gb_command_manager_lookup (GbCommandManager *manager,
-                           const gchar      *command_text)
+static GbCommand *
+gb_command_manager_lookup_providers (GbCommandManager *manager,
+                                     const gchar      *command_text)
 {
   GbCommand *ret = NULL;
   guint i;
 
-  g_return_val_if_fail (GB_IS_COMMAND_MANAGER (manager), NULL);
-  g_return_val_if_fail (command_text, NULL);
+  g_assert (GB_IS_COMMAND_MANAGER (manager));
+  g_assert (command_text != NULL);
 
   for (i = 0; i < manager->providers->len; i++)
     {
@@ -114,6 +114,32 @@ gb_command_manager_lookup (GbCommandManager *manager,
   return NULL;
 }
 
+GbCommand *
+gb_command_manager_lookup (GbCommandManager *manager,
+                           const gchar      *command_text)
+{
+  g_autofree gchar *name = NULL;
+  GbCommand *ret;
+
+  g_return_val_if_fail (GB_IS_COMMAND_MANAGER (manager), NULL);
+  g_return_val_if_fail (command_text, NULL);
+
+  if ((ret = gb_command_manager_lookup_providers (manager, command_text)))
+    return ret;
+
+  /*
+   * The command may belong to a plugin that has not been activated yet.
+   * Load it using the first word of the command and try again.
+   */
+  name = g_strdup (command_text);
+  g_strdelimit (g_strstrip (name), " \t", '\0');
+
+  if (ide_application_activate_plugins (IDE_APPLICATION_DEFAULT, "Commands", name))
+    return gb_command_manager_lookup_providers (manager, command_text);
+
+  return NULL;
+}
+
 static gint
 sort_strings (const gchar * const * a,
               const gchar * const * b)
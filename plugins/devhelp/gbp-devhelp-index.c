@@ -0,0 +1,744 @@
+/* gbp-devhelp-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "gbp-devhelp-index"
+
+#include <glib/gstdio.h>
+#include <ide.h>
+#include <string.h>
+
+#include "fuzzy.h"
+
+#include "gbp-devhelp-index.h"
+
+/*
+ * GbpDevhelpIndex is a keyword index over the installed .devhelp2 books,
+ * shared by every workbench in the process.
+ *
+ * The keywords of each book are stored as a GVariant beneath
+ * ~/.cache/gnome-builder/devhelp/ along with the path and mtime of the book
+ * they were read from. On startup the books are discovered on a worker
+ * thread and only the ones whose mtime changed are parsed again, the rest
+ * are mapped straight from the cache.
+ *
+ * The keywords are then loaded into a Fuzzy index which is never modified
+ * afterwards, so queries can run on a worker thread against a reference to
+ * it while the main thread only has to create rows for the top results.
+ */
+
+#define INDEX_VERSION      "1"
+#define INDEX_FORMAT       "(sxssa(ssu))"
+#define INDEX_ENTRY_FORMAT "(ssu)"
+#define INDEX_ENTRY_ITER   "(&s&su)"
+
+#define KEYWORD_DEPRECATED (1 << 0)
+
+typedef struct
+{
+  volatile gint  ref_count;
+
+  /* GVariant for each book, owning the strings referenced by @keywords */
+  GPtrArray     *books;
+
+  /* Keyword, indexed by the value stored in @fuzzy */
+  GArray        *keywords;
+
+  Fuzzy         *fuzzy;
+} IndexSnapshot;
+
+typedef struct
+{
+  const gchar *uri;
+  const gchar *book_title;
+  guint        flags;
+} Keyword;
+
+typedef struct
+{
+  IndexSnapshot *snapshot;
+  gchar         *query;
+  gsize          max_results;
+} QueryRequest;
+
+typedef struct
+{
+  gchar           *base_uri;
+  gchar           *name;
+  gchar           *title;
+  GVariantBuilder  keywords;
+} ParseState;
+
+struct _GbpDevhelpIndex
+{
+  GObject        parent_instance;
+
+  gchar         *cache_dir;
+
+  /* Immutable once loaded, shared with query workers */
+  IndexSnapshot *snapshot;
+
+  /* Queries that arrived before the index was loaded */
+  GPtrArray     *pending;
+
+  guint          loading : 1;
+};
+
+G_DEFINE_TYPE (GbpDevhelpIndex, gbp_devhelp_index, G_TYPE_OBJECT)
+
+static IndexSnapshot *
+index_snapshot_ref (IndexSnapshot *snapshot)
+{
+  g_assert (snapshot != NULL);
+  g_assert (snapshot->ref_count > 0);
+
+  g_atomic_int_inc (&snapshot->ref_count);
+
+  return snapshot;
+}
+
+static void
+index_snapshot_unref (IndexSnapshot *snapshot)
+{
+  g_assert (snapshot != NULL);
+  g_assert (snapshot->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&snapshot->ref_count))
+    {
+      g_clear_pointer (&snapshot->fuzzy, fuzzy_unref);
+      g_clear_pointer (&snapshot->keywords, g_array_unref);
+      g_clear_pointer (&snapshot->books, g_ptr_array_unref);
+      g_slice_free (IndexSnapshot, snapshot);
+    }
+}
+
+static void
+query_request_free (gpointer data)
+{
+  QueryRequest *request = data;
+
+  g_clear_pointer (&request->snapshot, index_snapshot_unref);
+  g_clear_pointer (&request->query, g_free);
+  g_slice_free (QueryRequest, request);
+}
+
+static void
+gbp_devhelp_index_match_clear (gpointer data)
+{
+  GbpDevhelpIndexMatch *match = data;
+
+  g_clear_pointer (&match->name, g_free);
+  g_clear_pointer (&match->uri, g_free);
+  g_clear_pointer (&match->book_title, g_free);
+}
+
+static gchar *
+get_cache_path (const gchar *cache_dir,
+                const gchar *book_path)
+{
+  g_autofree gchar *checksum = NULL;
+  g_autofree gchar *name = NULL;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, book_path, -1);
+  name = g_strdup_printf ("%s.gvariant", checksum);
+
+  return g_build_filename (cache_dir, name, NULL);
+}
+
+static void
+find_books_in_directory (const gchar *directory,
+                         GHashTable  *seen,
+                         GPtrArray   *books)
+{
+  g_autoptr(GDir) dir = NULL;
+  const gchar *name;
+
+  g_assert (directory != NULL);
+  g_assert (seen != NULL);
+  g_assert (books != NULL);
+
+  if (!(dir = g_dir_open (directory, 0, NULL)))
+    return;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      g_autofree gchar *filename = NULL;
+      g_autofree gchar *path = NULL;
+
+      /* Like devhelp, the first book found with a given name wins */
+      if (g_hash_table_contains (seen, name))
+        continue;
+
+      filename = g_strdup_printf ("%s.devhelp2", name);
+      path = g_build_filename (directory, name, filename, NULL);
+
+      if (!g_file_test (path, G_FILE_TEST_IS_REGULAR))
+        continue;
+
+      g_hash_table_add (seen, g_strdup (name));
+      g_ptr_array_add (books, g_steal_pointer (&path));
+    }
+}
+
+static GPtrArray *
+find_books (void)
+{
+  static const gchar *subdirs[] = { "gtk-doc/html", "devhelp/books" };
+  const gchar * const *system_dirs;
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *books;
+  guint i;
+  guint j;
+
+  books = g_ptr_array_new_with_free_func (g_free);
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (j = 0; j < G_N_ELEMENTS (subdirs); j++)
+    {
+      g_autofree gchar *path = g_build_filename (g_get_user_data_dir (), subdirs [j], NULL);
+
+      find_books_in_directory (path, seen, books);
+    }
+
+  system_dirs = g_get_system_data_dirs ();
+
+  for (i = 0; system_dirs [i]; i++)
+    {
+      for (j = 0; j < G_N_ELEMENTS (subdirs); j++)
+        {
+          g_autofree gchar *path = g_build_filename (system_dirs [i], subdirs [j], NULL);
+
+          find_books_in_directory (path, seen, books);
+        }
+    }
+
+  return books;
+}
+
+static const gchar *
+find_attribute (const gchar **attribute_names,
+                const gchar **attribute_values,
+                const gchar  *name)
+{
+  guint i;
+
+  for (i = 0; attribute_names [i]; i++)
+    {
+      if (g_str_equal (attribute_names [i], name))
+        return attribute_values [i];
+    }
+
+  return NULL;
+}
+
+static gchar *
+normalize_keyword (const gchar *type,
+                   const gchar *name)
+{
+  static const gchar *prefixes[] = { "struct ", "union ", "enum " };
+  guint i;
+
+  /* Match the names shown by devhelp's own keyword list */
+  if (g_strcmp0 (type, "function") == 0 || g_strcmp0 (type, "macro") == 0)
+    {
+      if (g_str_has_suffix (name, " ()"))
+        return g_strndup (name, strlen (name) - 3);
+    }
+  else if (g_strcmp0 (type, "struct") == 0 ||
+           g_strcmp0 (type, "union") == 0 ||
+           g_strcmp0 (type, "enum") == 0)
+    {
+      for (i = 0; i < G_N_ELEMENTS (prefixes); i++)
+        {
+          if (g_str_has_prefix (name, prefixes [i]))
+            return g_strdup (name + strlen (prefixes [i]));
+        }
+    }
+
+  return g_strdup (name);
+}
+
+static void
+book_start_element (GMarkupParseContext  *context,
+                    const gchar          *element_name,
+                    const gchar         **attribute_names,
+                    const gchar         **attribute_values,
+                    gpointer              user_data,
+                    GError              **error)
+{
+  ParseState *state = user_data;
+
+  g_assert (state != NULL);
+
+  if (g_str_equal (element_name, "book"))
+    {
+      g_free (state->name);
+      g_free (state->title);
+
+      state->name = g_strdup (find_attribute (attribute_names, attribute_values, "name"));
+      state->title = g_strdup (find_attribute (attribute_names, attribute_values, "title"));
+    }
+  else if (g_str_equal (element_name, "keyword"))
+    {
+      g_autofree gchar *normalized = NULL;
+      g_autofree gchar *uri = NULL;
+      const gchar *name;
+      const gchar *link;
+      const gchar *type;
+      guint flags = 0;
+
+      name = find_attribute (attribute_names, attribute_values, "name");
+      link = find_attribute (attribute_names, attribute_values, "link");
+      type = find_attribute (attribute_names, attribute_values, "type");
+
+      if (name == NULL || link == NULL || *name == '\0')
+        return;
+
+      if (find_attribute (attribute_names, attribute_values, "deprecated") != NULL)
+        flags |= KEYWORD_DEPRECATED;
+
+      normalized = normalize_keyword (type, name);
+      uri = g_strdup_printf ("%s/%s", state->base_uri, link);
+
+      g_variant_builder_add (&state->keywords, INDEX_ENTRY_FORMAT, normalized, uri, flags);
+    }
+}
+
+static const GMarkupParser book_parser = {
+  book_start_element,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+};
+
+static GVariant *
+parse_book (const gchar  *path,
+            gint64        mtime,
+            GError      **error)
+{
+  g_autoptr(GMarkupParseContext) context = NULL;
+  g_autofree gchar *contents = NULL;
+  g_autofree gchar *dirname = NULL;
+  ParseState state = { 0 };
+  GVariant *ret = NULL;
+  gsize len;
+
+  g_assert (path != NULL);
+
+  if (!g_file_get_contents (path, &contents, &len, error))
+    return NULL;
+
+  dirname = g_path_get_dirname (path);
+
+  if (!(state.base_uri = g_filename_to_uri (dirname, NULL, error)))
+    return NULL;
+
+  g_variant_builder_init (&state.keywords, G_VARIANT_TYPE ("a" INDEX_ENTRY_FORMAT));
+
+  context = g_markup_parse_context_new (&book_parser, 0, &state, NULL);
+
+  if (g_markup_parse_context_parse (context, contents, len, error) &&
+      g_markup_parse_context_end_parse (context, error))
+    ret = g_variant_ref_sink (g_variant_new (INDEX_FORMAT,
+                                             path,
+                                             mtime,
+                                             state.name ?: "",
+                                             state.title ?: state.name ?: "",
+                                             &state.keywords));
+  else
+    g_variant_builder_clear (&state.keywords);
+
+  g_free (state.base_uri);
+  g_free (state.name);
+  g_free (state.title);
+
+  return ret;
+}
+
+static GVariant *
+load_book (const gchar *cache_dir,
+           const gchar *path)
+{
+  g_autofree gchar *cache_path = NULL;
+  g_autoptr(GMappedFile) mapped = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariant *variant;
+  GStatBuf st;
+
+  g_assert (cache_dir != NULL);
+  g_assert (path != NULL);
+
+  if (g_stat (path, &st) != 0)
+    return NULL;
+
+  cache_path = get_cache_path (cache_dir, path);
+
+  if ((mapped = g_mapped_file_new (cache_path, FALSE, NULL)))
+    {
+      const gchar *cached_path;
+      gint64 cached_mtime;
+
+      bytes = g_mapped_file_get_bytes (mapped);
+      variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (INDEX_FORMAT),
+                                                              bytes, FALSE));
+      g_variant_get_child (variant, 0, "&s", &cached_path);
+      g_variant_get_child (variant, 1, "x", &cached_mtime);
+
+      if (g_str_equal (cached_path, path) && cached_mtime == (gint64)st.st_mtime)
+        return variant;
+
+      g_variant_unref (variant);
+      g_clear_pointer (&bytes, g_bytes_unref);
+    }
+
+  if (!(variant = parse_book (path, st.st_mtime, &error)))
+    {
+      g_debug ("Failed to parse %s: %s", path, error->message);
+      return NULL;
+    }
+
+  /*
+   * This serializes the variant, which must happen before we take pointers
+   * to the keywords within it. Failing to write the cache only means the
+   * book will be parsed again next time.
+   */
+  bytes = g_variant_get_data_as_bytes (variant);
+
+  if (!g_file_set_contents (cache_path,
+                            g_bytes_get_data (bytes, NULL),
+                            g_bytes_get_size (bytes),
+                            &error))
+    g_warning ("%s", error->message);
+
+  return variant;
+}
+
+static void
+gbp_devhelp_index_load_worker (GTask        *task,
+                               gpointer      source_object,
+                               gpointer      task_data,
+                               GCancellable *cancellable)
+{
+  const gchar *cache_dir = task_data;
+  g_autoptr(GHashTable) cache_files = NULL;
+  g_autoptr(GPtrArray) books = NULL;
+  g_autoptr(GDir) dir = NULL;
+  IndexSnapshot *snapshot;
+  const gchar *name;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_DEVHELP_INDEX (source_object));
+  g_assert (cache_dir != NULL);
+
+  if (g_mkdir_with_parents (cache_dir, 0750) != 0)
+    g_warning ("Failed to create directory %s", cache_dir);
+
+  snapshot = g_slice_new0 (IndexSnapshot);
+  snapshot->ref_count = 1;
+  snapshot->books = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+  snapshot->keywords = g_array_new (FALSE, FALSE, sizeof (Keyword));
+  snapshot->fuzzy = fuzzy_new (FALSE);
+
+  cache_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  books = find_books ();
+
+  for (i = 0; i < books->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (books, i);
+      GVariant *variant;
+
+      if ((variant = load_book (cache_dir, path)))
+        {
+          g_ptr_array_add (snapshot->books, variant);
+          g_hash_table_add (cache_files, get_cache_path (cache_dir, path));
+        }
+    }
+
+  /* Drop the cache of books that have been uninstalled */
+  if ((dir = g_dir_open (cache_dir, 0, NULL)))
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          g_autofree gchar *path = g_build_filename (cache_dir, name, NULL);
+
+          if (g_str_has_suffix (name, ".gvariant") && !g_hash_table_contains (cache_files, path))
+            g_unlink (path);
+        }
+    }
+
+  fuzzy_begin_bulk_insert (snapshot->fuzzy);
+
+  for (i = 0; i < snapshot->books->len; i++)
+    {
+      GVariant *variant = g_ptr_array_index (snapshot->books, i);
+      g_autoptr(GVariant) entries = NULL;
+      const gchar *keyword_name;
+      GVariantIter iter;
+      Keyword keyword = { 0 };
+
+      g_variant_get_child (variant, 3, "&s", &keyword.book_title);
+      entries = g_variant_get_child_value (variant, 4);
+
+      g_variant_iter_init (&iter, entries);
+
+      while (g_variant_iter_next (&iter, INDEX_ENTRY_ITER, &keyword_name, &keyword.uri, &keyword.flags))
+        {
+          g_array_append_val (snapshot->keywords, keyword);
+          fuzzy_insert (snapshot->fuzzy,
+                        keyword_name,
+                        GUINT_TO_POINTER (snapshot->keywords->len - 1));
+        }
+    }
+
+  fuzzy_end_bulk_insert (snapshot->fuzzy);
+
+  g_debug ("Indexed %u keywords from %u books",
+           snapshot->keywords->len, snapshot->books->len);
+
+  g_task_return_pointer (task, snapshot, (GDestroyNotify)index_snapshot_unref);
+}
+
+static void
+gbp_devhelp_index_query_worker (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+  QueryRequest *request = task_data;
+  g_autoptr(GArray) matches = NULL;
+  GArray *ret;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GBP_IS_DEVHELP_INDEX (source_object));
+  g_assert (request != NULL);
+  g_assert (request->snapshot != NULL);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  matches = fuzzy_match (request->snapshot->fuzzy, request->query, request->max_results);
+
+  /* Single character queries are not truncated by fuzzy_match() */
+  if (request->max_results > 0 && matches->len > request->max_results)
+    g_array_set_size (matches, request->max_results);
+
+  ret = g_array_sized_new (FALSE, FALSE, sizeof (GbpDevhelpIndexMatch), matches->len);
+  g_array_set_clear_func (ret, gbp_devhelp_index_match_clear);
+
+  for (i = 0; i < matches->len; i++)
+    {
+      const FuzzyMatch *match = &g_array_index (matches, FuzzyMatch, i);
+      const Keyword *keyword;
+      GbpDevhelpIndexMatch item;
+
+      keyword = &g_array_index (request->snapshot->keywords,
+                                Keyword,
+                                GPOINTER_TO_UINT (match->value));
+
+      item.name = g_strdup (match->key);
+      item.uri = g_strdup (keyword->uri);
+      item.book_title = g_strdup (keyword->book_title);
+      item.score = match->score;
+      item.deprecated = !!(keyword->flags & KEYWORD_DEPRECATED);
+
+      g_array_append_val (ret, item);
+    }
+
+  g_task_return_pointer (task, ret, (GDestroyNotify)g_array_unref);
+}
+
+static void
+gbp_devhelp_index_load_cb (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+  GbpDevhelpIndex *self = (GbpDevhelpIndex *)object;
+  g_autoptr(GPtrArray) pending = NULL;
+  g_autoptr(GError) error = NULL;
+  IndexSnapshot *snapshot;
+  guint i;
+
+  g_assert (GBP_IS_DEVHELP_INDEX (self));
+  g_assert (G_IS_TASK (result));
+
+  self->loading = FALSE;
+
+  pending = g_steal_pointer (&self->pending);
+  self->pending = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (!(snapshot = g_task_propagate_pointer (G_TASK (result), &error)))
+    {
+      g_warning ("Failed to load documentation index: %s", error->message);
+
+      for (i = 0; i < pending->len; i++)
+        g_task_return_error (g_ptr_array_index (pending, i), g_error_copy (error));
+
+      return;
+    }
+
+  g_clear_pointer (&self->snapshot, index_snapshot_unref);
+  self->snapshot = snapshot;
+
+  for (i = 0; i < pending->len; i++)
+    {
+      GTask *task = g_ptr_array_index (pending, i);
+      QueryRequest *request = g_task_get_task_data (task);
+
+      request->snapshot = index_snapshot_ref (snapshot);
+      g_task_run_in_thread (task, gbp_devhelp_index_query_worker);
+    }
+}
+
+static void
+gbp_devhelp_index_load (GbpDevhelpIndex *self)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_assert (GBP_IS_DEVHELP_INDEX (self));
+
+  if (self->loading)
+    return;
+
+  self->loading = TRUE;
+
+  task = g_task_new (self, NULL, gbp_devhelp_index_load_cb, NULL);
+  g_task_set_task_data (task, g_strdup (self->cache_dir), g_free);
+  ide_thread_pool_push_task (IDE_THREAD_POOL_INDEXER, task, gbp_devhelp_index_load_worker);
+}
+
+/**
+ * gbp_devhelp_index_query_async:
+ * @self: A #GbpDevhelpIndex
+ * @query: the search terms
+ * @max_results: the maximum number of matches, or 0 for unlimited
+ * @cancellable: (allow-none): A #GCancellable or %NULL
+ * @callback: A callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Asynchronously fuzzy searches the documentation keywords for @query.
+ * The search runs on a worker thread, and is delayed until the index has
+ * been loaded if necessary.
+ */
+void
+gbp_devhelp_index_query_async (GbpDevhelpIndex     *self,
+                               const gchar         *query,
+                               gsize                max_results,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  QueryRequest *request;
+
+  g_return_if_fail (GBP_IS_DEVHELP_INDEX (self));
+  g_return_if_fail (query != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gbp_devhelp_index_query_async);
+
+  request = g_slice_new0 (QueryRequest);
+  request->query = g_strdup (query);
+  request->max_results = max_results;
+  g_task_set_task_data (task, request, query_request_free);
+
+  if (self->snapshot == NULL)
+    {
+      g_ptr_array_add (self->pending, g_steal_pointer (&task));
+      gbp_devhelp_index_load (self);
+      return;
+    }
+
+  request->snapshot = index_snapshot_ref (self->snapshot);
+  g_task_run_in_thread (task, gbp_devhelp_index_query_worker);
+}
+
+/**
+ * gbp_devhelp_index_query_finish:
+ *
+ * Completes a request to gbp_devhelp_index_query_async().
+ *
+ * Returns: (transfer full) (element-type GbpDevhelpIndexMatch): The matches,
+ *   ordered from best to worst.
+ */
+GArray *
+gbp_devhelp_index_query_finish (GbpDevhelpIndex  *self,
+                                GAsyncResult     *result,
+                                GError          **error)
+{
+  g_return_val_if_fail (GBP_IS_DEVHELP_INDEX (self), NULL);
+  g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * gbp_devhelp_index_get_default:
+ *
+ * Gets the documentation index shared by the process. Loading the index
+ * is started in the background the first time this is called.
+ *
+ * Returns: (transfer none): A #GbpDevhelpIndex.
+ */
+GbpDevhelpIndex *
+gbp_devhelp_index_get_default (void)
+{
+  static GbpDevhelpIndex *instance;
+
+  if (instance == NULL)
+    {
+      instance = g_object_new (GBP_TYPE_DEVHELP_INDEX, NULL);
+      gbp_devhelp_index_load (instance);
+    }
+
+  return instance;
+}
+
+static void
+gbp_devhelp_index_finalize (GObject *object)
+{
+  GbpDevhelpIndex *self = (GbpDevhelpIndex *)object;
+
+  g_clear_pointer (&self->snapshot, index_snapshot_unref);
+  g_clear_pointer (&self->pending, g_ptr_array_unref);
+  g_clear_pointer (&self->cache_dir, g_free);
+
+  G_OBJECT_CLASS (gbp_devhelp_index_parent_class)->finalize (object);
+}
+
+static void
+gbp_devhelp_index_class_init (GbpDevhelpIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gbp_devhelp_index_finalize;
+}
+
+static void
+gbp_devhelp_index_init (GbpDevhelpIndex *self)
+{
+  self->pending = g_ptr_array_new_with_free_func (g_object_unref);
+  self->cache_dir = g_build_filename (g_get_user_cache_dir (),
+                                      ide_get_program_name (),
+                                      "devhelp",
+                                      INDEX_VERSION,
+                                      NULL);
+}
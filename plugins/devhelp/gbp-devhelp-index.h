@@ -0,0 +1,52 @@
+/* gbp-devhelp-index.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GBP_DEVHELP_INDEX_H
+#define GBP_DEVHELP_INDEX_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GBP_TYPE_DEVHELP_INDEX (gbp_devhelp_index_get_type())
+
+G_DECLARE_FINAL_TYPE (GbpDevhelpIndex, gbp_devhelp_index, GBP, DEVHELP_INDEX, GObject)
+
+typedef struct
+{
+  gchar    *name;
+  gchar    *uri;
+  gchar    *book_title;
+  gfloat    score;
+  gboolean  deprecated;
+} GbpDevhelpIndexMatch;
+
+GbpDevhelpIndex *gbp_devhelp_index_get_default (void);
+void             gbp_devhelp_index_query_async  (GbpDevhelpIndex      *self,
+                                                 const gchar          *query,
+                                                 gsize                 max_results,
+                                                 GCancellable         *cancellable,
+                                                 GAsyncReadyCallback   callback,
+                                                 gpointer              user_data);
+GArray          *gbp_devhelp_index_query_finish (GbpDevhelpIndex      *self,
+                                                 GAsyncResult         *result,
+                                                 GError              **error);
+
+G_END_DECLS
+
+#endif /* GBP_DEVHELP_INDEX_H */
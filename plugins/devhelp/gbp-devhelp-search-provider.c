@@ -19,11 +19,11 @@
 #define G_LOG_DOMAIN "devhelp-search"
 
 #include <ctype.h>
-#include <devhelp/devhelp.h>
 #include <glib/gi18n.h>
 #include <ide.h>
 #include <libpeas/peas.h>
 
+#include "gbp-devhelp-index.h"
 #include "gbp-devhelp-panel.h"
 #include "gbp-devhelp-search-provider.h"
 #include "gbp-devhelp-search-result.h"
@@ -31,11 +31,16 @@
 struct _GbpDevhelpSearchProvider
 {
   IdeObject          parent;
-
-  DhBookManager     *book_manager;
-  DhKeywordModel    *keywords_model;
 };
 
+typedef struct
+{
+  GbpDevhelpSearchProvider *self;
+  IdeSearchContext         *context;
+  gchar                    *casefold;
+  gsize                     max_results;
+} Populate;
+
 static void search_provider_iface_init (IdeSearchProviderInterface *iface);
 
 G_DEFINE_TYPE_EXTENDED (GbpDevhelpSearchProvider,
@@ -46,80 +51,119 @@ G_DEFINE_TYPE_EXTENDED (GbpDevhelpSearchProvider,
                                                search_provider_iface_init))
 
 static void
-gbp_devhelp_search_provider_populate (IdeSearchProvider *provider,
-                                      IdeSearchContext  *context,
-                                      const gchar       *search_terms,
-                                      gsize              max_results,
-                                      GCancellable      *cancellable)
+populate_free (gpointer data)
 {
-  GbpDevhelpSearchProvider *self = (GbpDevhelpSearchProvider *)provider;
+  Populate *state = data;
+
+  g_clear_object (&state->self);
+  g_clear_object (&state->context);
+  g_clear_pointer (&state->casefold, g_free);
+  g_slice_free (Populate, state);
+}
+
+static void
+gbp_devhelp_search_provider_query_cb (GObject      *object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  GbpDevhelpIndex *index = (GbpDevhelpIndex *)object;
+  Populate *state = user_data;
   g_auto(IdeSearchReducer) reducer = { 0 };
+  g_autoptr(GArray) matches = NULL;
+  g_autoptr(GError) error = NULL;
+  IdeSearchProvider *provider;
   IdeContext *idecontext;
-  GtkTreeIter iter;
-  gboolean valid;
-  gint count = 0;
-  gint total;
+  guint i;
 
-  g_assert (GBP_IS_DEVHELP_SEARCH_PROVIDER (self));
-  g_assert (IDE_IS_SEARCH_CONTEXT (context));
-  g_assert (search_terms);
-  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+  g_assert (GBP_IS_DEVHELP_INDEX (index));
+  g_assert (state != NULL);
+  g_assert (GBP_IS_DEVHELP_SEARCH_PROVIDER (state->self));
+  g_assert (IDE_IS_SEARCH_CONTEXT (state->context));
 
-  if (search_terms [0] == '\0')
+  provider = IDE_SEARCH_PROVIDER (state->self);
+
+  if (!(matches = gbp_devhelp_index_query_finish (index, result, &error)))
     {
-      ide_search_context_provider_completed (context, provider);
-      return;
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      goto completed;
     }
 
-  idecontext = ide_object_get_context (IDE_OBJECT (provider));
-
-  dh_keyword_model_filter (self->keywords_model, search_terms, NULL, NULL);
+  idecontext = ide_object_get_context (IDE_OBJECT (state->self));
+  ide_search_reducer_init (&reducer, state->context, provider, state->max_results);
 
-  ide_search_reducer_init (&reducer, context, provider, max_results);
+  for (i = 0; i < matches->len; i++)
+    {
+      const GbpDevhelpIndexMatch *match = &g_array_index (matches, GbpDevhelpIndexMatch, i);
+      g_autoptr(IdeSearchResult) item = NULL;
+      g_autofree gchar *markup = NULL;
 
-  valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (self->keywords_model), &iter);
-  total = gtk_tree_model_iter_n_children (GTK_TREE_MODEL (self->keywords_model), NULL);
+      if (!ide_search_reducer_accepts (&reducer, match->score))
+        continue;
 
-  while (valid)
-    {
-      g_autoptr(IdeSearchResult) result = NULL;
-      g_autofree gchar *name = NULL;
-      DhLink *link = NULL;
-      gfloat score = (total - count) / (gfloat)total;
+      markup = ide_completion_item_fuzzy_highlight (match->name, state->casefold);
 
-      gtk_tree_model_get (GTK_TREE_MODEL (self->keywords_model), &iter,
-                          DH_KEYWORD_MODEL_COL_NAME, &name,
-                          DH_KEYWORD_MODEL_COL_LINK, &link,
-                          -1);
+      if (match->deprecated)
+        {
+          gchar *italic = g_strdup_printf ("<i>%s</i>", markup);
+          g_free (markup);
+          markup = italic;
+        }
 
-      valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (self->keywords_model), &iter);
+      item = g_object_new (GBP_TYPE_DEVHELP_SEARCH_RESULT,
+                           "context", idecontext,
+                           "provider", provider,
+                           "title", markup,
+                           "subtitle", match->book_title,
+                           "score", match->score,
+                           "uri", match->uri,
+                           NULL);
 
-      /* we traverse from best to worst, so just break */
-      if (!ide_search_reducer_accepts (&reducer, score))
-        break;
+      ide_search_reducer_push (&reducer, item);
+    }
 
-      count++;
+completed:
+  ide_search_context_provider_completed (state->context, provider);
+  populate_free (state);
+}
 
-      if ((dh_link_get_flags (link) & DH_LINK_FLAGS_DEPRECATED) != 0)
-        {
-          gchar *italic_name = g_strdup_printf ("<i>%s</i>", name);
-          g_free (name);
-          name = italic_name;
-        }
+static void
+gbp_devhelp_search_provider_populate (IdeSearchProvider *provider,
+                                      IdeSearchContext  *context,
+                                      const gchar       *search_terms,
+                                      gsize              max_results,
+                                      GCancellable      *cancellable)
+{
+  GbpDevhelpSearchProvider *self = (GbpDevhelpSearchProvider *)provider;
+  Populate *state;
 
-      result = g_object_new (GBP_TYPE_DEVHELP_SEARCH_RESULT,
-                             "context", idecontext,
-                             "provider", provider,
-                             "title", name,
-                             "subtitle", dh_link_get_book_name (link),
-                             "score", score,
-                             "uri", dh_link_get_uri (link),
-                             NULL);
+  g_assert (GBP_IS_DEVHELP_SEARCH_PROVIDER (self));
+  g_assert (IDE_IS_SEARCH_CONTEXT (context));
+  g_assert (search_terms);
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-      ide_search_reducer_push (&reducer, result);
+  if (search_terms [0] == '\0')
+    {
+      ide_search_context_provider_completed (context, provider);
+      return;
     }
 
-  ide_search_context_provider_completed (context, provider);
+  state = g_slice_new0 (Populate);
+  state->self = g_object_ref (self);
+  state->context = g_object_ref (context);
+  state->casefold = g_utf8_casefold (search_terms, -1);
+  state->max_results = max_results;
+
+  /*
+   * Matching happens on a worker thread against the keyword index, we only
+   * create results for the top matches once it completes.
+   */
+  gbp_devhelp_index_query_async (gbp_devhelp_index_get_default (),
+                                 search_terms,
+                                 max_results,
+                                 cancellable,
+                                 gbp_devhelp_search_provider_query_cb,
+                                 state);
 }
 
 static const gchar *
@@ -128,15 +172,6 @@ gbp_devhelp_search_provider_get_verb (IdeSearchProvider *provider)
   return _("Documentation");
 }
 
-static void
-gbp_devhelp_search_provider_constructed (GObject *object)
-{
-  GbpDevhelpSearchProvider *self = GBP_DEVHELP_SEARCH_PROVIDER (object);
-
-  dh_book_manager_populate (self->book_manager);
-  dh_keyword_model_set_words (self->keywords_model, self->book_manager);
-}
-
 static GtkWidget *
 gbp_devhelp_search_provider_create_row (IdeSearchProvider *provider,
                                        IdeSearchResult   *result)
@@ -197,30 +232,16 @@ gbp_devhelp_search_provider_get_priority (IdeSearchProvider *provider)
   return 100;
 }
 
-static void
-gbp_devhelp_search_provider_finalize (GObject *object)
-{
-  GbpDevhelpSearchProvider *self = GBP_DEVHELP_SEARCH_PROVIDER (object);
-
-  g_clear_object (&self->book_manager);
-
-  G_OBJECT_CLASS (gbp_devhelp_search_provider_parent_class)->finalize (object);
-}
-
 static void
 gbp_devhelp_search_provider_class_init (GbpDevhelpSearchProviderClass *klass)
 {
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
-
-  object_class->constructed = gbp_devhelp_search_provider_constructed;
-  object_class->finalize = gbp_devhelp_search_provider_finalize;
 }
 
 static void
 gbp_devhelp_search_provider_init (GbpDevhelpSearchProvider *self)
 {
-  self->book_manager = dh_book_manager_new ();
-  self->keywords_model = dh_keyword_model_new ();
+  /* Start loading the index before the first search */
+  gbp_devhelp_index_get_default ();
 }
 
 static void
@@ -290,31 +290,71 @@ gb_file_search_index_build_finish (GbFileSearchIndex  *self,
   return g_task_propagate_boolean (task, error);
 }
 
-void
-gb_file_search_index_populate (GbFileSearchIndex *self,
-                               IdeSearchContext  *context,
-                               IdeSearchProvider *provider,
-                               const gchar       *query)
+typedef struct
 {
-  g_autoptr(GArray) ar = NULL;
+  IdeSearchContext  *context;
+  IdeSearchProvider *provider;
+  Fuzzy             *fuzzy;
+  gchar             *query;
+  gsize              max_matches;
+} Populate;
+
+static void
+populate_free (gpointer data)
+{
+  Populate *state = data;
+
+  g_clear_object (&state->context);
+  g_clear_object (&state->provider);
+  g_clear_pointer (&state->fuzzy, fuzzy_unref);
+  g_clear_pointer (&state->query, g_free);
+  g_slice_free (Populate, state);
+}
+
+static void
+gb_file_search_index_populate_worker (GTask        *task,
+                                      gpointer      source_object,
+                                      gpointer      task_data,
+                                      GCancellable *cancellable)
+{
+  Populate *state = task_data;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GB_IS_FILE_SEARCH_INDEX (source_object));
+  g_assert (state != NULL);
+  g_assert (state->fuzzy != NULL);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_task_return_pointer (task,
+                         fuzzy_match (state->fuzzy, state->query, state->max_matches),
+                         (GDestroyNotify)g_array_unref);
+}
+
+static void
+gb_file_search_index_populate_cb (GObject      *object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+  GbFileSearchIndex *self = (GbFileSearchIndex *)object;
   g_auto(IdeSearchReducer) reducer = { 0 };
+  g_autoptr(GArray) ar = NULL;
+  GTask *task = (GTask *)result;
+  Populate *state;
   IdeContext *icontext;
-  gsize max_matches;
   gsize i;
 
-  g_return_if_fail (GB_IS_FILE_SEARCH_INDEX (self));
-  g_return_if_fail (IDE_IS_SEARCH_CONTEXT (context));
-  g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
-  g_return_if_fail (query != NULL);
+  g_assert (GB_IS_FILE_SEARCH_INDEX (self));
+  g_assert (G_IS_TASK (task));
 
-  if (self->fuzzy == NULL)
-    return;
+  state = g_task_get_task_data (task);
 
-  icontext = ide_object_get_context (IDE_OBJECT (provider));
-  max_matches = ide_search_context_get_max_results (context);
-  ide_search_reducer_init (&reducer, context, provider, max_matches);
+  if (!(ar = g_task_propagate_pointer (task, NULL)))
+    goto completed;
 
-  ar = fuzzy_match (self->fuzzy, query, max_matches);
+  icontext = ide_object_get_context (IDE_OBJECT (state->provider));
+  ide_search_reducer_init (&reducer, state->context, state->provider, state->max_matches);
 
   for (i = 0; i < ar->len; i++)
     {
@@ -324,18 +364,66 @@ gb_file_search_index_populate (GbFileSearchIndex *self,
 
       if (ide_search_reducer_accepts (&reducer, match->score))
         {
-          g_autoptr(GbFileSearchResult) result = NULL;
+          g_autoptr(GbFileSearchResult) item = NULL;
           g_autofree gchar *markup = NULL;
 
-          markup = ide_completion_item_fuzzy_highlight (match->key, query);
-          result = g_object_new (GB_TYPE_FILE_SEARCH_RESULT,
-                                 "context", icontext,
-                                 "provider", provider,
-                                 "score", match->score,
-                                 "title", markup,
-                                 "path", match->key,
-                                 NULL);
-          ide_search_reducer_push (&reducer, IDE_SEARCH_RESULT (result));
+          markup = ide_completion_item_fuzzy_highlight (match->key, state->query);
+          item = g_object_new (GB_TYPE_FILE_SEARCH_RESULT,
+                               "context", icontext,
+                               "provider", state->provider,
+                               "score", match->score,
+                               "title", markup,
+                               "path", match->key,
+                               NULL);
+          ide_search_reducer_push (&reducer, IDE_SEARCH_RESULT (item));
         }
     }
+
+completed:
+  ide_search_context_provider_completed (state->context, state->provider);
+}
+
+/**
+ * gb_file_search_index_populate:
+ *
+ * Matches @query against the index on a worker thread and adds the results
+ * to @context. @provider is completed within @context once the results have
+ * been added, or immediately if the index has not been built yet.
+ */
+void
+gb_file_search_index_populate (GbFileSearchIndex *self,
+                               IdeSearchContext  *context,
+                               IdeSearchProvider *provider,
+                               const gchar       *query,
+                               GCancellable      *cancellable)
+{
+  g_autoptr(GTask) task = NULL;
+  Populate *state;
+
+  g_return_if_fail (GB_IS_FILE_SEARCH_INDEX (self));
+  g_return_if_fail (IDE_IS_SEARCH_CONTEXT (context));
+  g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
+  g_return_if_fail (query != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  if (self->fuzzy == NULL)
+    {
+      ide_search_context_provider_completed (context, provider);
+      return;
+    }
+
+  /*
+   * The fuzzy index is never modified once built, rebuilding replaces it,
+   * so the worker can match against a reference to the current one.
+   */
+  state = g_slice_new0 (Populate);
+  state->context = g_object_ref (context);
+  state->provider = g_object_ref (provider);
+  state->fuzzy = fuzzy_ref (self->fuzzy);
+  state->query = g_utf8_casefold (query, -1);
+  state->max_matches = ide_search_context_get_max_results (context);
+
+  task = g_task_new (self, cancellable, gb_file_search_index_populate_cb, NULL);
+  g_task_set_task_data (task, state, populate_free);
+  g_task_run_in_thread (task, gb_file_search_index_populate_worker);
 }
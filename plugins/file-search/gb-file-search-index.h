@@ -30,7 +30,8 @@ G_DECLARE_FINAL_TYPE (GbFileSearchIndex, gb_file_search_index, GB, FILE_SEARCH_I
 void     gb_file_search_index_populate     (GbFileSearchIndex    *self,
                                             IdeSearchContext     *context,
                                             IdeSearchProvider    *provider,
-                                            const gchar          *query);
+                                            const gchar          *query,
+                                            GCancellable         *cancellable);
 void     gb_file_search_index_build_async  (GbFileSearchIndex    *self,
                                             GCancellable         *cancellable,
                                             GAsyncReadyCallback   callback,
@@ -59,9 +59,9 @@ gb_file_search_provider_populate (IdeSearchProvider *provider,
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
   if (self->index != NULL)
-    gb_file_search_index_populate (self->index, context, provider, search_terms);
-
-  ide_search_context_provider_completed (context, provider);
+    gb_file_search_index_populate (self->index, context, provider, search_terms, cancellable);
+  else
+    ide_search_context_provider_completed (context, provider);
 }
 
 static void
@@ -25,6 +25,7 @@
 #include "egg-signal-group.h"
 
 #include "ide-buffer.h"
+#include "ide-buffer-snapshot.h"
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-file.h"
@@ -73,12 +74,12 @@ struct _IdeGitBufferChangeMonitor
 
 typedef struct
 {
-  GgitRepository *repository;
-  GHashTable     *state;
-  GFile          *file;
-  GBytes         *content;
-  GgitBlob       *blob;
-  guint           is_child_of_workdir : 1;
+  GgitRepository    *repository;
+  GHashTable        *state;
+  GFile             *file;
+  IdeBufferSnapshot *snapshot;
+  GgitBlob          *blob;
+  guint              is_child_of_workdir : 1;
 } DiffTask;
 
 G_DEFINE_TYPE (IdeGitBufferChangeMonitor,
@@ -109,7 +110,7 @@ diff_task_free (gpointer data)
       g_clear_object (&diff->blob);
       g_clear_object (&diff->repository);
       g_clear_pointer (&diff->state, g_hash_table_unref);
-      g_clear_pointer (&diff->content, g_bytes_unref);
+      g_clear_pointer (&diff->snapshot, ide_buffer_snapshot_unref);
     }
 }
 
@@ -172,7 +173,7 @@ ide_git_buffer_change_monitor_calculate_async (IdeGitBufferChangeMonitor *self,
   diff->file = g_object_ref (gfile);
   diff->repository = g_object_ref (self->repository);
   diff->state = g_hash_table_new (g_direct_hash, g_direct_equal);
-  diff->content = ide_buffer_get_content (self->buffer);
+  diff->snapshot = ide_buffer_get_snapshot (self->buffer);
   diff->blob = self->cached_blob ? g_object_ref (self->cached_blob) : NULL;
 
   g_task_set_task_data (task, diff, diff_task_free);
@@ -209,6 +210,93 @@ ide_git_buffer_change_monitor_get_change (IdeBufferChangeMonitor *monitor,
   return GPOINTER_TO_INT (value);
 }
 
+static gint
+compare_lines (gconstpointer a,
+               gconstpointer b)
+{
+  guint line_a = *(const guint *)a;
+  guint line_b = *(const guint *)b;
+
+  return (line_a > line_b) - (line_a < line_b);
+}
+
+static void
+ide_git_buffer_change_monitor_foreach_change (IdeBufferChangeMonitor        *monitor,
+                                              guint                          begin_line,
+                                              guint                          end_line,
+                                              IdeBufferChangeMonitorForeach  callback,
+                                              gpointer                       user_data)
+{
+  IdeGitBufferChangeMonitor *self = (IdeGitBufferChangeMonitor *)monitor;
+  g_autoptr(GArray) lines = NULL;
+  IdeBufferLineChange run_change = IDE_BUFFER_LINE_CHANGE_NONE;
+  GHashTableIter iter;
+  gpointer key;
+  guint run_begin = 0;
+  guint run_end = 0;
+  guint i;
+
+  g_assert (IDE_IS_GIT_BUFFER_CHANGE_MONITOR (self));
+  g_assert (begin_line <= end_line);
+  g_assert (callback != NULL);
+
+  if (!self->state)
+    {
+      /* See get_change(), an untracked file in the working directory is all new */
+      if (self->is_child_of_workdir)
+        callback (begin_line, end_line, IDE_BUFFER_LINE_CHANGE_ADDED, user_data);
+      return;
+    }
+
+  /* Only the changed lines are in the state, in no particular order */
+  lines = g_array_sized_new (FALSE, FALSE, sizeof (guint), g_hash_table_size (self->state));
+
+  g_hash_table_iter_init (&iter, self->state);
+
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      gint lineno = GPOINTER_TO_INT (key);
+      guint line;
+
+      /* The state uses 1-based line numbers */
+      if (lineno < 1)
+        continue;
+
+      line = lineno - 1;
+
+      if (line >= begin_line && line <= end_line)
+        g_array_append_val (lines, line);
+    }
+
+  g_array_sort (lines, compare_lines);
+
+  /* Coalesce neighbouring lines with the same change into one callback */
+  for (i = 0; i < lines->len; i++)
+    {
+      guint line = g_array_index (lines, guint, i);
+      IdeBufferLineChange change;
+
+      change = GPOINTER_TO_INT (g_hash_table_lookup (self->state, GINT_TO_POINTER (line + 1)));
+
+      if (run_change != IDE_BUFFER_LINE_CHANGE_NONE &&
+          change == run_change &&
+          line == run_end + 1)
+        {
+          run_end = line;
+          continue;
+        }
+
+      if (run_change != IDE_BUFFER_LINE_CHANGE_NONE)
+        callback (run_begin, run_end, run_change, user_data);
+
+      run_change = change;
+      run_begin = run_end = line;
+    }
+
+  if (run_change != IDE_BUFFER_LINE_CHANGE_NONE)
+    callback (run_begin, run_end, run_change, user_data);
+}
+
 static void
 ide_git_buffer_change_monitor_set_repository (IdeGitBufferChangeMonitor *self,
                                               GgitRepository            *repository)
@@ -516,6 +604,7 @@ ide_git_buffer_change_monitor_calculate_threaded (IdeGitBufferChangeMonitor  *se
 {
   g_autofree gchar *relative_path = NULL;
   g_autoptr(GFile) workdir = NULL;
+  g_autoptr(GBytes) content = NULL;
   const guint8 *data;
   gsize data_len = 0;
 
@@ -524,7 +613,7 @@ ide_git_buffer_change_monitor_calculate_threaded (IdeGitBufferChangeMonitor  *se
   g_assert (G_IS_FILE (diff->file));
   g_assert (diff->state);
   g_assert (GGIT_IS_REPOSITORY (diff->repository));
-  g_assert (diff->content);
+  g_assert (diff->snapshot);
   g_assert (!diff->blob || GGIT_IS_BLOB (diff->blob));
   g_assert (error);
   g_assert (!*error);
@@ -617,7 +706,9 @@ ide_git_buffer_change_monitor_calculate_threaded (IdeGitBufferChangeMonitor  *se
       return FALSE;
     }
 
-  data = g_bytes_get_data (diff->content, &data_len);
+  /* Flatten here rather than on the main thread while the user is typing. */
+  content = ide_buffer_snapshot_get_bytes (diff->snapshot);
+  data = g_bytes_get_data (content, &data_len);
 
   ggit_diff_blob_to_buffer (diff->blob, relative_path, data, data_len, relative_path,
                             NULL, NULL, NULL, NULL, diff_line_cb, (gpointer)diff->state, error);
@@ -714,6 +805,7 @@ ide_git_buffer_change_monitor_class_init (IdeGitBufferChangeMonitorClass *klass)
 
   parent_class->set_buffer = ide_git_buffer_change_monitor_set_buffer;
   parent_class->get_change = ide_git_buffer_change_monitor_get_change;
+  parent_class->foreach_change = ide_git_buffer_change_monitor_foreach_change;
 
   properties [PROP_REPOSITORY] =
     g_param_spec_object ("repository",
@@ -30,6 +30,10 @@ try:
 except ImportError:
     HAS_LXML = False
     print('Warning: python3-lxml is not installed, no documentation will be available in Python auto-completion')
+import concurrent.futures
+import fcntl
+import functools
+import itertools
 import os
 import os.path
 import sqlite3
@@ -174,10 +178,46 @@ except ImportError:
     HAS_JEDI = False
 
 
+_GIR_PATH = '/usr/share/gir-1.0'
+
+_GIR_NS = {'core': 'http://www.gtk.org/introspection/core/1.0',
+           'c': 'http://www.gtk.org/introspection/c/1.0',
+           'glib': 'http://www.gtk.org/introspection/glib/1.0'}
+
+# Number of (symbol, version) lookups kept in memory by the worker
+_DOC_CACHE_SIZE = 4096
+
+
+def _parse_gir_file(filename):
+    "Parse a single .gir file into rows for the doc table, safe to run in a thread"
+    parser = lxml.etree.XMLParser(recover=True)
+    tree = lxml.etree.parse(filename, parser=parser)
+    namespace = tree.find('core:namespace', namespaces=_GIR_NS)
+    if namespace is None:
+        return []
+    library_version = namespace.attrib.get('version')
+    type_name = '{%s}type-name' % _GIR_NS['glib']
+    identifier = '{%s}identifier' % _GIR_NS['c']
+    rows = []
+    for node in namespace.iterfind('core:class', namespaces=_GIR_NS):
+        doc = node.find('core:doc', namespaces=_GIR_NS)
+        symbol = node.attrib.get(type_name)
+        if doc is not None and symbol is not None:
+            rows.append((symbol, library_version, doc.text, filename))
+    for tag in ('method', 'constructor', 'function'):
+        for node in namespace.iterfind('.//core:' + tag, namespaces=_GIR_NS):
+            doc = node.find('core:doc', namespaces=_GIR_NS)
+            symbol = node.attrib.get(identifier)
+            if doc is not None and symbol is not None:
+                rows.append((symbol, library_version, doc.text, filename))
+    return rows
+
+
 class DocumentationDB(object):
     def __init__(self):
         self.db = None
         self.cursor = None
+        self._cached_query = functools.lru_cache(maxsize=_DOC_CACHE_SIZE)(self._query)
 
     def close(self):
         "Close the DB if open"
@@ -187,22 +227,30 @@ class DocumentationDB(object):
             self.cursor = None
             self.db = None
 
+    @staticmethod
+    def path():
+        "Path of the DB, creating its directory if needed"
+        doc_db_path = os.path.join(GLib.get_user_data_dir(), 'gnome-builder', 'jedi', 'girdoc.db')
+        try:
+            os.makedirs(os.path.dirname(doc_db_path))
+        except:
+            pass
+        return doc_db_path
+
     def open(self):
         "Open the DB (if needed)"
         if self.db is None:
-            doc_db_path = os.path.join(GLib.get_user_data_dir(), 'gnome-builder', 'jedi', 'girdoc.db')
-            try:
-                os.makedirs(os.path.dirname(doc_db_path))
-            except:
-                pass
-            self.db = sqlite3.connect(doc_db_path)
+            self.db = sqlite3.connect(self.path())
             self.cursor = self.db.cursor()
             # Create the tables if they don't exist to prevent exceptions later on
             self.cursor.execute('CREATE TABLE IF NOT EXISTS doc (symbol text, library_version text, doc text, gir_file text)')
             self.cursor.execute('CREATE TABLE IF NOT EXISTS girfiles (file text, last_modified integer)')
+            self.cursor.execute('CREATE INDEX IF NOT EXISTS doc_symbol_version ON doc (symbol, library_version)')
+            self.cursor.execute('CREATE INDEX IF NOT EXISTS doc_gir_file ON doc (gir_file)')
+            self.cursor.execute('CREATE UNIQUE INDEX IF NOT EXISTS girfiles_file ON girfiles (file)')
+            self.db.commit()
 
-    def query(self, symbol, version):
-        "Query the documentation DB"
+    def _query(self, symbol, version):
         self.open()
         self.cursor.execute('SELECT doc FROM doc WHERE symbol=? AND library_version=?', (symbol, version))
         result = self.cursor.fetchone()
@@ -211,59 +259,68 @@ class DocumentationDB(object):
         else:
             return None
 
+    def query(self, symbol, version):
+        "Query the documentation DB, answering repeated lookups from memory"
+        return self._cached_query(symbol, version)
+
+    def invalidate(self):
+        "Forget cached lookups, such as after the DB has been updated"
+        self._cached_query.cache_clear()
+
     def update(self, close_when_done=False):
         "Build the documentation DB and ensure it's up to date"
         if not HAS_LXML:
             return  # Can't process the gir files without lxml
-        gir_path = '/usr/share/gir-1.0'
-        ns = {'core': 'http://www.gtk.org/introspection/core/1.0',
-              'c': 'http://www.gtk.org/introspection/c/1.0'}
+        # Every pooled worker calls this at startup. Only one of them does the
+        # parsing, the others wait and then find the DB already up to date.
+        with open(self.path() + '.lock', 'w') as lock_file:
+            fcntl.flock(lock_file, fcntl.LOCK_EX)
+            try:
+                self._update_locked()
+            finally:
+                fcntl.flock(lock_file, fcntl.LOCK_UN)
+                if close_when_done:
+                    self.close()
+
+    def _update_locked(self):
         self.open()
         cursor = self.cursor
 
-        # I would use scandir for better performance, but it requires newer Python
-        for gir_file in os.listdir(gir_path):
-            filename = os.path.join(gir_path, gir_file)
-            mtime = os.stat(filename).st_mtime
-            cursor.execute('SELECT * from girfiles WHERE file=?', (filename,))
-            result = cursor.fetchone()
-            if result is None:
-                cursor.execute('INSERT INTO girfiles VALUES (?, ?)', (filename, mtime))
-            else:
-                if result[1] >= mtime:
-                    continue
-                else:
-                    # updated
-                    cursor.execute('DELETE FROM doc WHERE gir_file=?', (filename,))
-                    cursor.execute('UPDATE girfiles SET last_modified=? WHERE file=?', (mtime, filename))
-            parser = lxml.etree.XMLParser(recover=True)
-            tree = lxml.etree.parse(filename, parser=parser)
-            namespace = tree.find('core:namespace', namespaces=ns)
-            library_version = namespace.attrib['version']
-            for node in namespace.findall('core:class', namespaces=ns):
-                doc = node.find('core:doc', namespaces=ns)
-                if doc is not None:
-                    symbol = node.attrib['{http://www.gtk.org/introspection/glib/1.0}type-name']
-                    cursor.execute("INSERT INTO doc VALUES (?, ?, ?, ?)",
-                                   (symbol, library_version, doc.text, filename))
-            for method in namespace.findall('core:method', namespaces=ns) + \
-                          namespace.findall('core:constructor', namespaces=ns) + \
-                          namespace.findall('core:function', namespaces=ns):
-                doc = method.find('core:doc', namespaces=ns)
-                if doc is not None:
-                    symbol = method.attrib['{http://www.gtk.org/introspection/c/1.0}identifier']
-                    cursor.execute("INSERT INTO doc VALUES (?, ?, ?, ?)",
-                                   (symbol, library_version, doc.text, filename))
-        self.db.commit()
-        if close_when_done:
-            self.close()
-
-
-def update_doc_db_on_startup():
-    db = DocumentationDB()
-    threading.Thread(target=db.update, args={'close_when_done': True}).start()
-
-update_doc_db_on_startup()
+        cursor.execute('SELECT file, last_modified FROM girfiles')
+        known = dict(cursor.fetchall())
+
+        changed = {}
+        for gir_file in os.listdir(_GIR_PATH):
+            filename = os.path.join(_GIR_PATH, gir_file)
+            try:
+                mtime = os.stat(filename).st_mtime
+            except OSError:
+                continue
+            last_modified = known.pop(filename, None)
+            if last_modified is None or last_modified < mtime:
+                changed[filename] = mtime
+        # Anything left in known no longer exists on disk
+        removed = list(known.keys())
+
+        if not changed and not removed:
+            return
+
+        # lxml releases the GIL while parsing, so the threads overlap usefully
+        rows = []
+        with concurrent.futures.ThreadPoolExecutor(max_workers=os.cpu_count() or 1) as executor:
+            futures = {executor.submit(_parse_gir_file, filename): filename for filename in changed}
+            for future in concurrent.futures.as_completed(futures):
+                try:
+                    rows.extend(future.result())
+                except Exception as ex:
+                    print('Failed to parse %s: %s' % (futures[future], repr(ex)))
+
+        stale = [(filename,) for filename in list(changed.keys()) + removed]
+        with self.db:
+            cursor.executemany('DELETE FROM doc WHERE gir_file=?', stale)
+            cursor.executemany('DELETE FROM girfiles WHERE file=?', stale)
+            cursor.executemany('INSERT INTO doc VALUES (?, ?, ?, ?)', rows)
+            cursor.executemany('INSERT INTO girfiles VALUES (?, ?)', changed.items())
 
 
 class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.CompletionProvider):
@@ -275,9 +332,16 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
     line = -1
     line_offset = -1
     loading_proxy = False
+    sequence = 0
+    documents = None
 
     proxy = None
 
+    def __init__(self, *args, **kwargs):
+        super().__init__(*args, **kwargs)
+        # filename -> (revision, text) last sent to the worker
+        self.documents = {}
+
     def do_get_name(self):
         return 'Jedi Provider'
 
@@ -327,8 +391,7 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
                         .get_path())
 
         text = buffer.get_text(begin, end, True)
-        line = iter.get_line() + 1
-        column = iter.get_line_offset()
+        revision = buffer.get_change_count()
 
         self.line = iter.get_line()
         self.line_offset = iter.get_line_offset()
@@ -338,27 +401,22 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
         self.cancellable = cancellable = Gio.Cancellable()
         context.connect('cancelled', lambda *_: cancellable.cancel())
 
-        def async_handler(proxy, result, user_data):
-            (self, results, context) = user_data
-
-            try:
-                variant = proxy.call_finish(result)
-                # unwrap outer tuple
-                variant = variant.get_child_value(0)
-                for i in range(variant.n_children()):
-                    proposal = JediCompletionProposal(self, context, variant, i)
-                    results.take_proposal(proposal)
-                self.complete(context, results)
-            except Exception as ex:
-                if isinstance(ex, GLib.Error) and \
-                   ex.matches(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED):
-                    return
-                print(repr(ex))
-                context.add_proposals(self, [], True)
-
-        self.proxy.call('CodeComplete',
-                        GLib.Variant('(siis)', (filename, self.line, self.line_offset, text)),
-                        0, 10000, cancellable, async_handler, (self, results, context))
+        self.sequence = next(_sequences)
+        request = JediCompletionClientRequest(self, context, results, cancellable,
+                                              filename, self.sequence, revision, text)
+        request.send(full=False)
+
+    def send_delta(self, filename, revision, text, full):
+        "Returns (base_revision, begin, end, text) to move the worker's copy to @revision"
+        sent = None if full else self.documents.get(filename)
+        self.documents[filename] = (revision, text)
+        if sent is None:
+            return (-1, 0, 0, text)
+        sent_revision, sent_text = sent
+        if sent_revision == revision:
+            return (revision, 0, 0, '')
+        begin, end, replacement = _text_delta(sent_text, text)
+        return (sent_revision, begin, end, replacement)
 
     def do_match(self, context):
         if not HAS_JEDI:
@@ -439,6 +497,145 @@ class JediCompletionProvider(Ide.Object, GtkSource.CompletionProvider, Ide.Compl
         self.context = None
 
 
+# Sequence numbers are shared by all providers. The service drops requests
+# for a file older than the last one it saw, and there is one provider for
+# each view of that file.
+_sequences = itertools.count(1)
+
+
+def _text_delta(old, new):
+    "Returns (begin, end, replacement) such that old[:begin] + replacement + old[end:] == new"
+    # Bisect with slice comparisons, which run in C, rather than walking characters
+    lo, hi = 0, min(len(old), len(new))
+    while lo < hi:
+        mid = (lo + hi + 1) // 2
+        if old[:mid] == new[:mid]:
+            lo = mid
+        else:
+            hi = mid - 1
+    prefix = lo
+    lo, hi = 0, min(len(old), len(new)) - prefix
+    while lo < hi:
+        mid = (lo + hi + 1) // 2
+        if old[len(old) - mid:] == new[len(new) - mid:]:
+            lo = mid
+        else:
+            hi = mid - 1
+    suffix = lo
+    return (prefix, len(old) - suffix, new[prefix:len(new) - suffix])
+
+
+class JediCompletionClientRequest:
+    "A single CodeComplete call and the CodeCompleteMore calls streaming its results"
+    def __init__(self, provider, context, results, cancellable, filename, sequence, revision, text):
+        self.provider = provider
+        self.context = context
+        self.results = results
+        self.cancellable = cancellable
+        self.filename = filename
+        self.sequence = sequence
+        self.revision = revision
+        self.text = text
+        self.line = provider.line
+        self.column = provider.line_offset
+        self.streamed = False
+
+    def send(self, full):
+        base_revision, begin, end, text = self.provider.send_delta(self.filename, self.revision, self.text, full)
+        # Large texts travel through shared memory rather than the socket
+        fd_list = Gio.UnixFDList.new()
+        payload = Ide.worker_payload_new(GLib.Bytes.new(text.encode('utf-8')), fd_list)
+        params = GLib.Variant.new_tuple(GLib.Variant('s', self.filename),
+                                        GLib.Variant('x', self.sequence),
+                                        GLib.Variant('x', base_revision),
+                                        GLib.Variant('x', self.revision),
+                                        GLib.Variant('i', self.line),
+                                        GLib.Variant('i', self.column),
+                                        GLib.Variant('i', begin),
+                                        GLib.Variant('i', end),
+                                        payload)
+        self.provider.proxy.call_with_unix_fd_list('CodeComplete', params, 0, 10000, fd_list,
+                                                   self.cancellable, self.on_reply, full)
+
+    def on_reply(self, proxy, result, full):
+        try:
+            variant, _ = proxy.call_with_unix_fd_list_finish(result)
+        except Exception as ex:
+            if isinstance(ex, GLib.Error) and \
+               Gio.DBusError.get_remote_error(ex) == _ERROR_UNKNOWN_REVISION and \
+               not full:
+                # The worker lost our document (it may have restarted), resend it whole
+                self.send(full=True)
+                return
+            self.fail(ex)
+            return
+        self.on_chunk(proxy, variant, full)
+
+    def on_more_reply(self, proxy, result, full):
+        try:
+            variant = proxy.call_finish(result)
+        except Exception as ex:
+            self.fail(ex)
+            return
+        self.on_chunk(proxy, variant, full)
+
+    def on_chunk(self, proxy, variant, full):
+        more, chunk = self.unwrap(variant)
+        proposals = [JediCompletionProposal(self.provider, self.context, chunk, i)
+                     for i in range(chunk.n_children())]
+        for proposal in proposals:
+            self.results.take_proposal(proposal)
+
+        if not more:
+            self.finish(proposals)
+            return
+
+        # Show chunks while the remainder is computed, unless a newer
+        # request had already superseded this one by the first chunk.
+        if not self.streamed and self.sequence == self.provider.sequence:
+            self.streamed = True
+        if self.streamed:
+            query = self.provider.current_word_lower
+            matched = [p for p in proposals if p.match(query, query)]
+            self.context.add_proposals(self.provider, matched, False)
+
+        proxy.call('CodeCompleteMore',
+                   GLib.Variant('(sx)', (self.filename, self.sequence)),
+                   0, 10000, self.cancellable, self.on_more_reply, full)
+
+    def unwrap(self, variant):
+        # unwrap outer tuple
+        inner = variant.get_child_value(0)
+        return (inner.get_child_value(0).get_boolean(), inner.get_child_value(1))
+
+    def finish(self, proposals):
+        if not self.streamed:
+            self.provider.complete(self.context, self.results)
+            return
+        # Earlier chunks are already shown, so only add what arrived last.
+        # Later refinement replays from the complete results.
+        query = self.provider.current_word_lower
+        matched = [p for p in proposals if p.match(query, query)]
+        self.provider.results = self.results
+        self.context.add_proposals(self.provider, matched, True)
+        self.provider.context = None
+
+    def fail(self, ex):
+        if isinstance(ex, GLib.Error) and \
+           ex.matches(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED):
+            # Superseded by the service, the context still waits for us
+            if not self.cancellable.is_cancelled():
+                self.context.add_proposals(self.provider, [], True)
+            return
+        print(repr(ex))
+        # If the worker went away, ask for a new one (it is respawned) on the next match
+        proxy = self.provider.proxy
+        if proxy is not None and proxy.get_connection().is_closed():
+            self.provider.proxy = None
+            self.provider.documents.clear()
+        self.context.add_proposals(self.provider, [], True)
+
+
 class JediCompletionProposal(Ide.CompletionItem, GtkSource.CompletionProposal):
     def __init__(self, provider, context, variant, index, *args, **kwargs):
         super().__init__(*args, **kwargs)
@@ -504,36 +701,62 @@ class JediCompletionProposal(Ide.CompletionItem, GtkSource.CompletionProposal):
         return self.completion_doc
 
 
+# Results are streamed, the first chunk is kept small so it arrives quickly
+_FIRST_CHUNK_SIZE = 25
+_CHUNK_SIZE = 250
+
+_ERROR_UNKNOWN_REVISION = 'org.gnome.builder.plugins.jedi.Error.UnknownRevision'
+
+
+def _return_cancelled(invocation):
+    invocation.return_error_literal(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED, "Operation was cancelled")
+
+
 class JediCompletionRequest:
     did_run = False
     cancelled = False
+    proposals = None
 
-    def __init__(self, invocation, filename, line, column, content):
+    def __init__(self, invocation, docs, filename, sequence, line, column, content):
         assert(type(line) == int)
         assert(type(column) == int)
 
         self.invocation = invocation
+        self.docs = docs
         self.filename = filename
+        self.sequence = sequence
         self.line = line
         self.column = column
         self.content = content
 
     def run(self):
+        "Reply with the first chunk of results, returns True if more remain"
+        more = False
         try:
             if not self.cancelled:
-                self._run()
+                self.did_run = True
+                self.proposals = self._iter_results()
+                more = self.reply(self.invocation, _FIRST_CHUNK_SIZE)
         except Exception as ex:
             self.invocation.return_error_literal(Gio.dbus_error_quark(), Gio.DBusError.IO_ERROR, repr(ex))
-
-    def _run(self):
-        self.did_run = True
-
-        results = []
-
+        self.invocation = None
+        return more
+
+    def reply(self, invocation, max_results):
+        "Reply to @invocation with up to @max_results results, returns True if more remain"
+        results = list(itertools.islice(self.proposals, max_results))
+        # Peek so that the final chunk is not followed by an empty one
+        lookahead = list(itertools.islice(self.proposals, 1))
+        more = len(lookahead) > 0
+        if more:
+            self.proposals = itertools.chain(lookahead, self.proposals)
+        invocation.return_value(GLib.Variant('((ba(issass)))', ((more, results),)))
+        return more
+
+    def _iter_results(self):
         # Jedi uses 1-based line indexes, we use 0 throughout Builder.
         script = jedi.Script(self.content, self.line + 1, self.column, self.filename)
 
-        db = DocumentationDB()
         for info in script.completions():
             if self.cancelled:
                 return
@@ -584,44 +807,124 @@ class JediCompletionRequest:
                         else:
                             parent = new_parent
                     version = parent.obj._version
-                    result = db.query(symbol, version)
+                    result = self.docs.query(symbol, version)
                     if result is not None:
                         doc = result
 
-            results.append((_TYPES.get(info.real_type, 0), info.name, info.complete, params, doc))
-
-        db.close()
-
-        self.invocation.return_value(GLib.Variant('(a(issass))', (results,)))
+            yield (_TYPES.get(info.real_type, 0), info.name, info.complete, params, doc)
 
     def cancel(self):
         if not self.cancelled and not self.did_run:
             self.cancelled = True
-            self.invocation.return_error_literal(Gio.io_error_quark(), Gio.IOErrorEnum.CANCELLED, "Operation was cancelled")
+            _return_cancelled(self.invocation)
+        self.proposals = None
+
+
+class JediDocument:
+    "The worker's copy of a buffer, so that clients may send only what changed"
+    def __init__(self, revision, text):
+        self.revision = revision
+        self.text = text
+
 
 class JediService(Ide.DBusService):
     queue = None
+    active = None
+    documents = None
+    sequences = None
     handler_id = None
+    docs = None
 
     def __init__(self):
         super().__init__()
         self.queue = {}
+        self.active = {}
+        self.documents = {}
+        self.sequences = {}
         self.handler_id = 0
+        self.docs = DocumentationDB()
+        self.update_docs()
+
+    def update_docs(self):
+        "Bring the documentation DB up to date without blocking completion requests"
+        def invalidate():
+            # Lookups made while indexing may have missed, so forget them
+            self.docs.invalidate()
+            return False
 
-    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='siis', out_signature='a(issass)', async=True)
-    def CodeComplete(self, invocation, filename, line, column, content):
+        def update_thread():
+            db = DocumentationDB()
+            try:
+                db.update(close_when_done=True)
+            finally:
+                GLib.idle_add(invalidate)
+        threading.Thread(target=update_thread, daemon=True).start()
+
+    def supersede(self, filename, sequence):
+        "Drop work for @filename older than @sequence, returns False if @sequence is itself stale"
+        if sequence < self.sequences.get(filename, -1):
+            return False
+        self.sequences[filename] = sequence
         if filename in self.queue:
-            request = self.queue.pop(filename)
-            request.cancel()
-        self.queue[filename] = JediCompletionRequest(invocation, filename, line, column, content)
+            self.queue.pop(filename).cancel()
+        if filename in self.active:
+            self.active.pop(filename).cancel()
+        return True
+
+    def apply_delta(self, filename, base_revision, revision, begin, end, text):
+        "Bring our copy of @filename to @revision, returns None if we lack @base_revision"
+        document = self.documents.get(filename)
+        if base_revision < 0:
+            document = JediDocument(revision, text)
+        elif document is None or document.revision != base_revision:
+            return None
+        elif base_revision != revision:
+            document.text = document.text[:begin] + text + document.text[end:]
+            document.revision = revision
+        self.documents[filename] = document
+        return document
+
+    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='sxxxiiiiv', out_signature='(ba(issass))', async=True)
+    def CodeComplete(self, invocation, filename, sequence, base_revision, revision, line, column, begin, end, payload):
+        if not self.supersede(filename, sequence):
+            _return_cancelled(invocation)
+            return
+        try:
+            fd_list = invocation.get_message().get_unix_fd_list()
+            data = Ide.worker_payload_get_bytes(invocation.get_parameters().get_child_value(8), fd_list)
+            text = data.get_data().decode('utf-8')
+        except Exception as ex:
+            invocation.return_error_literal(Gio.dbus_error_quark(), Gio.DBusError.INVALID_ARGS, repr(ex))
+            return
+        document = self.apply_delta(filename, base_revision, revision, begin, end, text)
+        if document is None:
+            invocation.return_dbus_error(_ERROR_UNKNOWN_REVISION,
+                                         'No content for %s at revision %d' % (filename, base_revision))
+            return
+        self.queue[filename] = JediCompletionRequest(invocation, self.docs, filename, sequence,
+                                                     line, column, document.text)
         if not self.handler_id:
             self.handler_id = GLib.timeout_add(5, self.process)
 
+    @Ide.DBusMethod('org.gnome.builder.plugins.jedi', in_signature='sx', out_signature='(ba(issass))', async=True)
+    def CodeCompleteMore(self, invocation, filename, sequence):
+        request = self.active.get(filename)
+        if request is None or request.sequence != sequence:
+            _return_cancelled(invocation)
+            return
+        try:
+            if not request.reply(invocation, _CHUNK_SIZE):
+                del self.active[filename]
+        except Exception as ex:
+            del self.active[filename]
+            invocation.return_error_literal(Gio.dbus_error_quark(), Gio.DBusError.IO_ERROR, repr(ex))
+
     def process(self):
         self.handler_id = 0
         while self.queue:
             filename, request = self.queue.popitem()
-            request.run()
+            if request.run():
+                self.active[filename] = request
         return False
 
 class JediWorker(GObject.Object, Ide.Worker):
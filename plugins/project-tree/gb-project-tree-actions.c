@@ -559,24 +559,6 @@ gb_project_tree_actions_new_file (GSimpleAction *action,
   gb_project_tree_actions_new (self, G_FILE_TYPE_REGULAR);
 }
 
-static gboolean
-find_child_node (IdeTree     *tree,
-                 IdeTreeNode *parent,
-                 IdeTreeNode *child,
-                 gpointer    user_data)
-{
-  GObject *item = ide_tree_node_get_item (child);
-  GFile *target = user_data;
-  GFile *child_file;
-
-  if (GB_IS_PROJECT_FILE (item) &&
-      (child_file = gb_project_file_get_file (GB_PROJECT_FILE (item))) &&
-      g_file_equal (child_file, target))
-    return TRUE;
-
-  return FALSE;
-}
-
 static void
 gb_project_tree_actions__project_rename_file_cb (GObject      *object,
                                                  GAsyncResult *result,
@@ -614,13 +596,10 @@ gb_project_tree_actions__project_rename_file_cb (GObject      *object,
 
   ide_tree_node_invalidate (parent);
   ide_tree_node_expand (parent, FALSE);
+  ide_tree_node_select (parent);
 
-  node = ide_tree_find_child_node (tree, parent, find_child_node, file);
-
-  if (node != NULL)
-    ide_tree_node_select (node);
-  else
-    ide_tree_node_select (parent);
+  /* The directory is reloaded asynchronously, reveal selects it when ready. */
+  gb_project_tree_reveal (GB_PROJECT_TREE (tree), file);
 
 cleanup:
   gtk_widget_hide (GTK_WIDGET (popover));
@@ -18,10 +18,12 @@
 
 #include <glib/gi18n.h>
 #include <ide.h>
+#include <string.h>
 
 #include "gb-project-file.h"
 #include "gb-project-tree.h"
 #include "gb-project-tree-builder.h"
+#include "gb-project-tree-private.h"
 
 struct _GbProjectTreeBuilder
 {
@@ -96,98 +98,345 @@ get_vcs (IdeTreeNode *node)
   return ide_context_get_vcs (context);
 }
 
-static gint
-compare_nodes_func (IdeTreeNode *a,
-                    IdeTreeNode *b,
-                    gpointer     user_data)
+/*
+ * Directories with more children than this only get nodes for the first
+ * batch, followed by a row that loads the next batch when activated. This
+ * keeps directories such as node_modules from creating tens of thousands of
+ * nodes that will never be looked at.
+ */
+#define POPULATE_BATCH_SIZE 1000
+#define POPULATE_STATE_KEY  "GB_PROJECT_TREE_POPULATE_STATE"
+
+typedef struct
 {
-  GbProjectFile *file_a = GB_PROJECT_FILE (ide_tree_node_get_item (a));
-  GbProjectFile *file_b = GB_PROJECT_FILE (ide_tree_node_get_item (b));
-  GbProjectTreeBuilder *self = user_data;
+  GbProjectTreeBuilder *self;
+  GCancellable         *cancellable;
 
-  if (self->sort_directories_first)
-    return gb_project_file_compare_directories_first (file_a, file_b);
-  else
-    return gb_project_file_compare (file_a, file_b);
+  /* The "Loading…" or "more items" row, owned by the tree. */
+  IdeTreeNode          *placeholder;
+
+  /* Sorted GbProjectFile that do not have a node yet. */
+  GPtrArray            *files;
+  guint                 position;
+
+  guint                 parent_ignored : 1;
+} PopulateState;
+
+typedef struct
+{
+  GFile    *directory;
+  gboolean  directories_first;
+} BuildRequest;
+
+typedef struct
+{
+  GbProjectFile *file;
+  gchar         *key;
+  gboolean       is_directory;
+} SortEntry;
+
+static void
+build_request_free (gpointer data)
+{
+  BuildRequest *request = data;
+
+  g_clear_object (&request->directory);
+  g_slice_free (BuildRequest, request);
 }
 
 static void
-build_file (GbProjectTreeBuilder *self,
-            IdeTreeNode          *node)
+populate_state_free (gpointer data)
 {
-  g_autoptr(GFileEnumerator) enumerator = NULL;
-  GbProjectFile *project_file;
-  gpointer file_info_ptr;
-  IdeVcs *vcs;
-  GFile *file;
-  IdeTree *tree;
-  gboolean show_ignored_files;
+  PopulateState *state = data;
 
-  g_return_if_fail (GB_IS_PROJECT_TREE_BUILDER (self));
-  g_return_if_fail (IDE_IS_TREE_NODE (node));
+  g_cancellable_cancel (state->cancellable);
+  g_clear_object (&state->cancellable);
+  g_clear_pointer (&state->files, g_ptr_array_unref);
+  g_slice_free (PopulateState, state);
+}
 
-  project_file = GB_PROJECT_FILE (ide_tree_node_get_item (node));
+static gint
+sort_entry_compare (gconstpointer a,
+                    gconstpointer b)
+{
+  const SortEntry *entry_a = a;
+  const SortEntry *entry_b = b;
 
-  tree = ide_tree_builder_get_tree (IDE_TREE_BUILDER (self));
-  show_ignored_files = gb_project_tree_get_show_ignored_files (GB_PROJECT_TREE (tree));
+  return strcmp (entry_a->key, entry_b->key);
+}
 
-  vcs = get_vcs (node);
+static gint
+sort_entry_compare_directories_first (gconstpointer a,
+                                      gconstpointer b)
+{
+  const SortEntry *entry_a = a;
+  const SortEntry *entry_b = b;
+  gint ret;
 
-  /*
-   * TODO: Make this all async.
-   */
+  ret = entry_b->is_directory - entry_a->is_directory;
+  if (ret == 0)
+    ret = strcmp (entry_a->key, entry_b->key);
 
-  if (!gb_project_file_get_is_directory (project_file))
-    return;
+  return ret;
+}
 
-  file = gb_project_file_get_file (project_file);
+static void
+build_file_worker (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+  g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GArray) entries = NULL;
+  BuildRequest *request = task_data;
+  GError *error = NULL;
+  GPtrArray *ret;
+  GFile *directory;
+  gpointer file_info_ptr;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (GB_IS_PROJECT_TREE_BUILDER (source_object));
+  g_assert (request != NULL);
+  g_assert (G_IS_FILE (request->directory));
+
+  directory = request->directory;
 
-  enumerator = g_file_enumerate_children (file,
+  enumerator = g_file_enumerate_children (directory,
                                           G_FILE_ATTRIBUTE_STANDARD_NAME","
                                           G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME","
                                           G_FILE_ATTRIBUTE_STANDARD_TYPE,
                                           G_FILE_QUERY_INFO_NONE,
-                                          NULL,
-                                          NULL);
+                                          cancellable,
+                                          &error);
 
   if (enumerator == NULL)
-    return;
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  entries = g_array_new (FALSE, FALSE, sizeof (SortEntry));
 
-  while ((file_info_ptr = g_file_enumerator_next_file (enumerator, NULL, NULL)))
+  while ((file_info_ptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
     {
       g_autoptr(GFileInfo) item_file_info = file_info_ptr;
       g_autoptr(GFile) item_file = NULL;
-      g_autoptr(GbProjectFile) item = NULL;
+      SortEntry entry;
+
+      item_file = g_file_get_child (directory, g_file_info_get_name (item_file_info));
+
+      entry.file = gb_project_file_new (item_file, item_file_info);
+      entry.key = g_utf8_collate_key_for_filename (g_file_info_get_display_name (item_file_info), -1);
+      entry.is_directory = (g_file_info_get_file_type (item_file_info) == G_FILE_TYPE_DIRECTORY);
+
+      g_array_append_val (entries, entry);
+    }
+
+  /*
+   * Sort the whole directory once here, using precomputed collation keys,
+   * so the main thread only has to append the nodes in order.
+   */
+  if (request->directories_first)
+    g_array_sort (entries, sort_entry_compare_directories_first);
+  else
+    g_array_sort (entries, sort_entry_compare);
+
+  ret = g_ptr_array_new_full (entries->len, g_object_unref);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      SortEntry *entry = &g_array_index (entries, SortEntry, i);
+
+      g_ptr_array_add (ret, entry->file);
+      g_free (entry->key);
+    }
+
+  g_task_return_pointer (task, ret, (GDestroyNotify)g_ptr_array_unref);
+}
+
+static void
+build_file_populate (PopulateState *state,
+                     IdeTreeNode   *node)
+{
+  g_autoptr(GPtrArray) children = NULL;
+  GbProjectTreeBuilder *self = state->self;
+  IdeTree *tree;
+  IdeVcs *vcs;
+  gboolean show_ignored_files;
+
+  g_assert (state != NULL);
+  g_assert (state->files != NULL);
+  g_assert (IDE_IS_TREE_NODE (node));
+
+  tree = ide_tree_builder_get_tree (IDE_TREE_BUILDER (self));
+  show_ignored_files = gb_project_tree_get_show_ignored_files (GB_PROJECT_TREE (tree));
+  vcs = get_vcs (node);
+
+  if (state->placeholder != NULL)
+    {
+      ide_tree_node_remove (node, state->placeholder);
+      state->placeholder = NULL;
+    }
+
+  children = g_ptr_array_new ();
+
+  while (state->position < state->files->len &&
+         children->len < POPULATE_BATCH_SIZE)
+    {
+      GbProjectFile *item = g_ptr_array_index (state->files, state->position++);
       IdeTreeNode *child;
-      const gchar *name;
-      const gchar *display_name;
-      const gchar *icon_name;
       gboolean ignored;
 
-      name = g_file_info_get_name (item_file_info);
-      item_file = g_file_get_child (file, name);
-
-      ignored = ide_vcs_is_ignored (vcs, item_file, NULL);
+      /* Everything within an ignored directory is ignored too. */
+      ignored = state->parent_ignored ||
+                ide_vcs_is_ignored (vcs, gb_project_file_get_file (item), NULL);
       if (ignored && !show_ignored_files)
         continue;
 
-      item = gb_project_file_new (item_file, item_file_info);
-
-      display_name = gb_project_file_get_display_name (item);
-      icon_name = gb_project_file_get_icon_name (item);
-
       child = g_object_new (IDE_TYPE_TREE_NODE,
-                            "icon-name", icon_name,
-                            "text", display_name,
+                            "icon-name", gb_project_file_get_icon_name (item),
+                            "text", gb_project_file_get_display_name (item),
                             "item", item,
                             "use-dim-label", ignored,
                             NULL);
 
-      ide_tree_node_insert_sorted (node, child, compare_nodes_func, self);
-
-      if (g_file_info_get_file_type (item_file_info) == G_FILE_TYPE_DIRECTORY)
+      if (gb_project_file_get_is_directory (item))
         ide_tree_node_set_children_possible (child, TRUE);
+
+      g_ptr_array_add (children, child);
+    }
+
+  if (state->position < state->files->len)
+    {
+      g_autofree gchar *text = NULL;
+      guint remaining = state->files->len - state->position;
+
+      text = g_strdup_printf (ngettext ("%u more item…", "%u more items…", remaining), remaining);
+      state->placeholder = g_object_new (IDE_TYPE_TREE_NODE,
+                                         "icon-name", "view-more-symbolic",
+                                         "text", text,
+                                         "use-dim-label", TRUE,
+                                         NULL);
+      g_ptr_array_add (children, state->placeholder);
+    }
+  else
+    {
+      g_clear_pointer (&state->files, g_ptr_array_unref);
     }
+
+  ide_tree_node_append_all (node, children);
+
+  _gb_project_tree_node_populated (GB_PROJECT_TREE (tree), node);
+}
+
+static void
+build_file_cb (GObject      *object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  GbProjectTreeBuilder *self = (GbProjectTreeBuilder *)object;
+  g_autoptr(IdeTreeNode) node = user_data;
+  g_autoptr(GPtrArray) files = NULL;
+  g_autoptr(GError) error = NULL;
+  PopulateState *state;
+
+  g_assert (GB_IS_PROJECT_TREE_BUILDER (self));
+  g_assert (G_IS_TASK (result));
+  g_assert (IDE_IS_TREE_NODE (node));
+
+  files = g_task_propagate_pointer (G_TASK (result), &error);
+
+  /* The node was rebuilt or removed while we were enumerating. */
+  state = g_object_get_data (G_OBJECT (node), POPULATE_STATE_KEY);
+  if (state == NULL ||
+      g_cancellable_is_cancelled (g_task_get_cancellable (G_TASK (result))) ||
+      state->cancellable != g_task_get_cancellable (G_TASK (result)))
+    return;
+
+  if (files == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      files = g_ptr_array_new ();
+    }
+
+  state->files = g_steal_pointer (&files);
+
+  build_file_populate (state, node);
+}
+
+static void
+build_file (GbProjectTreeBuilder *self,
+            IdeTreeNode          *node)
+{
+  g_autoptr(GTask) task = NULL;
+  GbProjectFile *project_file;
+  PopulateState *state;
+  BuildRequest *request;
+
+  g_return_if_fail (GB_IS_PROJECT_TREE_BUILDER (self));
+  g_return_if_fail (IDE_IS_TREE_NODE (node));
+
+  project_file = GB_PROJECT_FILE (ide_tree_node_get_item (node));
+
+  if (!gb_project_file_get_is_directory (project_file))
+    return;
+
+  state = g_slice_new0 (PopulateState);
+  state->self = self;
+  state->cancellable = g_cancellable_new ();
+  state->parent_ignored = ide_tree_node_get_use_dim_label (node);
+
+  /* Replacing existing state cancels a previous population of the node. */
+  g_object_set_data_full (G_OBJECT (node), POPULATE_STATE_KEY, state, populate_state_free);
+
+  /*
+   * Keep a child around while we enumerate so that the row stays expanded,
+   * and so the user knows we are still working on it.
+   */
+  state->placeholder = g_object_new (IDE_TYPE_TREE_NODE,
+                                     "text", _("Loading…"),
+                                     "use-dim-label", TRUE,
+                                     NULL);
+  ide_tree_node_append (node, state->placeholder);
+
+  request = g_slice_new0 (BuildRequest);
+  request->directory = g_object_ref (gb_project_file_get_file (project_file));
+  request->directories_first = self->sort_directories_first;
+
+  task = g_task_new (self, state->cancellable, build_file_cb, g_object_ref (node));
+  g_task_set_task_data (task, request, build_request_free);
+  g_task_run_in_thread (task, build_file_worker);
+}
+
+gboolean
+_gb_project_tree_builder_is_loading (IdeTreeNode *node)
+{
+  PopulateState *state;
+
+  g_return_val_if_fail (IDE_IS_TREE_NODE (node), FALSE);
+
+  state = g_object_get_data (G_OBJECT (node), POPULATE_STATE_KEY);
+
+  return state != NULL && state->files == NULL && state->placeholder != NULL;
+}
+
+gboolean
+_gb_project_tree_builder_load_more (IdeTreeNode *node)
+{
+  PopulateState *state;
+
+  g_return_val_if_fail (IDE_IS_TREE_NODE (node), FALSE);
+
+  state = g_object_get_data (G_OBJECT (node), POPULATE_STATE_KEY);
+
+  if (state == NULL || state->files == NULL)
+    return FALSE;
+
+  build_file_populate (state, node);
+
+  return TRUE;
 }
 
 static void
@@ -303,6 +552,20 @@ gb_project_tree_builder_node_activated (IdeTreeBuilder *builder,
 
   item = ide_tree_node_get_item (node);
 
+  /* The row at the end of a large directory, load the next batch. */
+  if (item == NULL)
+    {
+      IdeTreeNode *parent = ide_tree_node_get_parent (node);
+      PopulateState *state;
+
+      if (parent != NULL &&
+          (state = g_object_get_data (G_OBJECT (parent), POPULATE_STATE_KEY)) &&
+          state->placeholder == node)
+        return _gb_project_tree_builder_load_more (parent);
+
+      goto failure;
+    }
+
   if (GB_IS_PROJECT_FILE (item))
     {
       GtkWidget *workbench;
@@ -21,6 +21,8 @@
 
 #include <ide.h>
 
+#include "gb-project-tree.h"
+
 G_BEGIN_DECLS
 
 struct _GbProjectTree
@@ -29,10 +31,18 @@ struct _GbProjectTree
 
   GSettings *settings;
 
+  /* File to reveal once its parent directory has been loaded. */
+  GFile     *reveal_pending;
+
   guint      expanded_in_new : 1;
   guint      show_ignored_files : 1;
 };
 
+void     _gb_project_tree_node_populated     (GbProjectTree *self,
+                                              IdeTreeNode   *node);
+gboolean _gb_project_tree_builder_is_loading (IdeTreeNode   *node);
+gboolean _gb_project_tree_builder_load_more  (IdeTreeNode   *node);
+
 G_END_DECLS
 
 #endif /* GB_PROJECT_TREE_PRIVATE_H */
@@ -90,6 +90,19 @@ gb_project_tree_set_context (GbProjectTree *self,
 }
 
 
+void
+_gb_project_tree_node_populated (GbProjectTree *self,
+                                 IdeTreeNode   *node)
+{
+  g_autoptr(GFile) file = NULL;
+
+  g_assert (GB_IS_PROJECT_TREE (self));
+  g_assert (IDE_IS_TREE_NODE (node));
+
+  if ((file = g_steal_pointer (&self->reveal_pending)))
+    gb_project_tree_reveal (self, file);
+}
+
 static void
 gb_project_tree_notify_selection (GbProjectTree *self)
 {
@@ -104,6 +117,7 @@ gb_project_tree_finalize (GObject *object)
   GbProjectTree *self = (GbProjectTree *)object;
 
   g_clear_object (&self->settings);
+  g_clear_object (&self->reveal_pending);
 
   G_OBJECT_CLASS (gb_project_tree_parent_class)->finalize (object);
 }
@@ -296,11 +310,25 @@ gb_project_tree_reveal (GbProjectTree *self,
 
   parts = g_strsplit (relpath, G_DIR_SEPARATOR_S, 0);
 
+  g_clear_object (&self->reveal_pending);
+
   for (i = 0; parts [i]; i++)
     {
-      node = ide_tree_find_child_node (IDE_TREE (self), node, find_child_node, parts [i]);
+      IdeTreeNode *parent = node;
+
+      node = ide_tree_find_child_node (IDE_TREE (self), parent, find_child_node, parts [i]);
+
+      /* The child may be in a batch of a large directory that isn't loaded. */
+      while (node == NULL && _gb_project_tree_builder_load_more (parent))
+        node = ide_tree_find_child_node (IDE_TREE (self), parent, find_child_node, parts [i]);
+
       if (node == NULL)
-        return;
+        {
+          /* Try again once the directory has been enumerated. */
+          if (_gb_project_tree_builder_is_loading (parent))
+            self->reveal_pending = g_object_ref (file);
+          return;
+        }
     }
 
   ide_tree_expand_to_node (IDE_TREE (self), node);
@@ -24,6 +24,7 @@
 
 #include "ide-debug.h"
 #include "ide-python-indenter.h"
+#include "ide-scan-cache.h"
 
 struct _IdePythonIndenter
 {
@@ -46,9 +47,19 @@ in_pydoc (const GtkTextIter *iter)
 {
   GtkTextIter copy = *iter;
   GtkSourceBuffer *buffer;
+  IdeScanCache *cache;
 
   buffer = GTK_SOURCE_BUFFER (gtk_text_iter_get_buffer (iter));
 
+  if ((cache = ide_scan_cache_get_for_buffer (GTK_TEXT_BUFFER (buffer))))
+    {
+      /* Either side of the character, so quotes count as part of the string */
+      if (ide_scan_cache_get_context (cache, &copy, NULL) != IDE_SCAN_CONTEXT_CODE)
+        return TRUE;
+      gtk_text_iter_forward_char (&copy);
+      return ide_scan_cache_get_context (cache, &copy, NULL) != IDE_SCAN_CONTEXT_CODE;
+    }
+
   if (gtk_source_buffer_iter_has_context_class (buffer, &copy, "comment") ||
       gtk_source_buffer_iter_has_context_class (buffer, &copy, "string"))
     return TRUE;
@@ -139,13 +150,58 @@ copy_indent (IdePythonIndenter *python,
   return g_string_free (str, FALSE);
 }
 
+static gboolean
+is_assignment_char (gunichar ch,
+                    gpointer user_data)
+{
+  return ch == '=';
+}
+
+static gboolean
+backtrack_to_open_pair_cached (IdeScanCache *cache,
+                               GtkTextIter  *iter)
+{
+  GtkTextIter pair = *iter;
+  GtkTextIter eq;
+
+  /* Include the character at @iter, like the slow path below */
+  gtk_text_iter_forward_char (&pair);
+  eq = pair;
+
+  if (!ide_scan_cache_backward_find_unmatched (cache, &pair, 0, 1))
+    return FALSE;
+
+  /*
+   * An assignment between the pair and @iter, at the same depth, means the
+   * statement is not a continuation of the pair.
+   */
+  while (gtk_text_iter_backward_find_char (&eq, is_assignment_char, NULL, &pair))
+    {
+      GtkTextIter enclosing = eq;
+
+      if (ide_scan_cache_get_context (cache, &eq, NULL) == IDE_SCAN_CONTEXT_CODE &&
+          ide_scan_cache_backward_find_unmatched (cache, &enclosing, 0, 1) &&
+          gtk_text_iter_equal (&enclosing, &pair))
+        return FALSE;
+    }
+
+  *iter = pair;
+
+  return TRUE;
+}
+
 static gboolean
 backtrack_to_open_pair (GtkTextIter *iter)
 {
   GtkTextIter copy;
   GtkSourceBuffer *buffer;
+  IdeScanCache *cache;
 
   buffer = GTK_SOURCE_BUFFER (gtk_text_iter_get_buffer (iter));
+
+  if ((cache = ide_scan_cache_get_for_buffer (GTK_TEXT_BUFFER (buffer))))
+    return backtrack_to_open_pair_cached (cache, iter);
+
   copy = *iter;
 
   do
@@ -29,6 +29,63 @@ struct _GbSysmonPanel
 
 G_DEFINE_TYPE (GbSysmonPanel, gb_sysmon_panel, GTK_TYPE_BOX)
 
+#define TIMESPAN    (30L * G_USEC_PER_SEC)
+#define MAX_SAMPLES 60
+
+static const gchar *colors[] = {
+  "#3465a4",
+  "#73d216",
+  "#f57900",
+};
+
+static void
+gb_sysmon_panel_add_graph (GbSysmonPanel *self,
+                           const gchar   *title,
+                           GType          table_type,
+                           guint          n_columns)
+{
+  g_autoptr(RgTable) table = NULL;
+  GtkWidget *graph;
+  GtkWidget *label;
+  guint i;
+
+  g_assert (GB_IS_SYSMON_PANEL (self));
+  g_assert (g_type_is_a (table_type, RG_TYPE_TABLE));
+  g_assert (n_columns <= G_N_ELEMENTS (colors));
+
+  table = g_object_new (table_type,
+                        "timespan", TIMESPAN,
+                        "max-samples", MAX_SAMPLES + 1,
+                        NULL);
+
+  label = g_object_new (GTK_TYPE_LABEL,
+                        "label", title,
+                        "xalign", 0.0f,
+                        "visible", TRUE,
+                        NULL);
+  gtk_style_context_add_class (gtk_widget_get_style_context (label), "dim-label");
+  gtk_container_add (GTK_CONTAINER (self), label);
+
+  graph = g_object_new (RG_TYPE_GRAPH,
+                        "expand", TRUE,
+                        "table", table,
+                        "visible", TRUE,
+                        NULL);
+
+  for (i = 0; i < n_columns; i++)
+    {
+      g_autoptr(RgRenderer) renderer = NULL;
+
+      renderer = g_object_new (RG_TYPE_LINE_RENDERER,
+                               "column", i,
+                               "stroke-color", colors [i],
+                               NULL);
+      rg_graph_add_renderer (RG_GRAPH (graph), renderer);
+    }
+
+  gtk_container_add (GTK_CONTAINER (self), graph);
+}
+
 static void
 gb_sysmon_panel_finalize (GObject *object)
 {
@@ -53,4 +110,11 @@ static void
 gb_sysmon_panel_init (GbSysmonPanel *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  /* Used, Cached, Swap */
+  gb_sysmon_panel_add_graph (self, _("Memory"), RG_TYPE_MEM_TABLE, 3);
+  /* Read, Write */
+  gb_sysmon_panel_add_graph (self, _("Disk"), RG_TYPE_IO_TABLE, 2);
+  /* CPU, Memory */
+  gb_sysmon_panel_add_graph (self, _("Build Processes"), RG_TYPE_PROCESS_TABLE, 2);
 }
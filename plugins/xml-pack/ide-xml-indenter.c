@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "ide-debug.h"
+#include "ide-scan-cache.h"
 #include "ide-xml-indenter.h"
 
 struct _IdeXmlIndenter
@@ -111,8 +112,12 @@ static gboolean
 text_iter_in_cdata (const GtkTextIter *location)
 {
   GtkTextIter iter = *location;
+  IdeScanCache *cache;
   gboolean ret = FALSE;
 
+  if ((cache = ide_scan_cache_get_for_buffer (gtk_text_iter_get_buffer (location))))
+    return ide_scan_cache_get_context (cache, location, NULL) == IDE_SCAN_CONTEXT_VERBATIM;
+
   if (gtk_text_iter_backward_search (&iter, "<![CDATA[",
                                      GTK_TEXT_SEARCH_TEXT_ONLY,
                                      NULL, &iter, NULL))
@@ -21,15 +21,23 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <ide.h>
+#include <string.h>
 
 #include "ide-application-tests.h"
+#include "ide-internal.h"
+
+#define TAG_ERROR   "diagnostician::error"
+#define TAG_WARNING "diagnostician::warning"
 
 static void
 flags_changed_cb (IdeBuffer *buffer,
                   gpointer   user_data)
 {
   g_autofree gchar *str = NULL;
+  g_autofree gchar *expected = NULL;
   g_autoptr(GTask) task = user_data;
+  g_autoptr(IdeBufferSnapshot) snapshot = NULL;
+  g_autoptr(GBytes) bytes = NULL;
   GtkTextIter begin;
   GtkTextIter end;
 
@@ -41,6 +49,17 @@ flags_changed_cb (IdeBuffer *buffer,
   str = gtk_text_buffer_get_text (GTK_TEXT_BUFFER (buffer), &begin, &end, TRUE);
   g_assert_cmpstr (str, ==, "abcd\n\n\n");
 
+  /* The snapshot is maintained incrementally and must match the buffer */
+  snapshot = ide_buffer_get_snapshot (buffer);
+  bytes = ide_buffer_snapshot_get_bytes (snapshot);
+  if (gtk_source_buffer_get_implicit_trailing_newline (GTK_SOURCE_BUFFER (buffer)))
+    expected = g_strconcat (str, "\n", NULL);
+  else
+    expected = g_strdup (str);
+  g_assert_cmpstr (g_bytes_get_data (bytes, NULL), ==, expected);
+  g_assert_cmpint (g_bytes_get_size (bytes), ==, strlen (expected));
+  g_assert_cmpint (ide_buffer_snapshot_get_length (snapshot), ==, strlen (expected));
+
   g_task_return_boolean (task, TRUE);
 
   g_object_unref (buffer);
@@ -128,6 +147,440 @@ test_buffer_basic (GCancellable        *cancellable,
   IDE_EXIT;
 }
 
+static const gchar *diagnostics_text =
+  "line0\n"
+  "line1\n"
+  "line2\n"
+  "line3\n"
+  "line4\n"
+  "line5\n"
+  "line6\n"
+  "line7\n"
+  "line8\n"
+  "line9\n";
+
+/*
+ * Creates a diagnostic located at the start of @line. If @end_line differs
+ * from @line, a range covering the lines in between is added too.
+ */
+static IdeDiagnostic *
+make_diagnostic (IdeFile               *file,
+                 IdeDiagnosticSeverity  severity,
+                 guint                  line,
+                 guint                  end_line)
+{
+  g_autoptr(IdeSourceLocation) location = NULL;
+  IdeDiagnostic *diagnostic;
+
+  location = ide_source_location_new (file, line, 0, 0);
+  diagnostic = ide_diagnostic_new (severity, "diagnostic", location);
+
+  if (end_line != line)
+    {
+      g_autoptr(IdeSourceLocation) end = NULL;
+      g_autoptr(IdeSourceRange) range = NULL;
+
+      end = ide_source_location_new (file, end_line, 2, 0);
+      range = ide_source_range_new (location, end);
+      ide_diagnostic_add_range (diagnostic, range);
+    }
+
+  return diagnostic;
+}
+
+/* Sets a new diagnostics set built from the NULL terminated list. */
+static void
+set_diagnostics (IdeBuffer     *buffer,
+                 IdeDiagnostic *first,
+                 ...)
+{
+  g_autoptr(IdeDiagnostics) diagnostics = NULL;
+  IdeDiagnostic *diagnostic;
+  GPtrArray *ar;
+  va_list args;
+
+  ar = g_ptr_array_new_with_free_func ((GDestroyNotify)ide_diagnostic_unref);
+
+  va_start (args, first);
+  for (diagnostic = first; diagnostic != NULL; diagnostic = va_arg (args, IdeDiagnostic *))
+    g_ptr_array_add (ar, diagnostic);
+  va_end (args);
+
+  diagnostics = ide_diagnostics_new (ar);
+  _ide_buffer_set_diagnostics (buffer, diagnostics);
+}
+
+static gboolean
+line_has_tag (IdeBuffer   *buffer,
+              guint        line,
+              const gchar *tag_name)
+{
+  GtkTextTagTable *table;
+  GtkTextTag *tag;
+  GtkTextIter iter;
+
+  table = gtk_text_buffer_get_tag_table (GTK_TEXT_BUFFER (buffer));
+  tag = gtk_text_tag_table_lookup (table, tag_name);
+  g_assert (tag != NULL);
+
+  gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (buffer), &iter, line);
+
+  return gtk_text_iter_has_tag (&iter, tag);
+}
+
+/*
+ * Checks the diagnostic flags of every line against @expected, which has
+ * one character per line: 'E' for an error, 'W' for a warning and '.' for
+ * none. The tags at the start of each line must agree.
+ */
+static void
+assert_diagnostics (IdeBuffer   *buffer,
+                    const gchar *expected)
+{
+  guint line;
+
+  for (line = 0; expected [line]; line++)
+    {
+      IdeBufferLineFlags flags;
+      IdeBufferLineFlags expected_flags = 0;
+
+      if (expected [line] == 'E')
+        expected_flags = IDE_BUFFER_LINE_FLAGS_ERROR;
+      else if (expected [line] == 'W')
+        expected_flags = IDE_BUFFER_LINE_FLAGS_WARNING;
+
+      flags = ide_buffer_get_line_flags (buffer, line) & IDE_BUFFER_LINE_FLAGS_DIAGNOSTICS_MASK;
+      g_assert_cmpint (flags, ==, expected_flags);
+
+      g_assert_cmpint (line_has_tag (buffer, line, TAG_ERROR), ==, expected [line] == 'E');
+      if (expected [line] != 'E')
+        g_assert_cmpint (line_has_tag (buffer, line, TAG_WARNING), ==, expected [line] == 'W');
+    }
+}
+
+static void
+reset_buffer (IdeBuffer *buffer)
+{
+  _ide_buffer_set_diagnostics (buffer, NULL);
+  gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), diagnostics_text, -1);
+  assert_diagnostics (buffer, "..........");
+}
+
+static void
+insert_line (IdeBuffer *buffer,
+             guint      line)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (buffer), &iter, line);
+  gtk_text_buffer_insert (GTK_TEXT_BUFFER (buffer), &iter, "new\n", -1);
+}
+
+static void
+check_diagnostics (IdeBuffer *buffer,
+                   IdeFile   *file)
+{
+  /* Unchanged */
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 2, 2),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   NULL);
+  assert_diagnostics (buffer, "..E..W....");
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 2, 2),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   NULL);
+  assert_diagnostics (buffer, "..E..W....");
+
+  /* One removed */
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 2, 2),
+                   NULL);
+  assert_diagnostics (buffer, "..E.......");
+
+  /* A remaining diagnostic overlapping the removed one is applied again */
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 6),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   NULL);
+  assert_diagnostics (buffer, "...EEEE...");
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 6),
+                   NULL);
+  assert_diagnostics (buffer, "...EEEE...");
+
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 6),
+                   NULL);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   NULL);
+  assert_diagnostics (buffer, ".....W....");
+
+  /* Lines inserted above a diagnostic move it along */
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 2, 2),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 5, 5),
+                   NULL);
+  insert_line (buffer, 0);
+  assert_diagnostics (buffer, "...E..W....");
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 3),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 6, 6),
+                   NULL);
+  assert_diagnostics (buffer, "...E..W....");
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 3),
+                   NULL);
+  assert_diagnostics (buffer, "...E.......");
+
+  /* Lines inserted inside a diagnostic grow its span */
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 5),
+                   NULL);
+  insert_line (buffer, 4);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_ERROR, 3, 6),
+                   NULL);
+  assert_diagnostics (buffer, "...EEEE....");
+  set_diagnostics (buffer, NULL);
+  assert_diagnostics (buffer, "...........");
+
+  /* Duplicates in the new set are applied once */
+  reset_buffer (buffer);
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 2, 2),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 2, 2),
+                   NULL);
+  assert_diagnostics (buffer, "..W.......");
+  set_diagnostics (buffer,
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 2, 2),
+                   make_diagnostic (file, IDE_DIAGNOSTIC_WARNING, 2, 2),
+                   NULL);
+  assert_diagnostics (buffer, "..W.......");
+  set_diagnostics (buffer, NULL);
+  assert_diagnostics (buffer, "..........");
+}
+
+/*
+ * Compares the snapshot with the contents of @buffer, both flattened and
+ * chunk by chunk.
+ */
+static void
+assert_snapshot (IdeBuffer *buffer,
+                 guint      min_chunks)
+{
+  g_autoptr(IdeBufferSnapshot) snapshot = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree gchar *text = NULL;
+  g_autoptr(GString) expected = NULL;
+  g_autoptr(GString) joined = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+  guint n_chunks;
+  guint i;
+
+  gtk_text_buffer_get_bounds (GTK_TEXT_BUFFER (buffer), &begin, &end);
+  text = gtk_text_buffer_get_text (GTK_TEXT_BUFFER (buffer), &begin, &end, TRUE);
+  expected = g_string_new (text);
+  if (gtk_source_buffer_get_implicit_trailing_newline (GTK_SOURCE_BUFFER (buffer)))
+    g_string_append_c (expected, '\n');
+
+  snapshot = ide_buffer_get_snapshot (buffer);
+  bytes = ide_buffer_snapshot_get_bytes (snapshot);
+  g_assert_cmpint (g_bytes_get_size (bytes), ==, expected->len);
+  g_assert_cmpint (ide_buffer_snapshot_get_length (snapshot), ==, expected->len);
+  g_assert (memcmp (g_bytes_get_data (bytes, NULL), expected->str, expected->len) == 0);
+
+  /* Chunks must never split a character */
+  n_chunks = ide_buffer_snapshot_get_n_chunks (snapshot);
+  g_assert_cmpint (n_chunks, >=, min_chunks);
+  joined = g_string_new (NULL);
+
+  for (i = 0; i < n_chunks; i++)
+    {
+      const gchar *chunk;
+      gsize len;
+
+      chunk = ide_buffer_snapshot_get_chunk (snapshot, i, &len);
+      g_assert (g_utf8_validate (chunk, len, NULL));
+      g_string_append_len (joined, chunk, len);
+    }
+
+  g_assert_cmpint (joined->len, ==, expected->len);
+  g_assert (memcmp (joined->str, expected->str, expected->len) == 0);
+}
+
+/* Multibyte text of at least @min_len bytes, with characters of 1 to 4 bytes */
+static gchar *
+make_text (gsize min_len)
+{
+  GString *str = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; str->len < min_len; i++)
+    {
+      g_string_append (str, "ab\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+      if (i % 7 == 6)
+        g_string_append_c (str, '\n');
+    }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+delete_range (IdeBuffer *buffer,
+              gint       begin_offset,
+              gint       end_offset)
+{
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_iter_at_offset (GTK_TEXT_BUFFER (buffer), &begin, begin_offset);
+  gtk_text_buffer_get_iter_at_offset (GTK_TEXT_BUFFER (buffer), &end, end_offset);
+  gtk_text_buffer_delete (GTK_TEXT_BUFFER (buffer), &begin, &end);
+}
+
+static void
+insert_at_offset (IdeBuffer   *buffer,
+                  gint         offset,
+                  const gchar *text)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_iter_at_offset (GTK_TEXT_BUFFER (buffer), &iter, offset);
+  gtk_text_buffer_insert (GTK_TEXT_BUFFER (buffer), &iter, text, -1);
+}
+
+static void
+check_snapshot (IdeBuffer *buffer,
+                IdeFile   *file)
+{
+  g_autofree gchar *large = make_text (30000);
+  g_autofree gchar *larger = make_text (20000);
+  gint n_chars;
+  gint i;
+
+  /* Loading text several times CHUNK_SIZE_MAX (8 KiB) splits it up */
+  gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), large, -1);
+  assert_snapshot (buffer, 4);
+
+  /* A large insert in the middle of a chunk, and at the very start */
+  insert_at_offset (buffer, 5001, larger);
+  assert_snapshot (buffer, 6);
+  insert_at_offset (buffer, 0, larger);
+  assert_snapshot (buffer, 8);
+
+  /* Small edits on either side of every chunk boundary and in between */
+  n_chars = gtk_text_buffer_get_char_count (GTK_TEXT_BUFFER (buffer));
+  for (i = 0; i < n_chars; i += 1531)
+    {
+      insert_at_offset (buffer, i, "\xe2\x82\xac");
+      assert_snapshot (buffer, 1);
+    }
+
+  /* Deletes spanning several chunks, starting and ending mid-chunk */
+  delete_range (buffer, 1003, 25007);
+  assert_snapshot (buffer, 1);
+  delete_range (buffer, 0, 10001);
+  assert_snapshot (buffer, 1);
+
+  /* Deleting a single multibyte character at each end */
+  n_chars = gtk_text_buffer_get_char_count (GTK_TEXT_BUFFER (buffer));
+  delete_range (buffer, n_chars - 1, n_chars);
+  assert_snapshot (buffer, 1);
+  delete_range (buffer, 0, 1);
+  assert_snapshot (buffer, 1);
+
+  /* Deleting everything, then starting over */
+  n_chars = gtk_text_buffer_get_char_count (GTK_TEXT_BUFFER (buffer));
+  delete_range (buffer, 0, n_chars);
+  assert_snapshot (buffer, 0);
+  insert_at_offset (buffer, 0, larger);
+  assert_snapshot (buffer, 2);
+}
+
+typedef void (*BufferTestFunc) (IdeBuffer *buffer,
+                                IdeFile   *file);
+
+static void
+new_buffer_cb (GObject      *object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(IdeContext) context = NULL;
+  g_autoptr(IdeBuffer) buffer = NULL;
+  g_autoptr(IdeFile) file = NULL;
+  BufferTestFunc func;
+  IdeProject *project;
+  GError *error = NULL;
+
+  IDE_ENTRY;
+
+  context = ide_context_new_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_CONTEXT (context));
+
+  project = ide_context_get_project (context);
+  file = ide_project_get_file_for_path (project, "test-ide-buffer-new.tmp");
+  buffer = g_object_new (IDE_TYPE_BUFFER,
+                         "context", context,
+                         "file", file,
+                         NULL);
+
+  func = (BufferTestFunc)g_task_get_task_data (task);
+  func (buffer, file);
+
+  g_task_return_boolean (task, TRUE);
+
+  IDE_EXIT;
+}
+
+/* Runs @func on a new buffer that is not backed by a file on disk */
+static void
+run_buffer_test (GCancellable        *cancellable,
+                 GAsyncReadyCallback  callback,
+                 gpointer             user_data,
+                 BufferTestFunc       func)
+{
+  g_autoptr(GFile) project_file = NULL;
+  g_autofree gchar *path = NULL;
+  GTask *task;
+
+  IDE_ENTRY;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_task_data (task, (gpointer)func, NULL);
+  path = g_build_filename (g_get_current_dir (), TEST_DATA_DIR, "project1", "configure.ac", NULL);
+  project_file = g_file_new_for_path (path);
+  ide_context_new_async (project_file, cancellable, new_buffer_cb, task);
+
+  IDE_EXIT;
+}
+
+static void
+test_buffer_diagnostics (GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+  run_buffer_test (cancellable, callback, user_data, check_diagnostics);
+}
+
+static void
+test_buffer_snapshot (GCancellable        *cancellable,
+                      GAsyncReadyCallback  callback,
+                      gpointer             user_data)
+{
+  run_buffer_test (cancellable, callback, user_data, check_snapshot);
+}
+
 gint
 main (gint   argc,
       gchar *argv[])
@@ -142,6 +595,8 @@ main (gint   argc,
 
   app = ide_application_new ();
   ide_application_add_test (app, "/Ide/Buffer/basic", test_buffer_basic, NULL);
+  ide_application_add_test (app, "/Ide/Buffer/diagnostics", test_buffer_diagnostics, NULL);
+  ide_application_add_test (app, "/Ide/Buffer/snapshot", test_buffer_snapshot, NULL);
   ret = g_application_run (G_APPLICATION (app), argc, argv);
   g_object_unref (app);
 
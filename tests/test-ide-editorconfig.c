@@ -0,0 +1,113 @@
+/* test-ide-editorconfig.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+
+#include "ide-internal.h"
+
+static const struct {
+  const gchar *section;
+  const gchar *path;
+  gboolean     matches;
+} globs [] = {
+  /* Without a slash, sections match at any depth */
+  { "*.c", "/project/a.c", TRUE },
+  { "*.c", "/project/src/a.c", TRUE },
+  { "*.c", "/project/a.h", FALSE },
+  { "*.c", "/other/a.c", FALSE },
+
+  /* With a slash, sections are anchored and * stops at a slash */
+  { "src/*.c", "/project/src/a.c", TRUE },
+  { "src/*.c", "/project/src/sub/a.c", FALSE },
+  { "src/*.c", "/project/lib/src/a.c", FALSE },
+  { "/src/*.c", "/project/src/a.c", TRUE },
+
+  /* ** crosses slashes */
+  { "src/**.c", "/project/src/sub/a.c", TRUE },
+  { "src/**/a.c", "/project/src/a.c", TRUE },
+  { "src/**/a.c", "/project/src/x/y/a.c", TRUE },
+  { "src/**/a.c", "/project/srca.c", FALSE },
+
+  /* ? is a single character */
+  { "a?c", "/project/abc", TRUE },
+  { "a?c", "/project/abbc", FALSE },
+
+  /* Alternatives */
+  { "*.{c,h}", "/project/a.c", TRUE },
+  { "*.{c,h}", "/project/a.h", TRUE },
+  { "*.{c,h}", "/project/a.x", FALSE },
+  { "{Makefile,*.mk}", "/project/Makefile", TRUE },
+  { "{Makefile,*.mk}", "/project/rules.mk", TRUE },
+
+  /* Numeric ranges */
+  { "file{1..3}.txt", "/project/file1.txt", TRUE },
+  { "file{1..3}.txt", "/project/file3.txt", TRUE },
+  { "file{1..3}.txt", "/project/file0.txt", FALSE },
+  { "file{1..3}.txt", "/project/file4.txt", FALSE },
+  { "file{1..3}.txt", "/project/file01.txt", FALSE },
+  { "file{-2..2}.txt", "/project/file-1.txt", TRUE },
+
+  /* A single word in braces is literal */
+  { "{foo}.c", "/project/{foo}.c", TRUE },
+  { "{foo}.c", "/project/foo.c", FALSE },
+
+  /* Bracket expressions */
+  { "[ab].c", "/project/a.c", TRUE },
+  { "[ab].c", "/project/c.c", FALSE },
+  { "[!x]y.c", "/project/ay.c", TRUE },
+  { "[!x]y.c", "/project/xy.c", FALSE },
+  { "[a-c].c", "/project/b.c", TRUE },
+  { "[a-c].c", "/project/d.c", FALSE },
+
+  /* Escaping and regex metacharacters */
+  { "\\*.c", "/project/*.c", TRUE },
+  { "\\*.c", "/project/a.c", FALSE },
+  { "a\\{b\\}.c", "/project/a{b}.c", TRUE },
+  { "a.b", "/project/a.b", TRUE },
+  { "a.b", "/project/axb", FALSE },
+  { "a+b", "/project/a+b", TRUE },
+  { "a+b", "/project/aab", FALSE },
+  { "a-b", "/project/a-b", TRUE },
+};
+
+static void
+test_glob (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (globs); i++)
+    {
+      gboolean matches;
+
+      matches = _ide_editorconfig_section_matches ("/project", globs [i].section, globs [i].path);
+
+      if (matches != globs [i].matches)
+        g_error ("[%s] %s %s", globs [i].section,
+                 globs [i].matches ? "should match" : "should not match",
+                 globs [i].path);
+    }
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/Editorconfig/glob", test_glob);
+  return g_test_run ();
+}
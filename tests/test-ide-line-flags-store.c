@@ -0,0 +1,167 @@
+/* test-ide-line-flags-store.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "ide-line-flags-store.h"
+
+#define FLAG_A (1 << 0)
+#define FLAG_B (1 << 1)
+
+static void
+assert_lines (IdeLineFlagsStore *store,
+              const guint       *expected,
+              guint              n_lines)
+{
+  g_autofree guint *range = g_new0 (guint, n_lines);
+  guint i;
+
+  ide_line_flags_store_get_range (store, 0, n_lines, range);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      g_assert_cmpuint (ide_line_flags_store_get (store, i), ==, expected [i]);
+      g_assert_cmpuint (range [i], ==, expected [i]);
+    }
+}
+
+static void
+test_add_and_clear (void)
+{
+  g_autoptr(IdeLineFlagsStore) store = ide_line_flags_store_new ();
+
+  ide_line_flags_store_add (store, 2, 4, FLAG_A);
+  ide_line_flags_store_add (store, 4, 6, FLAG_B);
+  ide_line_flags_store_add (store, 0, 0, FLAG_B);
+
+  {
+    const guint expected[] = { FLAG_B, 0, FLAG_A, FLAG_A, FLAG_A|FLAG_B, FLAG_B, FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  ide_line_flags_store_remove (store, 3, 5, FLAG_A);
+
+  {
+    const guint expected[] = { FLAG_B, 0, FLAG_A, 0, FLAG_B, FLAG_B, FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  ide_line_flags_store_clear (store, FLAG_B);
+
+  {
+    const guint expected[] = { 0, 0, FLAG_A, 0, 0, 0, 0, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+}
+
+static void
+test_add_merges (void)
+{
+  g_autoptr(IdeLineFlagsStore) store = ide_line_flags_store_new ();
+
+  ide_line_flags_store_add (store, 0, 1, FLAG_A);
+  ide_line_flags_store_add (store, 4, 5, FLAG_A);
+  ide_line_flags_store_add (store, 8, 8, FLAG_B);
+
+  /* Filling the gap joins both neighbours into one run */
+  ide_line_flags_store_add (store, 2, 3, FLAG_A);
+
+  {
+    const guint expected[] = { FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, 0, 0, FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  /* Lines growing into the run that follows keep their own flags */
+  ide_line_flags_store_add (store, 6, 8, FLAG_A);
+
+  {
+    const guint expected[] = { FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A|FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  /* The merged run behaves as one run when lines are inserted inside it */
+  ide_line_flags_store_insert_lines (store, 3, 1);
+
+  {
+    const guint expected[] = { FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A, FLAG_A|FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+}
+
+static void
+test_insert_lines (void)
+{
+  g_autoptr(IdeLineFlagsStore) store = ide_line_flags_store_new ();
+
+  ide_line_flags_store_add (store, 1, 2, FLAG_A);
+  ide_line_flags_store_add (store, 5, 5, FLAG_B);
+
+  /* Before the first run, everything moves down */
+  ide_line_flags_store_insert_lines (store, 0, 1);
+
+  {
+    const guint expected[] = { 0, 0, FLAG_A, FLAG_A, 0, 0, FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  /* Inside a run, the run grows */
+  ide_line_flags_store_insert_lines (store, 3, 2);
+
+  {
+    const guint expected[] = { 0, 0, FLAG_A, FLAG_A, FLAG_A, FLAG_A, 0, 0, FLAG_B, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+}
+
+static void
+test_delete_lines (void)
+{
+  g_autoptr(IdeLineFlagsStore) store = ide_line_flags_store_new ();
+
+  ide_line_flags_store_add (store, 1, 3, FLAG_A);
+  ide_line_flags_store_add (store, 5, 5, FLAG_B);
+  ide_line_flags_store_add (store, 8, 9, FLAG_A);
+
+  /* Removes line 5 entirely and the tail of the first run */
+  ide_line_flags_store_delete_lines (store, 3, 3);
+
+  {
+    const guint expected[] = { 0, FLAG_A, FLAG_A, 0, 0, FLAG_A, FLAG_A, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+
+  /* Joining the two runs merges them */
+  ide_line_flags_store_delete_lines (store, 3, 2);
+
+  {
+    const guint expected[] = { 0, FLAG_A, FLAG_A, FLAG_A, FLAG_A, 0 };
+    assert_lines (store, expected, G_N_ELEMENTS (expected));
+  }
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/LineFlagsStore/add_and_clear", test_add_and_clear);
+  g_test_add_func ("/Ide/LineFlagsStore/add_merges", test_add_merges);
+  g_test_add_func ("/Ide/LineFlagsStore/insert_lines", test_insert_lines);
+  g_test_add_func ("/Ide/LineFlagsStore/delete_lines", test_delete_lines);
+  return g_test_run ();
+}
@@ -0,0 +1,141 @@
+/* test-ide-scan-cache.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+#include <gtksourceview/gtksource.h>
+
+static const gchar *sample =
+  "int\n"
+  "main (int argc, /* ( */\n"
+  "      char *argv[])\n"
+  "{\n"
+  "  if (argc > 1) {\n"
+  "    g_print (\"{ %s\\n\", argv[1]); // }\n"
+  "  }\n"
+  "}\n";
+
+static GtkTextBuffer *
+create_buffer (const gchar *text)
+{
+  GtkSourceLanguageManager *manager;
+  GtkSourceBuffer *buffer;
+
+  manager = gtk_source_language_manager_get_default ();
+  buffer = gtk_source_buffer_new (NULL);
+  gtk_source_buffer_set_language (buffer, gtk_source_language_manager_get_language (manager, "c"));
+  gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), text, -1);
+
+  return GTK_TEXT_BUFFER (buffer);
+}
+
+static void
+test_context (void)
+{
+  g_autoptr(GtkTextBuffer) buffer = create_buffer (sample);
+  IdeScanCache *cache;
+  GtkTextIter iter;
+  GtkTextIter begin;
+
+  cache = ide_scan_cache_get_for_buffer (buffer);
+  g_assert (cache != NULL);
+
+  /* Inside the C89 comment on line 1 */
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &iter, 1, 20);
+  g_assert_cmpint (ide_scan_cache_get_context (cache, &iter, &begin), ==, IDE_SCAN_CONTEXT_BLOCK_COMMENT);
+  g_assert_cmpint (gtk_text_iter_get_line (&begin), ==, 1);
+  g_assert_cmpint (gtk_text_iter_get_line_offset (&begin), ==, 16);
+
+  /* Inside the string on line 5 */
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &iter, 5, 15);
+  g_assert_cmpint (ide_scan_cache_get_context (cache, &iter, NULL), ==, IDE_SCAN_CONTEXT_STRING);
+
+  /* End of the C99 comment on line 5 */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  gtk_text_iter_forward_to_line_end (&iter);
+  g_assert_cmpint (ide_scan_cache_get_context (cache, &iter, NULL), ==, IDE_SCAN_CONTEXT_LINE_COMMENT);
+
+  /* Open a comment that spans the rest of the buffer */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 3);
+  gtk_text_buffer_insert (buffer, &iter, "/*\n", -1);
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  g_assert_cmpint (ide_scan_cache_get_context (cache, &iter, &begin), ==, IDE_SCAN_CONTEXT_BLOCK_COMMENT);
+  g_assert_cmpint (gtk_text_iter_get_line (&begin), ==, 3);
+  g_assert_cmpint (gtk_text_iter_get_line_offset (&begin), ==, 0);
+
+  /* And remove it again */
+  gtk_text_buffer_get_iter_at_line (buffer, &begin, 3);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 4);
+  gtk_text_buffer_delete (buffer, &begin, &iter);
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  g_assert_cmpint (ide_scan_cache_get_context (cache, &iter, NULL), ==, IDE_SCAN_CONTEXT_CODE);
+}
+
+static void
+test_brackets (void)
+{
+  g_autoptr(GtkTextBuffer) buffer = create_buffer (sample);
+  IdeScanCache *cache;
+  GtkTextIter iter;
+
+  cache = ide_scan_cache_get_for_buffer (buffer);
+  g_assert (cache != NULL);
+
+  /* From the start of line 2, the "(" in the comment is ignored */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 2);
+  g_assert (ide_scan_cache_backward_find_unmatched (cache, &iter, '(', 1));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 1);
+  g_assert_cmpint (gtk_text_iter_get_line_offset (&iter), ==, 5);
+
+  /* From within the if block, find both enclosing braces */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  g_assert (ide_scan_cache_backward_find_unmatched (cache, &iter, '{', 1));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 4);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  g_assert (ide_scan_cache_backward_find_unmatched (cache, &iter, '{', 2));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 3);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  g_assert (ide_scan_cache_forward_find_unmatched (cache, &iter, '}', 1));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 6);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  g_assert (ide_scan_cache_forward_find_unmatched (cache, &iter, '}', 2));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 7);
+
+  /* Nothing encloses the start of the buffer */
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  g_assert (!ide_scan_cache_backward_find_unmatched (cache, &iter, 0, 1));
+
+  /* Add a new block and make sure the outer brace still matches */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 7);
+  gtk_text_buffer_insert (buffer, &iter, "  {\n  }\n", -1);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 5);
+  g_assert (ide_scan_cache_forward_find_unmatched (cache, &iter, '}', 2));
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 9);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/ScanCache/context", test_context);
+  g_test_add_func ("/Ide/ScanCache/brackets", test_brackets);
+  return g_test_run ();
+}
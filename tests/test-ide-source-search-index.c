@@ -0,0 +1,72 @@
+/* test-ide-source-search-index.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+#include <gtksourceview/gtksource.h>
+
+#include "ide-source-search-index.h"
+
+static void
+wait_for_count (IdeSourceSearchIndex *index)
+{
+  while (g_main_context_iteration (NULL, FALSE)) { }
+  while (ide_source_search_index_get_occurrences_count (index) < 0)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_invalid_regex (void)
+{
+  g_autoptr(GtkTextBuffer) buffer = NULL;
+  g_autoptr(GtkSourceSearchSettings) settings = NULL;
+  g_autoptr(IdeSourceSearchIndex) index = NULL;
+  GtkTextIter iter;
+
+  buffer = GTK_TEXT_BUFFER (gtk_source_buffer_new (NULL));
+  gtk_text_buffer_set_text (buffer, "foo (bar);\n", -1);
+
+  settings = gtk_source_search_settings_new ();
+  gtk_source_search_settings_set_regex_enabled (settings, TRUE);
+
+  index = ide_source_search_index_new (buffer, settings);
+
+  /* An unterminated group while the user is still typing */
+  gtk_source_search_settings_set_search_text (settings, "foo(");
+  wait_for_count (index);
+  g_assert_cmpint (ide_source_search_index_get_occurrences_count (index), ==, 0);
+
+  /* Editing must not rescan with the pattern as a literal string */
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  gtk_text_buffer_insert (buffer, &iter, "foo(\nfoo(\n", -1);
+  wait_for_count (index);
+  g_assert_cmpint (ide_source_search_index_get_occurrences_count (index), ==, 0);
+
+  /* Completing the pattern restarts the scan */
+  gtk_source_search_settings_set_search_text (settings, "foo\\(");
+  wait_for_count (index);
+  g_assert_cmpint (ide_source_search_index_get_occurrences_count (index), ==, 2);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/SourceSearchIndex/invalid_regex", test_invalid_regex);
+  return g_test_run ();
+}
@@ -0,0 +1,133 @@
+/* test-ide-word-completion-provider.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+
+#include "ide-application-tests.h"
+#include "ide-internal.h"
+
+/* Comfortably more than the provider will take from the project. */
+#define N_PROJECT_WORDS 60000
+
+static gboolean
+has_proposal (IdeWordCompletionProvider *provider,
+              const gchar               *prefix,
+              const gchar               *word)
+{
+  g_auto(GStrv) words = NULL;
+
+  words = _ide_word_completion_provider_complete (provider, prefix);
+
+  return g_strv_contains ((const gchar * const *)words, word);
+}
+
+static void
+new_context_cb (GObject      *object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(IdeContext) context = NULL;
+  g_autoptr(IdeWordCompletionProvider) provider = NULL;
+  g_autoptr(IdeBuffer) buffer = NULL;
+  g_autoptr(IdeFile) file = NULL;
+  g_autoptr(GTimer) timer = NULL;
+  IdeProject *project;
+  GtkTextIter iter;
+  GError *error = NULL;
+  guint i;
+
+  context = ide_context_new_finish (result, &error);
+  g_assert_no_error (error);
+  g_assert (IDE_IS_CONTEXT (context));
+
+  provider = ide_word_completion_provider_new (context);
+
+  /* Fill the index from the "project" well past its limit */
+  for (i = 0; i < N_PROJECT_WORDS; i++)
+    {
+      g_autofree gchar *word = g_strdup_printf ("project_word_%05u", i);
+
+      _ide_word_completion_provider_add_project_word (provider, word, 1);
+    }
+
+  g_assert (has_proposal (provider, "project_word_", "project_word_00000"));
+  g_assert (!has_proposal (provider, "project_word_5999", "project_word_59999"));
+
+  project = ide_context_get_project (context);
+  file = ide_project_get_file_for_path (project, "test.c");
+  buffer = g_object_new (IDE_TYPE_BUFFER,
+                         "context", context,
+                         "file", file,
+                         NULL);
+  gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), "opened_buffer_word\n", -1);
+
+  ide_word_completion_provider_register_buffer (provider, buffer);
+
+  /* The initial contents are scanned on a worker thread */
+  timer = g_timer_new ();
+  while (!has_proposal (provider, "opened_", "opened_buffer_word") &&
+         g_timer_elapsed (timer, NULL) < 10.0)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (has_proposal (provider, "opened_", "opened_buffer_word"));
+
+  /* Words typed afterwards are tracked from the edit itself */
+  gtk_text_buffer_get_end_iter (GTK_TEXT_BUFFER (buffer), &iter);
+  gtk_text_buffer_insert (GTK_TEXT_BUFFER (buffer), &iter, "freshly_typed_word", -1);
+  g_assert (has_proposal (provider, "freshly_", "freshly_typed_word"));
+
+  ide_word_completion_provider_unregister_buffer (provider, buffer);
+  g_assert (!has_proposal (provider, "freshly_", "freshly_typed_word"));
+
+  ide_word_completion_provider_cancel (provider);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+test_buffer_words_over_cap (GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+  g_autoptr(GFile) project_file = NULL;
+  GTask *task;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  project_file = g_file_new_for_path (TEST_DATA_DIR"/project1/configure.ac");
+  ide_context_new_async (project_file, NULL, new_context_cb, task);
+}
+
+gint
+main (gint argc,
+      gchar *argv[])
+{
+  IdeApplication *app;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  ide_log_init (TRUE, NULL);
+  ide_log_set_verbosity (4);
+
+  app = ide_application_new ();
+  ide_application_add_test (app, "/Ide/WordCompletionProvider/buffer_words_over_cap", test_buffer_words_over_cap, NULL);
+  ret = g_application_run (G_APPLICATION (app), argc, argv);
+  g_object_unref (app);
+
+  return ret;
+}
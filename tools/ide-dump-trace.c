@@ -0,0 +1,288 @@
+/* ide-dump-trace.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ide-trace-private.h"
+
+/*
+ * Dumps the tracing ring buffers of a running Builder process (built with
+ * --enable-tracing) in the Chrome trace event format, which can be loaded
+ * in chrome://tracing or other timeline viewers.
+ */
+
+#define TRACE_MEMORY_BARRIER __sync_synchronize()
+
+static void
+write_json_string (FILE        *stream,
+                   const gchar *str,
+                   gsize        max_len)
+{
+  gsize i;
+
+  fputc ('"', stream);
+
+  for (i = 0; i < max_len && str [i]; i++)
+    {
+      guchar ch = str [i];
+
+      if (ch == '"' || ch == '\\')
+        fprintf (stream, "\\%c", ch);
+      else if (ch < 0x20)
+        fprintf (stream, "\\u%04x", ch);
+      else
+        fputc (ch, stream);
+    }
+
+  fputc ('"', stream);
+}
+
+static gboolean
+int_parse_with_range (gint        *value,
+                      gint         lower,
+                      gint         upper,
+                      const gchar *str)
+{
+  gint64 v64;
+
+  g_assert (value);
+  g_assert (lower <= upper);
+
+  v64 = g_ascii_strtoll (str, NULL, 10);
+
+  if (((v64 == G_MININT64) || (v64 == G_MAXINT64)) && (errno == ERANGE))
+    return FALSE;
+
+  if ((v64 < lower) || (v64 > upper))
+    return FALSE;
+
+  *value = (gint)v64;
+
+  return TRUE;
+}
+
+/*
+ * Copies the valid records out of @ring while the owning thread may still
+ * be writing to it. Returns the number of records copied into @out.
+ */
+static guint
+copy_ring (const IdeTraceRingHeader *ring,
+           IdeTraceRecord           *out)
+{
+  const IdeTraceRecord *records;
+  gint64 head;
+  gint64 start;
+  gint64 valid_start;
+  gint64 i;
+
+  records = (const IdeTraceRecord *)(gconstpointer)((const guint8 *)ring + sizeof *ring);
+
+  head = ring->head;
+  TRACE_MEMORY_BARRIER;
+
+  start = MAX (0, head - IDE_TRACE_RING_SIZE);
+
+  for (i = start; i < head; i++)
+    out [i - start] = records [i % IDE_TRACE_RING_SIZE];
+
+  TRACE_MEMORY_BARRIER;
+
+  /* Anything the writer lapped while we were copying is garbage */
+  valid_start = MAX (start, ring->head - IDE_TRACE_RING_SIZE);
+
+  if (valid_start >= head)
+    return 0;
+
+  if (valid_start > start)
+    memmove (out, out + (valid_start - start), (head - valid_start) * sizeof *out);
+
+  return head - valid_start;
+}
+
+static void
+dump_ring (FILE                     *stream,
+           const IdeTraceHeader     *header,
+           const IdeTraceSite       *sites,
+           const IdeTraceRingHeader *ring,
+           IdeTraceRecord           *records,
+           gboolean                 *first)
+{
+  guint n_sites = header->n_sites;
+  guint depth = 0;
+  guint n_records;
+  gint tid;
+  guint i;
+
+  if (0 == (tid = ring->tid))
+    return;
+
+  n_records = copy_ring (ring, records);
+
+  if (n_records == 0)
+    return;
+
+  fprintf (stream, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+           *first ? "" : ",", header->pid, tid);
+  write_json_string (stream, ring->name, sizeof ring->name);
+  fprintf (stream, "}}");
+  *first = FALSE;
+
+  for (i = 0; i < n_records; i++)
+    {
+      const IdeTraceRecord *record = &records [i];
+      const IdeTraceSite *site;
+      const gchar *phase;
+
+      if (record->site == 0 || record->site > n_sites)
+        continue;
+
+      site = &sites [record->site - 1];
+
+      switch (record->type)
+        {
+        case IDE_TRACE_ENTRY:
+          phase = "B";
+          depth++;
+          break;
+
+        case IDE_TRACE_EXIT:
+          /* The matching entry may have been overwritten */
+          if (depth == 0)
+            continue;
+          phase = "E";
+          depth--;
+          break;
+
+        case IDE_TRACE_GOTO:
+        case IDE_TRACE_PROBE:
+        default:
+          phase = "i";
+          break;
+        }
+
+      fprintf (stream, ",\n{\"name\":");
+      write_json_string (stream, site->func, sizeof site->func);
+      fprintf (stream, ",\"cat\":");
+      write_json_string (stream, site->domain[0] ? site->domain : "default", sizeof site->domain);
+      fprintf (stream, ",\"ph\":\"%s\",\"ts\":%"G_GINT64_FORMAT",\"pid\":%d,\"tid\":%d",
+               phase, record->time, header->pid, tid);
+      if (*phase == 'i')
+        fprintf (stream, ",\"s\":\"t\"");
+      fprintf (stream, ",\"args\":{\"line\":%u", site->line);
+      if (site->detail[0])
+        {
+          fprintf (stream, ",\"label\":");
+          write_json_string (stream, site->detail, sizeof site->detail);
+        }
+      fprintf (stream, "}}");
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  const IdeTraceHeader *header;
+  const IdeTraceSite *sites;
+  const guint8 *rings;
+  IdeTraceHeader hdr;
+  IdeTraceRecord *records;
+  gboolean first = TRUE;
+  gpointer mem;
+  FILE *stream = stdout;
+  gchar name [32];
+  gint pid;
+  gint fd;
+  guint i;
+
+  if (argc < 2 || argc > 3 || !int_parse_with_range (&pid, 1, G_MAXINT, argv [1]))
+    {
+      fprintf (stderr, "usage: %s <pid> [trace.json]\n", argv [0]);
+      return EXIT_FAILURE;
+    }
+
+  g_snprintf (name, sizeof name, IDE_TRACE_NAME_FORMAT, (guint)pid);
+
+  if (-1 == (fd = shm_open (name, O_RDONLY, 0)))
+    {
+      fprintf (stderr, "Failed to access trace buffers for process %d. "
+                       "Was it built with --enable-tracing?\n", pid);
+      return EXIT_FAILURE;
+    }
+
+  if ((pread (fd, &hdr, sizeof hdr, 0) != sizeof hdr) ||
+      (hdr.magic != IDE_TRACE_MAGIC) ||
+      (hdr.size != IDE_TRACE_SHM_SIZE) ||
+      (hdr.ring_size != IDE_TRACE_RING_SIZE) ||
+      (hdr.max_rings != IDE_TRACE_MAX_RINGS) ||
+      (hdr.max_sites != IDE_TRACE_MAX_SITES))
+    {
+      fprintf (stderr, "Trace buffers for process %d are in an unknown format.\n", pid);
+      close (fd);
+      return EXIT_FAILURE;
+    }
+
+  mem = mmap (NULL, hdr.size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (mem == MAP_FAILED)
+    {
+      fprintf (stderr, "Failed to map trace buffers: %s\n", g_strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  if (argc == 3 && !(stream = fopen (argv [2], "w")))
+    {
+      fprintf (stderr, "Failed to open %s: %s\n", argv [2], g_strerror (errno));
+      return EXIT_FAILURE;
+    }
+
+  header = mem;
+  sites = (const IdeTraceSite *)(gconstpointer)((const guint8 *)mem + header->sites_offset);
+  rings = (const guint8 *)mem + header->rings_offset;
+  records = g_new (IdeTraceRecord, IDE_TRACE_RING_SIZE);
+
+  TRACE_MEMORY_BARRIER;
+
+  fprintf (stream, "{\"traceEvents\":[");
+
+  for (i = 0; i < header->max_rings; i++)
+    {
+      const IdeTraceRingHeader *ring;
+
+      ring = (const IdeTraceRingHeader *)(gconstpointer)(rings + (i * IDE_TRACE_RING_BYTES));
+      dump_ring (stream, header, sites, ring, records, &first);
+    }
+
+  fprintf (stream, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+  if (stream != stdout)
+    fclose (stream);
+
+  g_free (records);
+  munmap (mem, hdr.size);
+
+  return EXIT_SUCCESS;
+}
@@ -21,22 +21,120 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+typedef struct
+{
+  GHashTable *last_values;
+  GHashTable *last_buckets;
+  gdouble     elapsed;
+  guint       n_counters;
+} ListState;
+
+static gboolean watch;
+static gint interval = 1;
+
+static GOptionEntry entries[] = {
+  { "watch", 'w', 0, G_OPTION_ARG_NONE, &watch,
+    "Refresh the counters periodically and show rates" },
+  { "interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+    "Seconds between refreshes with --watch", "SECONDS" },
+  { NULL }
+};
 
 static void
 foreach_cb (EggCounter *counter,
             gpointer    user_data)
 {
-  guint *n_counters = user_data;
+  ListState *state = user_data;
+  gint64 value;
+
+  state->n_counters++;
+
+  value = egg_counter_get (counter);
+
+  if (state->last_values != NULL)
+    {
+      gpointer last = NULL;
+      gdouble rate = 0.0;
 
-  (*n_counters)++;
+      if (g_hash_table_lookup_extended (state->last_values, counter, NULL, &last) &&
+          state->elapsed > 0.0)
+        rate = (value - *(gint64 *)last) / state->elapsed;
+
+      g_hash_table_insert (state->last_values, counter, g_memdup (&value, sizeof value));
+
+      g_print ("%-20s : %-32s : %20"G_GINT64_FORMAT" : %12.1lf : %-s\n",
+               counter->category,
+               counter->name,
+               value,
+               rate,
+               counter->description);
+      return;
+    }
 
   g_print ("%-20s : %-32s : %20"G_GINT64_FORMAT" : %-s\n",
            counter->category,
            counter->name,
-           egg_counter_get (counter),
+           value,
            counter->description);
 }
 
+static void
+histogram_foreach_cb (EggHistogram *histogram,
+                      gpointer      user_data)
+{
+  ListState *state = user_data;
+  EggCounter *counter = &histogram->counter;
+  gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  gint64 count;
+  gint64 sum;
+  gdouble rate = 0.0;
+
+  state->n_counters++;
+
+  count = egg_histogram_get_buckets (histogram, buckets, &sum);
+
+  /*
+   * In watch mode, show the distribution of values recorded since the
+   * last refresh rather than since the process started.
+   */
+  if (state->last_buckets != NULL)
+    {
+      gint64 *last;
+      gint64 *copy;
+      guint i;
+
+      copy = g_memdup (buckets, sizeof buckets);
+
+      if ((last = g_hash_table_lookup (state->last_buckets, histogram)))
+        {
+          gint64 delta = 0;
+
+          for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+            {
+              buckets [i] -= last [i];
+              delta += buckets [i];
+            }
+
+          if (state->elapsed > 0.0)
+            rate = delta / state->elapsed;
+        }
+
+      g_hash_table_insert (state->last_buckets, histogram, copy);
+    }
+
+  g_print ("%-20s : %-32s : %12"G_GINT64_FORMAT" : %10.1lf : %10"G_GINT64_FORMAT" : %10"G_GINT64_FORMAT" : %10"G_GINT64_FORMAT" : %10"G_GINT64_FORMAT"\n",
+           counter->category,
+           counter->name,
+           count,
+           rate,
+           count ? sum / count : 0,
+           egg_histogram_get_percentile (buckets, 50.0),
+           egg_histogram_get_percentile (buckets, 90.0),
+           egg_histogram_get_percentile (buckets, 99.0));
+}
+
 static gboolean
 int_parse_with_range (gint        *value,
                       gint         lower,
@@ -61,23 +159,83 @@ int_parse_with_range (gint        *value,
   return TRUE;
 }
 
+static void
+print_counters (EggCounterArena *arena,
+                ListState       *state)
+{
+  state->n_counters = 0;
+
+  if (watch)
+    {
+      g_print ("%-20s : %-32s : %20s : %12s : %-72s\n",
+               "      Category",
+               "             Name", "Value", "Rate/sec", "Description");
+      g_print ("-------------------- : "
+               "-------------------------------- : "
+               "-------------------- : "
+               "------------ : "
+               "------------------------------------------------------------------------\n");
+    }
+  else
+    {
+      g_print ("%-20s : %-32s : %20s : %-72s\n",
+               "      Category",
+               "             Name", "Value", "Description");
+      g_print ("-------------------- : "
+               "-------------------------------- : "
+               "-------------------- : "
+               "------------------------------------------------------------------------\n");
+    }
+
+  egg_counter_arena_foreach (arena, foreach_cb, state);
+
+  g_print ("\n");
+  g_print ("%-20s : %-32s : %12s : %10s : %10s : %10s : %10s : %10s\n",
+           "      Category",
+           "             Name", "Count", "Rate/sec", "Mean", "p50", "p90", "p99");
+  g_print ("-------------------- : "
+           "-------------------------------- : "
+           "------------ : "
+           "---------- : "
+           "---------- : "
+           "---------- : "
+           "---------- : "
+           "----------\n");
+
+  egg_counter_arena_foreach_histogram (arena, histogram_foreach_cb, state);
+
+  g_print ("\n");
+  g_print ("Discovered %u counters\n", state->n_counters);
+}
+
 gint
 main (gint   argc,
       gchar *argv[])
 {
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
   EggCounterArena *arena;
-  guint n_counters = 0;
+  ListState state = { 0 };
   gint pid;
 
-  if (argc != 2)
+  context = g_option_context_new ("<pid> - list performance counters of a process");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc != 2 || interval < 1)
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      fprintf (stderr, "usage: %s [--watch [--interval=SECONDS]] <pid>\n", argv [0]);
       return EXIT_FAILURE;
     }
 
   if (!int_parse_with_range (&pid, 1, G_MAXUSHORT, argv [1]))
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      fprintf (stderr, "usage: %s [--watch [--interval=SECONDS]] <pid>\n", argv [0]);
       return EXIT_FAILURE;
     }
 
@@ -89,19 +247,25 @@ main (gint   argc,
       return EXIT_FAILURE;
     }
 
-  g_print ("%-20s : %-32s : %20s : %-72s\n",
-           "      Category",
-           "             Name", "Value", "Description");
-  g_print ("-------------------- : "
-           "-------------------------------- : "
-           "-------------------- : "
-           "------------------------------------------------------------------------\n");
-  egg_counter_arena_foreach (arena, foreach_cb, &n_counters);
-  g_print ("-------------------- : "
-           "-------------------------------- : "
-           "-------------------- : "
-           "------------------------------------------------------------------------\n");
-  g_print ("Discovered %u counters\n", n_counters);
+  if (!watch)
+    {
+      print_counters (arena, &state);
+      egg_counter_arena_unref (arena);
+      return EXIT_SUCCESS;
+    }
+
+  state.last_values = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  state.last_buckets = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  for (;;)
+    {
+      /* Clear the terminal and move to the top */
+      g_print ("\033[H\033[2J");
+      print_counters (arena, &state);
+
+      sleep (interval);
+      state.elapsed = interval;
+    }
 
   return EXIT_SUCCESS;
 }
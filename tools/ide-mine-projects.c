@@ -22,6 +22,19 @@
 #include "gb-plugins.h"
 
 static GMainLoop *main_loop;
+static gint64     begin_time;
+static gint64     first_result_time;
+
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  gpointer    user_data)
+{
+  if (added > 0 && first_result_time == 0)
+    first_result_time = g_get_monotonic_time ();
+}
 
 static void
 discover_cb (GObject      *object,
@@ -30,6 +43,7 @@ discover_cb (GObject      *object,
 {
   IdeRecentProjects *projects = (IdeRecentProjects *)object;
   GError *error = NULL;
+  gint64 end_time;
   guint count;
   guint i;
 
@@ -41,6 +55,8 @@ discover_cb (GObject      *object,
       return;
     }
 
+  end_time = g_get_monotonic_time ();
+
   count = g_list_model_get_n_items (G_LIST_MODEL (projects));
 
   for (i = 0; i < count; i++)
@@ -59,6 +75,13 @@ discover_cb (GObject      *object,
       g_free (path);
     }
 
+  g_printerr ("\n");
+  g_printerr ("Discovered %u projects in %.3lf seconds\n",
+              count, (end_time - begin_time) / (gdouble)G_USEC_PER_SEC);
+  if (first_result_time != 0)
+    g_printerr ("First project available after %.3lf seconds\n",
+                (first_result_time - begin_time) / (gdouble)G_USEC_PER_SEC);
+
   g_main_loop_quit (main_loop);
 }
 
@@ -98,6 +121,9 @@ main (int    argc,
   gb_plugins_init (NULL);
 
   projects = ide_recent_projects_new ();
+  g_signal_connect (projects, "items-changed", G_CALLBACK (items_changed_cb), NULL);
+
+  begin_time = g_get_monotonic_time ();
   ide_recent_projects_discover_async (projects, NULL, discover_cb, NULL);
 
   g_main_loop_run (main_loop);